@@ -0,0 +1,390 @@
+/*******************************************************************
+ @brief Host benchmark of the pitch engines on simulated ADC frames
+ @file bench_engines.cpp
+ @author Juergen Boehm
+ @date 2025, May 3
+ @note Build on Linux from the repository root:
+    g++ -O3 -march=native -pthread -I lib/ADC_Lib -I lib/MultiStream -I lib/Corpus host/bench_engines.cpp
+        lib/ADC_Lib/ADC_DataAnalysis.cpp lib/ADC_Lib/ADC_Sim.cpp lib/ADC_Lib/ADC_Spectral.cpp lib/ADC_Lib/ADC_Poly.cpp
+        lib/MultiStream/MultiStream.cpp lib/Corpus/Corpus.cpp -o bench_engines
+    Add -DSPECTRALFLOAT for the float path of the spectral engine.
+    Add -DPROFILING -I lib/Profiling lib/Profiling/Profiling.cpp for a report with p50/p99 per engine.
+ @note Usage: bench_engines [-w corpus] [-c corpus] [frames per note]
+    -w  writes the simulated frames to a corpus file (lib/Corpus) with their note as f_refFreq
+    -c  replays a corpus file (e.g. of tlm_decode -c) instead of the engine tables:
+        decoding speed (GB/s of samples), then edge counting on its frames,
+        cent error against f_refFreq where known.
+    Reports cycles (TSC on x86, else ns) per frame and mean absolute cent error
+    of each engine for sine frames from ADC_Sim with noise. "edge packed" includes pack12.
+    Then strum tuning (calcFreqPoly) on guitar chords from ADC_SimMix with strings 
+    detuned by up to +-30 cent: frames/s, strings found and mean absolute cent error.
+    Last the multi stream engine (msAnalyse) on BENCH_STREAMS streams with 1, 2, 4 ... threads
+    up to the number of cores: throughput in streams x samples/s against calcFreqAnalog per stream.
+
+ Copyright (C) <2025>  <Juergen Boehm>
+********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#if defined __x86_64__ || defined __i386__
+#include <x86intrin.h>    // __rdtsc
+#endif
+
+#include "ADC_DataAnalysis.h"
+#include "ADC_Sim.h"
+#include "ADC_Spectral.h"
+#include "ADC_Poly.h"
+#include "MultiStream.h"
+#include "Corpus.h"
+#include <thread>
+#ifdef PROFILING
+#include "Profiling.h"
+#endif
+
+#define BENCH_SFREQ (30000)
+#define BENCH_LEN (2000)
+#define BENCH_NOISE (300)
+#define BENCH_FRAMES (50)
+// strum tuning: detuning of strings up to +-BENCH_POLYDETUNE cent
+#define BENCH_POLYDETUNE (30)
+// multi stream engine: number of streams and frames per stream
+#define BENCH_STREAMS (64)
+#define BENCH_MSFRAMES (20)
+
+// engine under test: analyses sAD->data, result in d_freqClassic. <0 for invalid frames
+typedef int (*engine_t)(struct sADCData *);
+
+static spec_t gSpecWork[SPECTRALWORKLEN];
+static uint8_t gPacked[PACKED12BYTES(BENCH_LEN)];
+
+static uint64_t ticks(void) {
+#if defined __x86_64__ || defined __i386__
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000ull + ts.tv_nsec;
+#endif
+}
+
+static double seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+#ifdef PROFILING
+static void printLine(const char *line) {
+    printf("%s\n", line);
+}
+#endif
+
+static int engineEdge(struct sADCData *sAD) {
+    peak_mean(sAD, &sAD->d_max, &sAD->d_min, &sAD->d_mean);
+    return calcFreqAnalog(sAD);
+}
+
+static int engineEdgeSparse(struct sADCData *sAD) {
+    if(peak_mean_sparse(sAD, &sAD->d_max, &sAD->d_min, &sAD->d_mean) < 0) return -1;
+    return calcFreqAnalog(sAD);
+}
+
+// packs the frame as at capture (PACKEDSAMPLES), then edge counting on packed data
+static int engineEdgePacked(struct sADCData *sAD) {
+    int retval;
+
+    pack12(sAD->data, sAD->d_len, gPacked, 0);
+    sAD->pdata = gPacked;
+    peak_mean(sAD, &sAD->d_max, &sAD->d_min, &sAD->d_mean);
+    retval = calcFreqAnalog(sAD);
+    sAD->pdata = NULL;
+    return retval;
+}
+
+static int engineSpectral(struct sADCData *sAD) {
+    peak_mean(sAD, &sAD->d_max, &sAD->d_min, &sAD->d_mean);
+    return calcFreqSpectral(sAD, gSpecWork);
+}
+
+static const struct {
+    const char *name;
+    engine_t engine;
+} gEngines[] = {
+    {"edge", engineEdge},
+    {"edge sparse", engineEdgeSparse},
+    {"edge packed", engineEdgePacked},
+#ifdef SPECTRALFLOAT
+    {"spectral float", engineSpectral},
+#else
+    {"spectral Q15", engineSpectral},
+#endif
+};
+#define NUMENGINES (sizeof(gEngines)/sizeof(gEngines[0]))
+
+/*
+ @brief Strum tuning of frames guitar chords, captures of BENCH_LEN samples as in freq_tune
+ @return 0, 1 for memory errors
+*/
+static int benchPoly(int frames) {
+    static const float guitar[] = {82.4069f, 110.0f, 146.832f, 195.998f, 246.942f, 329.628f};
+    static const char *const names[] = {"E", "A", "d", "g", "h", "e1"};
+    const int numStrings = sizeof(guitar)/sizeof(guitar[0]);
+    const uint32_t rawLen = POLYDECIM*POLYLEN;
+    struct sPolyTuning sPT;
+    struct sPolyData sPD = {0};
+    struct sADCData sAD = {0};
+    float freq[POLYMAXSTRINGS], detune[POLYMAXSTRINGS];
+    uint16_t *raw;
+    uint64_t t0, cycles = 0;
+    double s0, secs = 0.0, centErr = 0.0;
+    int found = 0, retval;
+
+    raw = (uint16_t *)malloc((rawLen + BENCH_LEN)*sizeof(uint16_t));
+    sPD.data = (uint16_t *)malloc(POLYLEN*sizeof(uint16_t));
+    if(!raw || !sPD.data) return 1;
+    polySetTuning(&sPT, guitar, names, numStrings);
+    sAD.data = raw;
+    sAD.d_len = rawLen + BENCH_LEN;
+    sAD.d_sFreq = BENCH_SFREQ;
+
+    for(int f = 0; f < frames; f++) {
+        for(int i = 0; i < numStrings; i++) {
+            detune[i] = (float)(rand()%(20*BENCH_POLYDETUNE + 1) - 10*BENCH_POLYDETUNE)/10.0f;
+            freq[i] = guitar[i]*powf(2.0f, detune[i]/1200.0f);
+        }
+        ADC_SimMix(&sAD, freq, numStrings, BENCH_NOISE);
+
+        s0 = seconds();
+        t0 = ticks();
+        polyReset(&sPD, BENCH_SFREQ);
+        for(uint32_t o = 0; polyAccumulate(&sPD, raw + o, BENCH_LEN) == 0; o += BENCH_LEN) ;
+        retval = calcFreqPoly(&sPD, &sPT, gSpecWork);
+        cycles += ticks() - t0;
+        secs += seconds() - s0;
+        if(retval < 0) continue;
+        for(int i = 0; i < numStrings; i++)
+            if(sPD.p_found & (1 << i)) {
+                found++;
+                centErr += fabs(sPD.p_cent[i] - detune[i]);
+            }
+    }
+
+    printf("\nstrum tuning: %d guitar chords of %u samples (%u captures), detune +-%d cent\n", 
+        frames, rawLen, (rawLen + BENCH_LEN - 1)/BENCH_LEN, BENCH_POLYDETUNE);
+    printf("%12s %10s %10s %10s %10s\n", "ticks/frame", "us/frame", "frames/s", "found", "|cent|");
+    printf("%12.0f %10.1f %10.1f %5d/%-4d %10.2f\n", (double)cycles/frames, secs*1e6/frames,
+        secs > 0.0 ? frames/secs : 0.0, found, frames*numStrings, found ? centErr/found : 0.0);
+
+    free(sPD.data);
+    free(raw);
+    return 0;
+} /* benchPoly */
+
+/*
+ @brief Throughput of msAnalyse on BENCH_STREAMS streams of corpus frames with 1, 2, 4 ... threads
+ @return 0, 1 for errors
+*/
+static int benchMulti(const uint16_t *corpus, int numFrames) {
+    const uint16_t *frame[BENCH_STREAMS];
+    struct sMultiStream ms;
+    struct sADCData sAD = {0};
+    unsigned cores = std::thread::hardware_concurrency(), threads;
+    double s0, secs, single, rate;
+    int ok = 0;
+
+    if(msInit(&ms, BENCH_STREAMS, BENCH_SFREQ, NULL) < 0) return 1;
+    for(int i = 0; i < BENCH_STREAMS; i++)  frame[i] = corpus + (size_t)(i*7 % numFrames)*BENCH_LEN;
+
+    // reference: one calcFreqAnalog after the other
+    sAD.d_sFreq = BENCH_SFREQ;
+    sAD.d_deltaTime = 1.0f/BENCH_SFREQ;
+    s0 = seconds();
+    for(int f = 0; f < BENCH_MSFRAMES; f++)
+        for(int i = 0; i < BENCH_STREAMS; i++) {
+            sAD.data = (uint16_t *)frame[i];
+            sAD.d_len = BENCH_LEN;
+            engineEdge(&sAD);
+        }
+    single = (double)BENCH_MSFRAMES*BENCH_STREAMS*BENCH_LEN/(seconds() - s0);
+
+    printf("\nmulti stream: %d streams of %d samples, %d frames, %u cores, %d lanes\n",
+        BENCH_STREAMS, BENCH_LEN, BENCH_MSFRAMES, cores, MSLANES);
+    printf("%-16s %8s %14s %8s %8s\n", "engine", "threads", "Msamples/s", "speedup", "valid");
+    printf("%-16s %8d %14.1f %8.2f\n", "calcFreqAnalog", 1, single*1e-6, 1.0);
+    if(!cores)  cores = 1;
+    for(threads = 1; ; threads *= 2) {
+        if(threads > cores)  threads = cores;
+        if(msBegin(threads) < 0)  break;
+        msAnalyse(&ms, frame, BENCH_LEN);    // warm up
+        s0 = seconds();
+        for(int f = 0; f < BENCH_MSFRAMES; f++)  ok = msAnalyse(&ms, frame, BENCH_LEN);
+        secs = seconds() - s0;
+        rate = (double)BENCH_MSFRAMES*BENCH_STREAMS*BENCH_LEN/secs;
+        printf("%-16s %8u %14.1f %8.2f %5d/%-3d\n", "msAnalyse", threads, rate*1e-6, rate/single, ok, BENCH_STREAMS);
+        if(threads >= cores)  break;
+    }
+    msEnd();
+    msFree(&ms);
+    return 0;
+} /* benchMulti */
+
+/*
+ @brief Writes the simulated frames, numNotes*frames of BENCH_LEN, as corpus with their notes
+ @return 0, 1 for errors
+*/
+static int writeCorpus(const char *name, const uint16_t *corpus, const float *noteFreq, int numNotes, int frames) {
+    struct sCorpusWriter cw;
+    struct sCorpusFrame meta = {BENCH_LEN, 0, BENCH_SFREQ, 0, 0.0f};
+
+    if(corpusCreate(&cw, name, "ADC_Sim") < 0)  return 1;
+    for(int n = 0; n < numNotes; n++)
+        for(int f = 0; f < frames; f++) {
+            meta.f_refFreq = noteFreq[n];
+            meta.f_time = (uint64_t)(n*frames + f)*BENCH_LEN*1000000ull/BENCH_SFREQ;
+            if(corpusAppend(&cw, &meta, corpus + ((size_t)n*frames + f)*BENCH_LEN) < 0) {
+                corpusFinish(&cw);
+                return 1;
+            }
+        }
+    return corpusFinish(&cw) < 0;
+} /* writeCorpus */
+
+/*
+ @brief Replays a corpus file: decoding speed, then edge counting of each frame
+ @return 0, 1 for errors
+*/
+static int benchCorpus(const char *name) {
+    static uint16_t data[CORPUSMAXLEN];
+    struct sCorpusReader cr;
+    struct sCorpusFrame meta;
+    struct sADCData sAD = {0};
+    int32_t frames, len;
+    uint64_t samples = 0, sum = 0, t0, cycles = 0;
+    double s0, secs, centErr = 0.0;
+    int valid = 0, known = 0, retval;
+
+    if((frames = corpusOpen(&cr, name)) < 0) {
+        fprintf(stderr, "%s: no corpus (%d)\n", name, frames);
+        return 1;
+    }
+    // first pass maps the pages, second one is timed
+    for(int pass = 0; pass < 2; pass++) {
+        samples = 0;
+        s0 = seconds();
+        for(int32_t i = 0; i < frames; i++)
+            if((len = corpusRead(&cr, i, data, CORPUSMAXLEN)) > 0) {
+                samples += len;
+                sum += data[len - 1];
+            }
+    }
+    secs = seconds() - s0;
+    printf("corpus %s (%s): %d frames, %llu samples, %.2f bits/sample\n", name, cr.r_device, frames,
+        (unsigned long long)samples, samples ? cr.r_size*8.0/samples : 0.0);
+    printf("decode %.2f GB/s, %.1f Msamples/s (%llu)\n", secs > 0.0 ? samples*2e-9/secs : 0.0,
+        secs > 0.0 ? samples*1e-6/secs : 0.0, (unsigned long long)sum);
+
+    sAD.data = data;
+    for(int32_t i = 0; i < frames; i++) {
+        if(corpusFrame(&cr, i, &meta) < 0 || (len = corpusRead(&cr, i, data, CORPUSMAXLEN)) < 0)  continue;
+        sAD.d_len = len;
+        sAD.d_sFreq = meta.f_sFreq;
+        sAD.d_deltaTime = 1.0f/meta.f_sFreq;
+        t0 = ticks();
+        retval = engineEdge(&sAD);
+        cycles += ticks() - t0;
+        if(retval < 0 || !(sAD.d_freqClassic > 0.0f))  continue;
+        valid++;
+        if(meta.f_refFreq > 0.0f) {
+            known++;
+            centErr += fabs(1200.0*log2(sAD.d_freqClassic/meta.f_refFreq));
+        }
+    }
+    printf("%-16s %12s %8s %10s\n", "engine", "ticks/frame", "valid", "|cent|");
+    printf("%-16s %12.0f %5d/%-5d %9.2f\n", "edge", frames ? (double)cycles/frames : 0.0, valid, frames,
+        known ? centErr/known : 0.0);
+    corpusClose(&cr);
+    return 0;
+} /* benchCorpus */
+
+int main(int argc, char *argv[]) {
+    static const float noteFreq[] = {65.41f, 82.41f, 110.0f, 261.63f, 440.0f, 1046.5f, 2093.0f, 4186.0f};
+    const int numNotes = sizeof(noteFreq)/sizeof(noteFreq[0]);
+    const char *writeName = NULL;
+    uint16_t *corpus;
+    struct sADCData sAD = {0};
+    uint64_t t0, cycles;
+    double s0, secs, centErr;
+    int valid, retval, opt, frames;
+
+    while((opt = getopt(argc, argv, "w:c:")) != -1) {
+        switch(opt) {
+            case 'w': writeName = optarg; break;
+            case 'c': return benchCorpus(optarg);
+            default:
+                fprintf(stderr, "usage: %s [-w corpus] [-c corpus] [frames per note]\n", argv[0]);
+                return 1;
+        }
+    }
+    frames = (optind < argc) ? atoi(argv[optind]) : BENCH_FRAMES;
+    if(frames <= 0) frames = BENCH_FRAMES;
+    corpus = (uint16_t *)malloc((size_t)numNotes*frames*BENCH_LEN*sizeof(uint16_t));
+    if(!corpus) return 1;
+
+    // simulated frames, generated once for all engines
+    sAD.d_len = BENCH_LEN;
+    sAD.d_sFreq = BENCH_SFREQ;
+    sAD.d_deltaTime = 1.0f/BENCH_SFREQ;
+    srand(1);
+    for(int n = 0; n < numNotes; n++)
+        for(int f = 0; f < frames; f++) {
+            sAD.data = corpus + ((size_t)n*frames + f)*BENCH_LEN;
+            ADC_Sim(&sAD, 0, noteFreq[n], BENCH_NOISE);
+        }
+    if(writeName && writeCorpus(writeName, corpus, noteFreq, numNotes, frames)) {
+        perror(writeName);
+        return 1;
+    }
+
+    printf("%d frames of %d samples at %d Hz per note, noise %d\n", frames, BENCH_LEN, BENCH_SFREQ, BENCH_NOISE);
+#if defined __x86_64__ || defined __i386__
+    printf("%-16s %9s %12s %10s %8s %10s\n", "engine", "note[Hz]", "cycles/frame", "us/frame", "valid", "|cent|");
+#else
+    printf("%-16s %9s %12s %10s %8s %10s\n", "engine", "note[Hz]", "ns/frame", "us/frame", "valid", "|cent|");
+#endif
+    for(unsigned e = 0; e < NUMENGINES; e++) {
+        for(int n = 0; n < numNotes; n++) {
+            cycles = 0;  secs = 0.0;  centErr = 0.0;  valid = 0;
+            for(int f = 0; f < frames; f++) {
+                sAD.data = corpus + ((size_t)n*frames + f)*BENCH_LEN;
+                sAD.d_len = BENCH_LEN;
+                s0 = seconds();
+                t0 = ticks();
+                {
+#ifdef PROFILING
+                    sProfScope scope(profStage(gEngines[e].name));     // all notes of an engine
+#endif
+                    retval = gEngines[e].engine(&sAD);
+                }
+                cycles += ticks() - t0;
+                secs += seconds() - s0;
+                if(retval >= 0 && sAD.d_freqClassic > 0.0f) {
+                    valid++;
+                    centErr += fabs(1200.0*log2(sAD.d_freqClassic/noteFreq[n]));
+                }
+            }
+            printf("%-16s %9.2f %12.0f %10.2f %5d/%-3d %9.2f\n", gEngines[e].name, noteFreq[n],
+                (double)cycles/frames, secs*1e6/frames, valid, frames, valid ? centErr/valid : 0.0);
+        }
+    }
+
+#ifdef PROFILING
+    printf("\n");
+    profReport(printLine);
+#endif
+    if(benchMulti(corpus, numNotes*frames))  return 1;
+    free(corpus);
+    return benchPoly(frames);
+} /* main */
@@ -0,0 +1,119 @@
+/*******************************************************************
+ @brief Host check of the pitch contour (ADC_Contour) on signals with vibrato and drift
+ @file contour_check.cpp
+ @author Juergen Boehm
+ @date 2025, May 12
+ @note Build on Linux from the repository root:
+    g++ -O2 -DPITCHCONTOUR -I lib/ADC_Lib host/contour_check.cpp lib/ADC_Lib/ADC_DataAnalysis.cpp
+        lib/ADC_Lib/ADC_Contour.cpp -o contour_check
+ @note Usage: contour_check
+    Frequency modulated sine signals with noise, as a wind player's tone: vibrato of
+    CHECK_RATE Hz and CHECK_DEPTH cent, drifts of checkDrift cent/s. Frames of CHECK_LEN
+    samples are analysed one after the other (d_targetCent 0), the contour is evaluated
+    over the last CHECK_WINDOW seconds. Prints points per frame, the metrics found next to
+    the true drift and the cycles of calcFreqAnalog with and without contour.
+    A row fails if rate, depth or drift are off by more than CHECK_MAXRATE, CHECK_MAXDEPTH
+    resp. CHECK_MAXDRIFT.
+
+ Copyright (C) <2025>  <Juergen Boehm>
+********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#if defined __x86_64__ || defined __i386__
+#include <x86intrin.h>    // __rdtsc
+#endif
+
+#include "ADC_DataAnalysis.h"
+#include "ADC_Contour.h"
+
+#define CHECK_SFREQ (30000)
+#define CHECK_LEN (2000)
+#define CHECK_NOISE (300)
+#define CHECK_RATE (5.5f)       // [Hz]
+#define CHECK_DEPTH (25.0f)     // amplitude [cent]
+#define CHECK_WINDOW (1.0f)     // [s]
+#define CHECK_MAXRATE (0.2f)    // errors allowed [Hz]
+#define CHECK_MAXDEPTH (2.0f)   // [cent]
+#define CHECK_MAXDRIFT (2.0f)   // [cent/s]
+
+static const float checkDrift[] = {0.0f, -8.0f, 20.0f};     // [cent/s]
+
+static uint64_t ticks(void) {
+#if defined __x86_64__ || defined __i386__
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000ull + ts.tv_nsec;
+#endif
+}
+
+/*
+ @brief Next len samples of the modulated tone, phase and time kept by the caller
+*/
+static void fmTone(uint16_t *data, uint32_t len, float freq, float drift, double *phase, double *time) {
+    double f;
+
+    for(uint32_t i = 0; i < len; i++, *time += 1.0/CHECK_SFREQ) {
+        f = freq*pow(2.0, (drift*(*time) + CHECK_DEPTH*sin(2.0*M_PI*CHECK_RATE*(*time)))/1200.0);
+        *phase += 2.0*M_PI*f/CHECK_SFREQ;
+        data[i] = (uint16_t)(2000.0 + 1500.0*sin(*phase) + rand()%CHECK_NOISE - CHECK_NOISE/2);
+    }
+}
+
+int main(void) {
+    static const float noteFreq[] = {146.83f, 261.63f, 440.0f, 880.0f};
+    static uint16_t data[CHECK_LEN];
+    static struct sPitchContour contour;
+    struct sADCData sAD = {0};
+    struct sContourStats st;
+    uint32_t frames = (uint32_t)(CHECK_WINDOW*CHECK_SFREQ/CHECK_LEN) + 1, points;
+    uint64_t t0, cyclesOn, cyclesOff;
+    double phase, time;
+    int retval, fails = 0;
+    bool fail;
+
+    sAD.data = data;
+    sAD.d_sFreq = CHECK_SFREQ;
+    sAD.d_deltaTime = 1.0f/CHECK_SFREQ;
+    srand(1);
+    printf("vibrato %.1f Hz, depth %.1f cent, noise %d, %u frames of %d samples\n",
+        CHECK_RATE, CHECK_DEPTH, CHECK_NOISE, frames, CHECK_LEN);
+    printf("%9s %10s %8s %9s %9s %9s %9s %12s %12s\n", "note[Hz]", "true drift", "pts/fr", "rate[Hz]", "depth",
+        "drift", "mean", "cyc contour", "cyc without");
+    for(unsigned n = 0; n < sizeof(noteFreq)/sizeof(noteFreq[0]); n++)
+        for(unsigned d = 0; d < sizeof(checkDrift)/sizeof(checkDrift[0]); d++) {
+            contourSetRef(&contour, noteFreq[n]);
+            phase = time = 0.0;
+            cyclesOn = cyclesOff = 0;
+            for(uint32_t f = 0; f < frames; f++) {
+                contour.c_frameTime = (uint32_t)(time*1e6 + 0.5);
+                fmTone(data, CHECK_LEN, noteFreq[n], checkDrift[d], &phase, &time);
+                sAD.d_len = CHECK_LEN;
+                peak_mean(&sAD, &sAD.d_max, &sAD.d_min, &sAD.d_mean);
+                sAD.d_contour = NULL;
+                t0 = ticks();
+                calcFreqAnalog(&sAD);
+                cyclesOff += ticks() - t0;
+                sAD.d_contour = &contour;
+                t0 = ticks();
+                calcFreqAnalog(&sAD);
+                cyclesOn += ticks() - t0;
+            }
+            points = contour.c_count;
+            retval = contourStats(&contour, 0, &st);
+            fail = retval || fabsf(st.s_vibRate - CHECK_RATE) > CHECK_MAXRATE
+                || fabsf(st.s_vibDepth - CHECK_DEPTH) > CHECK_MAXDEPTH || fabsf(st.s_drift - checkDrift[d]) > CHECK_MAXDRIFT;
+            fails += fail;
+            // mean cent is the drift at the middle of the window
+            printf("%9.2f %10.1f %8.1f %9.2f %9.2f %9.2f %9.2f %12.0f %12.0f  %s%s\n", noteFreq[n], checkDrift[d],
+                (float)points/frames, st.s_vibRate, st.s_vibDepth, st.s_drift, st.s_meanCent, (double)cyclesOn/frames,
+                (double)cyclesOff/frames, fail ? "FAIL" : "ok", retval < 0 ? "  no contour" : (retval ? "  no vibrato" : ""));
+        }
+    printf("%d rows failed, bounds: rate %.1f Hz, depth %.1f cent, drift %.1f cent/s\n",
+        fails, CHECK_MAXRATE, CHECK_MAXDEPTH, CHECK_MAXDRIFT);
+    return fails ? 1 : 0;
+} /* main */
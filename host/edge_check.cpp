@@ -0,0 +1,101 @@
+/*******************************************************************
+ @brief Host check of dual edge timing (DUALEDGE): precision of d_periode and duty cycle
+ @file edge_check.cpp
+ @author Juergen Boehm
+ @date 2025, May 14
+ @note Build on Linux from the repository root, once with and once without -DDUALEDGE:
+    g++ -O2 -DDUALEDGE -I lib/ADC_Lib host/edge_check.cpp lib/ADC_Lib/ADC_DataAnalysis.cpp -o edge_check
+ @note Usage: edge_check
+    Per note CHECK_FRAMES frames of CHECK_LEN samples with random phase and noise: a sine and
+    pulses of duty cycle 0.3 and 0.7 (smooth edges). Prints the rms and median error of
+    1/d_periode [cent], the periodes per edge, the median of d_duty and the fraction
+    of frames found asymmetric (ADC_DutyAsymmetric). Then the samples needed for
+    d_targetCent CHECK_TARGET: DUALEDGE converges with fewer periodes.
+
+ Copyright (C) <2025>  <Juergen Boehm>
+********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "ADC_DataAnalysis.h"
+
+#define CHECK_SFREQ (30000)
+#define CHECK_LEN (2000)
+#define CHECK_NOISE (300)
+#define CHECK_FRAMES (400)
+#define CHECK_TARGET (1.0f)     // [cent]
+
+static int cmpFloat(const void *a, const void *b) {
+    float d = *(const float *)a - *(const float *)b;
+    return (d > 0.0f) - (d < 0.0f);
+}
+
+/*
+ @brief len samples of a sine (duty 0) or a pulse of duty cycle duty with smooth edges
+*/
+static void tone(uint16_t *data, uint32_t len, float freq, float duty, double phase) {
+    double v, c = cos(M_PI*duty);
+
+    for(uint32_t i = 0; i < len; i++, phase += 2.0*M_PI*freq/CHECK_SFREQ) {
+        v = (duty > 0.0f) ? tanh(4.0*(cos(phase) - c)) : cos(phase);     // high while |phase| < pi*duty
+        data[i] = (uint16_t)(2000.0 + 1500.0*v + rand()%CHECK_NOISE - CHECK_NOISE/2);
+    }
+}
+
+int main(void) {
+    static const float noteFreq[] = {82.41f, 146.83f, 261.63f, 440.0f, 880.0f};
+    static const float duties[] = {0.0f, 0.3f, 0.7f};
+    static uint16_t data[CHECK_LEN];
+    static float err[CHECK_FRAMES], duty[CHECK_FRAMES];
+    struct sADCData sAD = {0};
+    double rms, used, nR, nF;
+    uint32_t asym, f;
+    float freq;
+
+    sAD.data = data;
+    sAD.d_sFreq = CHECK_SFREQ;
+    sAD.d_deltaTime = 1.0f/CHECK_SFREQ;
+    srand(1);
+#ifdef DUALEDGE
+    printf("DUALEDGE, ");
+#else
+    printf("rising edges only, ");
+#endif
+    printf("%d frames of %d samples at %d Hz, noise %d\n", CHECK_FRAMES, CHECK_LEN, CHECK_SFREQ, CHECK_NOISE);
+    printf("%9s %5s %9s %9s %7s %7s %7s %6s %11s\n", "note[Hz]", "duty", "rms[ct]", "med[ct]", "rising", "falling",
+        "d_duty", "asym", "used@1ct");
+    for(unsigned d = 0; d < sizeof(duties)/sizeof(duties[0]); d++) {
+        for(unsigned n = 0; n < sizeof(noteFreq)/sizeof(noteFreq[0]); n++) {
+            rms = used = nR = nF = 0.0;
+            asym = 0;
+            for(f = 0; f < CHECK_FRAMES; f++) {
+                freq = noteFreq[n]*(1.0f + 0.01f*((float)rand()/RAND_MAX - 0.5f));
+                tone(data, CHECK_LEN, freq, duties[d], 2.0*M_PI*rand()/RAND_MAX);
+                sAD.d_len = CHECK_LEN;
+                peak_mean(&sAD, &sAD.d_max, &sAD.d_min, &sAD.d_mean);
+                sAD.d_targetCent = 0.0f;
+                err[f] = 1e6f;
+                duty[f] = sAD.d_duty;
+                if(calcFreqAnalog(&sAD) < 0)  continue;
+                err[f] = 1200.0f*log2f(1.0f/(sAD.d_periode*freq));
+                rms += err[f]*err[f];
+                err[f] = fabsf(err[f]);
+                nR += sAD.d_numPeriodes;
+                nF += sAD.d_numFalling;
+                duty[f] = sAD.d_duty;
+                if(ADC_DutyAsymmetric(&sAD))  asym++;
+                sAD.d_targetCent = CHECK_TARGET;
+                calcFreqAnalog(&sAD);
+                used += sAD.d_usedLen;
+            }
+            qsort(err, CHECK_FRAMES, sizeof(float), cmpFloat);
+            qsort(duty, CHECK_FRAMES, sizeof(float), cmpFloat);
+            printf("%9.2f %5.2f %9.3f %9.3f %7.1f %7.1f %7.3f %6.2f %11.0f\n", noteFreq[n], duties[d],
+                sqrt(rms/CHECK_FRAMES), err[CHECK_FRAMES/2], nR/CHECK_FRAMES, nF/CHECK_FRAMES,
+                duty[CHECK_FRAMES/2], (float)asym/CHECK_FRAMES, used/CHECK_FRAMES);
+        }
+    }
+    return 0;
+} /* main */
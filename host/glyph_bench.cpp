@@ -0,0 +1,212 @@
+/*******************************************************************
+ @brief Host benchmark of note name rendering: drawString path against the glyph cache
+ @file glyph_bench.cpp
+ @author Juergen Boehm
+ @date 2025, May 10
+ @note Build on Linux from the repository root:
+    g++ -O2 -I lib/GlyphCache -I lib/Afrequencies host/glyph_bench.cpp lib/GlyphCache/GlyphCache.cpp
+        lib/Afrequencies/AFrequencies.cpp -o glyph_bench
+ @note Usage: glyph_bench [rounds]
+    Mock display: the 8 bit frame buffer of the barGraph sprite (280x120).
+    drawString path as TFT_eSPI does it for a sprite per update: String(cNote) on the heap,
+    text width for TC_DATUM, then the run length decoding of each glyph of a RLE font (font 4 style:
+    bit 7 set: run of foreground pixels, else background, length (b & 0x7F) + 1), one virtual
+    drawFastHLine per foreground run.
+    Glyph cache path: gcTextWidth and gcDraw8, glyphs rasterised once from the same RLE font.
+    The mock glyphs are generated shapes of font 4 size, not the TFT_eSPI font data.
+    Both paths draw all note names (deep C .. c6) and the frame buffers are compared.
+    The timing alternates both paths REPEATS times and gives the fastest and slowest run per label.
+    On the host both paths take about the same time per label, within the spread of the runs;
+    the measured saving is the heap allocations (String) per label.
+
+ Copyright (C) <2025>  <Juergen Boehm>
+********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "GlyphCache.h"
+#include "AFrequencies.h"
+
+#define FBW (280)       // BGWIDTH
+#define FBH (120)       // BGHEIGHT
+#define NOTEX (FBW/2)   // BGCENTER
+#define NOTEY (80)      // BGNOTEY
+#define FONT (4)
+#define FONTH (26)      // height of font 4
+#define YELLOW8 (0xFC)  // TFT_YELLOW as RGB332
+#define ROUNDS (2000)
+#define REPEATS (5)
+
+// RLE glyphs of the mock font
+struct sRleGlyph {
+    uint8_t r_w;
+    uint16_t r_len;
+    uint8_t r_data[FONTH*GCMAXW];
+};
+
+static struct sRleGlyph gFont[128];
+static uint8_t gFbRef[FBW*FBH], gFbCache[FBW*FBH];
+static uint32_t gAllocs = 0;
+
+static double seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+// generated shape of a character: an outline and a stroke depending on the code
+static bool shapePixel(char c, int w, int x, int y) {
+    int cx = w/2, cy = FONTH/2 + 2, dx = x - cx, dy = y - cy, r2 = dx*dx*4 + dy*dy;
+    int rr = (w/2 - 1)*(w/2 - 1)*4;
+
+    if(y < 6 || y > FONTH - 3)  return false;
+    if(r2 <= rr && r2 >= rr - 6*w)  return true;     // ring
+    if(((c*7 + y) % 11) == 0 && x > 1 && x < w - 1)  return true;   // stroke
+    return (c & 1) && x == 2 && y < cy;               // ascender
+}
+
+// RLE encoding of the generated shape, as in the fonts of TFT_eSPI
+static void makeGlyph(char c) {
+    struct sRleGlyph *g = &gFont[(uint8_t)c];
+    bool cur, px;
+    int run = 0, n = 0;
+
+    g->r_w = (c >= '0' && c <= '9') ? 14 : ((c == 'i') ? 6 : 12 + (c % 3));
+    cur = shapePixel(c, g->r_w, 0, 0);
+    for(int y = 0; y < FONTH; y++)
+        for(int x = 0; x < g->r_w; x++) {
+            px = shapePixel(c, g->r_w, x, y);
+            if(px == cur && run < 128) { run++; continue; }
+            g->r_data[n++] = (uint8_t)((cur ? 0x80 : 0) | (run - 1));
+            cur = px;
+            run = 1;
+        }
+    g->r_data[n++] = (uint8_t)((cur ? 0x80 : 0) | (run - 1));
+    g->r_len = n;
+}
+
+/*** drawString path of the mock display ***/
+
+// heap String of Arduino: one allocation per update
+struct sMockString {
+    char *s_buf;
+    explicit sMockString(const char *text) {
+        s_buf = (char *)malloc(strlen(text) + 1);
+        strcpy(s_buf, text);
+        gAllocs++;
+    }
+    ~sMockString() { free(s_buf); }
+};
+
+struct sMockSprite {
+    uint8_t *m_fb;
+    virtual void drawFastHLine(int x, int y, int w, uint8_t color) {
+        if(y < 0 || y >= FBH)  return;
+        if(x < 0) { w += x;  x = 0; }
+        if(x + w > FBW)  w = FBW - x;
+        if(w > 0)  memset(m_fb + y*FBW + x, color, w);
+    }
+    virtual ~sMockSprite() {}
+};
+
+static int refTextWidth(const char *text) {
+    int w = 0;
+    for(; *text; text++)  w += gFont[(uint8_t)*text].r_w;
+    return w;
+}
+
+static void refDrawString(sMockSprite *spr, const sMockString &str, int xc, int y, uint8_t color) {
+    int x = xc - refTextWidth(str.s_buf)/2, px, py, run;
+    const struct sRleGlyph *g;
+
+    for(const char *p = str.s_buf; *p; p++) {
+        g = &gFont[(uint8_t)*p];
+        px = 0;  py = 0;
+        for(int i = 0; i < g->r_len; i++) {
+            run = (g->r_data[i] & 0x7F) + 1;
+            while(run > 0) {
+                int n = (run < g->r_w - px) ? run : g->r_w - px;
+                if(g->r_data[i] & 0x80)  spr->drawFastHLine(x + px, y + py, n, color);
+                px += n;  run -= n;
+                if(px >= g->r_w) { px = 0;  py++; }
+            }
+        }
+        x += g->r_w;
+    }
+}
+
+/*** glyph cache: rasterised from the RLE font as initGlyphCache does with a 1 bit sprite ***/
+
+static int fillCache(struct sGlyphCache *gc, const char *chars) {
+    const struct sRleGlyph *g;
+    int idx, px, py, run;
+
+    gcInit(gc);
+    for(const char *c = chars; *c; c++) {
+        g = &gFont[(uint8_t)*c];
+        if((idx = gcAdd(gc, *c, FONT, g->r_w, FONTH)) < 0)  return idx;
+        px = 0;  py = 0;
+        for(int i = 0; i < g->r_len; i++)
+            for(run = (g->r_data[i] & 0x7F) + 1; run > 0; run--) {
+                if(g->r_data[i] & 0x80)  gcSetPixel(gc, idx, px, py);
+                if(++px >= g->r_w) { px = 0;  py++; }
+            }
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    static const char chars[] = "abcdefghis0123456";
+    static struct sGlyphCache gc;
+    char names[NOTECOUNT][5];
+    int rounds = (argc > 1) ? atoi(argv[1]) : ROUNDS, diff = 0;
+    sMockSprite spr;
+    double s0, t, tRef[2] = {1e30, 0.0}, tCache[2] = {1e30, 0.0};
+    uint32_t allocs;
+
+    if(rounds <= 0)  rounds = ROUNDS;
+    for(const char *c = chars; *c; c++)  makeGlyph(*c);
+    if(fillCache(&gc, chars) < 0)  { fprintf(stderr, "glyph cache full\n");  return 1; }
+    for(int n = 0; n < NOTECOUNT; n++)  tuningNoteName(n, names[n]);
+
+    // same pixels?
+    for(int n = 0; n < NOTECOUNT; n++) {
+        memset(gFbRef, 0, sizeof(gFbRef));
+        memset(gFbCache, 0, sizeof(gFbCache));
+        spr.m_fb = gFbRef;
+        refDrawString(&spr, sMockString(names[n]), NOTEX, NOTEY, YELLOW8);
+        gcDraw8(&gc, names[n], FONT, gFbCache, FBW, FBH, NOTEX - gcTextWidth(&gc, names[n], FONT)/2, NOTEY, YELLOW8);
+        if(memcmp(gFbRef, gFbCache, sizeof(gFbRef)))  diff++;
+    }
+
+    spr.m_fb = gFbRef;
+    for(int k = 0; k < REPEATS; k++) {
+        gAllocs = 0;
+        s0 = seconds();
+        for(int r = 0; r < rounds; r++)
+            for(int n = 0; n < NOTECOUNT; n++)
+                refDrawString(&spr, sMockString(names[n]), NOTEX, NOTEY, YELLOW8);
+        t = seconds() - s0;
+        if(t < tRef[0])  tRef[0] = t;
+        if(t > tRef[1])  tRef[1] = t;
+        allocs = gAllocs;
+
+        s0 = seconds();
+        for(int r = 0; r < rounds; r++)
+            for(int n = 0; n < NOTECOUNT; n++)
+                gcDraw8(&gc, names[n], FONT, gFbCache, FBW, FBH, NOTEX - gcTextWidth(&gc, names[n], FONT)/2, NOTEY, YELLOW8);
+        t = seconds() - s0;
+        if(t < tCache[0])  tCache[0] = t;
+        if(t > tCache[1])  tCache[1] = t;
+    }
+
+    printf("glyph cache: %u glyphs, %u bytes of bits, %zu bytes in all\n", gc.c_num, gc.c_used, sizeof(gc));
+    printf("%d note names x %d rounds, %d differing frames\n", NOTECOUNT, rounds, diff);
+    printf("%-12s %10s %10s %14s\n", "path", "min ns", "max ns", "heap allocs");
+    printf("%-12s %10.1f %10.1f %14u\n", "drawString", tRef[0]*1e9/rounds/NOTECOUNT, tRef[1]*1e9/rounds/NOTECOUNT, allocs);
+    printf("%-12s %10.1f %10.1f %14u\n", "glyph cache", tCache[0]*1e9/rounds/NOTECOUNT, tCache[1]*1e9/rounds/NOTECOUNT, 0u);
+    return diff ? 1 : 0;
+} /* main */
@@ -0,0 +1,104 @@
+/*******************************************************************
+ @brief Host check of the Goertzel refinement (refineFreqGoertzel) against the edge result, low notes included
+ @file goertzel_check.cpp
+ @author Juergen Boehm
+ @date 2025, May 17
+ @note Build on Linux from the repository root:
+    g++ -O2 -I lib/ADC_Lib host/goertzel_check.cpp lib/ADC_Lib/ADC_DataAnalysis.cpp
+        lib/ADC_Lib/ADC_Sim.cpp lib/ADC_Lib/ADC_Spectral.cpp -o goertzel_check
+ @note Usage: goertzel_check
+    Per note CHECK_FRAMES frames of CHECK_LEN samples detuned by up to +-40 cent against the note
+    given to refineFreqGoertzel: a sine and a tone with SIMMIXHARMONICS harmonics (ADC_SimMix),
+    each without and with noise. Prints the periodes in the frame, rms and max. error [cent]
+    of calcFreqAnalog and of the refined frequency, and the frames refined.
+    Notes with fewer than GOERTZELMINPERIODES are not refined, freq_tune keeps the edge result.
+    A refined note fails with an rms error above the edges' (+CHECK_RMSMARGIN) or a max. error
+    above both the edges' and CHECK_MAXCENT; octave errors of the edges are not counted.
+
+ Copyright (C) <2025>  <Juergen Boehm>
+********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "ADC_DataAnalysis.h"
+#include "ADC_Sim.h"
+#include "ADC_Spectral.h"
+
+#define CHECK_SFREQ (30000)
+#define CHECK_LEN (2000)
+#define CHECK_NOISE (300)
+#define CHECK_FRAMES (200)
+#define CHECK_DETUNE (40.0f)        // [cent]
+#define CHECK_MAXCENT (2.5)         // max. error of a refined note allowed anyway [cent]
+#define CHECK_RMSMARGIN (0.1)       // [cent]
+
+struct sErr {
+    double e_sum2, e_max;
+    uint32_t e_num;
+};
+
+static void addErr(struct sErr *e, double cent) {
+    e->e_sum2 += cent*cent;
+    if(fabs(cent) > e->e_max)  e->e_max = fabs(cent);
+    e->e_num++;
+}
+
+static double rmsErr(const struct sErr *e) {
+    return e->e_num ? sqrt(e->e_sum2/e->e_num) : 0.0;
+}
+
+int main(void) {
+    static const float noteFreq[] = {65.41f, 73.42f, 82.41f, 92.50f, 98.00f, 110.0f, 130.81f,
+        164.81f, 196.0f, 261.63f, 440.0f, 880.0f};
+    static const char *kind[] = {"sine", "harm"};
+    static uint16_t buf[CHECK_LEN];
+    struct sADCData sAD = {0};
+    struct sErr edge, gz;
+    float f, refined;
+    double cent;
+    uint32_t seed = 1;
+    int fails = 0, octaves;
+    bool fail;
+
+    sAD.data = buf;
+    sAD.d_sFreq = CHECK_SFREQ;
+    sAD.d_deltaTime = 1.0f/CHECK_SFREQ;
+
+    printf("%5s %5s %9s %3s %9s %9s %9s %9s %7s %4s\n", "tone", "noise", "note[Hz]", "P",
+        "edge rms", "edge max", "gz rms", "gz max", "refined", "");
+    for(int k = 0; k < 2; k++)
+        for(int noise = 0; noise <= CHECK_NOISE; noise += CHECK_NOISE)
+            for(unsigned n = 0; n < sizeof(noteFreq)/sizeof(noteFreq[0]); n++) {
+                edge = gz = (struct sErr){0};
+                octaves = 0;
+                for(int i = 0; i < CHECK_FRAMES; i++) {
+                    f = noteFreq[n]*powf(2.0f, CHECK_DETUNE*(2.0f*(rand_r(&seed)%1000)/999.0f - 1.0f)/1200.0f);
+                    sAD.d_len = CHECK_LEN;
+                    if(k == 0)  ADC_Sim_r(&sAD, 0, f, noise, &seed);
+                    else  ADC_SimMix_r(&sAD, &f, 1, noise, &seed);
+                    peak_mean(&sAD, &sAD.d_max, &sAD.d_min, &sAD.d_mean);
+                    if(calcFreqAnalog(&sAD) >= 0) {
+                        cent = 1200.0*log2(sAD.d_freqClassic/f);
+                        if(fabs(cent) < 600.0)  addErr(&edge, cent);
+                        else  octaves++;
+                    }
+                    if(refineFreqGoertzel(&sAD, noteFreq[n], &refined) >= 0)
+                        addErr(&gz, 1200.0*log2(refined/f));
+                }
+                fail = gz.e_num && (rmsErr(&gz) > rmsErr(&edge) + CHECK_RMSMARGIN
+                    || gz.e_max > fmax(edge.e_max, CHECK_MAXCENT));
+                fails += fail;
+                printf("%5s %5d %9.2f %3d %9.2f %9.2f", kind[k], noise, noteFreq[n],
+                    (int)(CHECK_LEN*noteFreq[n]/CHECK_SFREQ), rmsErr(&edge), edge.e_max);
+                if(gz.e_num)  printf(" %9.2f %9.2f %7u %4s", rmsErr(&gz), gz.e_max, gz.e_num, fail ? "FAIL" : "ok");
+                else  printf(" %9s %9s %7u %4s", "-", "-", 0, "edge");
+                if(octaves)  printf("  (%d octave errors of the edges)", octaves);
+                printf("\n");
+            }
+
+    printf("%d notes failed, bounds: rms not above the edges' + %.1f cent, max. not above the edges' or %.1f cent\n",
+        fails, CHECK_RMSMARGIN, CHECK_MAXCENT);
+    return fails ? 1 : 0;
+} /* main */
@@ -0,0 +1,235 @@
+/*******************************************************************
+ @brief Host benchmark of the barGraph sprite: 8 bit against 4 bit palette (PALETTESPRITE)
+ @file palette_bench.cpp
+ @author Juergen Boehm
+ @date 2025, May 13
+ @note Build on Linux from the repository root:
+    g++ -O2 -I lib/PalSprite -I lib/GlyphCache host/palette_bench.cpp lib/PalSprite/PalSprite.cpp
+        lib/GlyphCache/GlyphCache.cpp -o palette_bench
+ @note Usage: palette_bench [updates]
+    Mock display: the frame buffer of barGraph (280x120) and a byte counter of pushes.
+    The screen of initBarGraph and a sequence of updateBarGraph calls (a held note with
+    +-2 cent jitter, note changes, invalid frames) are drawn the same way by three backends:
+      8 bit       RGB332 sprite as now: fillRect as memset per row, gcDraw8, pushSprite of all
+      4 bit pixel colour depth 4 by TFT_eSPI alone: fillRect pixel by pixel, pushSprite of all
+      4 bit spans PalSprite: span fills, gcDraw4, push of the changed rows only
+    Prints sprite RAM, bytes read from the sprite and sent over SPI (2 per pixel) per update,
+    time per update and the frames whose pixels differ from the 8 bit sprite.
+    The mock glyphs are generated shapes of font 4 and 2 size, not the TFT_eSPI font data.
+
+ Copyright (C) <2025>  <Juergen Boehm>
+********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "PalSprite.h"
+#include "GlyphCache.h"
+
+// geometry of freq_tune.cpp initBarGraph
+#define BGHEIGHT (120)
+#define BGWIDTH  (280)
+#define BGBARW (202)
+#define BGBARW2 (101)
+#define BGCENTER (BGWIDTH/2)
+#define BGBARX  (BGCENTER - BGBARW2 +1)
+#define BGBARXE (BGCENTER + BGBARW2 -1)
+#define BGBARXRED (BGCENTER - 50)
+#define BGMARKH (10)
+#define BGBARY (26)
+#define BGBARH (40)
+#define BGNOTEY (BGBARY+BGBARH+BGMARKH+4)
+#define UPDATES (20000)
+
+enum eBackend {B8, B4PIXEL, B4SPAN, BACKENDS};
+static const char *backendName[BACKENDS] = {"8 bit", "4 bit pixel", "4 bit spans"};
+
+struct sMock {
+    enum eBackend m_type;
+    uint8_t m_fb8[BGWIDTH*BGHEIGHT];
+    uint8_t m_fb4[BGWIDTH*BGHEIGHT/2];
+    struct sPalSprite m_pal;
+    uint64_t m_read, m_spi;     // bytes read from the sprite and sent to the display
+};
+
+static struct sGlyphCache gGlyphs;
+static uint8_t gRgb332[PSCOLORS];   // palette as color16to8
+
+// generated glyph shapes: a ring and a stroke depending on the code
+static void makeGlyphs(const char *chars, uint8_t font, uint8_t h) {
+    int idx, w, cx, cy, dx, dy, r2, rr;
+
+    for(const char *c = chars; *c; c++) {
+        w = (font == 4) ? 12 + (*c % 3) : 7;
+        if((idx = gcAdd(&gGlyphs, *c, font, w, h)) < 0)  continue;
+        cx = w/2;  cy = h/2;  rr = (w/2 - 1)*(w/2 - 1)*4;
+        for(int y = 2; y < h - 2; y++)
+            for(int x = 0; x < w; x++) {
+                dx = x - cx;  dy = y - cy;  r2 = dx*dx*4 + dy*dy;
+                if((r2 <= rr && r2 >= rr - 6*w) || (((*c)*7 + y) % 11 == 0 && x > 1 && x < w - 1))
+                    gcSetPixel(&gGlyphs, idx, x, y);
+            }
+    }
+}
+
+/*** backends ***/
+
+static void mockFill(struct sMock *m, int16_t x, int16_t y, int16_t w, int16_t h, uint8_t idx) {
+    if(m->m_type == B4SPAN) { psFillRect(&m->m_pal, x, y, w, h, idx);  return; }
+    if(x < 0) { w += x;  x = 0; }
+    if(y < 0) { h += y;  y = 0; }
+    if(x + w > BGWIDTH)  w = BGWIDTH - x;
+    if(y + h > BGHEIGHT)  h = BGHEIGHT - y;
+    if(w <= 0 || h <= 0)  return;
+    for(int16_t r = y; r < y + h; r++) {
+        if(m->m_type == B8) { memset(m->m_fb8 + r*BGWIDTH + x, gRgb332[idx], w);  continue; }
+        for(int16_t c = x; c < x + w; c++) {    // drawPixel of a 4 bit sprite
+            uint8_t *p = m->m_fb4 + (r*BGWIDTH + c)/2;
+            *p = (c & 1) ? ((*p & 0xF0) | idx) : ((*p & 0x0F) | (idx << 4));
+        }
+    }
+}
+
+static void mockLabel(struct sMock *m, const char *text, uint8_t font, int16_t xc, int16_t y, uint8_t idx) {
+    int w = gcTextWidth(&gGlyphs, text, font);
+
+    if(m->m_type == B8)  gcDraw8(&gGlyphs, text, font, m->m_fb8, BGWIDTH, BGHEIGHT, xc - w/2, y, gRgb332[idx]);
+    else  gcDraw4(&gGlyphs, text, font, m->m_fb4, BGWIDTH, BGHEIGHT, xc - w/2, y, idx);
+    if(m->m_type == B4SPAN)  psMarkRows(&m->m_pal, y, (font == 4) ? 26 : 16);
+}
+
+static void mockPush(struct sMock *m) {
+    int16_t y, n;
+
+    if(m->m_type != B4SPAN) {
+        m->m_read += (m->m_type == B8) ? sizeof(m->m_fb8) : sizeof(m->m_fb4);
+        m->m_spi += 2*BGWIDTH*BGHEIGHT;
+        return;
+    }
+    if((n = psTakeRows(&m->m_pal, &y)) <= 0)  return;
+    m->m_read += n*BGWIDTH/2;
+    m->m_spi += 2*n*BGWIDTH;
+}
+
+/*** screens as in freq_tune.cpp ***/
+
+static void initBar(struct sMock *m) {
+    if(m->m_type == B4SPAN)  psInit(&m->m_pal, m->m_fb4, BGWIDTH, BGHEIGHT);
+    mockFill(m, 0, 0, BGWIDTH, BGHEIGHT, PSBLACK);
+    mockLabel(m, "-50", 2, BGBARX, 0, PSWHITE);
+    mockFill(m, BGBARX, 15, 1, BGMARKH, PSWHITE);
+    mockLabel(m, "-25", 2, BGCENTER-52, 0, PSWHITE);
+    mockFill(m, BGCENTER-50, 15, 1, BGMARKH, PSWHITE);
+    mockLabel(m, "-10", 2, BGCENTER-22, 0, PSWHITE);
+    mockFill(m, BGCENTER-20, 15, 1, BGMARKH, PSWHITE);
+    mockLabel(m, "0", 2, BGCENTER, 0, PSWHITE);
+    mockFill(m, BGCENTER, 15, 1, 2*BGMARKH+BGBARH, PSWHITE);
+    mockLabel(m, "10", 2, BGCENTER+20, 0, PSWHITE);
+    mockFill(m, BGCENTER+20, 15, 1, BGMARKH, PSWHITE);
+    mockLabel(m, "25", 2, BGCENTER+50, 0, PSWHITE);
+    mockFill(m, BGCENTER+50, 15, 1, BGMARKH, PSWHITE);
+    mockLabel(m, "50", 2, BGBARXE, 0, PSWHITE);
+    mockFill(m, BGBARXE, 15, 1, BGMARKH, PSWHITE);
+    mockFill(m, BGBARXRED, BGBARY, BGBARW2, BGBARH, PSRED);
+    mockPush(m);
+}
+
+static void updateBar(struct sMock *m, int16_t *bCent, bool *bValid, bool valid, bool bGreen, int16_t cent, const char *note) {
+    bool bReDrawEq = false;
+
+    if(valid) {
+        if(!*bValid) {
+            mockFill(m, BGBARXRED, BGBARY, BGBARW2, BGBARH, PSBLACK);
+            *bValid = true;
+            bReDrawEq = true;
+        }
+        if(*bCent != cent || bReDrawEq) {
+            if(*bCent < 0)  mockFill(m, BGBARX, BGBARY, BGBARW2, BGBARH, PSBLACK);
+            else  mockFill(m, BGCENTER+1, BGBARY, BGBARW2, BGBARH, PSBLACK);
+            if(cent > 50)  cent = 51;
+            else if(cent < -50)  cent = -51;
+            *bCent = cent;
+            mockFill(m, BGCENTER-40, BGNOTEY, 80, 25, PSBLACK);
+            mockFill(m, BGCENTER, BGBARY, 1, BGBARH, PSWHITE);
+            if(cent > 0)  mockFill(m, BGCENTER+1, BGBARY, cent*2, BGBARH, bGreen ? PSGREEN : PSORANGE);
+            else if(cent < 0)  mockFill(m, BGCENTER+2*cent-1, BGBARY, -2*cent, BGBARH, bGreen ? PSGREEN : PSORANGE);
+            mockLabel(m, note, 4, BGCENTER, BGNOTEY, PSYELLOW);
+        }
+    }
+    else if(*bValid) {
+        *bValid = false;
+        mockFill(m, BGBARX, BGBARY, BGBARW, BGBARH, PSBLACK);
+        mockFill(m, BGBARXRED, BGBARY, BGBARW2, BGBARH, PSRED);
+        mockFill(m, BGCENTER-40, BGNOTEY, 80, 25, PSBLACK);
+    }
+    mockPush(m);
+}
+
+// 8 bit sprite and 4 bit buffer show the same colours?
+static bool samePixels(const struct sMock *m8, const struct sMock *m4) {
+    uint8_t b;
+
+    for(int i = 0; i < BGWIDTH*BGHEIGHT; i++) {
+        b = m4->m_fb4[i >> 1];
+        if(m8->m_fb8[i] != gRgb332[(i & 1) ? (b & 0x0F) : (b >> 4)])  return false;
+    }
+    return true;
+}
+
+static double seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+int main(int argc, char *argv[]) {
+    static const char *notes[] = {"e", "a", "d1", "g1", "h1", "e2", "fis3", "cis2"};
+    static struct sMock mock[BACKENDS];
+    int updates = (argc > 1) ? atoi(argv[1]) : UPDATES, diff[BACKENDS] = {0};
+    int16_t bCent[BACKENDS], cent, target = 0;
+    bool bValid[BACKENDS], valid, green;
+    const char *note = notes[0];
+    double t[BACKENDS] = {0}, s0;
+    uint16_t c;
+
+    if(updates <= 0)  updates = UPDATES;
+    for(int i = 0; i < PSCOLORS; i++) {     // RGB565 to RGB332 as color16to8
+        c = psPalette[i];
+        gRgb332[i] = (uint8_t)(((c & 0xE000) >> 8) | ((c & 0x0700) >> 6) | ((c & 0x0018) >> 3));
+    }
+    gcInit(&gGlyphs);
+    makeGlyphs("abcdefghis0123456", 4, 26);
+    makeGlyphs("-0125", 2, 16);
+
+    for(int b = 0; b < BACKENDS; b++) {
+        mock[b].m_type = (enum eBackend)b;
+        initBar(&mock[b]);
+        bCent[b] = 0;
+        bValid[b] = false;
+    }
+    srand(1);
+    for(int u = 0; u < updates; u++) {
+        if(u % 120 == 0) {      // next note, some cent off
+            note = notes[rand() % 8];
+            target = rand() % 81 - 40;
+        }
+        valid = (u % 120) >= 3 && rand() % 20;      // attack and dropouts
+        green = rand() % 8;
+        cent = target + rand() % 5 - 2;
+        for(int b = 0; b < BACKENDS; b++) {
+            s0 = seconds();
+            updateBar(&mock[b], &bCent[b], &bValid[b], valid, green, cent, note);
+            t[b] += seconds() - s0;
+            if(b != B8 && !samePixels(&mock[B8], &mock[b]))  diff[b]++;
+        }
+    }
+
+    printf("%d updates of barGraph %dx%d\n", updates, BGWIDTH, BGHEIGHT);
+    printf("%-12s %10s %14s %14s %10s %8s\n", "sprite", "RAM", "read/update", "SPI/update", "ns/update", "differ");
+    for(int b = 0; b < BACKENDS; b++)
+        printf("%-12s %10zu %14.0f %14.0f %10.1f %8d\n", backendName[b], b == B8 ? sizeof(mock[b].m_fb8) : sizeof(mock[b].m_fb4),
+            (double)mock[b].m_read/(updates + 1), (double)mock[b].m_spi/(updates + 1), t[b]*1e9/updates, diff[b]);
+    return 0;
+}
@@ -0,0 +1,464 @@
+/*******************************************************************
+ @brief Tuner of the analysis constants (sADCParams, SAMPLERATE, BUFF_SIZE, TARGETCENT)
+        per instrument profile over a simulated and/or recorded corpus
+ @file param_tuner.cpp
+ @author Juergen Boehm
+ @date 2025, May 9
+ @note Build on Linux from the repository root:
+    g++ -O3 -march=native -pthread -I lib/ADC_Lib -I lib/Corpus host/param_tuner.cpp lib/ADC_Lib/ADC_DataAnalysis.cpp
+        lib/ADC_Lib/ADC_Sim.cpp lib/Corpus/Corpus.cpp -o param_tuner
+ @note Usage: param_tuner [-p profile|all] [-n frames] [-b cent] [-v valid] [-w weight] [-j threads]
+                          [-r rawfile[:freq]] [-s seed] [-o dir]
+    -p  instrument profile (guitar, bass, violin, piano, flute) or all (default guitar)
+    -n  simulated frames per profile (default TUNEFRAMES)
+    -b  bound of the 95th percentile of |cent error| of green results (default TUNECENTBOUND)
+    -v  minimum fraction of green results (default TUNEMINVALID)
+    -w  weight of latency against CPU (default 1)
+    -j  worker threads (default: number of cores)
+    -r  raw frames of tlm_decode -r, all taken from a signal of freq Hz, or a corpus file
+        (tlm_decode -c, lib/Corpus): frames of freq Hz, without freq those with their f_refFreq.
+        Their sample rate is the only SAMPLERATE searched then, BUFF_SIZE at most their length.
+    -o  writes dir/tuned_<profile>.h instead of printing the header to stdout
+ @note Each analysis setting (sample rate, frame length, MAXADCDIFF, ANASPANDIV, MINTICDIFF,
+    MAXSIDECHANGES, TARGETCENT) runs peak_mean_sparse and calcFreqAnalog on all frames as
+    freq_tune does, timed in cycles (TSC on x86, else ns). The classification limits
+    (MINFREQQUALITY, MINFREQDIFF) are applied afterwards to the stored results, so they cost nothing.
+    Settings are spread over the threads, each thread uses its own analyser (ADC_AnalyserInit) on its stack.
+ @note Per green result (classifyResult==1):
+      CPU      all cycles of the corpus / green results
+      latency  time of all ADC reads / green results, a read being 1.5*d_usedLen of the frame
+               (MINREADLEN..BUFF_SIZE, see freq_tune), or all of BUFF_SIZE for invalid frames
+    Among the settings with p95 |cent| <= bound and green fraction >= valid the one with least
+      CPU/CPU(defaults) + weight*latency/latency(defaults)
+    is chosen. Cent errors are those of d_freqClassic without GOERTZELREFINE.
+    The best settings go to stderr, the header to stdout (or -o).
+    Include it at the top of main.h: SAMPLERATE, BUFF_SIZE and TARGETCENT replace the defaults
+    and freq_tune sets TUNEDPARAMS as gsAD.d_params.
+
+ Copyright (C) <2025>  <Juergen Boehm>
+********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#if defined __x86_64__ || defined __i386__
+#include <x86intrin.h>    // __rdtsc
+#endif
+
+#include "ADC_DataAnalysis.h"
+#include "ADC_Sim.h"
+#include "Corpus.h"
+
+#define TUNEFRAMES (200)
+#define TUNECENTBOUND (5.0f)
+#define TUNEMINVALID (0.7f)
+// wrong note: green result further off than this [cent]. At most TUNEMAXWRONG of the green ones
+#define TUNEWRONGCENT (50.0f)
+#define TUNEMAXWRONG (0.01f)
+// random detuning of simulated notes +-TUNEDETUNE cent
+#define TUNEDETUNE (40)
+#define TUNEMAXRAW (2000)
+
+// grid of the search, the defaults of freq_tune and ADC_DataAnalysis.h are part of it
+static const uint32_t gSFreqs[] = {20000, 30000, 44100};
+static const uint32_t gLens[] = {1000, 1500, 2000, 3000, 4000};
+static const uint16_t gMaxAdcDiffs[] = {4, 8, 16};
+static const uint16_t gSpanDivs[] = {2, 3, 4, 6};
+static const uint16_t gMinTicDiffs[] = {2, 4, 6};
+static const uint16_t gMaxSideChanges[] = {50, 100, 200};
+static const float gTargetCents[] = {0.0f, 0.5f, 1.0f, 2.0f};
+static const float gFreqQualities[] = {0.05f, 0.1f, 0.15f, 0.25f};
+static const float gFreqDiffs[] = {0.02f, 0.05f, 0.1f, 0.2f};
+#define NUMOF(a) (sizeof(a)/sizeof(a[0]))
+// defaults of main.h
+#define DEFSFREQ (30000)
+#define DEFLEN (2000)
+#define DEFTARGETCENT (1.0f)
+
+struct sProfile {
+    const char *p_name;
+    float p_low, p_high;    // range of fundamentals [Hz]
+    uint16_t p_noise;       // ADC_Sim noise
+    bool p_mix;             // string with harmonics (ADC_SimMix), else sine (ADC_Sim)
+};
+
+static const struct sProfile gProfiles[] = {
+    {"guitar", 82.41f, 659.26f, 300, true},
+    {"bass", 41.20f, 261.63f, 200, true},
+    {"violin", 196.0f, 2637.0f, 300, true},
+    {"piano", 65.41f, 4186.0f, 200, true},
+    {"flute", 261.63f, 2093.0f, 400, false},
+};
+
+// frames of one sample rate
+struct sCorpus {
+    uint32_t c_sFreq;
+    uint32_t c_len;             // samples per frame
+    std::vector<uint16_t> c_data;
+    std::vector<float> c_freq;  // true frequency of each frame
+};
+
+// one analysis setting and its results for all classification limits
+struct sSetting {
+    const struct sCorpus *s_corpus;
+    uint32_t s_len;
+    struct sADCParams s_par;    // a_freqQuality, a_freqDiff of the best classification
+    float s_targetCent;
+    // results
+    bool s_ok;              // within bounds
+    float s_cpu;            // cycles per green result
+    float s_latency;        // ms per green result
+    float s_p95;            // |cent| of green results
+    float s_valid;          // fraction of green results
+    float s_cost;
+};
+
+static uint64_t ticks(void) {
+#if defined __x86_64__ || defined __i386__
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000ull + ts.tv_nsec;
+#endif
+}
+
+/*
+ @brief Simulated frames of a profile, notes log uniform over its range plus detuning
+ @note Not thread safe (rand), called before the workers start
+*/
+static void simCorpus(struct sCorpus *co, const struct sProfile *pr, uint32_t frames) {
+    struct sADCData sAD = {0};
+    float f;
+
+    co->c_data.resize((size_t)frames*co->c_len);
+    co->c_freq.resize(frames);
+    sAD.d_len = co->c_len;
+    sAD.d_sFreq = co->c_sFreq;
+    for(uint32_t i = 0; i < frames; i++) {
+        f = pr->p_low*powf(pr->p_high/pr->p_low, (float)(rand()%1001)/1000.0f);
+        f *= powf(2.0f, (float)(rand()%(2*TUNEDETUNE + 1) - TUNEDETUNE)/1200.0f);
+        co->c_freq[i] = f;
+        sAD.data = &co->c_data[(size_t)i*co->c_len];
+        if(pr->p_mix) ADC_SimMix(&sAD, &f, 1, pr->p_noise);
+        else ADC_Sim(&sAD, 0, f, pr->p_noise);
+    }
+}
+
+// appends a recorded frame, frames are cut to the shortest one. Returns 1 if taken
+static int addFrame(struct sCorpus *co, const uint16_t *frame, uint32_t len, uint32_t sFreq, float freq) {
+    if(!(freq > 0.0f))  return 0;       // unknown signal
+    if(!co->c_sFreq)  co->c_sFreq = sFreq;
+    if(sFreq != co->c_sFreq)  return 0;
+    if(!co->c_len || len < co->c_len)  {
+        for(size_t f = 1; f < co->c_freq.size(); f++)
+            memmove(&co->c_data[f*len], &co->c_data[f*co->c_len], len*sizeof(uint16_t));
+        co->c_len = len;
+        co->c_data.resize(co->c_freq.size()*len);
+    }
+    co->c_data.insert(co->c_data.end(), frame, frame + co->c_len);
+    co->c_freq.push_back(freq);
+    return 1;
+}
+
+/*
+ @brief Appends recorded frames of a corpus file (lib/Corpus), freq 0: their f_refFreq
+ @return number of frames, <0 for errors, -3 no corpus file
+*/
+static int readCorpus(const char *name, float freq, struct sCorpus *co) {
+    struct sCorpusReader cr;
+    struct sCorpusFrame meta;
+    std::vector<uint16_t> frame(TUNEMAXRAW);
+    int32_t n, len;
+    int frames = 0;
+
+    if((n = corpusOpen(&cr, name)) < 0)  return n;
+    for(int32_t i = 0; i < n; i++) {
+        if(corpusFrame(&cr, i, &meta) < 0 || (len = corpusRead(&cr, i, frame.data(), TUNEMAXRAW)) < 0)  continue;
+        frames += addFrame(co, frame.data(), len, meta.f_sFreq, (freq > 0.0f) ? freq : meta.f_refFreq);
+    }
+    corpusClose(&cr);
+    return frames;
+}
+
+/*
+ @brief Appends recorded frames (lines seq,time_s,sFreq,len,samples... of tlm_decode -r)
+ @return number of frames, <0 for errors
+*/
+static int readRaw(const char *name, float freq, struct sCorpus *co) {
+    FILE *fp;
+    unsigned seq, sFreq, len, v, i;
+    double time;
+    int frames = 0;
+    std::vector<uint16_t> frame(TUNEMAXRAW);
+
+    if(!(fp = fopen(name, "r")))  return -1;
+    while(fscanf(fp, "%u,%lf,%u,%u", &seq, &time, &sFreq, &len) == 4) {
+        if(len > TUNEMAXRAW)  break;
+        for(i = 0; i < len && fscanf(fp, ",%u", &v) == 1; i++)  frame[i] = (uint16_t)v;
+        if(i < len)  break;
+        frames += addFrame(co, frame.data(), len, sFreq, freq);
+    }
+    fclose(fp);
+    return frames;
+}
+
+/*
+ @brief Runs the analysis of one setting over its corpus and picks the best of the classification limits
+ @param[in] quals, diffs: limits tried (MINFREQQUALITY, MINFREQDIFF)
+ @param[in] refCpu, refLatency: of the defaults for the cost, 0 while the defaults are evaluated
+*/
+static void evaluate(struct sSetting *st, const float *quals, uint32_t numQuals, const float *diffs, uint32_t numDiffs,
+    float centBound, float minValid, float weight, float refCpu, float refLatency) {
+    const struct sCorpus *co = st->s_corpus;
+    uint32_t frames = co->c_freq.size(), green, wrong, minRead = st->s_len/8, read, f, c, q, d;
+    alignas(void *) uint8_t arena[ADCANALYSERBYTES(MAXSIDECHANGES)];    // analyser of this thread
+    struct sADCAnalyser *an = ADC_AnalyserInit(arena, sizeof(arena), co->c_sFreq, &st->s_par);
+    const struct sADCData *sAD;
+    std::vector<float> cent(frames), quality(frames), diff(frames), errs;
+    std::vector<uint32_t> readLen(frames);
+    uint64_t cycles = 0, t0, samples;
+    int retval;
+    float cpu, latency, p95, cost;
+
+    st->s_ok = false;
+    st->s_cost = st->s_p95 = INFINITY;
+    if(!an)  return;
+    an->a_sAD.d_targetCent = st->s_targetCent;
+    sAD = &an->a_sAD;
+    for(f = 0; f < frames; f++) {
+        t0 = ticks();
+        retval = ADC_Analyse(an, &co->c_data[(size_t)f*co->c_len], st->s_len);
+        if(retval >= 0)  retval = classifyResult(sAD);     // cost of classification is part of a reading
+        cycles += ticks() - t0;
+        readLen[f] = st->s_len;
+        quality[f] = diff[f] = INFINITY;
+        if(retval < 0)  continue;
+        read = (sAD->d_usedLen + sAD->d_usedLen/2 + 1) & ~1UL;
+        readLen[f] = read < minRead ? minRead : (read > st->s_len ? st->s_len : read);
+        quality[f] = sAD->d_quality/sAD->d_periode;
+        diff[f] = fabsf(sAD->d_freqClassic - 1.0f/sAD->d_periode)/sAD->d_freqClassic;
+        cent[f] = fabsf(1200.0f*log2f(sAD->d_freqClassic/co->c_freq[f]));
+    }
+    for(samples = 0, f = 0; f < frames; f++)  samples += readLen[f];
+
+    for(c = 0; c < numQuals*numDiffs; c++) {
+        q = c/numDiffs;
+        d = c%numDiffs;
+        errs.clear();
+        wrong = 0;
+        for(f = 0; f < frames; f++) {
+            // same limits as classifyResult
+            if(quality[f] > quals[q] || diff[f] > diffs[d])  continue;
+            errs.push_back(cent[f]);
+            if(cent[f] > TUNEWRONGCENT)  wrong++;
+        }
+        green = errs.size();
+        if(!green)  continue;
+        std::sort(errs.begin(), errs.end());
+        p95 = errs[(green*95)/100 < green ? (green*95)/100 : green - 1];
+        cpu = (float)cycles/green;
+        latency = 1000.0f*samples/co->c_sFreq/green;
+        cost = refCpu > 0.0f ? cpu/refCpu + weight*latency/refLatency : 0.0f;
+        if(p95 > centBound || (float)green < minValid*frames || (float)wrong > TUNEMAXWRONG*green)  {
+            if(st->s_ok || p95 >= st->s_p95)  continue;   // out of bounds: remember the most accurate for the report only
+        }
+        else if(st->s_ok && cost >= st->s_cost)  continue;
+        else st->s_ok = true;
+        st->s_cost = cost;
+        st->s_cpu = cpu;
+        st->s_latency = latency;
+        st->s_p95 = p95;
+        st->s_valid = (float)green/frames;
+        st->s_par.a_freqQuality = quals[q];
+        st->s_par.a_freqDiff = diffs[d];
+    }
+}
+
+static void printSetting(const char *title, const struct sSetting *st) {
+    fprintf(stderr, "%-9s %6u %5u %4u %4u %4u %4u %5.1f %5.2f %5.2f | %9.0f %8.2f %6.2f %6.2f %6.3f%s\n",
+        title, st->s_corpus->c_sFreq, st->s_len, st->s_par.a_maxAdcDiff, st->s_par.a_spanDiv,
+        st->s_par.a_minTicDiff, st->s_par.a_maxSideChanges, st->s_targetCent, st->s_par.a_freqQuality,
+        st->s_par.a_freqDiff, st->s_cpu, st->s_latency, st->s_p95, st->s_valid, st->s_cost,
+        st->s_ok ? "" : "  out of bounds");
+}
+
+static void writeHeader(FILE *fp, const struct sProfile *pr, const struct sSetting *st, const struct sSetting *def,
+    uint32_t frames, float centBound, float minValid) {
+    char guard[32];
+    size_t i;
+
+    fprintf(fp, "/**************************\n");
+    fprintf(fp, " * tuned_%s.h: constants for %s (%.1f .. %.1f Hz), generated by host/param_tuner\n",
+        pr->p_name, pr->p_name, pr->p_low, pr->p_high);
+    fprintf(fp, " * corpus of %u frames, bounds: p95 |cent| <= %.1f, green >= %.0f%%\n", frames, centBound, 100.0f*minValid);
+    fprintf(fp, " * per green result  defaults: %.0f cycles, %.1f ms, p95 %.2f cent, green %.0f%%\n",
+        def->s_cpu, def->s_latency, def->s_p95, 100.0f*def->s_valid);
+    fprintf(fp, " *                   tuned:    %.0f cycles, %.1f ms, p95 %.2f cent, green %.0f%%\n",
+        st->s_cpu, st->s_latency, st->s_p95, 100.0f*st->s_valid);
+    fprintf(fp, "***************************/\n");
+    for(i = 0; pr->p_name[i] && i < sizeof(guard) - 1; i++)  guard[i] = toupper(pr->p_name[i]);
+    guard[i] = '\0';
+    fprintf(fp, "#ifndef TUNED_%s_H\n#define TUNED_%s_H\n\n", guard, guard);
+    fprintf(fp, "#define TUNEDPROFILE \"%s\"\n", pr->p_name);
+    fprintf(fp, "#define SAMPLERATE (%u)\n", st->s_corpus->c_sFreq);
+    fprintf(fp, "#define BUFF_SIZE (%u)\n", st->s_len);
+    fprintf(fp, "#define TARGETCENT (%.1ff)\n", st->s_targetCent);
+    fprintf(fp, "// struct sADCParams: MAXADCDIFF, ANASPANDIV, MINTICDIFF, MAXSIDECHANGES, MINFREQQUALITY, MINFREQDIFF\n");
+    fprintf(fp, "#define TUNEDPARAMS {%u, %u, %u, %u, %.2ff, %.2ff}\n\n", st->s_par.a_maxAdcDiff, st->s_par.a_spanDiv,
+        st->s_par.a_minTicDiff, st->s_par.a_maxSideChanges, st->s_par.a_freqQuality, st->s_par.a_freqDiff);
+    fprintf(fp, "#endif\n");
+}
+
+/*
+ @brief Searches the grid for one profile and emits its header
+ @return 0, 1 for errors
+*/
+static int tuneProfile(const struct sProfile *pr, uint32_t frames, const char *rawName, float rawFreq,
+    float centBound, float minValid, float weight, unsigned threads, const char *outDir) {
+    std::vector<struct sCorpus> corpora;
+    std::vector<struct sSetting> settings;
+    std::vector<std::thread> workers;
+    std::atomic<uint32_t> next(0);
+    struct sSetting def = {0}, *best = NULL;
+    struct sADCParams par;
+    uint32_t maxLen = gLens[NUMOF(gLens)-1], ok = 0;
+    char name[256];
+    FILE *fp = stdout;
+    int n;
+
+    if(rawName) {
+        // the recorded sample rate only, simulated frames of the same length added
+        corpora.resize(1);
+        if((n = readCorpus(rawName, rawFreq, &corpora[0])) == -3)  n = readRaw(rawName, rawFreq, &corpora[0]);
+        if(n <= 0)  { fprintf(stderr, "no frames of known frequency in %s (rawfile:freq)\n", rawName);  return 1; }
+        struct sCorpus sim;
+        sim.c_sFreq = corpora[0].c_sFreq;
+        sim.c_len = corpora[0].c_len;
+        simCorpus(&sim, pr, frames);
+        corpora[0].c_data.insert(corpora[0].c_data.end(), sim.c_data.begin(), sim.c_data.end());
+        corpora[0].c_freq.insert(corpora[0].c_freq.end(), sim.c_freq.begin(), sim.c_freq.end());
+        fprintf(stderr, "%d recorded frames of %u samples at %u Hz\n", n, corpora[0].c_len, corpora[0].c_sFreq);
+    }
+    else for(unsigned s = 0; s < NUMOF(gSFreqs); s++) {
+        if(pr->p_high*3.0f >= gSFreqs[s])  continue;    // signals below samplerate/3 only
+        corpora.push_back(sCorpus());
+        corpora.back().c_sFreq = gSFreqs[s];
+        corpora.back().c_len = maxLen;
+        simCorpus(&corpora.back(), pr, frames);
+    }
+
+    // all analysis settings, frames are the first s_len samples of each corpus frame
+    ADC_ParamsDefault(&par);
+    for(auto &co : corpora)
+      for(unsigned l = 0; l < NUMOF(gLens); l++) {
+        if(gLens[l] > co.c_len)  continue;
+        for(unsigned a = 0; a < NUMOF(gMaxAdcDiffs); a++)
+        for(unsigned sd = 0; sd < NUMOF(gSpanDivs); sd++)
+        for(unsigned t = 0; t < NUMOF(gMinTicDiffs); t++)
+        for(unsigned m = 0; m < NUMOF(gMaxSideChanges); m++)
+        for(unsigned c = 0; c < NUMOF(gTargetCents); c++) {
+            struct sSetting st = {0};
+            st.s_corpus = &co;
+            st.s_len = gLens[l];
+            st.s_par = par;
+            st.s_par.a_maxAdcDiff = gMaxAdcDiffs[a];
+            st.s_par.a_spanDiv = gSpanDivs[sd];
+            st.s_par.a_minTicDiff = gMinTicDiffs[t];
+            st.s_par.a_maxSideChanges = gMaxSideChanges[m];
+            st.s_targetCent = gTargetCents[c];
+            settings.push_back(st);
+        }
+      }
+
+    // reference: defaults of freq_tune, or the nearest frame length of the recorded corpus
+    def.s_corpus = &corpora[0];
+    for(auto &co : corpora)  if(co.c_sFreq == DEFSFREQ)  def.s_corpus = &co;
+    def.s_len = def.s_corpus->c_len < DEFLEN ? def.s_corpus->c_len : DEFLEN;
+    def.s_par = par;
+    def.s_targetCent = DEFTARGETCENT;
+    for(int i = 0; i < 2; i++)    // 1st pass warms up caches and clock
+        evaluate(&def, &par.a_freqQuality, 1, &par.a_freqDiff, 1, INFINITY, 0.0f, weight, 0.0f, 0.0f);
+    if(!(def.s_cpu > 0.0f))  { fprintf(stderr, "%s: no green results with the defaults\n", pr->p_name);  return 1; }
+
+    for(unsigned t = 0; t < threads; t++)
+        workers.push_back(std::thread([&]() {
+            uint32_t i;
+            while((i = next.fetch_add(1)) < settings.size())
+                evaluate(&settings[i], gFreqQualities, NUMOF(gFreqQualities), gFreqDiffs, NUMOF(gFreqDiffs),
+                    centBound, minValid, weight, def.s_cpu, def.s_latency);
+        }));
+    for(auto &w : workers)  w.join();
+
+    for(auto &st : settings) {
+        if(st.s_ok)  ok++;
+        if(!best || (st.s_ok && !best->s_ok))  best = &st;
+        else if(st.s_ok == best->s_ok && (st.s_ok ? st.s_cost < best->s_cost : st.s_p95 < best->s_p95))  best = &st;
+    }
+
+    fprintf(stderr, "\n%s: %u frames per sample rate, %zu settings, %u within bounds, %u threads\n",
+        pr->p_name, (uint32_t)corpora[0].c_freq.size(), settings.size(), ok, threads);
+    fprintf(stderr, "%-9s %6s %5s %4s %4s %4s %4s %5s %5s %5s | %9s %8s %6s %6s %6s\n", "", "sFreq", "len",
+        "adc", "span", "tic", "side", "cent", "qual", "diff", "cpu", "lat[ms]", "p95", "green", "cost");
+    def.s_cost = 1.0f + weight;
+    printSetting("defaults", &def);
+    printSetting("tuned", best);
+    if(!best->s_ok)  return 1;
+
+    if(outDir) {
+        snprintf(name, sizeof(name), "%s/tuned_%s.h", outDir, pr->p_name);
+        if(!(fp = fopen(name, "w")))  { perror(name);  return 1; }
+    }
+    writeHeader(fp, pr, best, &def, (uint32_t)corpora[0].c_freq.size(), centBound, minValid);
+    if(outDir)  fclose(fp);
+    return 0;
+} /* tuneProfile */
+
+int main(int argc, char *argv[]) {
+    const char *profile = "guitar", *outDir = NULL, *rawName = NULL;
+    char *colon;
+    float centBound = TUNECENTBOUND, minValid = TUNEMINVALID, weight = 1.0f, rawFreq = 0.0f;
+    uint32_t frames = TUNEFRAMES;
+    unsigned threads = std::thread::hardware_concurrency(), seed = 1;
+    int opt, retval = 0, found = 0;
+
+    while((opt = getopt(argc, argv, "p:n:b:v:w:j:r:s:o:")) != -1) {
+        switch(opt) {
+            case 'p': profile = optarg; break;
+            case 'n': frames = atoi(optarg); break;
+            case 'b': centBound = atof(optarg); break;
+            case 'v': minValid = atof(optarg); break;
+            case 'w': weight = atof(optarg); break;
+            case 'j': threads = atoi(optarg); break;
+            case 'r':
+                rawName = optarg;
+                if((colon = strrchr(optarg, ':')))  { *colon = '\0';  rawFreq = atof(colon + 1); }
+                break;
+            case 's': seed = atoi(optarg); break;
+            case 'o': outDir = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [-p profile|all] [-n frames] [-b cent] [-v valid] [-w weight] [-j threads]"
+                    " [-r rawfile[:freq]] [-s seed] [-o dir]\n", argv[0]);
+                return 1;
+        }
+    }
+    if(!frames)  frames = TUNEFRAMES;
+    if(!threads)  threads = 1;
+
+    for(unsigned p = 0; p < NUMOF(gProfiles); p++) {
+        if(strcmp(profile, "all") && strcmp(profile, gProfiles[p].p_name))  continue;
+        found++;
+        srand(seed + p);
+        retval |= tuneProfile(&gProfiles[p], frames, rawName, rawFreq, centBound, minValid, weight, threads, outDir);
+    }
+    if(!found)  { fprintf(stderr, "unknown profile %s\n", profile);  return 1; }
+    return retval;
+} /* main */
@@ -0,0 +1,248 @@
+/*******************************************************************
+ @brief Live tuner on the host: PCM from stdin, a FIFO or a pipe through the analysis of the ESP32
+ @file pcm_tuner.cpp
+ @author Juergen Boehm
+ @date 2025, May 16
+ @note Build on Linux from the repository root:
+    g++ -O2 -I lib/ADC_Lib -I lib/PcmStream -I lib/Profiling -I lib/Afrequencies -I lib/ResultShm host/pcm_tuner.cpp
+        lib/PcmStream/PcmStream.cpp lib/Profiling/Profiling.cpp lib/Afrequencies/AFrequencies.cpp
+        lib/ADC_Lib/ADC_DataAnalysis.cpp lib/ResultShm/ResultShm.cpp -lrt -o pcm_tuner
+ @note Usage:
+    pcm_tuner [options] [input]       analyse input (file or FIFO, default stdin), raw or WAV
+      -r rate -c channels -b bits [-f]  raw format (default 48000 Hz, mono, 16 bit, -f 32 bit float)
+      -C channel   channel analysed (default 0)
+      -n len       samples per frame (default rate/15, 66 ms)
+      -g gain      applied before the conversion to 12 bit (default 1)
+      -k frames    frames that may wait behind the next one, older ones are dropped (default 2),
+                   not for regular files
+      -l ms        latency budget, results later than this after the arrival of their last
+                   sample are counted as late (default the frame duration)
+      -s us        extra time per frame (a slow analysis, to test drops and late frames)
+      -m name      publishes each result also in the shared memory segment name, e.g. /freqtuner
+                   (lib/ResultShm, read e.g. by shm_bench -m /freqtuner)
+    pcm_tuner -e seconds [-w] [-x] [-r rate]   emit a synthetic S16 mono tone sequence to stdout,
+                   paced in real time (-x as fast as possible), -w with a WAV header
+    e.g.  arecord -f S16_LE -r 48000 | pcm_tuner   or   pcm_tuner -e 10 | pcm_tuner
+    or    mkfifo /tmp/pcm; pcm_tuner /tmp/pcm & pcm_tuner -e 10 -w > /tmp/pcm
+ @note Pitch track (stdout) as tlm_decode, one line per frame with the latency added:
+    # freq-tuner pitch track
+    time_s,freq_hz,note,cent,quality_s,periodes,used,flags,latency_ms
+    time_s is the stream time of the frame end, flags 1 valid, 2 green, 4 late.
+    Statistics (frames, dropped, late, latency and analysis time p50/p99) go to stderr.
+
+ Copyright (C) <2025>  <Juergen Boehm>
+********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <math.h>
+
+#include "ADC_DataAnalysis.h"
+#include "AFrequencies.h"
+#include "PcmStream.h"
+#include "Profiling.h"
+#include "ResultShm.h"
+
+#define TUNER_RATE (48000)
+#define TUNER_MAXLEN (16384)    // samples per frame
+#define TUNER_BACKLOG (2)
+#define EMIT_BLOCK (480)        // samples per paced write, 10 ms at 48 kHz
+#define EMIT_NOTESEC (0.5)      // duration of each note [s]
+#define EMIT_NOISE (0.02)       // relative to full scale
+
+#define FLAGVALID (SHMVALID)    // as TLMVALID
+#define FLAGGREEN (SHMGREEN)    // as TLMGREEN
+#define FLAGLATE (SHMLATE)
+
+static void printLine(const char *line) {
+    fprintf(stderr, "%s\n", line);
+}
+
+/*
+ @brief Synthetic tone sequence as S16 mono PCM, optionally with WAV header
+ @param paced: writes in real time, else as fast as the pipe takes it
+*/
+static int emit(double seconds, uint32_t rate, bool paced, bool wav, int fd) {
+    static const float notes[] = {82.41f, 110.0f, 146.83f, 196.0f, 246.94f, 329.63f, 440.0f, 880.0f};
+    static int16_t block[EMIT_BLOCK*4];
+    struct sPcmFormat fmt = {rate, 1, 16, PCMINT};
+    uint8_t header[44];
+    uint32_t blockLen = EMIT_BLOCK*rate/TUNER_RATE, total = (uint32_t)(seconds*rate), n, i;
+    struct timespec next;
+    double phase = 0.0, t, f, v;
+    uint64_t s = 0;
+
+    if(!blockLen || blockLen > sizeof(block)/sizeof(block[0]))  return 1;
+    if(wav) {
+        pcmWavHeader(header, &fmt);
+        if(write(fd, header, sizeof(header)) != sizeof(header))  return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    srand(1);
+    while(s < total) {
+        n = (total - s < blockLen) ? total - s : blockLen;
+        for(i = 0; i < n; i++, s++) {
+            t = (double)s/rate;
+            f = notes[(uint32_t)(t/EMIT_NOTESEC) % (sizeof(notes)/sizeof(notes[0]))];
+            f *= pow(2.0, 10.0*sin(2.0*M_PI*5.0*t)/1200.0);    // vibrato of 10 cent
+            phase += 2.0*M_PI*f/rate;
+            v = 0.5*sin(phase) + 0.15*sin(2.0*phase + 1.0) + EMIT_NOISE*(2.0*rand()/RAND_MAX - 1.0);
+            block[i] = (int16_t)(v*32767.0);
+        }
+        if(write(fd, block, n*sizeof(int16_t)) != (ssize_t)(n*sizeof(int16_t)))  return 1;
+        if(!paced)  continue;
+        next.tv_nsec += (long)(1e9*n/rate);
+        if(next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+    return 0;
+} /* emit */
+
+int main(int argc, char *argv[]) {
+    static uint16_t data[TUNER_MAXLEN];
+    alignas(void *) static uint8_t arena[ADCANALYSERBYTES(MAXSIDECHANGES)];
+    struct sPcmFormat fmt = {TUNER_RATE, 1, 16, PCMINT};
+    struct sPcmStream st;
+    struct sADCAnalyser *an;
+    struct sTuning tuning;
+    struct sProfStage *stLatency, *stAnalysis;
+    struct sShmPublisher pub;
+    struct sShmResult res;
+    const char *shmName = NULL;
+    struct pollfd pfd;
+    struct stat sb;
+    uint32_t len = 0, backlog = TUNER_BACKLOG, late = 0, slowUs = 0, results = 0;
+    uint64_t arrivalNs, t0, t1, budgetNs = 0, stream = 0;
+    double seconds = 0.0, latencyMs;
+    float gain = 1.0f, cent;
+    uint16_t channel = 0;
+    bool paced = true, wav = false;
+    int opt, fd, retval, flags, note;
+    char name[sizeof(res.r_note)];
+
+    while((opt = getopt(argc, argv, "r:c:b:fC:n:g:k:l:s:m:e:xw")) != -1) {
+        switch(opt) {
+            case 'r': fmt.f_rate = atoi(optarg); break;
+            case 'c': fmt.f_channels = atoi(optarg); break;
+            case 'b': fmt.f_bits = atoi(optarg); break;
+            case 'f': fmt.f_type = PCMFLOAT; fmt.f_bits = 32; break;
+            case 'C': channel = atoi(optarg); break;
+            case 'n': len = atoi(optarg); break;
+            case 'g': gain = atof(optarg); break;
+            case 'k': backlog = atoi(optarg); break;
+            case 'l': budgetNs = (uint64_t)(atof(optarg)*1e6); break;
+            case 's': slowUs = atoi(optarg); break;
+            case 'm': shmName = optarg; break;
+            case 'e': seconds = atof(optarg); break;
+            case 'x': paced = false; break;
+            case 'w': wav = true; break;
+            default:
+                fprintf(stderr, "usage: %s [-r rate] [-c channels] [-b bits] [-f] [-C channel] [-n len] [-g gain]"
+                    " [-k frames] [-l ms] [-s us] [-m name] [input] | -e seconds [-w] [-x] [-r rate]\n", argv[0]);
+                return 1;
+        }
+    }
+    if(seconds > 0.0)  return emit(seconds, fmt.f_rate, paced, wav, STDOUT_FILENO);
+
+    if(optind < argc) {
+        fd = open(argv[optind], O_RDONLY);
+        if(fd < 0) { perror(argv[optind]); return 1; }
+    }
+    else fd = STDIN_FILENO;
+    if(!fstat(fd, &sb) && S_ISREG(sb.st_mode))  backlog = UINT32_MAX;    // a file is not live, nothing dropped
+    if((retval = pcmOpen(&st, fd, &fmt, gain)) < 0) {
+        fprintf(stderr, "pcmOpen: error %d\n", retval);
+        return 1;
+    }
+    if(shmName && shmPublisherOpen(&pub, shmName) < 0) {
+        perror(shmName);
+        return 1;
+    }
+    tuningDefaults(&tuning);
+    setTuning(&tuning);
+    stLatency = profStage("latency");
+    stAnalysis = profStage("analysis");
+    printf("# freq-tuner pitch track\ntime_s,freq_hz,note,cent,quality_s,periodes,used,flags,latency_ms\n");
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    an = NULL;
+    for(;;) {
+        if(poll(&pfd, 1, 1000) < 0)  break;
+        if((retval = pcmRead(&st)) < 0) {
+            fprintf(stderr, "pcmRead: error %d\n", retval);
+            break;
+        }
+        if(!an && st.s_header) {
+            // format known (WAV header or raw): analyser for its rate
+            if(!len)  len = st.s_fmt.f_rate/15;
+            if(len > TUNER_MAXLEN)  len = TUNER_MAXLEN;
+            if(!budgetNs)  budgetNs = (uint64_t)len*1000000000ull/st.s_fmt.f_rate;
+            an = ADC_AnalyserInit(arena, sizeof(arena), st.s_fmt.f_rate, NULL);
+            if(!an)  return 1;
+            fprintf(stderr, "%u Hz, %u channels, %u bit%s, frames of %u samples, budget %.1f ms\n", st.s_fmt.f_rate,
+                st.s_fmt.f_channels, st.s_fmt.f_bits, (st.s_fmt.f_type == PCMFLOAT) ? " float" : "", len, budgetNs*1e-6);
+        }
+        while(an && (retval = pcmFrame(&st, data, len, channel, backlog, &arrivalNs)) > 0) {
+            t0 = pcmNow();
+            retval = ADC_Analyse(an, data, len);
+            if(slowUs)  usleep(slowUs);
+            t1 = pcmNow();
+            profRecord(stAnalysis, (uint32_t)(t1 - t0));
+            profRecord(stLatency, (uint32_t)(t1 - arrivalNs));
+            latencyMs = (t1 - arrivalNs)*1e-6;
+            flags = 0;
+            if(t1 - arrivalNs > budgetNs) {
+                flags |= FLAGLATE;
+                late++;
+            }
+            stream = (st.s_consumed/((uint64_t)st.s_fmt.f_bits/8*st.s_fmt.f_channels));
+            if(retval >= 0 && (note = findNote(&tuning, an->a_sAD.d_freqClassic, name, &cent)) >= 0) {
+                flags |= FLAGVALID | ((classifyResult(&an->a_sAD) > 0) ? FLAGGREEN : 0);
+                results++;
+                printf("%.6f,%.3f,%s,%.2f,%.3g,%u,%u,%u,%.3f\n", (double)stream/st.s_fmt.f_rate,
+                    an->a_sAD.d_freqClassic, name, cent, an->a_sAD.d_quality, an->a_sAD.d_numPeriodes,
+                    an->a_sAD.d_usedLen, flags, latencyMs);
+            }
+            else printf("%.6f,0,,0,0,0,0,%u,%.3f\n", (double)stream/st.s_fmt.f_rate, flags, latencyMs);
+            if(shmName) {
+                memset(&res, 0, sizeof(res));
+                if(flags & FLAGVALID) {
+                    res.r_freq = an->a_sAD.d_freqClassic;
+                    res.r_cent = cent;
+                    res.r_quality = an->a_sAD.d_quality;
+                    res.r_numPeriodes = (uint16_t)an->a_sAD.d_numPeriodes;
+                    res.r_usedLen = (uint16_t)an->a_sAD.d_usedLen;
+                    snprintf(res.r_note, sizeof(res.r_note), "%s", name);
+                }
+                res.r_flags = (uint8_t)flags;
+                res.r_latencyMs = (float)latencyMs;
+                res.r_timeNs = pcmNow();
+                shmPublish(&pub, &res);
+            }
+        }
+        fflush(stdout);
+        if(retval < 0) {
+            fprintf(stderr, "pcmFrame: error %d\n", retval);
+            break;
+        }
+        if(st.s_eof)  break;
+    }
+
+    fprintf(stderr, "%u frames (%u results), %u dropped, %u late, %u reads of %.1f kByte mean\n", st.s_frames,
+        results, st.s_dropped, late, st.s_reads, st.s_reads ? st.s_total/1024.0/st.s_reads : 0.0);
+    profReport(printLine);
+    pcmClose(&st);
+    if(shmName)  shmPublisherClose(&pub, true);
+    if(fd != STDIN_FILENO)  close(fd);
+    return 0;
+} /* main */
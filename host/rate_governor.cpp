@@ -0,0 +1,299 @@
+/*******************************************************************
+ @brief Host simulation of the sample rate governor (ADC_Governor) against a fixed SAMPLERATE
+ @file rate_governor.cpp
+ @author Juergen Boehm
+ @date 2025, May 14
+ @note Build on Linux from the repository root:
+    g++ -O2 -I lib/ADC_Lib host/rate_governor.cpp lib/ADC_Lib/ADC_Governor.cpp lib/ADC_Lib/ADC_DataAnalysis.cpp
+        lib/ADC_Lib/ADC_Sim.cpp -o rate_governor
+ @note Usage: rate_governor [-t] [-n notes] [-s seed]
+    -t  table first: median |cent|, wrong notes, green fraction and samples per periode of single
+        notes at each rate, to check GOVMINSPP and the precision limit
+    -n  notes per sequence (default SEQNOTES)
+ @note Sequences of notes as played: an instrument's open strings one after the other, melodies
+    of the instrument's range. Each note is held for some frames after an attack of invalid
+    frames (noise only), detuned by up to +-SEQDETUNE cent.
+    Frames are analysed as getFreqNoteName does: ADC read of the adaptive length
+    (1.5*d_usedLen, 1/8..all of a full frame, all after invalid results; a full frame is BUFF_SIZE
+    at SAMPLERATE, govFrameLen with the governor, so frames keep their duration),
+    peak_mean_sparse, calcFreqAnalog with TARGETCENT, classifyResult, nearest note to govUpdate.
+    A rate switch costs SWITCHMS (I2S clock reprogrammed, DMA restarted) and the next frame,
+    which is dropped while the ADC settles.
+    Per sequence and policy (fixed SAMPLERATE, governor): mean rate over time (ADC and DMA load),
+    analysis cycles per second of signal (CPU load), time per green result, median |cent| and
+    wrong notes (> SEQWRONGCENT) of green results, green fraction and switches.
+
+ Copyright (C) <2025>  <Juergen Boehm>
+********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include <algorithm>
+#if defined __x86_64__ || defined __i386__
+#include <x86intrin.h>    // __rdtsc
+#endif
+
+#include "ADC_DataAnalysis.h"
+#include "ADC_Sim.h"
+#include "ADC_Governor.h"
+
+// as main.h
+#define SAMPLERATE (30000)
+#define BUFF_SIZE (2000)
+#define TARGETCENT (1.0f)
+#define MINREADLEN (BUFF_SIZE/8)
+// governor: rates offered and precision target
+static const uint32_t gRates[] = {12000, 16000, 20000, 24000, 30000};
+#define GOVFRAMETIME ((float)BUFF_SIZE/SAMPLERATE)    // frames keep the duration of the fixed rate
+#define SWITCHMS (2.0f)
+#define SEQNOTES (40)
+#define SEQDETUNE (30)
+#define SEQATTACK (2)           // invalid frames before each note
+#define SEQWRONGCENT (50.0f)    // wrong note
+#define TABLEFRAMES (100)
+#define NUMOF(a) (sizeof(a)/sizeof(a[0]))
+
+struct sProfile {
+    const char *p_name;
+    float p_low, p_high;    // range of melodies [Hz]
+    uint16_t p_noise;
+    bool p_mix;             // string with harmonics (ADC_SimMix), else sine (ADC_Sim)
+    const float *p_open;    // open strings, NULL for none
+    uint8_t p_numOpen;
+};
+
+static const float gGuitar[] = {82.41f, 110.0f, 146.83f, 196.0f, 246.94f, 329.63f};
+static const float gViolin[] = {196.0f, 293.66f, 440.0f, 659.26f};
+static const struct sProfile gProfiles[] = {
+    {"guitar", 82.41f, 659.26f, 300, true, gGuitar, NUMOF(gGuitar)},
+    {"violin", 196.0f, 2637.0f, 300, true, gViolin, NUMOF(gViolin)},
+    {"flute", 261.63f, 2093.0f, 400, false, NULL, 0},
+};
+
+struct sNote {
+    float n_freq;       // true frequency [Hz], 0 for noise
+    uint16_t n_frames;
+};
+
+struct sStats {
+    double s_time;          // signal time [s]
+    double s_samples;       // samples read
+    uint64_t s_cycles;
+    uint32_t s_frames, s_green, s_switches;
+    std::vector<float> s_cent;
+};
+
+static uint64_t ticks(void) {
+#if defined __x86_64__ || defined __i386__
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000ull + ts.tv_nsec;
+#endif
+}
+
+static float cents(float f, float ref) {
+    return 1200.0f*log2f(f/ref);
+}
+
+// nearest equal tempered note to a1=440Hz
+static float nearestNote(float f) {
+    return 440.0f*powf(2.0f, roundf(12.0f*log2f(f/440.0f))/12.0f);
+}
+
+/*
+ @brief One frame as getFreqNoteName: simulate *readLen samples of freq at sAD->d_sFreq and analyse
+ @param[in] frameLen: samples of a full frame (BUFF_SIZE, govFrameLen)
+ @return 1 green, 0 doubtful, <0 invalid; *readLen is set to the next read length
+*/
+static int frame(struct sADCData *sAD, float freq, uint16_t noise, bool mix, uint32_t frameLen, uint32_t *readLen,
+        float *result, uint64_t *cycles) {
+    uint16_t max, min, mean;
+    uint64_t t0;
+    int retval;
+    uint32_t newLen;
+
+    sAD->d_len = *readLen;
+    if(freq <= 0.0f)  for(uint32_t i = 0; i < sAD->d_len; i++)  sAD->data[i] = 2000 + rand()%noise;
+    else if(mix)  ADC_SimMix(sAD, &freq, 1, noise);
+    else  ADC_Sim(sAD, 0, freq, noise);
+    sAD->d_deltaTime = 1.0f/sAD->d_sFreq;
+    t0 = ticks();
+    retval = peak_mean_sparse(sAD, &max, &min, &mean);
+    if(retval >= 0) {
+        sAD->d_max = max;
+        sAD->d_min = min;
+        sAD->d_mean = mean;
+        retval = calcFreqAnalog(sAD);
+    }
+    *cycles += ticks() - t0;
+    if(retval < 0 || sAD->d_freqClassic < 1.0f || sAD->d_periode*sAD->d_sFreq > sAD->d_len) {
+        *readLen = frameLen;
+        return -1;
+    }
+    newLen = (sAD->d_usedLen + sAD->d_usedLen/2 + 1) & ~1UL;
+    *readLen = (newLen < frameLen/8) ? frameLen/8 : ((newLen > frameLen) ? frameLen : newLen);
+    *result = sAD->d_freqClassic;
+    return classifyResult(sAD) == 1;
+}
+
+/*
+ @brief Plays the sequence with a fixed rate (gv NULL) or the governor
+*/
+static void play(const std::vector<struct sNote> &seq, const struct sProfile *pr, struct sRateGovernor *gv,
+        struct sStats *st) {
+    static uint16_t data[BUFF_SIZE];
+    struct sADCData sAD = {0};
+    uint32_t frameLen, readLen, rate;
+    float result;
+    int green;
+    bool drop = false;
+
+    sAD.data = data;
+    sAD.d_targetCent = TARGETCENT;
+    sAD.d_sFreq = gv ? govRate(gv) : SAMPLERATE;
+    frameLen = readLen = gv ? govFrameLen(gv) : BUFF_SIZE;
+    for(const struct sNote &n : seq)
+        for(uint16_t f = 0; f < n.n_frames; f++) {
+            green = frame(&sAD, n.n_freq, pr->p_noise, pr->p_mix, frameLen, &readLen, &result, &st->s_cycles);
+            st->s_time += (double)sAD.d_len/sAD.d_sFreq;
+            st->s_samples += sAD.d_len;
+            st->s_frames++;
+            if(drop) {      // settling after a switch
+                drop = false;
+                continue;
+            }
+            if(green > 0 && n.n_freq > 0.0f) {
+                st->s_green++;
+                st->s_cent.push_back(fabsf(cents(result, n.n_freq)));
+            }
+            if(!gv)  continue;
+            // nearest note of green results as gNoteFreq, else invalid
+            rate = govUpdate(gv, green > 0 ? nearestNote(result) : 0.0f);
+            if(rate) {
+                sAD.d_sFreq = rate;
+                frameLen = readLen = govFrameLen(gv);
+                st->s_time += SWITCHMS*1e-3;
+                st->s_switches++;
+                drop = true;
+            }
+        }
+}
+
+// median and wrong notes (> SEQWRONGCENT) of |cent| of green results
+static void centStats(std::vector<float> &cent, float *median, float *wrong) {
+    size_t w = 0;
+
+    *median = *wrong = 0.0f;
+    if(cent.empty())  return;
+    std::sort(cent.begin(), cent.end());
+    *median = cent[cent.size()/2];
+    for(float c : cent)  w += c > SEQWRONGCENT;
+    *wrong = (float)w/cent.size();
+}
+
+static void report(const char *policy, struct sStats *st) {
+    float median, wrong;
+
+    centStats(st->s_cent, &median, &wrong);
+    printf("  %-9s %9.1f %12.2f %10.1f %8.2f %7.3f %7.2f %9u\n", policy, st->s_samples/st->s_time*1e-3,
+        (double)st->s_cycles/st->s_time*1e-6, st->s_green ? st->s_time*1e3/st->s_green : 0.0, median, wrong,
+        (float)st->s_green/st->s_frames, st->s_switches);
+}
+
+// cent error, green fraction and samples per periode of single notes per rate, frames of BUFF_SIZE/SAMPLERATE seconds
+static void table(void) {
+    static const float notes[] = {82.41f, 164.81f, 329.63f, 659.26f, 1318.5f, 2637.0f};
+    static uint16_t data[BUFF_SIZE];
+    struct sADCData sAD = {0};
+    std::vector<float> cent;
+    uint32_t frameLen, readLen;
+    uint64_t cycles = 0;
+    float result, median, wrong;
+    int green;
+
+    sAD.data = data;
+    sAD.d_targetCent = TARGETCENT;
+    printf("single notes (strings, noise 300), %d frames of %.1f ms: median |cent| / wrong notes / green / samples per periode\n",
+        TABLEFRAMES, 1e3f*BUFF_SIZE/SAMPLERATE);
+    printf("%8s", "Hz");
+    for(unsigned r = 0; r < NUMOF(gRates); r++)  printf(" %22u", gRates[r]);
+    printf("\n");
+    for(unsigned n = 0; n < NUMOF(notes); n++) {
+        printf("%8.1f", notes[n]);
+        for(unsigned r = 0; r < NUMOF(gRates); r++) {
+            sAD.d_sFreq = gRates[r];
+            frameLen = readLen = (uint32_t)((uint64_t)BUFF_SIZE*gRates[r]/SAMPLERATE) & ~1UL;
+            cent.clear();
+            for(int f = 0; f < TABLEFRAMES; f++) {
+                green = frame(&sAD, notes[n], 300, true, frameLen, &readLen, &result, &cycles);
+                if(green > 0)  cent.push_back(fabsf(cents(result, notes[n])));
+            }
+            centStats(cent, &median, &wrong);
+            printf("   %5.2f %5.3f %4.2f %5.1f", median, wrong, (float)cent.size()/TABLEFRAMES, gRates[r]/notes[n]);
+        }
+        printf("\n");
+    }
+    printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+    std::vector<struct sNote> seq;
+    struct sRateGovernor gv;
+    struct sStats fixed, gov;
+    int opt, notes = SEQNOTES, numRates;
+    unsigned seed = 1;
+    bool bTable = false;
+    float f;
+
+    while((opt = getopt(argc, argv, "tn:s:")) != -1) {
+        switch(opt) {
+            case 't': bTable = true; break;
+            case 'n': notes = atoi(optarg); break;
+            case 's': seed = (unsigned)atoi(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-t] [-n notes] [-s seed]\n", argv[0]);
+                return 1;
+        }
+    }
+    if(notes <= 0)  notes = SEQNOTES;
+    srand(seed);
+    if(bTable)  table();
+
+    numRates = govInit(&gv, gRates, NUMOF(gRates), TARGETCENT, GOVFRAMETIME);
+    if(numRates < 0)  { fprintf(stderr, "no rate meets %.1f cent within %.0f ms\n", TARGETCENT, GOVFRAMETIME*1e3);  return 1; }
+    printf("governor: %d rates from %u Hz (precision limit %.0f Hz), %d samples per periode at least, fixed: %d Hz\n",
+        numRates, gv.g_rates[0], GOVQUANTK/(TARGETCENT*GOVFRAMETIME), GOVMINSPP, SAMPLERATE);
+    printf("  %-9s %9s %12s %10s %8s %7s %7s %9s\n", "policy", "rate[kHz]", "Mcycles/s", "ms/green", "med cent", "wrong", "green",
+        "switches");
+    for(const struct sProfile &pr : gProfiles) {
+        for(int kind = 0; kind < 2; kind++) {
+            if(kind == 0 && !pr.p_open)  continue;
+            // open strings one after the other, or a melody of the range
+            seq.clear();
+            for(int i = 0; i < notes; i++) {
+                if(kind == 0)  f = pr.p_open[(i/4) % pr.p_numOpen];     // each string plucked 4 times
+                else  f = pr.p_low*powf(2.0f, (float)(rand() % (int)(12.0f*log2f(pr.p_high/pr.p_low) + 1))/12.0f);
+                f *= powf(2.0f, (float)(rand()%(2*SEQDETUNE + 1) - SEQDETUNE)/1200.0f);
+                seq.push_back({0.0f, SEQATTACK});
+                seq.push_back({f, (uint16_t)(kind == 0 ? 30 : 6 + rand()%15)});
+            }
+            printf("%s %s\n", pr.p_name, kind == 0 ? "open strings" : "melody");
+            fixed = gov = sStats();
+            srand(seed + 7);
+            play(seq, &pr, NULL, &fixed);
+            srand(seed + 7);
+            govInit(&gv, gRates, NUMOF(gRates), TARGETCENT, GOVFRAMETIME);
+            play(seq, &pr, &gv, &gov);
+            report("fixed", &fixed);
+            report("governor", &gov);
+        }
+    }
+    return 0;
+}
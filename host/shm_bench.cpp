@@ -0,0 +1,282 @@
+/*******************************************************************
+ @brief Throughput and latency of the shared memory result publisher (lib/ResultShm) with many readers
+ @file shm_bench.cpp
+ @author Juergen Boehm
+ @date 2025, May 16
+ @note Build on Linux from the repository root:
+    g++ -O2 -I lib/ResultShm -I lib/Profiling host/shm_bench.cpp lib/ResultShm/ResultShm.cpp
+        lib/Profiling/Profiling.cpp -lrt -o shm_bench
+ @note Usage:
+    shm_bench [-t readers] [-d seconds] [-r results/s] [-p us]   benchmark (default 8 readers, 2 s, results
+                          as fast as possible, readers spinning; -p: readers sleep us between polls)
+    shm_bench -m name     watch the segment of a writer, e.g. pcm_tuner -m /freqtuner, prints its
+                          history, then each new result as the pitch track of pcm_tuner
+ @note The benchmark forks the readers (own processes, own read only mapping), each polls
+    shmChanged/shmLatest and every SHMBENCH_HISTEVERY results shmHistory. Payload fields are
+    derived from r_seq, so a torn copy is detected. Prints results/s and publish time of the
+    writer (p50/p99), per reader polls/s, results seen and missed (overwritten before seen),
+    seqlock retries, torn copies (must be 0) and the latency from publishing to the reader
+    (p50/p99/max over all readers).
+
+ Copyright (C) <2025>  <Juergen Boehm>
+********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <atomic>
+
+#include "ResultShm.h"
+#include "Profiling.h"
+
+#define SHMBENCH_NAME "/freqtuner_bench"
+#define SHMBENCH_MAXREADERS (256)
+#define SHMBENCH_HISTEVERY (1000)   // results between two shmHistory of a reader
+#define SHMBENCH_HISTLEN (32)
+#define SHMBENCH_SUB (4)            // histogram buckets per octave
+#define SHMBENCH_BUCKETS (64*SHMBENCH_SUB)
+
+// statistics of a reader, in shared anonymous memory
+struct sReaderStat {
+    uint64_t polls, seen, missed, torn, retries, histories;
+    uint64_t hist[SHMBENCH_BUCKETS];    // latency [ns]
+    uint64_t maxNs;
+};
+
+static uint64_t nowNs(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000ull + ts.tv_nsec;
+}
+
+static void printLine(const char *line) {
+    printf("%s\n", line);
+}
+
+// bucket of ns, SHMBENCH_SUB per octave
+static uint32_t bucket(uint64_t ns) {
+    uint32_t msb;
+
+    if(ns < SHMBENCH_SUB)  return (uint32_t)ns;
+    msb = 63 - __builtin_clzll(ns);
+    return msb*SHMBENCH_SUB + (uint32_t)((ns >> (msb - 2)) & (SHMBENCH_SUB - 1));
+}
+
+// upper limit of bucket b [ns]
+static double bucketNs(uint32_t b) {
+    if(b < SHMBENCH_SUB)  return b + 1;
+    return (double)(1ull << (b/SHMBENCH_SUB))*(1.0 + (b%SHMBENCH_SUB + 1)/(double)SHMBENCH_SUB);
+}
+
+// upper limit of the bucket at p, but not above the largest latency seen
+static double percentile(const uint64_t *hist, uint64_t total, double p, uint64_t maxNs) {
+    uint64_t sum = 0;
+    double ns;
+
+    for(uint32_t b = 0; b < SHMBENCH_BUCKETS; b++) {
+        sum += hist[b];
+        if(sum < p*total)  continue;
+        ns = bucketNs(b);
+        return (ns > maxNs) ? (double)maxNs : ns;
+    }
+    return 0.0;
+}
+
+// payload derived from seq
+static void fillResult(struct sShmResult *r, uint64_t seq) {
+    memset(r, 0, sizeof(*r));
+    r->r_freq = (float)(seq & 0xFFFFF);
+    r->r_cent = -(float)(seq & 0xFFFF);
+    r->r_quality = (float)(seq & 0xFF);
+    r->r_numPeriodes = (uint16_t)seq;
+    r->r_usedLen = (uint16_t)~seq;
+    r->r_flags = SHMVALID | ((seq & 1) ? SHMGREEN : 0);
+    snprintf(r->r_note, sizeof(r->r_note), "%06u", (unsigned)(seq % 1000000));
+}
+
+static bool consistent(const struct sShmResult *r) {
+    struct sShmResult e;
+
+    fillResult(&e, r->r_seq);
+    e.r_seq = r->r_seq;
+    e.r_timeNs = r->r_timeNs;
+    return !memcmp(&e, r, sizeof(e));
+}
+
+static void reader(struct sReaderStat *st, const std::atomic<uint32_t> *stop, uint32_t pollUs) {
+    static struct sShmResult hist[SHMBENCH_HISTLEN];
+    struct sShmReader q;
+    struct sShmResult r;
+    uint64_t last = 0, ns;
+    bool first = true;
+    int n;
+
+    if(shmReaderOpen(&q, SHMBENCH_NAME) < 0)  exit(1);
+    while(!stop->load(std::memory_order_relaxed)) {
+        st->polls++;
+        if(!shmChanged(&q)) {
+            if(pollUs)  usleep(pollUs);
+#if defined __x86_64__ || defined __i386__
+            else  __builtin_ia32_pause();
+#endif
+            continue;
+        }
+        if(shmLatest(&q, &r) <= 0)  continue;
+        ns = nowNs() - r.r_timeNs;
+        st->hist[bucket(ns)]++;
+        if(ns > st->maxNs)  st->maxNs = ns;
+        if(!consistent(&r))  st->torn++;
+        if(!first)  st->missed += r.r_seq - last - 1;
+        first = false;
+        last = r.r_seq;
+        st->seen++;
+        if(st->seen % SHMBENCH_HISTEVERY == 0) {
+            n = shmHistory(&q, hist, SHMBENCH_HISTLEN);
+            for(int i = 0; i < n; i++)
+                if(!consistent(&hist[i]) || (i && hist[i].r_seq <= hist[i - 1].r_seq))  st->torn++;
+            st->histories++;
+        }
+    }
+    st->retries = q.q_retries;
+    shmReaderClose(&q);
+}
+
+static int bench(int readers, double seconds, double rate, uint32_t pollUs) {
+    struct sReaderStat *stat;
+    std::atomic<uint32_t> *stop;
+    struct sShmPublisher p;
+    struct sShmResult r;
+    struct sProfStage *stPublish = profStage("publish");
+    uint64_t t0, t, next, seq = 0, seen = 0, missed = 0, torn = 0, retries = 0, polls = 0, maxNs = 0, total;
+    static uint64_t hist[SHMBENCH_BUCKETS];
+    pid_t pid[SHMBENCH_MAXREADERS];
+    int status, failed = 0;
+
+    if(shmPublisherOpen(&p, SHMBENCH_NAME) < 0) {
+        perror(SHMBENCH_NAME);
+        return 1;
+    }
+    stat = (struct sReaderStat *)mmap(NULL, readers*sizeof(*stat) + 64, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(stat == MAP_FAILED)  return 1;
+    stop = (std::atomic<uint32_t> *)(stat + readers);
+    fillResult(&r, 0);
+    r.r_timeNs = nowNs();
+    shmPublish(&p, &r);     // readers find a result from the start
+    seq = 1;
+    for(int i = 0; i < readers; i++) {
+        pid[i] = fork();
+        if(pid[i] < 0) { perror("fork"); return 1; }
+        if(!pid[i]) {
+            reader(&stat[i], stop, pollUs);
+            _exit(0);
+        }
+    }
+    usleep(100000);         // readers mapped and polling
+
+    t0 = next = nowNs();
+    while((t = nowNs()) - t0 < (uint64_t)(seconds*1e9)) {
+        if(rate > 0.0) {
+            if(t < next)  continue;
+            next += (uint64_t)(1e9/rate);
+        }
+        fillResult(&r, seq++);
+        r.r_timeNs = nowNs();
+        shmPublish(&p, &r);
+        profRecord(stPublish, (uint32_t)(nowNs() - r.r_timeNs));
+    }
+    t = nowNs() - t0;
+    stop->store(1, std::memory_order_relaxed);
+    for(int i = 0; i < readers; i++) {
+        waitpid(pid[i], &status, 0);
+        if(!WIFEXITED(status) || WEXITSTATUS(status))  failed++;
+    }
+
+    for(int i = 0; i < readers; i++) {
+        seen += stat[i].seen;
+        missed += stat[i].missed;
+        torn += stat[i].torn;
+        retries += stat[i].retries;
+        polls += stat[i].polls;
+        if(stat[i].maxNs > maxNs)  maxNs = stat[i].maxNs;
+        for(int b = 0; b < SHMBENCH_BUCKETS; b++)  hist[b] += stat[i].hist[b];
+    }
+    total = 0;
+    for(int b = 0; b < SHMBENCH_BUCKETS; b++)  total += hist[b];
+    printf("%d readers, %.1f s, %.0f results/s published (segment %u bytes)\n", readers, t*1e-9, (seq - 1)/(t*1e-9),
+        (unsigned)sizeof(struct sShmSegment));
+    profReport(printLine);
+    printf("per reader: %.3g polls/s, %.0f results/s seen, %.1f%% missed, %.3g retries/s; %" PRIu64 " torn, %d failed\n",
+        polls/(t*1e-9)/readers, seen/(t*1e-9)/readers, (seen + missed) ? 100.0*missed/(seen + missed) : 0.0,
+        retries/(t*1e-9)/readers, torn, failed);
+    printf("latency publish to reader [ns]: p50 %.0f, p99 %.0f, max %" PRIu64 "\n",
+        percentile(hist, total, 0.5, maxNs), percentile(hist, total, 0.99, maxNs), maxNs);
+    munmap(stat, readers*sizeof(*stat) + 64);
+    shmPublisherClose(&p, true);
+    return (torn || failed) ? 1 : 0;
+} /* bench */
+
+// prints the results of a writer until it ends
+static int watch(const char *name) {
+    static struct sShmResult hist[SHMHISTORY];
+    struct sShmReader q;
+    struct sShmResult r;
+    uint32_t idle = 0;
+    int n;
+
+    while(shmReaderOpen(&q, name) < 0)  usleep(100000);    // writer not yet started
+    printf("# freq-tuner pitch track\nseq,freq_hz,note,cent,quality_s,periodes,used,flags,latency_ms\n");
+    n = shmHistory(&q, hist, SHMHISTORY);
+    for(int i = 0; i <= n; i++) {
+        if(i < n)  r = hist[i];
+        else if(shmLatest(&q, &r) <= 0 || (n && r.r_seq <= hist[n - 1].r_seq))  break;
+        printf("%" PRIu64 ",%.3f,%s,%.2f,%.3g,%u,%u,%u,%.3f\n", r.r_seq, r.r_freq, r.r_note, r.r_cent, r.r_quality,
+            r.r_numPeriodes, r.r_usedLen, r.r_flags, r.r_latencyMs);
+    }
+    fflush(stdout);
+    for(;;) {
+        if(shmChanged(&q) && shmLatest(&q, &r) > 0) {
+            printf("%" PRIu64 ",%.3f,%s,%.2f,%.3g,%u,%u,%u,%.3f\n", r.r_seq, r.r_freq, r.r_note, r.r_cent, r.r_quality,
+                r.r_numPeriodes, r.r_usedLen, r.r_flags, r.r_latencyMs);
+            fflush(stdout);
+            idle = 0;
+        }
+        else if(++idle % 1000 == 0 && kill((pid_t)q.q_seg->h_pid, 0) < 0)  break;     // writer ended
+        usleep(1000);
+    }
+    shmReaderClose(&q);
+    return 0;
+} /* watch */
+
+int main(int argc, char *argv[]) {
+    const char *name = NULL;
+    double seconds = 2.0, rate = 0.0;
+    int opt, readers = 8;
+    uint32_t pollUs = 0;
+
+    while((opt = getopt(argc, argv, "t:d:r:p:m:")) != -1) {
+        switch(opt) {
+            case 't': readers = atoi(optarg); break;
+            case 'd': seconds = atof(optarg); break;
+            case 'r': rate = atof(optarg); break;
+            case 'p': pollUs = atoi(optarg); break;
+            case 'm': name = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [-t readers] [-d seconds] [-r results/s] [-p us] | -m name\n", argv[0]);
+                return 1;
+        }
+    }
+    if(name)  return watch(name);
+    if(readers < 1 || readers > SHMBENCH_MAXREADERS) {
+        fprintf(stderr, "1 to %d readers\n", SHMBENCH_MAXREADERS);
+        return 1;
+    }
+    return bench(readers, seconds, rate, pollUs);
+} /* main */
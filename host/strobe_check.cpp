@@ -0,0 +1,74 @@
+/*******************************************************************
+ @brief Host check of the strobe tracker (ADC_Strobe) on detuned sine signals
+ @file strobe_check.cpp
+ @author Juergen Boehm
+ @date 2025, May 5
+ @note Build on Linux from the repository root:
+    g++ -O2 -I lib/ADC_Lib host/strobe_check.cpp lib/ADC_Lib/ADC_DataAnalysis.cpp
+        lib/ADC_Lib/ADC_Sim.cpp lib/ADC_Lib/ADC_Spectral.cpp lib/ADC_Lib/ADC_Strobe.cpp -o strobe_check
+ @note Usage: strobe_check
+    Tracks one second of ADC_Sim signals detuned against the reference note in
+    blocks of one display frame and prints the cent value found, the angle drift
+    and the time per sample compared to the sample budget.
+
+ Copyright (C) <2025>  <Juergen Boehm>
+********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+
+#include "ADC_DataAnalysis.h"
+#include "ADC_Sim.h"
+#include "ADC_Strobe.h"
+
+#define CHECK_SFREQ (30000)
+#define CHECK_FPS (60)
+#define CHECK_NOISE (300)
+
+static double seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+int main(void) {
+    static const float noteFreq[] = {65.41f, 110.0f, 261.63f, 440.0f, 1046.5f};
+    static const float detune[] = {-20.0f, -5.0f, -1.0f, 0.0f, 0.5f, 3.0f, 12.0f};
+    static uint16_t buf[CHECK_SFREQ];
+    const uint32_t block = CHECK_SFREQ/CHECK_FPS;
+    struct sADCData sAD = {0};
+    struct sStrobe sST;
+    uint16_t max, min, mean;
+    double s0, secs = 0.0, maxErr = 0.0;
+    uint64_t samples = 0;
+    int retval;
+
+    sAD.data = buf;
+    sAD.d_len = CHECK_SFREQ;
+    sAD.d_sFreq = CHECK_SFREQ;
+    sAD.d_deltaTime = 1.0f/CHECK_SFREQ;
+    srand(1);
+
+    printf("%9s %7s %8s %10s %7s\n", "note[Hz]", "detune", "cent", "turns", "level");
+    for(unsigned n = 0; n < sizeof(noteFreq)/sizeof(noteFreq[0]); n++)
+        for(unsigned d = 0; d < sizeof(detune)/sizeof(detune[0]); d++) {
+            ADC_Sim(&sAD, 0, noteFreq[n]*powf(2.0f, detune[d]/1200.0f), CHECK_NOISE);
+            peak_mean(&sAD, &max, &min, &mean);
+            strobeSetNote(&sST, noteFreq[n], CHECK_SFREQ);
+            retval = 0;
+            s0 = seconds();
+            for(uint32_t o = 0; o + block <= CHECK_SFREQ; o += block)
+                retval = strobeProcess(&sST, buf + o, block, mean);
+            secs += seconds() - s0;
+            samples += CHECK_SFREQ - CHECK_SFREQ%block;
+            if(retval > 0 && fabs(sST.s_cent - detune[d]) > maxErr) maxErr = fabs(sST.s_cent - detune[d]);
+            printf("%9.2f %7.1f %8.2f %10.3f %7u%s\n", noteFreq[n], detune[d], sST.s_cent,
+                (double)sST.s_angle/65536.0, sST.s_level, retval > 0 ? "" : "  no phase");
+        }
+
+    printf("max. |cent error| %.2f, %.1f ns per sample, budget %.0f ns at %d Hz\n",
+        maxErr, secs*1e9/samples, 1e9/CHECK_SFREQ, CHECK_SFREQ);
+    return 0;
+} /* main */
@@ -0,0 +1,229 @@
+/*******************************************************************
+ @brief Decoder of the binary telemetry (lib/Telemetry) into a pitch track
+ @file tlm_decode.cpp
+ @author Juergen Boehm
+ @date 2025, May 6
+ @note Build on Linux from the repository root:
+    g++ -O2 -I lib/ADC_Lib -I lib/Telemetry -I lib/Corpus host/tlm_decode.cpp lib/Telemetry/Telemetry.cpp
+        lib/ADC_Lib/ADC_DataAnalysis.cpp lib/ADC_Lib/ADC_Sim.cpp lib/Corpus/Corpus.cpp -o tlm_decode
+ @note Usage:
+    tlm_decode [-r rawfile] [-c corpus] [input]   decode input (file, FIFO, serial device; default stdin)
+    tlm_decode -p [-r rawfile] [-c corpus]        decode from a new pty, its name is printed to stderr
+    tlm_decode -e frames [output]     emit simulated telemetry (like the ESP32) to output (default stdout)
+    Test without hardware:  tlm_decode -p > track.csv   and in a 2nd shell  tlm_decode -e 100 /dev/pts/N
+    or simply               tlm_decode -e 100 | tlm_decode
+ @note Pitch track (stdout), one line per result record:
+    # freq-tuner pitch track
+    time_s,freq_hz,note,cent,quality_s,periodes,used,flags
+    Raw frames go to rawfile (-r), one line per frame: seq,time_s,sFreq,len,samples...
+    and/or to a corpus file (-c, lib/Corpus) for replay by bench_engines and param_tuner.
+    Statistics (frames, CRC errors, lost frames) go to stderr.
+
+ Copyright (C) <2025>  <Juergen Boehm>
+********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <math.h>
+
+#include "ADC_DataAnalysis.h"
+#include "ADC_Sim.h"
+#include "Telemetry.h"
+#include "Corpus.h"
+
+#define EMIT_SFREQ (30000)
+#define EMIT_LEN (2000)
+#define EMIT_RAWEVERY (10)      // every 10th frame also as raw record
+
+struct sDecodeStat {
+    uint32_t frames, results, raws, errors, lost;
+    int32_t lastSeq;
+};
+
+// decodes one frame (without delimiter), writes track line or raw line and corpus frame
+static void decodeFrame(const uint8_t *frame, uint32_t len, FILE *track, FILE *raw, struct sCorpusWriter *corpus,
+    struct sDecodeStat *st) {
+    static uint8_t payload[TLMMAXPAYLOAD + 2];
+    static uint16_t samples[TLMMAXRAW];
+    struct sTlmResult r;
+    struct sCorpusFrame meta = {0};
+    uint32_t time, sFreq;
+    uint16_t seq;
+    int32_t n;
+    int i, ns;
+
+    if(!len) return;
+    n = tlmUnframe(frame, len, payload);
+    if(n < 0) {
+        st->errors++;     // CRC errors, also text lines between frames
+        return;
+    }
+    st->frames++;
+    if(tlmGetResult(payload, n, &r) == 0) {
+        st->results++;
+        if(st->lastSeq >= 0) st->lost += (uint16_t)(r.t_seq - st->lastSeq - 1);
+        st->lastSeq = r.t_seq;
+        fprintf(track, "%.6f,%.3f,%s,%.2f,%.3g,%u,%u,%u\n", r.t_time*1e-6, r.t_freq, r.t_note,
+            r.t_cent, r.t_quality, r.t_numPeriodes, r.t_usedLen, r.t_flags);
+        fflush(track);
+    }
+    else if((ns = tlmGetRaw(payload, n, &seq, &time, &sFreq, samples)) >= 0) {
+        st->raws++;
+        if(corpus && ns > 0) {
+            meta.f_len = (uint16_t)ns;
+            meta.f_sFreq = sFreq;
+            meta.f_time = time;
+            if(corpusAppend(corpus, &meta, samples) < 0) st->errors++;
+        }
+        if(!raw) return;
+        fprintf(raw, "%u,%.6f,%u,%d", seq, time*1e-6, sFreq, ns);
+        for(i = 0; i < ns; i++) fprintf(raw, ",%u", samples[i]);
+        fprintf(raw, "\n");
+    }
+}
+
+// reads fd until EOF and splits the stream at 0x00
+static int decodeStream(int fd, FILE *track, FILE *raw, struct sCorpusWriter *corpus) {
+    static uint8_t frame[TLMMAXFRAME];
+    uint8_t buf[512];
+    uint32_t len = 0;
+    bool overflow = false;
+    struct sDecodeStat st = {0, 0, 0, 0, 0, -1};
+    ssize_t n, i;
+
+    fprintf(track, "# freq-tuner pitch track\ntime_s,freq_hz,note,cent,quality_s,periodes,used,flags\n");
+    while((n = read(fd, buf, sizeof(buf))) > 0) {
+        for(i = 0; i < n; i++) {
+            if(buf[i]) {
+                if(len < sizeof(frame)) frame[len++] = buf[i];
+                else overflow = true;
+                continue;
+            }
+            if(overflow) st.errors++;
+            else decodeFrame(frame, len, track, raw, corpus, &st);
+            len = 0;
+            overflow = false;
+        }
+    }
+    fprintf(stderr, "%u frames (%u results, %u raw), %u errors, %u results lost\n",
+        st.frames, st.results, st.raws, st.errors, st.lost);
+    return 0;
+}
+
+// simulated ESP32: analysis of ADC_Sim frames as in getFreqNoteName, with log text in between
+static int emit(int frames, int fd) {
+    static const struct { float freq; const char *name; } notes[] = {
+        {82.41f, "E"}, {110.0f, "A"}, {146.83f, "d"}, {196.0f, "g"}, {246.94f, "h"}, {329.63f, "e1"}, {440.0f, "a1"}};
+    static uint16_t data[EMIT_LEN];
+    static uint8_t payload[TLMMAXPAYLOAD + 2], frame[TLMMAXFRAME];
+    const char logLine[] = "D (1234) FreqTune: Classic F=440.0[Hz]\n";
+    struct sADCData sAD = {0};
+    struct sTlmResult r;
+    float freq, detune;
+    int32_t n;
+    int note;
+
+    sAD.data = data;
+    sAD.d_sFreq = EMIT_SFREQ;
+    sAD.d_deltaTime = 1.0f/EMIT_SFREQ;
+    for(int f = 0; f < frames; f++) {
+        note = f/10 % (sizeof(notes)/sizeof(notes[0]));
+        detune = (float)(f%10 - 5)*2.0f;
+        freq = notes[note].freq*powf(2.0f, detune/1200.0f);
+        sAD.d_len = EMIT_LEN;
+        ADC_Sim(&sAD, 0, freq, 300);
+        peak_mean(&sAD, &sAD.d_max, &sAD.d_min, &sAD.d_mean);
+
+        memset(&r, 0, sizeof(r));
+        r.t_seq = (uint16_t)f;
+        r.t_time = (uint32_t)(f*1e6*EMIT_LEN/EMIT_SFREQ);
+        if(calcFreqAnalog(&sAD) >= 0) {
+            r.t_freq = sAD.d_freqClassic;
+            r.t_periode = sAD.d_periode;
+            r.t_quality = sAD.d_quality;
+            r.t_cent = 1200.0f*log2f(sAD.d_freqClassic/notes[note].freq);
+            r.t_numPeriodes = sAD.d_numPeriodes;
+            r.t_usedLen = (uint16_t)sAD.d_usedLen;
+            r.t_flags = TLMVALID | TLMGREEN;
+            strncpy(r.t_note, notes[note].name, 4);
+        }
+        n = tlmFrame(payload, tlmPutResult(&r, payload), frame, sizeof(frame));
+        if(n < 0 || write(fd, frame, n) != n) return 1;
+        if(f%EMIT_RAWEVERY == 0) {
+            n = tlmFrame(payload, tlmPutRaw(r.t_seq, r.t_time, EMIT_SFREQ, data, EMIT_LEN, payload), frame, sizeof(frame));
+            if(n < 0 || write(fd, frame, n) != n) return 1;
+        }
+        if(f%25 == 0 && write(fd, logLine, sizeof(logLine) - 1) < 0) return 1;
+    }
+    return 0;
+}
+
+// raw mode for serial devices and ptys, no echo or line editing
+static void setRaw(int fd) {
+    struct termios tio;
+
+    if(!isatty(fd) || tcgetattr(fd, &tio) < 0) return;
+    cfmakeraw(&tio);
+    tcsetattr(fd, TCSANOW, &tio);
+}
+
+int main(int argc, char *argv[]) {
+    const char *rawName = NULL, *corpusName = NULL;
+    int opt, fd, frames = 0, retval;
+    bool bPty = false;
+    FILE *raw = NULL;
+    struct sCorpusWriter corpus;
+
+    while((opt = getopt(argc, argv, "pr:c:e:")) != -1) {
+        switch(opt) {
+            case 'p': bPty = true; break;
+            case 'r': rawName = optarg; break;
+            case 'c': corpusName = optarg; break;
+            case 'e': frames = atoi(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-r rawfile] [-c corpus] [input] | -p [-r rawfile] [-c corpus]"
+                    " | -e frames [output]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if(frames > 0) {
+        fd = (optind < argc) ? open(argv[optind], O_WRONLY | O_NOCTTY) : STDOUT_FILENO;
+        if(fd < 0) { perror(argv[optind]); return 1; }
+        setRaw(fd);
+        retval = emit(frames, fd);
+        if(fd != STDOUT_FILENO) {
+            tcdrain(fd);
+            close(fd);
+        }
+        return retval;
+    }
+
+    if(bPty) {
+        fd = posix_openpt(O_RDWR | O_NOCTTY);
+        if(fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0) { perror("pty"); return 1; }
+        setRaw(fd);
+        fprintf(stderr, "telemetry pty: %s\n", ptsname(fd));
+    }
+    else if(optind < argc) {
+        fd = open(argv[optind], O_RDONLY | O_NOCTTY);
+        if(fd < 0) { perror(argv[optind]); return 1; }
+        setRaw(fd);
+    }
+    else fd = STDIN_FILENO;
+
+    if(rawName && !(raw = fopen(rawName, "w"))) { perror(rawName); return 1; }
+    // device: the input, e.g. /dev/ttyUSB0
+    if(corpusName && corpusCreate(&corpus, corpusName, (optind < argc) ? argv[optind] : "telemetry") < 0) {
+        perror(corpusName);
+        return 1;
+    }
+    retval = decodeStream(fd, stdout, raw, corpusName ? &corpus : NULL);
+    if(raw) fclose(raw);
+    if(corpusName && corpusFinish(&corpus) < 0) { perror(corpusName); retval = 1; }
+    return retval;
+} /* main */
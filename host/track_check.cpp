@@ -0,0 +1,158 @@
+/*******************************************************************
+ @brief Host check of the tracking mode (calcFreqTrack) against calcFreqAnalog on sustained notes
+ @file track_check.cpp
+ @author Juergen Boehm
+ @date 2025, May 15
+ @note Build on Linux from the repository root:
+    g++ -O2 -I lib/ADC_Lib host/track_check.cpp lib/ADC_Lib/ADC_Track.cpp lib/ADC_Lib/ADC_DataAnalysis.cpp -o track_check
+ @note Usage: track_check [-t targetCent] [-s spikes]
+    Per note CHECK_NOTEFRAMES frames of CHECK_LEN samples of a held tone with drift and vibrato,
+    noise and -s spikes per 1000 samples (default 2) of +-1500. Each frame is analysed by
+    calcFreqAnalog and by calcFreqTrack with the periode of the last tracked (or full) result,
+    falling back to calcFreqAnalog on loss of lock. Prints cycles per frame of both, frames
+    in lock, rms and median error [cent] of each (against the mean frequency of the samples used), the
+    samples used and how the note changes ended the lock.
+
+ Copyright (C) <2025>  <Juergen Boehm>
+********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <float.h>
+#if defined __x86_64__ || defined __i386__
+#include <x86intrin.h>    // __rdtsc
+#endif
+
+#include "ADC_DataAnalysis.h"
+#include "ADC_Track.h"
+
+#define CHECK_SFREQ (30000)
+#define CHECK_LEN (2000)
+#define CHECK_NOISE (300)
+#define CHECK_NOTEFRAMES (200)
+#define CHECK_RATE (5.0f)       // vibrato [Hz]
+#define CHECK_DEPTH (10.0f)     // vibrato amplitude [cent]
+#define CHECK_DRIFT (3.0f)      // [cent/s]
+
+static uint64_t ticks(void) {
+#if defined __x86_64__ || defined __i386__
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000ull + ts.tv_nsec;
+#endif
+}
+
+static int cmpFloat(const void *a, const void *b) {
+    float d = *(const float *)a - *(const float *)b;
+    return (d > 0.0f) - (d < 0.0f);
+}
+
+/*
+ @brief Next len samples of the held tone with spikes, phase and time kept by the caller
+ @param[out] fInst: frequency at each sample [Hz]
+*/
+static void heldTone(uint16_t *data, float *fInst, uint32_t len, float freq, int spikes, double *phase, double *time) {
+    double f, v;
+
+    for(uint32_t i = 0; i < len; i++, *time += 1.0/CHECK_SFREQ) {
+        f = freq*pow(2.0, (CHECK_DRIFT*(*time) + CHECK_DEPTH*sin(2.0*M_PI*CHECK_RATE*(*time)))/1200.0);
+        fInst[i] = (float)f;
+        *phase += 2.0*M_PI*f/CHECK_SFREQ;
+        v = 2000.0 + 1200.0*sin(*phase) + 300.0*sin(2.0*(*phase) + 1.0) + rand()%CHECK_NOISE - CHECK_NOISE/2;
+        if(rand()%1000 < spikes)  v += (rand() & 1) ? 1500.0 : -1500.0;
+        data[i] = (uint16_t)(v < 0.0 ? 0.0 : (v > 4095.0 ? 4095.0 : v));
+    }
+}
+
+// error of a result [cent] against the mean frequency of the samples used, 1e6 for none
+static float centError(const struct sADCData *sAD, int retval, const float *fInst) {
+    double sum = 0.0;
+
+    if(retval < 0 || sAD->d_periode >= FLT_MAX || !sAD->d_usedLen)  return 1e6f;
+    for(uint32_t i = 0; i < sAD->d_usedLen; i++)  sum += fInst[i];
+    return 1200.0f*log2f(sAD->d_usedLen/(sAD->d_periode*sum));
+}
+
+static void stats(float *err, uint32_t n, float *rms, float *med) {
+    double sum = 0.0;
+    uint32_t k = 0;
+
+    for(uint32_t i = 0; i < n; i++) {
+        if(err[i] >= 1e6f)  continue;
+        sum += err[i]*err[i];
+        err[k++] = fabsf(err[i]);
+    }
+    qsort(err, k, sizeof(float), cmpFloat);
+    *rms = k ? (float)sqrt(sum/k) : 0.0f;
+    *med = k ? err[k/2] : 0.0f;
+}
+
+int main(int argc, char **argv) {
+    static const float noteFreq[] = {82.41f, 110.0f, 146.83f, 196.0f, 246.94f, 329.63f, 440.0f, 880.0f};
+    static uint16_t data[CHECK_LEN];
+    static float errFull[CHECK_NOTEFRAMES], errTrack[CHECK_NOTEFRAMES], fInst[CHECK_LEN];
+    struct sADCData sAD = {0}, sTrack;
+    float targetCent = 0.0f, prev = 0.0f, rmsF, medF, rmsT, medT;
+    int spikes = 2, retval, lostAtChange = 0;
+    uint64_t t0, cycFull, cycTrack;
+    uint32_t locked, usedFull, usedTrack;
+    double phase = 0.0, time = 0.0;
+
+    for(int a = 1; a < argc; a++) {
+        if(!strcmp(argv[a], "-t") && a + 1 < argc)  targetCent = atof(argv[++a]);
+        else if(!strcmp(argv[a], "-s") && a + 1 < argc)  spikes = atoi(argv[++a]);
+        else {
+            fprintf(stderr, "usage: %s [-t targetCent] [-s spikes per 1000 samples]\n", argv[0]);
+            return 1;
+        }
+    }
+    sAD.data = data;
+    sAD.d_sFreq = CHECK_SFREQ;
+    sAD.d_deltaTime = 1.0f/CHECK_SFREQ;
+    sAD.d_targetCent = targetCent;
+    srand(1);
+    printf("%d frames of %d samples per note, noise %d, %d spikes per 1000 samples, targetCent %.2f\n",
+        CHECK_NOTEFRAMES, CHECK_LEN, CHECK_NOISE, spikes, targetCent);
+    printf("%9s %10s %10s %7s %8s %8s %8s %8s %7s %7s\n", "note[Hz]", "cyc full", "cyc track", "locked",
+        "rms full", "med full", "rms trk", "med trk", "used f", "used t");
+    for(unsigned n = 0; n < sizeof(noteFreq)/sizeof(noteFreq[0]); n++) {
+        cycFull = cycTrack = 0;
+        locked = usedFull = usedTrack = 0;
+        for(uint32_t f = 0; f < CHECK_NOTEFRAMES; f++) {
+            heldTone(data, fInst, CHECK_LEN, noteFreq[n], spikes, &phase, &time);
+            sAD.d_len = CHECK_LEN;
+            peak_mean_sparse(&sAD, &sAD.d_max, &sAD.d_min, &sAD.d_mean);
+            sTrack = sAD;
+
+            t0 = ticks();
+            retval = calcFreqAnalog(&sAD);
+            cycFull += ticks() - t0;
+            errFull[f] = centError(&sAD, retval, fInst);
+            usedFull += sAD.d_usedLen;
+
+            t0 = ticks();
+            retval = calcFreqTrack(&sTrack, prev);
+            if(retval == -9)  {
+                if(!f && prev > 0.0f)  lostAtChange++;
+                retval = calcFreqAnalog(&sTrack);
+            }
+            else if(retval >= 0)  locked++;
+            cycTrack += ticks() - t0;
+            errTrack[f] = centError(&sTrack, retval, fInst);
+            usedTrack += sTrack.d_usedLen;
+            prev = (retval >= 0 && classifyResult(&sTrack) > 0) ? sTrack.d_periode : 0.0f;
+        }
+        stats(errFull, CHECK_NOTEFRAMES, &rmsF, &medF);
+        stats(errTrack, CHECK_NOTEFRAMES, &rmsT, &medT);
+        printf("%9.2f %10.0f %10.0f %6.1f%% %8.2f %8.2f %8.2f %8.2f %7u %7u\n", noteFreq[n],
+            (double)cycFull/CHECK_NOTEFRAMES, (double)cycTrack/CHECK_NOTEFRAMES, 100.0f*locked/CHECK_NOTEFRAMES,
+            rmsF, medF, rmsT, medT, usedFull/CHECK_NOTEFRAMES, usedTrack/CHECK_NOTEFRAMES);
+    }
+    printf("lock lost at %d of %d note changes\n", lostAtChange, (int)(sizeof(noteFreq)/sizeof(noteFreq[0])) - 1);
+    return 0;
+} /* main */
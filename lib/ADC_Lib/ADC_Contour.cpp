@@ -0,0 +1,197 @@
+/**********************************************************
+ @brief Pitch contour of calcFreqAnalog: ring buffer of per periode cent values, drift and vibrato
+ @file ADC_Contour.cpp
+ @author Juergen Boehm
+ @date 2025, May 12
+ @include ADC_Contour.h
+ @note Compiler: GCC under Win32, Linux resp. Espressif
+ @note RAM: sizeof(struct sPitchContour), 4 kByte with CONTOURLEN 512; contourStats
+        needs CONTOURLEN floats on the stack
+
+ Copyright (C) <2025>  <Juergen Boehm>
+***********************************************************/
+#if defined _WIN32 || defined __linux__
+#include <stdio.h>
+#include <stdlib.h>
+#elif defined ESP32
+#include <Arduino.h>
+#endif
+
+#include <stdint.h>
+#include <math.h>     // log2f, sqrtf, sinf, cosf
+
+#include "ADC_Contour.h"
+
+// 1200/ln(2): cent of a small relative frequency difference
+#define CENTPERLN (1731.234f)
+// residuals are smoothed over this time before the vibrato crossings [s], well below a periode of 8Hz
+#define CONTOURSMOOTH (0.02f)
+
+
+/*** private functions ***/
+
+// point i of the last n (starting at first)
+static inline const struct sContourPoint *point(const struct sPitchContour *c, uint32_t first, uint32_t i) {
+    return &c->c_pt[(first + i) & (CONTOURLEN - 1)];
+}
+
+// seconds of point p from t0
+static inline float pointTime(const struct sContourPoint *p, uint32_t t0) {
+    return (float)(p->p_time - t0)*1e-6f;
+}
+
+/************************************************************************
+ * @brief Least squares of cent = m + drift*(t-mt) + a*cos(omega*(t-mt)) + b*sin(omega*(t-mt))
+ *   over the last n points: the drift without the part of the vibrato that is
+ *   not whole cycles within the window. Normal equations by Gauss elimination.
+ * @return 0, -1 singular (too few points per vibrato cycle)
+*************************************************************************/
+static int fitDriftVibrato(const struct sPitchContour *c, uint32_t first, uint32_t n, uint32_t t0, float mt,
+        float omega, float *drift, float *depth) {
+    float m[4][5] = {{0.0f}}, g[4], t, q;
+    const struct sContourPoint *p;
+    uint32_t i;
+    int j, k, l, piv;
+
+    for(i = 0; i < n; i++) {
+        p = point(c, first, i);
+        t = pointTime(p, t0) - mt;
+        g[0] = 1.0f;
+        g[1] = t;
+        g[2] = cosf(omega*t);
+        g[3] = sinf(omega*t);
+        for(j = 0; j < 4; j++) {
+            for(k = j; k < 4; k++)  m[j][k] += g[j]*g[k];
+            m[j][4] += g[j]*p->p_cent;
+        }
+    }
+    for(j = 1; j < 4; j++)
+        for(k = 0; k < j; k++)  m[j][k] = m[k][j];
+    for(j = 0; j < 4; j++) {
+        for(piv = j, k = j + 1; k < 4; k++)
+            if(fabsf(m[k][j]) > fabsf(m[piv][j]))  piv = k;
+        if(fabsf(m[piv][j]) <= 1e-6f*m[0][0])  return -1;
+        if(piv != j)
+            for(l = j; l < 5; l++) { q = m[j][l];  m[j][l] = m[piv][l];  m[piv][l] = q; }
+        for(k = j + 1; k < 4; k++) {
+            q = m[k][j]/m[j][j];
+            for(l = j; l < 5; l++)  m[k][l] -= q*m[j][l];
+        }
+    }
+    for(j = 3; j >= 0; j--) {
+        for(l = j + 1; l < 4; l++)  m[j][4] -= m[j][l]*m[l][4];
+        m[j][4] /= m[j][j];
+    }
+    *drift = m[1][4];
+    *depth = sqrtf(m[2][4]*m[2][4] + m[3][4]*m[3][4]);
+    return 0;
+} /* fitDriftVibrato */
+
+
+/*** public functions ***/
+
+void contourSetRef(struct sPitchContour *c, float refFreq) {
+    c->c_refFreq = refFreq;
+    c->c_count = 0;
+} /* contourSetRef */
+
+void contourAdd(struct sPitchContour *c, uint32_t time, float cent) {
+    struct sContourPoint *p = &c->c_pt[c->c_count & (CONTOURLEN - 1)];
+
+    p->p_time = time;
+    p->p_cent = cent;
+    c->c_count++;
+} /* contourAdd */
+
+/************************************************************************
+ * @brief 1200*log2(ratio): ln(1+d) as polynomial near 1 (error < 0.002 cent within +-100 cent)
+*************************************************************************/
+float contourCent(float ratio) {
+    float d = ratio - 1.0f;
+
+    if(d > -0.056f && d < 0.06f)  return CENTPERLN*d*(1.0f - d*(0.5f - d*(1.0f/3.0f - 0.25f*d)));
+    return 1200.0f*log2f(ratio);
+} /* contourCent */
+
+/************************************************************************
+ * @brief Least squares line through the last n points gives mean and drift.
+ *   The residuals, smoothed over CONTOURSMOOTH, give the vibrato: depth from their rms,
+ *   rate from the upward crossings of +-CONTOURHYST*rms.
+ *   With a vibrato, drift and depth come from a fit of line and sine at that rate
+ *   (fitDriftVibrato): the line alone tilts by the incomplete vibrato cycle.
+ * @return 0, 1 without vibrato, <0 for errors
+*************************************************************************/
+int contourStats(const struct sPitchContour *c, uint16_t n, struct sContourStats *st) {
+    float res[CONTOURLEN], t, mt = 0.0f, mc = 0.0f, sxx = 0.0f, sxy = 0.0f, rms = 0.0f, h, sum, tUp = 0.0f, tFirst = 0.0f, r;
+    uint32_t first, t0, i, w, ups = 0;
+    const struct sContourPoint *p;
+    bool high = true;
+
+    if(!c || !st)  return -3;
+    if(!n || n > CONTOURLEN || n > c->c_count)  n = (c->c_count < CONTOURLEN) ? c->c_count : CONTOURLEN;
+    st->s_num = n;
+    st->s_vibRate = st->s_vibDepth = 0.0f;
+    if(n < 3)  return -7;
+    first = c->c_count - n;
+    t0 = point(c, first, 0)->p_time;
+
+    // means, then slope
+    for(i = 0; i < n; i++) {
+        p = point(c, first, i);
+        mt += pointTime(p, t0);
+        mc += p->p_cent;
+    }
+    mt /= n;
+    mc /= n;
+    for(i = 0; i < n; i++) {
+        p = point(c, first, i);
+        t = pointTime(p, t0) - mt;
+        sxx += t*t;
+        sxy += t*(p->p_cent - mc);
+    }
+    st->s_meanCent = mc;
+    st->s_drift = (sxx > 0.0f) ? sxy/sxx : 0.0f;
+    st->s_span = pointTime(point(c, first, n - 1), t0);
+    if(st->s_span <= 0.0f)  return -6;
+
+    // residuals, smoothed by a centred running mean over w points (less at the ends)
+    w = (uint32_t)(CONTOURSMOOTH*n/st->s_span) | 1;
+    for(i = 0; i < n; i++) {
+        p = point(c, first, i);
+        res[i] = p->p_cent - mc - st->s_drift*(pointTime(p, t0) - mt);
+    }
+    for(i = 0, sum = 0.0f; i < n + w/2; i++) {
+        if(i < n)  sum += res[i];
+        if(i >= w) {    // res[i-w] is overwritten already: recalculated
+            p = point(c, first, i - w);
+            sum -= p->p_cent - mc - st->s_drift*(pointTime(p, t0) - mt);
+        }
+        if(i >= w/2) {
+            r = (float)((i < w ? i + 1 : w) - (i >= n ? i + 1 - n : 0));
+            res[i - w/2] = sum/r;
+        }
+    }
+    for(i = 0; i < n; i++)  rms += res[i]*res[i];
+    rms = sqrtf(rms/n);
+    st->s_vibDepth = 1.41421356f*rms;
+    if(rms < CONTOURMINDEPTH)  return 1;
+
+    // upward crossings with hysteresis
+    h = CONTOURHYST*rms;
+    for(i = 0; i < n; i++) {
+        if(high) {
+            if(res[i] < -h)  high = false;
+            continue;
+        }
+        if(res[i] > h) {
+            high = true;
+            tUp = pointTime(point(c, first, i), t0);
+            if(!ups)  tFirst = tUp;
+            ups++;
+        }
+    }
+    if(ups < CONTOURMINCYCLES + 1 || tUp <= tFirst)  return 1;
+    st->s_vibRate = (float)(ups - 1)/(tUp - tFirst);
+    fitDriftVibrato(c, first, n, t0, mt, 2.0f*(float)M_PI*st->s_vibRate, &st->s_drift, &st->s_vibDepth);
+    return 0;
+} /* contourStats */
@@ -0,0 +1,64 @@
+/****************************************************
+ * @file ADC_Contour.h
+ * @brief Pitch contour: one time stamped cent value per periode found by calcFreqAnalog
+ * @note With PITCHCONTOUR (ADC_DataAnalysis.h) calcFreqAnalog fills the ring buffer of
+ *    sADCData.d_contour (if not NULL) from the side change positions it has anyway.
+ *    Without it the analysis does not refer to this file.
+ *    The crossing of each edge is interpolated between
+ *    the two samples around the upper threshold, so a periode is not quantised to whole samples
+ *    (68 samples of a1 at 30000Hz would give steps of 25 cent).
+ *    Periodes off d_periode by more than 1/4 (spurious or missed crossings) and frames with
+ *    an octave correction (d_octaveShift) are skipped.
+ * @note Cost per periode: two samples, a division and a short polynomial for the cent value.
+ * @note contourStats derives mean, linear drift and vibrato (rate, depth) from the last points,
+ *    in one pass plus one over the residuals, and with a vibrato a fit of line and sine at its rate
+ *    (a line alone tilts by the part of the vibrato that is not whole cycles). No FFT, no sorting.
+*****************************************************/
+
+#ifndef ADCCONTOUR_H
+#define ADCCONTOUR_H
+
+#include <stdint.h>
+
+// points in the ring buffer, power of 2. 512 hold 1.2s of a1, 6s of E (8 bytes each)
+#define CONTOURLEN (512)
+// hysteresis of the vibrato crossings in multiples of the rms of the residuals
+#define CONTOURHYST (0.5f)
+// minimum vibrato: rms of residuals [cent] and number of cycles
+#define CONTOURMINDEPTH (2.0f)
+#define CONTOURMINCYCLES (2)
+
+struct sContourPoint {
+  uint32_t p_time;        // middle of the periode [us], c_frameTime based
+  float p_cent;           // instantaneous frequency against c_refFreq [cent]
+};
+
+struct sPitchContour {
+  float c_refFreq;        // reference of p_cent [Hz], signal domain. 0: 1/d_periode of the next frame
+  uint32_t c_frameTime;   // time of the first sample of the frame [us], set by the caller before analysis
+  uint32_t c_count;       // points written since contourSetRef, the last at c_count-1 & (CONTOURLEN-1)
+  struct sContourPoint c_pt[CONTOURLEN];
+};
+
+struct sContourStats {
+  uint16_t s_num;         // points used
+  float s_span;           // time from first to last point [s]
+  float s_meanCent;       // mean against c_refFreq
+  float s_drift;          // linear drift [cent/s], slope of line and vibrato sine fitted together
+  float s_vibRate;        // vibrato rate [Hz], 0 if none was found
+  float s_vibDepth;       // vibrato depth [cent], amplitude of the fitted sine (without vibrato sqrt(2)*rms of the residuals)
+};
+
+// sets the reference and clears the points
+void contourSetRef(struct sPitchContour *, float refFreq);
+// appends a point, overwriting the oldest when full
+void contourAdd(struct sPitchContour *, uint32_t time, float cent);
+// cent of a frequency ratio: polynomial within +-100 cent, else log2f
+float contourCent(float ratio);
+/*
+  @brief Mean, drift and vibrato of the last n points (all if n==0 or more are asked for)
+  @return 0, 1 without vibrato (s_vibRate 0), <0 for errors (less than 3 points)
+*/
+int contourStats(const struct sPitchContour *, uint16_t n, struct sContourStats *);
+
+#endif
@@ -27,13 +27,270 @@
 #include <math.h>   // sqrtf
 #include <float.h>    // FLT_MIN
 #include <stdbool.h>
+#include <string.h>   // memset
 
 #include "ADC_DataAnalysis.h"
+#ifdef PITCHCONTOUR
+#include "ADC_Contour.h"
+#endif
 
 #ifdef FLTERDATA
 #include "filter.h"
 #endif
 
+const struct sADCParams gADCDefaultParams = {MAXADCDIFF, ANASPANDIV, MINTICDIFF, MAXSIDECHANGES, MINFREQQUALITY, MINFREQDIFF};
+
+/*** private functions ***/
+
+/*********************************************************
+ * @brief Finds the k-th smallest item of a[0..n-1] by quickselect (O(n) on average)
+ * @note Reorders a[] !
+**********************************************************/
+static uint16_t selectKth(uint16_t *a, uint16_t n, uint16_t k) {
+    uint16_t left = 0, right = n-1, pivot, temp;
+    int32_t i, j;
+
+    while(left < right) {
+        pivot = a[(left + right) >> 1];
+        i = left;  j = right;
+        while(i <= j) {
+            while(a[i] < pivot) i++;
+            while(a[j] > pivot) j--;
+            if(i <= j) {
+                temp = a[i];  a[i] = a[j];  a[j] = temp;
+                i++;  j--;
+            }
+        }
+        if(k <= j) right = j;
+        else if(k >= i) left = i;
+        else break;
+    }
+    return a[k];
+} /* selectKth */
+
+// periode i between rising edges pos (high NULL) or between the falling edges pos+high
+static inline uint32_t periodeAt(const uint32_t *pos, const uint16_t *high, uint16_t i) {
+    return high ? (pos[i+1] + high[i+1]) - (pos[i] + high[i]) : pos[i+1] - pos[i];
+}
+
+/*********************************************************
+ * @brief Robust mean and standard deviation of periodes between n+1 positions.
+ *        Periodes off the median by more than ROBUSTMADK times the (scaled) median absolute deviation,
+ *        or beyond 3/4 resp. 3/2 of the median (double crossings, missed periodes) are rejected.
+ * @param[in] pos: n+1 side change positions
+ * @param[in] high: NULL, or n+1 high times after pos: periodes of the falling edges (DUALEDGE)
+ * @param[in] dlt: room for n periodes (workspace)
+ * @param[out] mean, stdev: in samples
+ * @param[out] numUsed, numRejected: periodes used resp. rejected
+ * @return <0, if no periode is left
+**********************************************************/
+static int robustPeriode(const uint32_t *pos, const uint16_t *high, uint16_t n, uint16_t *dlt, float *mean, float *stdev, uint16_t *numUsed, uint16_t *numRejected) {
+    uint16_t median, mad, lo, hi, used=0, i;
+    uint32_t sum=0, d;
+    float ftemp, var=0.0f;
+
+    for(i=0; i<n; i++) {
+        d = periodeAt(pos, high, i);
+        dlt[i] = (d > 0xFFFF) ? 0xFFFF : (uint16_t)d;
+    }
+    median = selectKth(dlt, n, n/2);
+    for(i=0; i<n; i++)  dlt[i] = (dlt[i] > median) ? dlt[i] - median : median - dlt[i];
+    mad = selectKth(dlt, n, n/2);
+
+    // 1.4826*MAD estimates sigma of normal distributed periodes. Integer periodes need some slack.
+    d = (uint32_t)(ROBUSTMADK*1.4826f*mad + 0.5f);
+    if(d < ROBUSTMINDEV) d = ROBUSTMINDEV;
+    lo = (median > d) ? median - d : 0;
+    if(lo < median - median/4) lo = median - median/4;
+    hi = (median + d > 0xFFFF) ? 0xFFFF : median + d;
+    if(hi > median + median/2) hi = median + median/2;
+
+    for(i=0; i<n; i++) {
+        d = periodeAt(pos, high, i);
+        if(d < lo || d > hi) continue;
+        sum += d;
+        used++;
+    }
+    *numUsed = used;
+    *numRejected = n - used;
+    if(!used) return -1;
+    *mean = (float)sum/(float)used;
+
+    if(used >= 2) {
+        for(i=0; i<n; i++) {
+            d = periodeAt(pos, high, i);
+            if(d < lo || d > hi) continue;
+            ftemp = (float)d - *mean;
+            var += ftemp*ftemp;
+        }
+        *stdev = sqrtf(var/(float)(used-1));
+    }
+    else *stdev = 0.0f;
+    return 0;
+} /* robustPeriode */
+
+
+/*********************************************************
+ * @brief Normalized difference of data and data shifted by a fractional lag
+ *        using (at most) OCTAVETERMS items spread over the buffer.
+ *        Each item lies at a pseudo random place within its stride (fixed sequence,
+ *        the same for every lag): a fixed stride may alias with a harmonic at the lag.
+ * @return 0 for identical, 1 for uncorrelated, up to 2 for inverted signal, <0 if lag is too large
+**********************************************************/
+static float lagDifference(const struct sADCData *sAD, float mean, float lag) {
+    uint32_t iLag = (uint32_t)lag, len = sAD->d_len, avail, step, base, i, seed = 12345u;
+    float frac = lag - (float)iLag, x, y, diff = 0.0f, energy = 0.0f;
+
+    if(iLag + 2 >= len) return -1.0f;
+    avail = len - iLag - 1;
+    step = avail/OCTAVETERMS;
+    if(!step) step = 1;
+    for(base = 0; base < avail; base += step) {
+        seed = seed*1664525u + 1013904223u;     // LCG, upper bits used
+        i = base + (seed >> 16)%step;
+        if(i >= avail)  break;
+        x = (float)ADC_Sample(sAD, i) - mean;
+        y = (float)ADC_Sample(sAD, i+iLag)*(1.0f-frac) + (float)ADC_Sample(sAD, i+iLag+1)*frac - mean;   // linear interpolation
+        diff += (x-y)*(x-y);
+        energy += x*x + y*y;
+    }
+    if(energy <= FLT_MIN) return -1.0f;
+    return diff/energy;
+} /* lagDifference */
+
+#ifdef PITCHCONTOUR
+/*********************************************************
+ * @brief Appends the periodes between the n side changes in pos to d_contour.
+ *        Each edge is interpolated between the samples around the upper threshold,
+ *        periodes off d_periode by more than 1/4 are skipped.
+**********************************************************/
+static void contourFrame(const struct sADCData *sAD, const uint32_t *pos, uint16_t n, uint16_t upper) {
+    struct sPitchContour *c = sAD->d_contour;
+    float periode = sAD->d_periode/sAD->d_deltaTime, refPeriode, edge, last = 0.0f, frac, usPerSample;
+    uint16_t x0, x1;
+
+    if(c->c_refFreq <= 0.0f)  c->c_refFreq = 1.0f/sAD->d_periode;
+    refPeriode = (float)sAD->d_sFreq/c->c_refFreq;     // in samples
+    usPerSample = 1e6f*sAD->d_deltaTime;
+    for(uint16_t k = 0; k < n; k++) {
+        x0 = ADC_Sample(sAD, pos[k] - 1);   // pos >= a_minTicDiff >= 2
+        x1 = ADC_Sample(sAD, pos[k]);
+        frac = (x1 > x0) ? ((float)upper - x0)/(float)(x1 - x0) : 1.0f;
+        if(frac < 0.0f) frac = 0.0f;
+        else if(frac > 1.0f) frac = 1.0f;
+        edge = (float)(pos[k] - 1) + frac;
+        if(k && edge - last >= 0.75f*periode && edge - last <= 1.25f*periode)
+            contourAdd(c, c->c_frameTime + (uint32_t)(0.5f*(last + edge)*usPerSample), contourCent(refPeriode/(edge - last)));
+        last = edge;
+    }
+} /* contourFrame */
+#endif
+
+#ifdef DUALEDGE
+/*********************************************************
+ * @brief Combines the periodes of the falling edges with the result of the rising ones
+ *        (d_periode, d_quality, d_numPeriodes) and measures the duty cycle.
+ *        Both means come from independent edges, so each is weighted by the inverse of its
+ *        variance (periode variance/n^2, as the mean telescopes to first and last edge):
+ *        about sqrt(2) less error than the rising edges alone. d_quality is the pooled stdev.
+ * @param[in] pos, high: numFalls rising edges and the high time after each
+ * @param[in] dlt: workspace of numFalls periodes
+**********************************************************/
+static void dualEdge(struct sADCData *sAD, const uint32_t *pos, const uint16_t *high, uint16_t numFalls, uint16_t *dlt) {
+    float meanR, varR, meanF, varF, stdevF, wR, wF;
+    uint16_t nR = sAD->d_numPeriodes, usedF, rejectedF, i;
+
+    if(numFalls < 3)  return;
+    if(robustPeriode(pos, high, numFalls-1, dlt, &meanF, &stdevF, &usedF, &rejectedF) < 0)  return;
+    meanR = sAD->d_periode/sAD->d_deltaTime;     // in samples
+    varR = sAD->d_quality/sAD->d_deltaTime;
+    varR *= varR;
+
+    // median high time: robust against a spurious crossing within a periode
+    for(i = 0; i < numFalls; i++)  dlt[i] = high[i];
+    sAD->d_duty = (float)selectKth(dlt, numFalls, numFalls/2)/meanR;
+    if(nR < 2 || usedF < 2)  return;
+
+    varF = stdevF*stdevF;
+    wR = (float)nR*nR/(varR > 1.0f/6.0f ? varR : 1.0f/6.0f);     // at least the quantisation of two edges
+    wF = (float)usedF*usedF/(varF > 1.0f/6.0f ? varF : 1.0f/6.0f);
+    sAD->d_periode = (wR*meanR + wF*meanF)/(wR + wF)*sAD->d_deltaTime;
+    sAD->d_quality = sqrtf(((nR-1)*varR + (usedF-1)*varF)/(float)(nR + usedF - 2))*sAD->d_deltaTime;
+    sAD->d_numFalling = usedF;
+    sAD->d_numRejected += rejectedF;
+} /* dualEdge */
+#endif
+
+/*********************************************************
+ * @brief peak_mean of packed 12 bit data: reads 3 bytes, two samples per step
+ * @note FLTERDATA is not applied to packed data
+**********************************************************/
+static void peak_mean_packed(const struct sADCData *sAD, uint16_t *max_value, uint16_t *min_value, uint16_t *mean_value) {
+    const uint8_t *pp = sAD->pdata;
+    uint32_t mean = 0, i, len = sAD->d_len;
+    uint16_t v0, v1, maxv, minv;
+
+    maxv = minv = unpack12At(pp, 0);
+    for(i = 0; i + 1 < len; i += 2, pp += 3) {
+        v0 = (uint16_t)(pp[0] | ((pp[1] & 0x0F) << 8));
+        v1 = (uint16_t)((pp[1] >> 4) | (pp[2] << 4));
+        if(v0 > maxv)       maxv = v0;
+        else if(v0 < minv)  minv = v0;
+        if(v1 > maxv)       maxv = v1;
+        else if(v1 < minv)  minv = v1;
+        mean += (uint32_t)v0 + v1;
+    }
+    if(i < len) {   // odd length
+        v0 = (uint16_t)(pp[0] | ((pp[1] & 0x0F) << 8));
+        if(v0 > maxv)       maxv = v0;
+        else if(v0 < minv)  minv = v0;
+        mean += v0;
+    }
+    *max_value = maxv;
+    *min_value = minv;
+    *mean_value = (uint16_t)(mean/len);
+} /* peak_mean_packed */
+
+/*** public functions ***/
+
+/*********************************************************
+ * @brief Packs the lower 12 bits of len samples into out (see PACKED12BYTES),
+ *        starting at sample offset of out. Capture in chunks packs each chunk 
+ *        right after reading, so only the chunk needs a uint16_t (DMA) buffer.
+ * @param[in] offset: even, as two samples share 3 bytes
+ * @return number of bytes written, 0 for odd offset
+**********************************************************/
+uint32_t pack12(const uint16_t *in, uint32_t len, uint8_t *out, uint32_t offset) {
+    uint16_t a, b;
+    uint32_t i;
+
+    if(offset & 1)  return 0;
+    out += (offset >> 1)*3;
+    for(i = 0; i + 1 < len; i += 2, out += 3) {
+        a = in[i] & 0x0FFF;
+        b = in[i+1] & 0x0FFF;
+        out[0] = (uint8_t)a;
+        out[1] = (uint8_t)((a >> 8) | (b << 4));
+        out[2] = (uint8_t)(b >> 4);
+    }
+    if(i < len) {   // odd length, upper half stays 0
+        a = in[i] & 0x0FFF;
+        out[0] = (uint8_t)a;
+        out[1] = (uint8_t)(a >> 8);
+        out[2] = 0;
+    }
+    return PACKED12BYTES(len);
+} /* pack12 */
+
+/*********************************************************
+ * @brief Unpacks len samples starting at sample offset of in
+**********************************************************/
+void unpack12(const uint8_t *in, uint32_t offset, uint32_t len, uint16_t *out) {
+    uint32_t i;
+
+    for(i = 0; i < len; i++)  out[i] = unpack12At(in, offset + i);
+} /* unpack12 */
+
 /*********************************************************
  * @brief Calculates min, max and mean from (mean filtered) ADC data
  * @param[in] sAD: pointer to global ADC structure populated with a data buffer, its length and sample frequency
@@ -46,6 +303,10 @@ void peak_mean(struct sADCData *sAD, uint16_t *max_value, uint16_t *min_value, u
     uint32_t mean;   // bufferlength*(2^16) should fit within 32 bit (for 16 bit AC data)!
     uint16_t *pb;
     
+    if(sAD->pdata) {
+      peak_mean_packed(sAD, max_value, min_value, mean_value);
+      return;
+    }
     pb = sAD->data;
     mean = (int32_t)pb[0]; 
     *max_value = pb[0];
@@ -69,6 +330,98 @@ void peak_mean(struct sADCData *sAD, uint16_t *max_value, uint16_t *min_value, u
     *mean_value = (uint16_t)mean;
   } /* peak_mean */
 
+/*********************************************************
+ * @brief Estimates thresholds for calcFreqAnalog from a jittered subsample
+ *        of about d_len/SPARSESTRIDE items instead of scanning all data.
+ *        Max and min are replaced by the SPARSEHIGHPM resp. SPARSELOWPM percentiles
+ *        taken from a histogram of SPARSEBINS bins.
+ * @note Error bound: Percentiles of the subsample always lie within min..max of the full scan.
+ *       The estimate is used only, if 2 standard errors of the mean plus the bin width 
+ *       are below (high-low)/SPARSEERRDIV. Otherwise (and for small signals below SPARSEMINSPAN
+ *       or short buffers) peak_mean is called instead.
+ *       The subsample is walked twice (min/max/mean, then histogram), 
+ *       thus it touches about 2/SPARSESTRIDE of the data.
+ * @param[in] sAD: pointer to global ADC structure populated with a data buffer, its length and sample frequency
+ * @param[out] *max_value   SPARSEHIGHPM percentile
+ * @param[out] *min_value   SPARSELOWPM percentile
+ * @param[out] *mean_value 
+ * @return 0 when estimated, 1 when full scan was used, <0 for errors
+**********************************************************/
+int peak_mean_sparse(struct sADCData *sAD, uint16_t *max_value, uint16_t *min_value, uint16_t *mean_value) {
+    uint16_t hist[SPARSEBINS], *pb, smin, smax, value;
+    uint32_t len, idx, rnd, n, sum, sumBins, limit;
+    uint64_t sumSq;     // 4095^2 * 500 does not fit into 32 bit
+    int shift, bin;
+    float fMean, fVar, span, err;
+
+    if(!sAD)  return -3;
+    pb = sAD->data;
+    if(!pb && !sAD->pdata)  return -4;
+    len = sAD->d_len;
+    if(!len) return -7;
+
+#ifndef FLTERDATA   // filtered data needs all items
+    if(len/SPARSESTRIDE >= SPARSEMINITEMS) {
+        // 1st walk: min, max, mean and variance of subsample
+        rnd = 0x2545F491u;  // fixed seed, so the 2nd walk visits the same items
+        smin = smax = ADC_Sample(sAD, 0);
+        sum = 0;  sumSq = 0;  n = 0;
+        for(idx = 0; idx < len; ) {
+            value = ADC_Sample(sAD, idx);
+            if(value > smax)       smax = value;
+            else if(value < smin)  smin = value;
+            sum += value;
+            sumSq += (uint32_t)value*value;
+            n++;
+            rnd = rnd*1664525u + 1013904223u;   // LCG, use high bits only
+            idx += 1 + ((rnd >> 24) & (2*SPARSESTRIDE - 1));
+        }
+
+        // bin width as power of 2 avoids a division per item
+        for(shift = 0; ((uint32_t)(smax - smin) >> shift) >= SPARSEBINS; shift++)  ;
+
+        // 2nd walk: histogram
+        for(bin = 0; bin < SPARSEBINS; bin++)  hist[bin] = 0;
+        rnd = 0x2545F491u;
+        for(idx = 0; idx < len; ) {
+            hist[(ADC_Sample(sAD, idx) - smin) >> shift]++;
+            rnd = rnd*1664525u + 1013904223u;
+            idx += 1 + ((rnd >> 24) & (2*SPARSESTRIDE - 1));
+        }
+
+        // percentiles: lower edge of low bin, upper edge of high bin
+        limit = (n*SPARSELOWPM)/1000;
+        for(bin = 0, sumBins = 0; bin < SPARSEBINS-1; bin++) {
+            sumBins += hist[bin];
+            if(sumBins > limit) break;
+        }
+        *min_value = smin + (bin << shift);
+        limit = (n*(1000-SPARSEHIGHPM))/1000;
+        for(bin = SPARSEBINS-1, sumBins = 0; bin > 0; bin--) {
+            sumBins += hist[bin];
+            if(sumBins > limit) break;
+        }
+        limit = smin + ((uint32_t)(bin+1) << shift) - 1;
+        *max_value = (limit > smax) ? smax : (uint16_t)limit;
+
+        // error check
+        fMean = (float)sum/(float)n;
+        fVar = (float)sumSq/(float)n - fMean*fMean;
+        if(fVar < 0.0f)  fVar = 0.0f;
+        err = 2.0f*sqrtf(fVar/(float)n) + (float)(1 << shift);
+        span = (float)(*max_value) - (float)(*min_value);
+        if(span >= SPARSEMINSPAN && err*SPARSEERRDIV < span) {
+            *mean_value = (uint16_t)(fMean + 0.5f);
+            return 0;
+        }
+    }
+#endif
+
+    // not reliable: scan all
+    peak_mean(sAD, max_value, min_value, mean_value);
+    return 1;
+} /* peak_mean_sparse */
+
   /************************************************************************
  * @brief Calculates frequency of analog signal (from periods, not the classical method)
  *        based on sample_frequency in sAD
@@ -82,36 +435,66 @@ void peak_mean(struct sADCData *sAD, uint16_t *max_value, uint16_t *min_value, u
  * @param[out] d_numCP      number of periods counted for d_freqClassic
  * @param[out] d_periode        mean of a (reduced) number of periods
  * @param[out] d_numPeriodes    count of periods used for quality measure 
+ * @param[out] d_numRejected    count of periods rejected as outliers (ROBUSTPERIODE)
  * @param[out] d_quality   standard deviation of signal's periode length
- * @return <0 for errors
+ * @param[in] d_targetCent  >0 enables early termination, when the standard error of the mean periode,
+ *                      estimated from the spread of the periodes so far, is below d_targetCent [cent] or pos buffer is full.
+ *                      Estimate-based stop after CONVERGEMINPERIODS periodes: with outliers or correlated jitter
+ *                      the error of d_periode may be larger than d_targetCent.
+ * @param[out] d_usedLen    number of samples scanned. The caller may shorten the next read accordingly.
+ * @param[in] d_params  thresholds and limits, NULL for the defines (ADC_Params)
+ * @param[out] d_contour  PITCHCONTOUR: if not NULL, a point per periode is appended (contourFrame)
+ * @param[out] d_numFalling, d_duty  DUALEDGE: falling edges are timed as well (dualEdge)
+ * @param[in] pos, dlt: workspace of a_maxSideChanges positions resp. periodes (stack or analyser arena)
+ * @param[in] high: workspace of a_maxSideChanges high times (DUALEDGE), else NULL
+ * @return <0 for errors, -8 for invalid d_params
 *************************************************************************/
-int calcFreqAnalog(struct sADCData *sAD) {
+static int calcFreqWork(struct sADCData *sAD, uint32_t *pos, uint16_t *dlt, uint16_t *high) {
     uint16_t sideChanges = 0, allPeriods = 0;    // counts sign changes
     uint16_t lower_wc, upper_wc;    // center band limits
     uint16_t *pb;
+    const uint8_t *pp, *pq;   // packed data or NULL, walking pointer
     uint32_t sFreq, len, firstPeriodeStart=-1;
-    uint16_t max_v, min_v, temp, minticdiff2 = MINTICDIFF >>1;
+    uint16_t max_v, min_v, temp, minticdiff2;
     float dTime;
     bool signal_side = false; // does the signal lie beyond threshold (true) or not?
-    uint32_t pos[MAXSIDECHANGES], mean=0, lastPos, utemp;   // stack overflow ???   
+    uint32_t lastPos, utemp;
     float ftemp, stdev=0.0f;    
     int32_t iValue;
+    float targetCent, sumD=0.0f, sumD2=0.0f, fn;   // running sums of periodes for early termination
+    uint16_t numD = 0;      // periodes in sumD
+#ifdef DUALEDGE
+    uint16_t numFalls = 0;  // high[] entries: falling edges after pos[0..numFalls-1]
+#else
+    (void)high;             // workspace of DUALEDGE only
+#endif
+    const struct sADCParams *par;
+    uint16_t maxAdcDiff, minTicDiff, maxSideChanges;
 
     // check input
     if(!sAD)  return -3;
     pb = sAD->data;
-    if(!pb)  return -4;
+    pp = sAD->pdata;
+    if(!pb && !pp)  return -4;
     sFreq = sAD->d_sFreq;
     if(!sFreq)  return -5;
     len = sAD->d_len;
     if(!len) return -7;
     dTime = sAD->d_deltaTime;
     if(dTime <= FLT_MIN) return -6;
+    targetCent = sAD->d_targetCent;
+    sAD->d_usedLen = len;
+    par = ADC_Params(sAD);
+    if(sAD->d_params && ADC_ParamsCheck(par) < 0)  return -8;
+    maxAdcDiff = par->a_maxAdcDiff;
+    minTicDiff = par->a_minTicDiff;
+    minticdiff2 = minTicDiff >> 1;
+    maxSideChanges = par->a_maxSideChanges;
 
     // check constant data signal
     max_v = sAD->d_max; 
     min_v = sAD->d_min;
-    if( max_v - min_v <= MAXADCDIFF) {
+    if( max_v - min_v <= maxAdcDiff) {
         sAD->d_freqClassic = 0.0f;
         sAD->d_numCP = 0;
         sAD->d_numPeriodes = 0;
@@ -120,25 +503,25 @@ int calcFreqAnalog(struct sADCData *sAD) {
     }
     
     // calculate center limits depending on data
-    lower_wc = sAD->d_mean - (sAD->d_mean - min_v)/ANASPANDIV;
-    if(lower_wc <= min_v + MAXADCDIFF) lower_wc = sAD->d_mean - MAXADCDIFF/2;  // for non-symmetric data
+    lower_wc = sAD->d_mean - (sAD->d_mean - min_v)/par->a_spanDiv;
+    if(lower_wc <= min_v + maxAdcDiff) lower_wc = sAD->d_mean - maxAdcDiff/2;  // for non-symmetric data
     
-    upper_wc = sAD->d_mean + (max_v - sAD->d_mean)/ANASPANDIV;   
-    if(upper_wc >= max_v - MAXADCDIFF) upper_wc = sAD->d_mean + MAXADCDIFF/2;  // for non-symmetric data
+    upper_wc = sAD->d_mean + (max_v - sAD->d_mean)/par->a_spanDiv;   
+    if(upper_wc >= max_v - maxAdcDiff) upper_wc = sAD->d_mean + maxAdcDiff/2;  // for non-symmetric data
 
     /* *** data segmentation : *** */
 
     // Get initial signal relative to upper_wc (uphill detection). 
     temp = 0;
 #ifdef FLTERDATA
-    mean_filter_init(5, (int32_t)pb[0]);
+    mean_filter_init(5, (int32_t)ADC_Sample(sAD, 0));
 #endif
-    if(pb[0] > upper_wc) temp++;
-    for (int i = 0 ; i <MINTICDIFF; i++) {
+    if(ADC_Sample(sAD, 0) > upper_wc) temp++;
+    for (int i = 0 ; i <minTicDiff; i++) {
 #ifdef FLTERDATA
-        iValue = mean_filter((int32_t)pb[i]);  // should work!
+        iValue = mean_filter((int32_t)ADC_Sample(sAD, i));  // should work!
 #else 
-        iValue = (int32_t)pb[i];
+        iValue = (int32_t)ADC_Sample(sAD, i);
 #endif
         if(iValue > (int32_t)upper_wc) temp++;
     }
@@ -149,23 +532,46 @@ int calcFreqAnalog(struct sADCData *sAD) {
 #ifdef FLTERDATA
     // init mean filter, maybe inconstistent median versus mean?
     iValue = 0;
-    for (uint32_t i = 0 ; i <MINTICDIFF; i++) {
-        iValue += (int32_t)pb[i];
+    for (uint32_t i = 0 ; i <minTicDiff; i++) {
+        iValue += (int32_t)ADC_Sample(sAD, i);
     }
-    mean_filter_init(5, (iValue/MINTICDIFF));
+    mean_filter_init(5, (iValue/minTicDiff));
 #endif
 
-    // loop over data
-    for (uint32_t i = MINTICDIFF ; i < len; i++) {
+    // loop over data. Packed data: pq walks the 3 byte pairs, samples are unpacked in registers
+    pq = pp ? pp + minticdiff2*3 : NULL;
+    for (uint32_t i = minTicDiff ; i < len; i++) {
+        if(pq) {
+            if(i & 1) {
+                iValue = (int32_t)((pq[1] >> 4) | (pq[2] << 4));
+                pq += 3;
+            }
+            else iValue = (int32_t)(pq[0] | ((pq[1] & 0x0F) << 8));
+        }
+        else iValue = (int32_t)pb[i];
 #ifdef FLTERDATA
-        iValue = mean_filter((int32_t)pb[i]);
-#else
-        iValue = (int32_t)pb[i];
+        iValue = mean_filter(iValue);
 #endif
         //  if signal_side=true
         if(signal_side) {
             // has signaldropped out of non lower region?
-            if(iValue <= (int32_t)lower_wc) signal_side=false;   // hysterisis !
+            if(iValue <= (int32_t)lower_wc) {
+                signal_side=false;   // hysterisis !
+#ifdef DUALEDGE
+                // falling edge after the last saved rising one (none before the first or with pos[] full)
+                if(numFalls + 1 == sideChanges) {
+                    utemp = i - pos[numFalls];
+                    high[numFalls] = (utemp > 0xFFFF) ? 0xFFFF : (uint16_t)utemp;
+                    if(targetCent > 0.0f && numFalls)  {
+                        ftemp = (float)periodeAt(pos, high, numFalls-1);
+                        sumD += ftemp;
+                        sumD2 += ftemp*ftemp;
+                        numD++;
+                    }
+                    numFalls++;
+                }
+#endif
+            }
             continue;
         }
         else {  // signal_side == false
@@ -173,14 +579,41 @@ int calcFreqAnalog(struct sADCData *sAD) {
             if(iValue > (int32_t)upper_wc) {
                 signal_side=true;
                 // remember side change
-                if(sideChanges < MAXSIDECHANGES-1)  {
+                if(sideChanges < maxSideChanges-1)  {
                     pos[sideChanges] = i;            
                     sideChanges++;  // count them starting with 1
                 }
+                else if(targetCent > 0.0f) {    // pos[] is full, d_periode won't get any better
+                    sAD->d_usedLen = i;
+                    break;
+                }
                 // call periods anyway for classical frquency calculation. Else you may quit here.
                 lastPos = i;
                     //Serial.printf("calcFA: period %u pos %u\n", allPeriods, lastPos);
                 allPeriods++;
+
+                // early termination, when the estimated standard error of mean periode is below targetCent
+                if(targetCent > 0.0f && sideChanges >= 2)  {
+                    ftemp = (float)(pos[sideChanges-1] - pos[sideChanges-2]);
+                    sumD += ftemp;
+                    sumD2 += ftemp*ftemp;
+                    numD++;
+                    if(sideChanges > CONVERGEMINPERIODS)  {
+                        fn = (float)numD;
+                        ftemp = (sumD2 - sumD*sumD/fn)/(fn - 1.0f);  // variance of periodes [samples^2]
+                        if(ftemp < 1.0f/6.0f) ftemp = 1.0f/6.0f;      // at least the quantisation of two edges
+#ifdef DUALEDGE
+                        // sumD holds the periodes of both edges, about twice those of either mean
+                        ftemp *= 2.0f;
+#endif
+                        // mean periode is (last pos - first pos)/n, so its standard error is that of two edges:
+                        // sqrt(var)/n relative to mean sumD/n gives sqrt(var)/sumD < targetCent/CENTPERREL
+                        if(ftemp*CENTPERREL*CENTPERREL < targetCent*targetCent*sumD*sumD) {
+                            sAD->d_usedLen = i+1;
+                            break;
+                        }
+                    }
+                }
             }
             continue;
         }
@@ -188,6 +621,9 @@ int calcFreqAnalog(struct sADCData *sAD) {
 
     /* *** evaluation *** */
     sAD->d_numPeriodes = sideChanges-1;
+    sAD->d_numRejected = 0;
+    sAD->d_numFalling = 0;
+    sAD->d_duty = 0.0f;
     // mean periode is now last saved periode start minus first periode start divided by number of periodes in between
     if(sideChanges<=1)    {
         sAD->d_freqClassic = 0.0f;
@@ -196,19 +632,38 @@ int calcFreqAnalog(struct sADCData *sAD) {
         return -2;
     }
     
+    // Classical frequency calculation may have a different result: 
+    sAD->d_freqClassic = (float)(allPeriods-1)/(float)(lastPos - pos[0])/dTime;       
+    sAD->d_numCP = allPeriods-1;
+
+#ifdef ROBUSTPERIODE
+    if(robustPeriode(pos, NULL, sideChanges-1, dlt, &ftemp, &stdev, &sAD->d_numPeriodes, &sAD->d_numRejected) < 0) {
+        sAD->d_quality = sAD->d_periode = FLT_MAX;
+        return -2;
+    }
+    // remember: real time is step in data times dTime:
+    sAD->d_periode = ftemp*dTime;
+    sAD->d_quality = stdev*dTime;
+    // spurious or missed crossings also spoil the classic count: count periodes from span instead
+    if(sAD->d_numRejected)  {
+        utemp = (uint32_t)((float)(lastPos - pos[0])/ftemp + 0.5f);
+        if(utemp)  {
+            sAD->d_numCP = utemp;
+            sAD->d_freqClassic = (float)utemp/(float)(lastPos - pos[0])/dTime;
+        }
+    }
+#else
+    uint32_t mean = 0;
     for(uint16_t i=0; i< sideChanges-1; i++) {
         utemp = pos[i+1] - pos[i];
         mean += utemp;
     }
     // remember: real time is step in data times dTime:
     sAD->d_periode = (float)mean*dTime/(float)(sideChanges-1);
-    // Classical frequency calculation may have a different result: 
-    sAD->d_freqClassic = (float)(allPeriods-1)/(float)(lastPos - pos[0])/dTime;       
         /*
         Serial.printf("Debug: firstPos=%lu lastPos=%lu allPeriods=%lu F=%g mean=%u meanP=%g\n", 
             pos[0], lastPos, allPeriods, sAD->d_freqClassic, mean/(sideChanges-1), sAD->d_periode);
         */
-    sAD->d_numCP = allPeriods-1;
 
     // get a quality measure from standard deviation of periods
     // with two sideChanges I could only evaluate one periode, thus for stdev we must have sideChanges>=3
@@ -222,8 +677,172 @@ int calcFreqAnalog(struct sADCData *sAD) {
         sAD->d_quality = sqrtf(stdev);
     }
     else sAD->d_quality = 0.0f;     // no hint for user, that the result depends only on one periode. Introduced sAD->d_numPeriodes and d_numCP.
+#endif
+
+#ifdef DUALEDGE
+    dualEdge(sAD, pos, high, numFalls, dlt);
+#endif
+    sAD->d_octaveShift = 0;
+#ifdef OCTAVEGUARD
+    octaveGuard(sAD);
+#endif
+#ifdef PITCHCONTOUR
+    if(sAD->d_contour && !sAD->d_octaveShift)  contourFrame(sAD, pos, sideChanges, upper_wc);
+#endif
 
     return 0;
 
-} /* calcFreqAnalog*/
+} /* calcFreqWork */
+
+/************************************************************************
+ * @brief calcFreqAnalog with its workspace on the stack (MAXSIDECHANGES*6 bytes, *8 with DUALEDGE)
+ * @return see calcFreqWork
+*************************************************************************/
+int calcFreqAnalog(struct sADCData *sAD) {
+    uint32_t pos[MAXSIDECHANGES];
+    uint16_t dlt[MAXSIDECHANGES];
+#ifdef DUALEDGE
+    uint16_t high[MAXSIDECHANGES];
+
+    return calcFreqWork(sAD, pos, dlt, high);
+#else
+    return calcFreqWork(sAD, pos, dlt, NULL);
+#endif
+} /* calcFreqAnalog */
   
+
+
+/************************************************************************
+ * @brief Octave error guard for edge counting: Harmonically rich signals may
+ *        cross the thresholds twice per periode (locked onto 2nd harmonic) or 
+ *        small signals may miss every other periode.
+ *        Compares normalized lag differences at half, single and double periode
+ *        (3*OCTAVETERMS items) and corrects d_periode, d_freqClassic, d_quality
+ *        and the counts d_numCP, d_numPeriodes.
+ * @param[in] sAD: results of calcFreqAnalog
+ * @param[out] d_octaveShift  +1 periode doubled, -1 halved, 0 unchanged
+ * @return octave shift as above, <-1 for errors
+*************************************************************************/
+int octaveGuard(struct sADCData *sAD) {
+    float periode, dHalf, dSingle, dDouble, mean;
+
+    if(!sAD || (!sAD->data && !sAD->pdata))  return -4;
+    sAD->d_octaveShift = 0;
+    if(sAD->d_periode >= FLT_MAX || sAD->d_deltaTime <= FLT_MIN)  return -2;
+    periode = sAD->d_periode/sAD->d_deltaTime;     // in samples
+    mean = (float)sAD->d_mean;
+
+    // missed every other crossing: signal is periodic with half the periode
+    if(periode >= 2.0f*ADC_Params(sAD)->a_minTicDiff) {
+        dHalf = lagDifference(sAD, mean, 0.5f*periode);
+        if(dHalf >= 0.0f && dHalf < OCTAVETHRES)  {
+            sAD->d_octaveShift = -1;
+            sAD->d_periode *= 0.5f;
+            sAD->d_quality *= 0.5f;
+            sAD->d_freqClassic *= 2.0f;
+            sAD->d_numCP *= 2;
+            sAD->d_numPeriodes *= 2;
+            return -1;
+        }
+    }
+
+    // locked onto 2nd harmonic: double periode fits much better than single one
+    dDouble = lagDifference(sAD, mean, 2.0f*periode);
+    if(dDouble < 0.0f || dDouble >= OCTAVETHRES)  return 0;
+    dSingle = lagDifference(sAD, mean, periode);
+    if(dSingle > dDouble + OCTAVEMARGIN)  {
+        sAD->d_octaveShift = 1;
+        sAD->d_periode *= 2.0f;
+        sAD->d_quality *= 2.0f;
+        sAD->d_freqClassic *= 0.5f;
+        sAD->d_numCP = (sAD->d_numCP + 1)/2;
+        sAD->d_numPeriodes = (sAD->d_numPeriodes + 1)/2;
+        return 1;
+    }
+    return 0;
+} /* octaveGuard */
+
+/************************************************************************
+ * @brief Sets the defaults of the analysis parameters
+*************************************************************************/
+void ADC_ParamsDefault(struct sADCParams *par) {
+    *par = gADCDefaultParams;
+} /* ADC_ParamsDefault */
+
+/************************************************************************
+ * @brief Checks limits of the analysis parameters
+ * @return 0, <0 for invalid parameters
+*************************************************************************/
+int ADC_ParamsCheck(const struct sADCParams *par) {
+    if(!par)  return -1;
+    if(!par->a_spanDiv)  return -2;
+    if(par->a_minTicDiff < 2 || (par->a_minTicDiff & 1))  return -3;   // walk of packed data
+    if(par->a_maxSideChanges < 3 || par->a_maxSideChanges > MAXSIDECHANGES)  return -4;
+    if(!(par->a_freqQuality > 0.0f) || !(par->a_freqDiff > 0.0f))  return -5;
+    return 0;
+} /* ADC_ParamsCheck */
+
+/************************************************************************
+ * @brief Quality of a result of calcFreqAnalog, i.e. the colour of the bar:
+ *        doubtful, when the periodes scatter (stdev/periode > a_freqQuality) or 
+ *        classic frequency and 1/d_periode differ relatively by more than a_freqDiff.
+ *        The mean value of both is not used, as d_numPeriodes may be small.
+ * @param[in] sAD: results of calcFreqAnalog, d_params
+ * @return 1 good (green), 0 doubtful (orange), <0 no result
+*************************************************************************/
+int classifyResult(const struct sADCData *sAD) {
+    const struct sADCParams *par;
+
+    if(!sAD)  return -3;
+    if(sAD->d_freqClassic < FLT_MIN || sAD->d_periode >= FLT_MAX || sAD->d_periode < FLT_MIN)  return -2;
+    par = ADC_Params(sAD);
+    if(sAD->d_quality/sAD->d_periode > par->a_freqQuality)  return 0;
+    if(fabsf(sAD->d_freqClassic - 1.0f/sAD->d_periode) > par->a_freqDiff*sAD->d_freqClassic)  return 0;
+    return 1;
+} /* classifyResult */
+
+/************************************************************************
+ * @brief Places an analyser into a caller's arena: handle, then the workspace
+ *   of calcFreqAnalog for params->a_maxSideChanges. Nothing is allocated.
+ * @param[in] arena: ADCANALYSERBYTES(a_maxSideChanges) bytes, aligned like a pointer
+ * @param[in] params: copied into the handle, NULL for the defaults
+ * @return handle, NULL if arena is too small or misaligned or params are invalid
+*************************************************************************/
+struct sADCAnalyser *ADC_AnalyserInit(void *arena, uint32_t bytes, uint32_t sFreq, const struct sADCParams *params) {
+    struct sADCAnalyser *an = (struct sADCAnalyser *)arena;
+    const struct sADCParams *par = params ? params : &gADCDefaultParams;
+
+    if(!arena || ((uintptr_t)arena & (sizeof(void *) - 1)))  return NULL;
+    if(!sFreq || ADC_ParamsCheck(par) < 0)  return NULL;
+    if(bytes < ADCANALYSERBYTES(par->a_maxSideChanges))  return NULL;
+    memset(an, 0, sizeof(*an));
+    an->a_params = *par;
+    an->a_pos = (uint32_t *)(an + 1);
+    an->a_dlt = (uint16_t *)(an->a_pos + par->a_maxSideChanges);
+#ifdef DUALEDGE
+    an->a_high = an->a_dlt + par->a_maxSideChanges;
+#endif
+    an->a_sAD.d_sFreq = sFreq;
+    an->a_sAD.d_deltaTime = 1.0f/sFreq;
+    an->a_sAD.d_params = &an->a_params;
+    return an;
+} /* ADC_AnalyserInit */
+
+/************************************************************************
+ * @brief Thresholds (peak_mean_sparse) and calcFreqAnalog of len samples in data,
+ *   touching nothing but the handle, its arena and data
+ * @return result of calcFreqAnalog, <0 for errors. Results in an->a_sAD
+*************************************************************************/
+int ADC_Analyse(struct sADCAnalyser *an, const uint16_t *data, uint32_t len) {
+    struct sADCData *sAD;
+    int retval;
+
+    if(!an)  return -3;
+    sAD = &an->a_sAD;
+    sAD->data = (uint16_t *)data;   // read only
+    sAD->pdata = NULL;
+    sAD->d_len = len;
+    retval = peak_mean_sparse(sAD, &sAD->d_max, &sAD->d_min, &sAD->d_mean);
+    if(retval < 0)  return retval;
+    return calcFreqWork(sAD, an->a_pos, an->a_dlt, an->a_high);
+} /* ADC_Analyse */
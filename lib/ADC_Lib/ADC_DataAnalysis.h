@@ -11,11 +11,21 @@
  * @note Do not use signals above samplerate/3 !!!
  *    Bit depth of ADC data is irrelevant between 8 and 16bit
  *    Use a preamp to have a large amplitude. 
+ * @note 12 bit data may be stored packed (pack12): 2 samples in 3 bytes, 
+ *    i.e. 33% more samples in the same RAM. peak_mean, peak_mean_sparse, calcFreqAnalog,
+ *    octaveGuard and the engines of ADC_Spectral read pdata directly, when it is not NULL.
+ * @note No function keeps state between calls or writes globals: all state is in sADCData
+ *    (and its workspace). ADC_AnalyserInit places a handle with the workspace of calcFreqAnalog
+ *    into a caller's arena, for concurrent analysers without heap or MAXSIDECHANGES*6 bytes of stack.
+ * @note DUALEDGE times the falling edges as well: twice the observations from the same frame,
+ *    about sqrt(2) less error of d_periode, and the duty cycle d_duty of the waveform.
 *****************************************************/
 
 #ifndef ADCDATAANALYSIS_H
 #define ADCDATAANALYSIS_H
 
+#include <math.h>   // fabsf
+
 // #define SAMPLERATE (96000)  // default sample rate in Hz
 // #define BUFF_SIZE (48000)  // default buffer length
 // for high frequency signals you must NOT mean-filter data!!!
@@ -25,21 +35,89 @@
 #define MAXADCDIFF (8)
 // span around mean for digital segmentation. For example 10 <--> (mean-min)/10 for lower threshold. /3 gives middle third of ranges for sin/cos
 #define ANASPANDIV (3)
-// minimum sample item difference. >2 according to Nyquist but should be even!
+// minimum sample item difference. >2 according to Nyquist but must be even (walk of packed data)!
 #define MINTICDIFF (4)
 // length of pos buffer (uint32_t) in calcFreqAnalog on stack = maximum side changes recognized for mean period calculation and quality.
 // For higher notes (c5 approx 280 periods) results from classic frequency and reciprocal mean period differ, due to more irregular periods
 // thus do not use less than 100 here. 200 worked for me and small signals between ADC 1359 and 1397 for good c4 identification.
 #define MAXSIDECHANGES (200)
+// results of calcFreqAnalog are doubtful (orange, see classifyResult), when stdev/periode is above MINFREQQUALITY
+// or classic frequency and 1/d_periode differ relatively by more than MINFREQDIFF. Reduce quality limit to 15%
+#define MINFREQQUALITY (0.15f)
+#define MINFREQDIFF (0.1f)
+// d_periode and d_quality from periodes without outliers (see robustPeriode). Comment out for plain mean and stdev.
+#define ROBUSTPERIODE
+// outlier limit in multiples of sigma estimated from median absolute deviation, but at least ROBUSTMINDEV samples
+#define ROBUSTMADK (3)
+#define ROBUSTMINDEV (2)
+// verify d_periode against half and double periode hypotheses at the end of calcFreqAnalog (see octaveGuard)
+#define OCTAVEGUARD
+// number of sparse terms for each of the three lag correlations. Keeps cost at a few % of calcFreqAnalog
+#define OCTAVETERMS (32)
+// normalized difference (0: identical, 1: uncorrelated, 2: inverted) accepted as periodic
+#define OCTAVETHRES (0.15f)
+// doubling also needs the difference at d_periode to be worse by this margin
+#define OCTAVEMARGIN (0.1f)
+// d_periode from the periodes between rising edges and those between falling edges, combined (see dualEdge).
+// Also gives the duty cycle d_duty. Workspace of MAXSIDECHANGES*2 bytes more. Host: -DDUALEDGE
+//#define DUALEDGE
+// |d_duty - 0.5| above this: asymmetric waveform (the hysteresis band is symmetric, so sines give 0.5)
+#define DUTYASYMMETRY (0.1f)
+// calcFreqAnalog and calcFreqTrack append a point per periode to d_contour, ADC_Contour.cpp has to be linked.
+// Needed by CONTOURMODE in main.h. Host: -DPITCHCONTOUR
+//#define PITCHCONTOUR
+// early termination (d_targetCent>0): minimum number of periodes before the standard error is estimated.
+// The stop is a heuristic on the spread of these periodes, not an error bound: outliers or correlated
+// jitter (drift, vibrato) are not covered by it.
+#define CONVERGEMINPERIODS (8)
+// 1200/ln(2): converts a small relative periode error into cent
+#define CENTPERREL (1731.234f)
+
+// Sparse threshold estimation (peak_mean_sparse):
+// mean distance of subsampled items. Power of 2! Each step is jittered between 1 and 2*SPARSESTRIDE
+// in order to avoid aliasing with signal periodes being a multiple of the stride.
+#define SPARSESTRIDE (8)
+// minimum number of subsampled items. For less data the full scan of peak_mean is used.
+#define SPARSEMINITEMS (64)
+// number of histogram bins between min and max of the subsample. Power of 2!
+#define SPARSEBINS (64)
+// percentiles in per mille used instead of raw min/max, which are sensitive to single spikes
+#define SPARSELOWPM (20)
+#define SPARSEHIGHPM (980)
+// error bound: estimated mean (2 sigma) plus histogram bin width must stay below span/SPARSEERRDIV,
+// else the full scan is used. 12 keeps thresholds well inside the hysteresis band of span/ANASPANDIV.
+#define SPARSEERRDIV (12)
+// minimum span (ADC units) of the subsample percentiles. Small signals always use the full scan.
+#define SPARSEMINSPAN (4*MAXADCDIFF)
+
+// bytes of len packed 12 bit samples: byte 0 low 8 bits of even sample, 
+// byte 1 high 4 bits of even sample | low 4 bits of odd sample << 4, byte 2 high 8 bits of odd sample
+#define PACKED12BYTES(len) ((((len) + 1)/2)*3)
 
 
+struct sPitchContour;   // ADC_Contour.h
+
+// Runtime parameters of the analysis (see defines above for their meaning). 
+// ADC_ParamsDefault gives the defines, host/param_tuner tuned values per instrument.
+struct sADCParams {
+  uint16_t a_maxAdcDiff;      // MAXADCDIFF
+  uint16_t a_spanDiv;         // ANASPANDIV, >0
+  uint16_t a_minTicDiff;      // MINTICDIFF, even and >=2
+  uint16_t a_maxSideChanges;  // MAXSIDECHANGES at most, which sizes the pos buffer. >=3
+  float a_freqQuality;        // MINFREQQUALITY
+  float a_freqDiff;           // MINFREQDIFF
+};
+
+extern const struct sADCParams gADCDefaultParams;
+
 // A structure to hold ADC data buffer and results
 struct sADCData {
   uint16_t *data;       // buffer for ADC DMA data input
   uint32_t d_len;       // length of data buffer
   uint32_t d_sFreq;     // used sample frequency for ADC reading [Hz resp. 1/s]
   float d_deltaTime;    // == 1/d_sFreq in s 
-  // first four setup by caller, who provided data buffer
+  float d_targetCent;   // >0: stop scanning, when the estimated standard error of mean periode is below this [cent]. 0: scan all
+  // first five setup by caller, who provided data buffer
   // next are calculated by my algorithms
   uint16_t d_mean;      // mean value overall   
   uint16_t d_max;       // max
@@ -48,17 +126,119 @@ struct sADCData {
   uint16_t d_numCP;     // number of periods counted for d_freqClassic
   float d_periode;     // mean value over maximum MAXSIDECHANGES periodes [s]
   uint16_t d_numPeriodes; // number of periods <= MAXSIDECHANGES used for mean calculation
+  uint16_t d_numRejected; // number of periods rejected as outliers (ROBUSTPERIODE), of both edges with DUALEDGE
+  uint16_t d_numFalling;  // DUALEDGE: periods between falling edges used besides d_numPeriodes, else 0
+  float d_duty;         // DUALEDGE: median time from rising to falling edge relative to the periode, else 0
   float d_quality;     // standard deviation over all periodes if >2       [s]        
+  int8_t d_octaveShift; // +1: periode was doubled (octave down), -1: halved by octaveGuard, else 0
+  uint32_t d_usedLen;   // number of samples consumed by calcFreqAnalog, < d_len after early termination
+  uint8_t *pdata;       // packed 12 bit data (pack12) of d_len samples. If not NULL, used instead of data
+  const struct sADCParams *d_params;  // analysis parameters, NULL for the defaults
+  struct sPitchContour *d_contour;    // PITCHCONTOUR: if not NULL, calcFreqAnalog appends a point per periode (ADC_Contour.h)
+};
+
+/*
+  Analyser instance in a caller's arena (ADC_AnalyserInit): frame, results, parameters and
+  the workspace of calcFreqAnalog, so several instances may run concurrently (both cores,
+  host threads) without locks, heap or large stack frames.
+*/
+struct sADCAnalyser {
+  struct sADCData a_sAD;        // d_targetCent may be set by the caller, results after ADC_Analyse
+  struct sADCParams a_params;   // own copy, a_sAD.d_params points here
+  uint32_t *a_pos;              // a_maxSideChanges side change positions, in the arena
+  uint16_t *a_dlt;              // a_maxSideChanges periodes for ROBUSTPERIODE, in the arena
+  uint16_t *a_high;             // a_maxSideChanges high times for DUALEDGE, in the arena, else NULL
 };
 
+// arena bytes of an analyser for maxSideChanges (a_maxSideChanges), known at compile time
+#ifdef DUALEDGE
+#define ADCANALYSERBYTES(maxSideChanges) (sizeof(struct sADCAnalyser) + (maxSideChanges)*(sizeof(uint32_t) + 2*sizeof(uint16_t)))
+#else
+#define ADCANALYSERBYTES(maxSideChanges) (sizeof(struct sADCAnalyser) + (maxSideChanges)*(sizeof(uint32_t) + sizeof(uint16_t)))
+#endif
+
+/*
+  @brief Parameters of sAD: d_params or the defaults
+*/
+static inline const struct sADCParams *ADC_Params(const struct sADCData *sAD) {
+    return sAD->d_params ? sAD->d_params : &gADCDefaultParams;
+}
+
+/*
+  @brief Duty cycle of a DUALEDGE result off 0.5 by more than DUTYASYMMETRY (pulse like waveform)
+*/
+static inline bool ADC_DutyAsymmetric(const struct sADCData *sAD) {
+    return sAD->d_duty > 0.0f && fabsf(sAD->d_duty - 0.5f) > DUTYASYMMETRY;
+}
+
+/*
+  @brief Sample i of packed 12 bit data, unpacked in registers
+*/
+static inline uint16_t unpack12At(const uint8_t *pp, uint32_t i) {
+    pp += (i >> 1)*3;
+    return (i & 1) ? (uint16_t)((pp[1] >> 4) | (pp[2] << 4)) : (uint16_t)(pp[0] | ((pp[1] & 0x0F) << 8));
+}
+
+/*
+  @brief Sample i of sAD, from pdata when packed data is given, else from data
+*/
+static inline uint16_t ADC_Sample(const struct sADCData *sAD, uint32_t i) {
+    return sAD->pdata ? unpack12At(sAD->pdata, i) : sAD->data[i];
+}
+
 /*  
   @brief Calculates min, max and mean from (mean filtered, see NOFILTER) ADC data
   @note call peak_mean first and setup vars in sAD with these results before calling calcFreqAnalog
 */
 void peak_mean(struct sADCData *, uint16_t *, uint16_t *, uint16_t *);
+/*
+  @brief Same as peak_mean, but estimates percentiles and mean from a jittered subsample
+  @return 0 for estimated values, 1 when it fell back to the full scan of peak_mean, <0 for errors
+*/
+int peak_mean_sparse(struct sADCData *, uint16_t *, uint16_t *, uint16_t *);
+/*
+  @brief Packs len samples (lower 12 bits) into out, starting at sample offset (even!) of out.
+  Called chunk by chunk at capture.
+  @return number of bytes written, 0 for an odd offset
+*/
+uint32_t pack12(const uint16_t *in, uint32_t len, uint8_t *out, uint32_t offset);
+/*
+  @brief Unpacks len samples starting at sample offset of packed data
+*/
+void unpack12(const uint8_t *in, uint32_t offset, uint32_t len, uint16_t *out);
 /*
   @brief Calculates frequency of analog signal (classical method) based on first five variables in sAD
 */
 int calcFreqAnalog(struct sADCData *);
+/*
+  @brief Sets the defaults (the defines above)
+*/
+void ADC_ParamsDefault(struct sADCParams *);
+/*
+  @brief Checks limits of the parameters
+  @return 0, <0 for invalid parameters
+*/
+int ADC_ParamsCheck(const struct sADCParams *);
+/*
+  @brief Quality of a result of calcFreqAnalog (before any tuning correction of d_freqClassic)
+  @return 1 good (green), 0 doubtful (orange, see MINFREQQUALITY and MINFREQDIFF), <0 no result
+*/
+int classifyResult(const struct sADCData *);
+/*
+  @brief Places an analyser of sample rate sFreq into arena (ADCANALYSERBYTES, aligned like a pointer)
+  @param[in] params: copied, NULL for the defaults
+  @return handle, NULL for errors
+*/
+struct sADCAnalyser *ADC_AnalyserInit(void *arena, uint32_t bytes, uint32_t sFreq, const struct sADCParams *params);
+/*
+  @brief peak_mean_sparse and calcFreqAnalog of len samples with the workspace of the arena
+  @return as calcFreqAnalog, results in a_sAD
+*/
+int ADC_Analyse(struct sADCAnalyser *, const uint16_t *data, uint32_t len);
+/*
+  @brief Checks results of calcFreqAnalog against half and double periode and corrects the octave
+  @note called by calcFreqAnalog, when OCTAVEGUARD is defined
+*/
+int octaveGuard(struct sADCData *);
 
 #endif
@@ -0,0 +1,112 @@
+/**********************************************************
+ @brief Sample rate governor: lowest sample rate adequate for the note played
+ @file ADC_Governor.cpp
+ @author Juergen Boehm
+ @date 2025, May 14
+ @include ADC_Governor.h
+ @note Compiler: GCC under Win32, Linux resp. Espressif
+ @note RAM: sizeof(struct sRateGovernor), 76 bytes
+
+ Copyright (C) <2025>  <Juergen Boehm>
+***********************************************************/
+#include <stdint.h>
+#include <math.h>     // powf
+
+#include "ADC_Governor.h"
+
+
+/*** private functions ***/
+
+// index of the lowest rate serving freq, g_num if none
+static uint8_t lowestFor(const struct sRateGovernor *gv, float freq) {
+    uint8_t i;
+
+    for(i = 0; i < gv->g_num; i++)
+        if(freq <= gv->g_maxFreq[i])  break;
+    return i;
+} /* lowestFor */
+
+// switches to rate i, returns the rate
+static uint32_t switchTo(struct sRateGovernor *gv, uint8_t i) {
+    gv->g_cur = i;
+    gv->g_count = 0;
+    gv->g_switches++;
+    return gv->g_rates[i];
+} /* switchTo */
+
+
+/*** public functions ***/
+
+/************************************************************************
+ * @brief Sorts the rates, drops those below GOVQUANTK/(targetCent*frameTime)
+ *   and sets the highest note of each one (rate/GOVMINSPP)
+ * @return number of usable rates, -3 for invalid arguments, -1 none usable
+*************************************************************************/
+int govInit(struct sRateGovernor *gv, const uint32_t *rates, uint8_t num, float targetCent, float frameTime) {
+    float minRate;
+    uint8_t i, j;
+
+    if(!gv || !rates || !num || num > GOVMAXRATES || !(targetCent > 0.0f) || !(frameTime > 0.0f))  return -3;
+    minRate = GOVQUANTK/(targetCent*frameTime);
+    gv->g_num = 0;
+    for(i = 0; i < num; i++) {
+        if((float)rates[i] < minRate)  continue;
+        // insertion sort
+        for(j = gv->g_num; j > 0 && gv->g_rates[j - 1] > rates[i]; j--)  gv->g_rates[j] = gv->g_rates[j - 1];
+        gv->g_rates[j] = rates[i];
+        gv->g_num++;
+    }
+    if(!gv->g_num)  return -1;
+    for(i = 0; i < gv->g_num; i++)  gv->g_maxFreq[i] = (float)gv->g_rates[i]/GOVMINSPP;
+    gv->g_cur = gv->g_num - 1;
+    gv->g_pending = gv->g_cur;
+    gv->g_count = 0;
+    gv->g_switches = 0;
+    gv->g_frameTime = frameTime;
+    return gv->g_num;
+} /* govInit */
+
+uint32_t govRate(const struct sRateGovernor *gv) {
+    return gv->g_rates[gv->g_cur];
+} /* govRate */
+
+uint32_t govFrameLen(const struct sRateGovernor *gv) {
+    return (uint32_t)(gv->g_rates[gv->g_cur]*gv->g_frameTime + 0.5f) & ~1UL;
+} /* govFrameLen */
+
+/************************************************************************
+ * @brief Up at once (note out of range, or GOVINVALIDUP invalid results),
+ *   down after GOVHOLD results for the same lower rate with GOVHYSTCENT margin
+ * @return new rate, 0 to keep the present one
+*************************************************************************/
+uint32_t govUpdate(struct sRateGovernor *gv, float freq) {
+    float margin = powf(2.0f, GOVHYSTCENT/1200.0f);
+    uint8_t need;
+
+    if(!(freq > 0.0f)) {
+        if(gv->g_pending != gv->g_num) {    // counting invalid results now
+            gv->g_pending = gv->g_num;
+            gv->g_count = 0;
+        }
+        if(++gv->g_count < GOVINVALIDUP || gv->g_cur == gv->g_num - 1)  return 0;
+        return switchTo(gv, gv->g_num - 1);
+    }
+
+    need = lowestFor(gv, freq);
+    if(need >= gv->g_num)  need = gv->g_num - 1;    // above all ranges: the highest rate
+    if(need > gv->g_cur)  return switchTo(gv, need);
+
+    // lower rate with margin, the same one GOVHOLD times
+    need = lowestFor(gv, freq*margin);
+    if(need >= gv->g_cur) {
+        gv->g_pending = gv->g_cur;
+        gv->g_count = 0;
+        return 0;
+    }
+    if(need != gv->g_pending) {
+        gv->g_pending = need;
+        gv->g_count = 0;
+    }
+    if(++gv->g_count < GOVHOLD)  return 0;
+    return switchTo(gv, need);
+} /* govUpdate */
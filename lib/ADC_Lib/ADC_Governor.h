@@ -0,0 +1,68 @@
+/****************************************************
+ * @file ADC_Governor.h
+ * @brief Sample rate governor: lowest sample rate adequate for the note played
+ * @note Two limits per rate:
+ *    - periode resolution: the detected note needs at least GOVMINSPP samples per periode
+ *      (edges between the thresholds, harmonics; calcFreqAnalog wants signals below sFreq/3).
+ *      So a rate serves notes up to rate/GOVMINSPP.
+ *    - precision of a frame: the mean periode of calcFreqAnalog telescopes to (last-first edge)/N, the
+ *      quantisation of both edges (1/(sFreq*sqrt(12)) each) gives a standard error of
+ *      GOVQUANTK/(sFreq*T) cent for a frame of T seconds. To reach targetCent within frameTime
+ *      the rate must be at least GOVQUANTK/(targetCent*frameTime), whatever the note.
+ *    Frames keep their duration (govFrameLen), so the latency is that of the fixed rate,
+ *    while ADC, DMA and analysis handle fewer samples per second at lower rates.
+ *    Timing noise of the edges does not depend on the rate.
+ * @note Hysteresis: a higher rate is taken at once, when the note exceeds the range of the
+ *    present rate (or after GOVINVALIDUP invalid results: a new note may be out of range).
+ *    A lower rate only when the note is GOVHYSTCENT inside its range for GOVHOLD results in a row.
+ *    So a note played at a range limit or a vibrato does not switch back and forth.
+ * @note No I2S here: govUpdate tells the caller the new rate (switch_sample_rate in myI2s.cpp),
+ *    so the host tool rate_governor runs the same policy on simulated note sequences.
+*****************************************************/
+
+#ifndef ADCGOVERNOR_H
+#define ADCGOVERNOR_H
+
+#include <stdint.h>
+
+// max. number of rates
+#define GOVMAXRATES (8)
+// minimum samples per periode of the highest note of a rate
+#define GOVMINSPP (10)
+// a lower rate needs the note this far below its highest note [cent]
+#define GOVHYSTCENT (200.0f)
+// results in a row a lower rate must be adequate for before it is taken
+#define GOVHOLD (4)
+// invalid results in a row, then back to the highest rate
+#define GOVINVALIDUP (3)
+// 1200/ln(2)*sqrt(2)/sqrt(12): cent*s*Hz of the quantisation error of the mean periode
+#define GOVQUANTK (706.8f)
+
+struct sRateGovernor {
+  uint32_t g_rates[GOVMAXRATES];  // usable rates, ascending [Hz]
+  float g_maxFreq[GOVMAXRATES];   // highest note of each rate [Hz]
+  uint8_t g_num;                  // usable rates
+  uint8_t g_cur;                  // index of the present rate
+  uint8_t g_pending;              // lower rate requested
+  uint8_t g_count;                // results in a row for g_pending resp. invalid ones
+  uint32_t g_switches;            // rate changes since govInit
+  float g_frameTime;              // duration of a full frame [s]
+};
+
+/*
+  @brief Keeps the rates (any order) meeting the precision targetCent [cent] within frames of
+    frameTime [s] (e.g. BUFF_SIZE/SAMPLERATE), starting at the highest one
+  @return number of usable rates, <0 for errors (none usable)
+*/
+int govInit(struct sRateGovernor *, const uint32_t *rates, uint8_t num, float targetCent, float frameTime);
+// rate in use [Hz]
+uint32_t govRate(const struct sRateGovernor *);
+// samples of a full frame at the rate in use, even
+uint32_t govFrameLen(const struct sRateGovernor *);
+/*
+  @brief Next result: freq of the detected note [Hz] in the signal domain, <=0 for invalid results
+  @return the new rate if the caller has to switch, 0 to keep the present one
+*/
+uint32_t govUpdate(struct sRateGovernor *, float freq);
+
+#endif
@@ -0,0 +1,204 @@
+/**********************************************************
+ @brief Polyphonic (strum) tuning of all strings of an instrument
+ @file ADC_Poly.cpp
+ @author Juergen Boehm
+ @date 2025, May 4
+ @include ADC_Poly.h
+ @note Compiler: GCC under Win32, Linux resp. Espressif
+ @implements Box filter decimation of consecutive captures, spectrum by the
+        spectral engine (spectralLoad, spectralPower) and a per string peak search
+        around the target harmonics (harmonic grouping). The fundamental of a string
+        is the power weighted mean of its harmonics' interpolated peaks divided by h.
+ @note Memory: POLYLEN uint16_t decimated data (caller) and the spectral workspace.
+
+ Copyright (C) <2025>  <Juergen Boehm>
+***********************************************************/
+#if defined _WIN32 || defined __linux__
+#include <stdio.h>
+#include <stdlib.h>
+#elif defined ESP32
+#include <Arduino.h>
+#endif
+
+#include <stdint-gcc.h>
+#include <math.h>     // powf, log2f, fabsf
+#include <float.h>    // FLT_MIN
+#include <string.h>   // strncpy
+
+#include "ADC_Poly.h"
+
+#if POLYLEN > SPECTRALN
+#error "POLYLEN must not exceed SPECTRALN"
+#endif
+
+
+/*** private functions ***/
+
+/************************************************************************
+ * @brief Is harmonic h of string i within POLYWINDOWCENT of a harmonic 1..gMax of another string?
+*************************************************************************/
+static bool harmonicShared(const float *freq, uint8_t num, int i, int h, int gMax) {
+    int j, g;
+
+    for(j = 0; j < num; j++) {
+        if(j == i) continue;
+        for(g = 1; g <= gMax; g++)
+            if(fabsf(1200.0f*log2f(h*freq[i]/(g*freq[j]))) < POLYWINDOWCENT) return true;
+    }
+    return false;
+} /* harmonicShared */
+
+
+/*** public functions ***/
+
+/************************************************************************
+ * @brief Sets up an instrument tuning and marks the harmonics to be used.
+ *   A harmonic is used, when no harmonic 1..POLYCHECKHARM of another string
+ *   lies within POLYWINDOWCENT. Strings without such a clean harmonic (e.g. h and e1
+ *   of a guitar at low POLYHARM) use those harmonics, which are shared with a higher 
+ *   harmonic of the other string only, and are marked in sharedMask.
+ * @param[out] sPT: tuning
+ * @param[in] freq: target frequencies of num strings [Hz]
+ * @param[in] names: names of the strings (max. 3 letters) or NULL
+ * @param[in] num: number of strings 1..POLYMAXSTRINGS
+ * @return <0 for errors, else number of harmonics left out
+*************************************************************************/
+int polySetTuning(struct sPolyTuning *sPT, const float *freq, const char *const *names, uint8_t num) {
+    int i, h, skipped = 0;
+
+    if(!sPT || !freq)  return -3;
+    if(!num || num > POLYMAXSTRINGS)  return -7;
+
+    sPT->numStrings = num;
+    sPT->sharedMask = 0;
+    for(i = 0; i < num; i++) {
+        if(freq[i] <= FLT_MIN)  return -9;
+        sPT->freq[i] = freq[i];
+        sPT->name[i][0] = '\0';
+        if(names && names[i]) {
+            strncpy(sPT->name[i], names[i], sizeof(sPT->name[i]) - 1);
+            sPT->name[i][sizeof(sPT->name[i]) - 1] = '\0';
+        }
+    }
+
+    for(i = 0; i < num; i++) {
+        sPT->harmMask[i] = 0;
+        for(h = 1; h <= POLYHARM; h++)
+            if(!harmonicShared(freq, num, i, h, POLYCHECKHARM)) sPT->harmMask[i] |= 1 << (h-1);
+        if(!sPT->harmMask[i]) {
+            // no clean harmonic: take those, that are shared with higher harmonics of other strings only
+            for(h = 1; h <= POLYHARM; h++)
+                if(!harmonicShared(freq, num, i, h, h-1)) sPT->harmMask[i] |= 1 << (h-1);
+            sPT->sharedMask |= 1 << i;
+        }
+        for(h = 1; h <= POLYHARM; h++)
+            if(!(sPT->harmMask[i] & (1 << (h-1)))) skipped++;
+    }
+    return skipped;
+} /* polySetTuning */
+
+/************************************************************************
+ * @brief Starts a new accumulation of captures
+ * @param[out] sPD: poly data, data buffer already set up
+ * @param[in] sFreq: sample frequency of the captures [Hz]
+*************************************************************************/
+void polyReset(struct sPolyData *sPD, uint32_t sFreq) {
+    if(!sPD) return;
+    sPD->d_len = 0;
+    sPD->d_sFreq = sFreq;
+    sPD->d_accu = 0;
+    sPD->d_accuCount = 0;
+    sPD->p_found = 0;
+} /* polyReset */
+
+/************************************************************************
+ * @brief Decimates a capture by POLYDECIM (mean of POLYDECIM samples) and appends it.
+ *   A decimation block may span two captures. Captures should be consecutive
+ *   (I2S not stopped in between), else the phase jumps broaden the peaks.
+ * @param[in,out] sPD: poly data
+ * @param[in] data: len ADC samples
+ * @return <0 for errors, 0 if more data is needed, 1 when POLYLEN samples are accumulated
+*************************************************************************/
+int polyAccumulate(struct sPolyData *sPD, const uint16_t *data, uint32_t len) {
+    uint32_t i;
+
+    if(!sPD)  return -3;
+    if(!sPD->data || !data)  return -4;
+
+    for(i = 0; i < len && sPD->d_len < POLYLEN; i++) {
+        sPD->d_accu += data[i];
+        if(++sPD->d_accuCount == POLYDECIM) {
+            sPD->data[sPD->d_len++] = (uint16_t)(sPD->d_accu/POLYDECIM);
+            sPD->d_accu = 0;
+            sPD->d_accuCount = 0;
+        }
+    }
+    return (sPD->d_len >= POLYLEN) ? 1 : 0;
+} /* polyAccumulate */
+
+/************************************************************************
+ * @brief Finds the strings of a tuning in the accumulated data.
+ *   For each used harmonic h of a string the maximum of the power spectrum within
+ *   +-POLYWINDOWCENT of h*target is taken, if it is a local maximum with at least
+ *   POLYMINREL of the strongest peak. Its interpolated position divided by h is
+ *   averaged with the power as weight.
+ * @param[in,out] sPD: poly data with d_len decimated samples, results in p_*
+ * @param[in] sPT: tuning from polySetTuning
+ * @param[in] work: spectral workspace (SPECTRALWORKLEN)
+ * @return <0 for errors, else number of strings found
+*************************************************************************/
+int calcFreqPoly(struct sPolyData *sPD, const struct sPolyTuning *sPT, spec_t *work) {
+    struct sADCData sAD = {0};
+    uint32_t i, k, kLo, kHi, kBest, sum;
+    float binHz, lo, hi, p, pMax = 0.0f, pBest, sumW, sumF;
+    int n, s, h, found = 0;
+
+    if(!sPD || !sPT)  return -3;
+    if(!sPD->data)  return -4;
+    if(sPD->d_sFreq < POLYDECIM)  return -5;
+    if(!work)  return -8;
+    sPD->p_found = 0;
+    if(sPD->d_len < SPECTRALN/4)  return -7;    // too short for the resolution we need
+
+    // decimated data as ADC data for the spectral engine
+    sAD.data = sPD->data;
+    sAD.d_len = sPD->d_len;
+    sAD.d_sFreq = sPD->d_sFreq/POLYDECIM;
+    sAD.d_deltaTime = 1.0f/sAD.d_sFreq;
+    for(i = 0, sum = 0; i < sPD->d_len; i++)  sum += sPD->data[i];
+    sAD.d_mean = (uint16_t)(sum/sPD->d_len);
+    n = spectralLoad(&sAD, work);
+    if(n < 0) return n;
+    spectralPower(work);
+
+    binHz = (float)sAD.d_sFreq/(float)SPECTRALN;
+    for(k = 2; k < SPECTRALN/2 - 1; k++)
+        if((float)work[k] > pMax) pMax = (float)work[k];
+    if(pMax <= 0.0f)  return 0;
+
+    for(s = 0; s < sPT->numStrings; s++) {
+        sumW = sumF = pBest = 0.0f;
+        for(h = 1; h <= POLYHARM; h++) {
+            if(!(sPT->harmMask[s] & (1 << (h-1)))) continue;
+            lo = h*sPT->freq[s]*powf(2.0f, -POLYWINDOWCENT/1200.0f)/binHz;
+            hi = h*sPT->freq[s]*powf(2.0f, POLYWINDOWCENT/1200.0f)/binHz;
+            kLo = (lo < 2.0f) ? 2 : (uint32_t)lo;
+            kHi = (hi > SPECTRALN/2 - 2) ? SPECTRALN/2 - 2 : (uint32_t)hi + 1;
+            if(kLo > kHi) continue;
+            for(k = kBest = kLo; k <= kHi; k++)
+                if(work[k] > work[kBest]) kBest = k;
+            p = (float)work[kBest];
+            if(p < POLYMINREL*pMax || work[kBest-1] > work[kBest] || work[kBest+1] > work[kBest]) continue;
+            sumF += p*spectralPeak(work, kBest)*binHz/h;
+            sumW += p;
+            if(p > pBest) pBest = p;
+        }
+        if(sumW <= 0.0f) continue;
+        sPD->p_freq[s] = sumF/sumW;
+        sPD->p_cent[s] = 1200.0f*log2f(sPD->p_freq[s]/sPT->freq[s]);
+        sPD->p_level[s] = pBest/pMax;
+        sPD->p_found |= 1 << s;
+        found++;
+    }
+    return found;
+} /* calcFreqPoly */
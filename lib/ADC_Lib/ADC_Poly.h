@@ -0,0 +1,79 @@
+/****************************************************
+ * @file ADC_Poly.h
+ * @brief Polyphonic (strum) tuning: all strings of an instrument from one chord capture
+ * @note Captures are decimated by POLYDECIM (box filter) and accumulated to POLYLEN samples,
+ *    e.g. 8192 ADC samples (0.27s) with 30000Hz. The spectrum is taken by the spectral engine
+ *    (ADC_Spectral.h), so bins are d_sFreq/POLYDECIM/SPECTRALN wide (3.7Hz with 30000Hz).
+ *    Each string is searched within +-POLYWINDOWCENT around its POLYHARM harmonics.
+ *    Harmonics shared with another string are left out (e.g. the 3rd of E is the fundamental
+ *    of h), so the fundamental of h and e1 of a guitar come from their 2nd harmonic.
+*****************************************************/
+
+#ifndef ADCPOLY_H
+#define ADCPOLY_H
+
+#include "ADC_DataAnalysis.h"
+#include "ADC_Spectral.h"
+
+// max. number of strings of an instrument
+#define POLYMAXSTRINGS (6)
+// decimation factor of captures. d_sFreq/POLYDECIM/2 must be above POLYHARM times the highest string
+#define POLYDECIM (4)
+// decimated samples analysed, not more than SPECTRALN
+#define POLYLEN (SPECTRALN)
+// harmonics used for each string
+#define POLYHARM (3)
+// harmonics of the other strings checked for shared peaks (real strings have more than POLYHARM)
+#define POLYCHECKHARM (POLYHARM+1)
+// search window around each harmonic of a string, less than half the distance of neighbouring strings.
+// Strings must be tuned roughly to this before.
+#define POLYWINDOWCENT (100.0f)
+// a string is found, if its strongest harmonic has at least this fraction of the strongest peak's power
+#define POLYMINREL (0.01f)
+
+// instrument tuning, set up by polySetTuning
+struct sPolyTuning {
+    uint8_t numStrings;
+    float freq[POLYMAXSTRINGS];         // target frequencies of the strings [Hz]
+    char name[POLYMAXSTRINGS][4];       // string names for the display, e.g. "E", "A", .. "h", "e"
+    uint8_t harmMask[POLYMAXSTRINGS];   // bit h-1 set: harmonic h of the string is used
+    uint8_t sharedMask;                 // bit i set: string i has no harmonic of its own, less reliable
+};
+
+// decimated capture and results
+struct sPolyData {
+    uint16_t *data;         // POLYLEN decimated samples, setup by caller
+    uint32_t d_len;         // decimated samples accumulated so far
+    uint32_t d_sFreq;       // sample frequency of the captures [Hz]
+    uint32_t d_accu;        // sum of the current decimation block
+    uint8_t d_accuCount;    // samples in d_accu
+    // results of calcFreqPoly:
+    uint8_t p_found;                    // bit i set: string i found
+    float p_freq[POLYMAXSTRINGS];       // measured fundamental [Hz]
+    float p_cent[POLYMAXSTRINGS];       // deviation from target in cent
+    float p_level[POLYMAXSTRINGS];      // power of strongest harmonic relative to the strongest peak
+};
+
+/*
+  @brief Sets up tuning from num frequencies and names, e.g. guitar E A d g h e1
+  @return <0 for errors, else number of harmonics left out
+*/
+int polySetTuning(struct sPolyTuning *, const float *freq, const char *const *names, uint8_t num);
+
+// starts a new accumulation of captures with sample frequency sFreq
+void polyReset(struct sPolyData *, uint32_t sFreq);
+
+/*
+  @brief Decimates and appends a capture of len ADC samples
+  @return <0 for errors, 0 if more captures are needed, 1 when POLYLEN samples are accumulated
+*/
+int polyAccumulate(struct sPolyData *, const uint16_t *data, uint32_t len);
+
+/*
+  @brief Finds all strings of the tuning in the accumulated data
+  @param work: workspace of SPECTRALWORKLEN spec_t, may be shared with calcFreqSpectral
+  @return <0 for errors, else number of strings found; results in p_found, p_freq, p_cent and p_level
+*/
+int calcFreqPoly(struct sPolyData *, const struct sPolyTuning *, spec_t *work);
+
+#endif
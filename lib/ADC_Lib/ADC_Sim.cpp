@@ -6,7 +6,7 @@
  * 
   Copyright (C) <2025>  <Juergen Boehm>
 **************************************************/
-#ifdef _WIN32
+#if defined _WIN32 || defined __linux__
   #include <stdio.h>
   #include <stdlib.h>
 #elif defined ESP32
@@ -20,28 +20,39 @@
 #include "ADC_Sim.h"
 #include "ADC_DataAnalysis.h"
 
-#ifdef _WIN32
+#if defined _WIN32 || defined __linux__
   #define PRINT printf
 #elif defined ESP32
   #define PRINT Serial.printf
 #endif
 
+/*** private functions ***/
+
+// 0..0x7FFF as rand(): from *seed (LCG of rand_r), or rand() when seed is NULL
+static inline int simRand(uint32_t *seed) {
+    if(!seed) return rand();
+    *seed = *seed*1103515245u + 12345u;
+    return (int)((*seed >> 16) & 0x7FFF);
+}
+
+/*** public functions ***/
+
 /*************************************************
  @brief Simulate an ADC reading
  @param[in] sAD: pointer to global ADC structure populated with a data buffer, its length and sample frequency
  @param[in] type: 0=sin, 1=upstep ramp, 2=downstep ramp
  @param[in] freq: signal frequency < samplefrequency/3 !!!
  @param[in] noise: if >0, if <= MAXNOISE : add random +/-noise/2 to clean signal
+ @param[in,out] seed: state of the random numbers of this caller, NULL for rand()
  @return <0 for errors
  @returns waveform data in sAD.data within range 0..MAXADCVALUE
 **************************************************/
-int ADC_Sim(struct sADCData *sAD, int type, float freq, uint16_t noise) {
+int ADC_Sim_r(struct sADCData *sAD, int type, float freq, uint16_t noise, uint32_t *seed) {
   
     uint16_t ampli, mean, n2;    
     float dTime, dPeriode, periodeTime;  // delta time and periode of signal (freq) in data array. Duration of one periode
     uint32_t sFreq;
     uint16_t *pb;
-    static int ic=0;
     uint32_t len;
   
     if(type>2 || type<0) return -1;
@@ -59,8 +70,8 @@ int ADC_Sim(struct sADCData *sAD, int type, float freq, uint16_t noise) {
   
     // calculate a randomly changed amplitude and mean value within range 0..MAXADCVALUE
     // RAND_MAX is 0x7fff here
-    ampli = rand()%(MAXADCVALUE/20) + MAXADCVALUE*2/5  ;
-    mean = rand()%(MAXADCVALUE/10) + MAXADCVALUE*2/5;   // thus fmean+ampli <= 1800+400 + 1600+200 = 4000 < MAXADCVALUE
+    ampli = simRand(seed)%(MAXADCVALUE/20) + MAXADCVALUE*2/5  ;
+    mean = simRand(seed)%(MAXADCVALUE/10) + MAXADCVALUE*2/5;   // thus fmean+ampli <= 1800+400 + 1600+200 = 4000 < MAXADCVALUE
     dTime = 1.0f/sFreq;   // each data entry in pb is of that timestep
     
     /* a periode of 1/freq [s] must match with a spacing of dTime in pb
@@ -80,7 +91,7 @@ int ADC_Sim(struct sADCData *sAD, int type, float freq, uint16_t noise) {
         //PRINT("Noise: \n");
       for (uint32_t ix=0; ix<len; ix++)  {
         if(noise) {
-          sNoise = rand()%noise;
+          sNoise = simRand(seed)%noise;
           signedNoise = sNoise - n2;   // -n2 .. +n2
             //PRINT("%d,", signedNoise);
         }
@@ -107,7 +118,7 @@ int ADC_Sim(struct sADCData *sAD, int type, float freq, uint16_t noise) {
       
       for (uint32_t ix=0; ix<len; ix++)  {
         if(noise) {
-          sNoise = rand()%noise;
+          sNoise = simRand(seed)%noise;
           signedNoise = sNoise - n2;
         }
         if(type==1) signal = (int)((sTime/periodeTime) * ampli2) + 100 + signedNoise;
@@ -124,4 +135,70 @@ int ADC_Sim(struct sADCData *sAD, int type, float freq, uint16_t noise) {
   
     return 0;
   
-  } /* ADC_Sim */
+  } /* ADC_Sim_r */
+
+int ADC_Sim(struct sADCData *sAD, int type, float freq, uint16_t noise) {
+    return ADC_Sim_r(sAD, type, freq, noise, NULL);
+} /* ADC_Sim */
+
+/*************************************************
+ @brief Simulate an ADC reading of a strummed chord
+ @param[in] sAD: pointer to ADC structure populated with a data buffer, its length and sample frequency
+ @param[in] freq: fundamentals of the strings, each < samplefrequency/2
+ @param[in] num: number of strings
+ @param[in] noise: if >0, if <= MAXNOISE : add random +/-noise/2 to clean signal
+ @param[in,out] seed: state of the random numbers of this caller, NULL for rand()
+ @return <0 for errors
+ @returns waveform data in sAD.data within range 0..MAXADCVALUE. Each string has 
+    SIMMIXHARMONICS harmonics with amplitude 1/h (below Nyquist), random phases
+    and a random level of 50..100%.
+**************************************************/
+int ADC_SimMix_r(struct sADCData *sAD, const float *freq, uint8_t num, uint16_t noise, uint32_t *seed) {
+    float level[8], phase[8][SIMMIXHARMONICS], omega[8], sum, ampli, x;
+    uint32_t sFreq, len, ix;
+    uint16_t *pb, mean, n2;
+    int i, h, signal, signedNoise = 0;
+
+    if(!freq || !num || num > 8) return -1;
+    if(!sAD)  return -3;
+    pb = sAD->data;
+    if(!pb)  return -4;
+    sFreq = sAD->d_sFreq;
+    if(!sFreq)  return -5;
+    len = sAD->d_len;
+    if(!len) return -7;
+    if(noise > MAXNOISE) return -8;
+    n2 = noise/2;
+
+    // levels and phases, amplitudes scaled so the sum of all peaks fits into 0..MAXADCVALUE
+    sum = 0.0f;
+    for(i = 0; i < num; i++) {
+        if(freq[i] <= FLT_MIN || freq[i] >= sFreq/2) return -6;
+        omega[i] = 2.0f*M_PI*freq[i]/sFreq;
+        level[i] = 0.5f + 0.5f*(simRand(seed)%1000)/1000.0f;
+        for(h = 0; h < SIMMIXHARMONICS; h++) {
+            phase[i][h] = 2.0f*M_PI*(simRand(seed)%1000)/1000.0f;
+            if((h+1)*freq[i] < sFreq/2) sum += level[i]/(h+1);
+        }
+    }
+    mean = simRand(seed)%(MAXADCVALUE/10) + MAXADCVALUE*2/5;
+    ampli = (float)(MAXADCVALUE*2/5)/sum;
+
+    for(ix = 0; ix < len; ix++) {
+        if(noise) signedNoise = simRand(seed)%noise - n2;
+        x = 0.0f;
+        for(i = 0; i < num; i++)
+            for(h = 0; h < SIMMIXHARMONICS && (h+1)*freq[i] < sFreq/2; h++)
+                x += level[i]/(h+1)*sinf((h+1)*omega[i]*ix + phase[i][h]);
+        signal = (int)(ampli*x) + mean + signedNoise;
+        if(signal < 0) signal = 0;
+        else if(signal > MAXADCVALUE) signal = MAXADCVALUE;
+        *pb++ = signal;
+    }
+    return 0;
+
+} /* ADC_SimMix_r */
+
+int ADC_SimMix(struct sADCData *sAD, const float *freq, uint8_t num, uint16_t noise) {
+    return ADC_SimMix_r(sAD, freq, num, noise, NULL);
+} /* ADC_SimMix */
@@ -15,6 +15,14 @@
 #define MAXNOISE (600)
 #define MAXADCVALUE (4095)
 
+// harmonics of each string in ADC_SimMix, amplitude 1/h
+#define SIMMIXHARMONICS (4)
+
 int ADC_Sim(struct sADCData *, int , float , uint16_t );
+// mixture of num plucked strings (random level and phases) as with a strummed chord
+int ADC_SimMix(struct sADCData *, const float *freq, uint8_t num, uint16_t noise);
+// reentrant: random numbers from the caller's *seed (like rand_r), so threads don't share rand()
+int ADC_Sim_r(struct sADCData *, int type, float freq, uint16_t noise, uint32_t *seed);
+int ADC_SimMix_r(struct sADCData *, const float *freq, uint8_t num, uint16_t noise, uint32_t *seed);
 
 #endif
@@ -0,0 +1,539 @@
+/**********************************************************
+ @brief Spectral pitch engine for uint16_t ADC data
+ @file ADC_Spectral.cpp
+ @author Juergen Boehm
+ @date 2025, May 3
+ @include ADC_Spectral.h
+ @note Compiler: GCC under Win32, Linux resp. Espressif
+ @implements Real FFT of SPECTRALN points via complex radix-2 FFT of SPECTRALN/2 points
+        and a split step. Q15 with block floating point scaling (a stage is
+        scaled by 1/2 only if it could overflow) or float (SPECTRALFLOAT).
+        Fundamental from harmonic product spectrum (sum of log2 power of SPECHARMONICS harmonics),
+        refined by Gaussian interpolation of the log power around the peak.
+ @note Q15 workspace is SPECTRALN/2 uint32_t (4 kByte), the twiddle table 
+        is a quarter wave of SPECTRALN/4+1 int16_t in flash.
+ @note Host: compile with -O3 -DSPECTRALFLOAT to get the vectorized float path.
+
+ Copyright (C) <2025>  <Juergen Boehm>
+***********************************************************/
+#if defined _WIN32 || defined __linux__
+#include <stdio.h>
+#include <stdlib.h>
+#elif defined ESP32
+#include <Arduino.h>
+#endif
+
+#include <stdint-gcc.h>
+#include <math.h>     // logf, sqrtf, cosf, powf
+#include <float.h>    // FLT_MIN
+#include <string.h>   // memcpy
+
+#include "ADC_Spectral.h"
+
+#if SPECTRALN != 2048
+#error "Regenerate sinTab in ADC_Spectral.cpp for SPECTRALN"
+#endif
+
+#define SPECM (SPECTRALN/2)     // length of complex FFT
+#define SPECQ (SPECTRALN/4)     // quarter wave
+// max. absolute Q15 value, that cannot overflow in a butterfly: 32767/(1+sqrt(2))
+#define SPECSAFE (13572)
+// 12 bit ADC data minus mean shifted into Q15 range
+#define SPECINSHIFT (3)
+// candidates for the fundamental need at least this fraction of the maximum power
+#define SPECMINFUND (0.01f)
+
+// Q15 complex values packed into uint32_t
+#define CRE(v) ((int32_t)(int16_t)((v) & 0xFFFF))
+#define CIM(v) ((int32_t)(int16_t)((v) >> 16))
+#define CPLX(r, i) ((uint32_t)(uint16_t)(r) | ((uint32_t)(uint16_t)(i) << 16))
+
+// quarter wave: round(32767*sin(2*pi*k/SPECTRALN)) for k=0..SPECTRALN/4. Being const it stays in flash.
+static const int16_t sinTab[SPECQ+1] = {
+        0,   101,   201,   302,   402,   503,   603,   704,   804,   905,  1005,  1106,
+     1206,  1307,  1407,  1507,  1608,  1708,  1809,  1909,  2009,  2110,  2210,  2310,
+     2410,  2511,  2611,  2711,  2811,  2911,  3012,  3112,  3212,  3312,  3412,  3512,
+     3612,  3712,  3811,  3911,  4011,  4111,  4210,  4310,  4410,  4509,  4609,  4708,
+     4808,  4907,  5007,  5106,  5205,  5305,  5404,  5503,  5602,  5701,  5800,  5899,
+     5998,  6096,  6195,  6294,  6393,  6491,  6590,  6688,  6786,  6885,  6983,  7081,
+     7179,  7277,  7375,  7473,  7571,  7669,  7767,  7864,  7962,  8059,  8157,  8254,
+     8351,  8448,  8545,  8642,  8739,  8836,  8933,  9030,  9126,  9223,  9319,  9416,
+     9512,  9608,  9704,  9800,  9896,  9992, 10087, 10183, 10278, 10374, 10469, 10564,
+    10659, 10754, 10849, 10944, 11039, 11133, 11228, 11322, 11417, 11511, 11605, 11699,
+    11793, 11886, 11980, 12074, 12167, 12260, 12353, 12446, 12539, 12632, 12725, 12817,
+    12910, 13002, 13094, 13187, 13279, 13370, 13462, 13554, 13645, 13736, 13828, 13919,
+    14010, 14101, 14191, 14282, 14372, 14462, 14553, 14643, 14732, 14822, 14912, 15001,
+    15090, 15180, 15269, 15358, 15446, 15535, 15623, 15712, 15800, 15888, 15976, 16063,
+    16151, 16238, 16325, 16413, 16499, 16586, 16673, 16759, 16846, 16932, 17018, 17104,
+    17189, 17275, 17360, 17445, 17530, 17615, 17700, 17784, 17869, 17953, 18037, 18121,
+    18204, 18288, 18371, 18454, 18537, 18620, 18703, 18785, 18868, 18950, 19032, 19113,
+    19195, 19276, 19357, 19438, 19519, 19600, 19680, 19761, 19841, 19921, 20000, 20080,
+    20159, 20238, 20317, 20396, 20475, 20553, 20631, 20709, 20787, 20865, 20942, 21019,
+    21096, 21173, 21250, 21326, 21403, 21479, 21554, 21630, 21705, 21781, 21856, 21930,
+    22005, 22079, 22154, 22227, 22301, 22375, 22448, 22521, 22594, 22667, 22739, 22812,
+    22884, 22956, 23027, 23099, 23170, 23241, 23311, 23382, 23452, 23522, 23592, 23662,
+    23731, 23801, 23870, 23938, 24007, 24075, 24143, 24211, 24279, 24346, 24413, 24480,
+    24547, 24613, 24680, 24746, 24811, 24877, 24942, 25007, 25072, 25137, 25201, 25265,
+    25329, 25393, 25456, 25519, 25582, 25645, 25708, 25770, 25832, 25893, 25955, 26016,
+    26077, 26138, 26198, 26259, 26319, 26378, 26438, 26497, 26556, 26615, 26674, 26732,
+    26790, 26848, 26905, 26962, 27019, 27076, 27133, 27189, 27245, 27300, 27356, 27411,
+    27466, 27521, 27575, 27629, 27683, 27737, 27790, 27843, 27896, 27949, 28001, 28053,
+    28105, 28157, 28208, 28259, 28310, 28360, 28411, 28460, 28510, 28560, 28609, 28658,
+    28706, 28755, 28803, 28850, 28898, 28945, 28992, 29039, 29085, 29131, 29177, 29223,
+    29268, 29313, 29358, 29403, 29447, 29491, 29534, 29578, 29621, 29664, 29706, 29749,
+    29791, 29832, 29874, 29915, 29956, 29997, 30037, 30077, 30117, 30156, 30195, 30234,
+    30273, 30311, 30349, 30387, 30424, 30462, 30498, 30535, 30571, 30607, 30643, 30679,
+    30714, 30749, 30783, 30818, 30852, 30885, 30919, 30952, 30985, 31017, 31050, 31082,
+    31113, 31145, 31176, 31206, 31237, 31267, 31297, 31327, 31356, 31385, 31414, 31442,
+    31470, 31498, 31526, 31553, 31580, 31607, 31633, 31659, 31685, 31710, 31736, 31760,
+    31785, 31809, 31833, 31857, 31880, 31903, 31926, 31949, 31971, 31993, 32014, 32036,
+    32057, 32077, 32098, 32118, 32137, 32157, 32176, 32195, 32213, 32232, 32250, 32267,
+    32285, 32302, 32318, 32335, 32351, 32367, 32382, 32397, 32412, 32427, 32441, 32455,
+    32469, 32482, 32495, 32508, 32521, 32533, 32545, 32556, 32567, 32578, 32589, 32599,
+    32609, 32619, 32628, 32637, 32646, 32655, 32663, 32671, 32678, 32685, 32692, 32699,
+    32705, 32711, 32717, 32722, 32728, 32732, 32737, 32741, 32745, 32748, 32752, 32755,
+    32757, 32759, 32761, 32763, 32765, 32766, 32766, 32767, 32767
+};
+
+
+/*** private functions ***/
+
+/*********************************************************
+ * @brief Bit reversal permutation of SPECM items
+**********************************************************/
+static void bitReverse(spec_t *re, spec_t *im) {
+    uint32_t i, j = 0, bit;
+    spec_t temp;
+
+    for(i = 1; i < SPECM; i++) {
+        for(bit = SPECM >> 1; j & bit; bit >>= 1)  j ^= bit;
+        j ^= bit;
+        if(i < j) {
+            temp = re[i];  re[i] = re[j];  re[j] = temp;
+            if(im) { temp = im[i];  im[i] = im[j];  im[j] = temp; }
+        }
+    }
+} /* bitReverse */
+
+/*********************************************************
+ * @brief Fast log2 approximation (error < 0.01) for peak picking
+**********************************************************/
+static inline float fastLog2(float x) {
+    uint32_t bits;
+    float m;
+
+    memcpy(&bits, &x, sizeof(bits));
+    m = (float)(bits & 0x7FFFFF)*(1.0f/8388608.0f);
+    return (float)((int32_t)((bits >> 23) & 0xFF) - 127) + m + 0.3466f*m*(1.0f - m);
+} /* fastLog2 */
+
+#ifdef SPECTRALFLOAT
+/*********************************************************
+ * @brief Complex radix-2 FFT with real and imaginary parts in separate arrays.
+ *        The inner loop runs over contiguous items and twiddles, so the compiler can vectorize it.
+**********************************************************/
+static void fftFloat(float *__restrict re, float *__restrict im) {
+    float twr[SPECM/2], twi[SPECM/2];
+    uint32_t size, half, step, g, j;
+    int16_t s, c;
+
+    bitReverse(re, im);
+    for(size = 2; size <= SPECM; size <<= 1) {
+        half = size >> 1;
+        step = SPECTRALN/size;
+        for(j = 0; j < half; j++) {
+            sinCosQ15(j*step, &s, &c);
+            twr[j] = (float)c*(1.0f/32767.0f);
+            twi[j] = (float)s*(1.0f/32767.0f);
+        }
+        for(g = 0; g < SPECM; g += size) {
+            float *__restrict ar = re + g, *__restrict ai = im + g;
+            float *__restrict br = re + g + half, *__restrict bi = im + g + half;
+            for(j = 0; j < half; j++) {
+                float tr = twr[j]*br[j] + twi[j]*bi[j];     // W = c - i*s
+                float ti = twr[j]*bi[j] - twi[j]*br[j];
+                br[j] = ar[j] - tr;
+                bi[j] = ai[j] - ti;
+                ar[j] += tr;
+                ai[j] += ti;
+            }
+        }
+    }
+} /* fftFloat */
+
+#else
+/*********************************************************
+ * @brief Complex radix-2 FFT in Q15 with block floating point:
+ *        A stage is scaled by 1/2 or 1/4 only, when the previous maximum could overflow
+ *        (a butterfly grows by up to 1+sqrt(2), so 1/2 is enough up to 2*SPECSAFE).
+**********************************************************/
+static void fftQ15(uint32_t *w) {
+    uint32_t size, half, step, g, j, a, b;
+    int32_t ar, ai, br, bi, tr, ti, v, maxAbs = 0, newMax;
+    int shift;
+    int16_t s, c;
+
+    bitReverse(w, NULL);
+    for(j = 0; j < SPECM; j++) {
+        v = CRE(w[j]);  if(v < 0) v = -v;  if(v > maxAbs) maxAbs = v;
+        v = CIM(w[j]);  if(v < 0) v = -v;  if(v > maxAbs) maxAbs = v;
+    }
+
+    for(size = 2; size <= SPECM; size <<= 1) {
+        half = size >> 1;
+        step = SPECTRALN/size;
+        shift = (maxAbs > 2*SPECSAFE) ? 2 : (maxAbs > SPECSAFE) ? 1 : 0;
+        newMax = 0;
+        for(j = 0; j < half; j++) {
+            sinCosQ15(j*step, &s, &c);
+            for(g = j; g < SPECM; g += size) {
+                a = w[g];  b = w[g+half];
+                br = CRE(b);  bi = CIM(b);
+                tr = (c*br + s*bi) >> 15;     // W = c - i*s
+                ti = (c*bi - s*br) >> 15;
+                ar = CRE(a);  ai = CIM(a);
+                w[g] = CPLX((ar + tr) >> shift, (ai + ti) >> shift);
+                w[g+half] = CPLX((ar - tr) >> shift, (ai - ti) >> shift);
+                v = (ar + tr) >> shift;  if(v < 0) v = -v;  if(v > newMax) newMax = v;
+                v = (ai + ti) >> shift;  if(v < 0) v = -v;  if(v > newMax) newMax = v;
+                v = (ar - tr) >> shift;  if(v < 0) v = -v;  if(v > newMax) newMax = v;
+                v = (ai - ti) >> shift;  if(v < 0) v = -v;  if(v > newMax) newMax = v;
+            }
+        }
+        maxAbs = newMax;
+    }
+} /* fftQ15 */
+#endif
+
+
+// sum of Hann window (0.5-0.5*cos(2*pi*i/n)) times exp(j*theta*i) over i = 0..n-1, closed form
+static void hannSum(float theta, uint32_t n, float *re, float *im) {
+    const float d[3] = {0.0f, 2.0f*(float)M_PI/n, -2.0f*(float)M_PI/n}, g[3] = {0.5f, -0.25f, -0.25f};
+    float t, sh, r;
+
+    *re = *im = 0.0f;
+    for(int k = 0; k < 3; k++) {
+        t = theta + d[k];
+        // geometric sum: exp(j*t*(n-1)/2)*sin(n*t/2)/sin(t/2), its limit n*cos(n*t/2)/cos(t/2) at t = 0, 2pi
+        sh = sinf(0.5f*t);
+        r = (fabsf(sh) > 1e-6f) ? sinf(0.5f*n*t)/sh : n*cosf(0.5f*n*t)/cosf(0.5f*t);
+        *re += g[k]*r*cosf(0.5f*t*(n - 1));
+        *im += g[k]*r*sinf(0.5f*t*(n - 1));
+    }
+} /* hannSum */
+
+/*** public functions ***/
+
+/*********************************************************
+ * @brief Sine and cosine in Q15 from quarter wave table
+ * @param[in] k: phase in 1/SPECTRALN of a full circle (taken modulo SPECTRALN)
+**********************************************************/
+void sinCosQ15(uint32_t k, int16_t *sinVal, int16_t *cosVal) {
+    k &= SPECTRALN-1;
+    if(k <= SPECQ)          { *sinVal = sinTab[k];              *cosVal = sinTab[SPECQ-k]; }
+    else if(k <= 2*SPECQ)   { *sinVal = sinTab[2*SPECQ-k];      *cosVal = -sinTab[k-SPECQ]; }
+    else if(k <= 3*SPECQ)   { *sinVal = -sinTab[k-2*SPECQ];     *cosVal = -sinTab[3*SPECQ-k]; }
+    else                    { *sinVal = -sinTab[SPECTRALN-k];   *cosVal = sinTab[k-3*SPECQ]; }
+} /* sinCosQ15 */
+
+/*********************************************************
+ * @brief Loads mean free data with Hann window into the workspace, zero padded up to SPECTRALN
+ * @param[in] sAD: data, d_len and d_mean (from peak_mean)
+ * @param[out] work: Q15 pairs (even, odd sample) resp. float real/imaginary parts
+ * @return number of samples used or <0 for errors
+**********************************************************/
+int spectralLoad(const struct sADCData *sAD, spec_t *work) {
+    const uint16_t *pb;
+    uint32_t n, i, phase, phaseStep;
+    int32_t x[2], mean;
+    int16_t s, c;
+    int j;
+
+    if(!sAD)  return -3;
+    pb = sAD->data;
+    if(!pb && !sAD->pdata)  return -4;
+    if(!work)  return -8;
+    n = sAD->d_len;
+    if(!n) return -7;
+    if(n > SPECTRALN) n = SPECTRALN;
+    mean = sAD->d_mean;
+    phaseStep = 0xFFFFFFFFu/n;     // 2^32 is one window length
+
+    for(i = 0, phase = 0; i < SPECM; i++) {
+        for(j = 0; j < 2; j++, phase += phaseStep) {
+            if(2*i+j >= n) { x[j] = 0;  continue; }
+            sinCosQ15(phase >> (32 - 11), &s, &c);      // SPECTRALN == 2^11
+            x[j] = ((int32_t)ADC_Sample(sAD, 2*i+j) - mean) << SPECINSHIFT;
+            if(x[j] > 32767) x[j] = 32767;
+            else if(x[j] < -32767) x[j] = -32767;
+            x[j] = (x[j]*((32767 - c) >> 1)) >> 15;   // Hann: (1-cos)/2
+        }
+#ifdef SPECTRALFLOAT
+        work[i] = (float)x[0];
+        work[SPECM+i] = (float)x[1];
+#else
+        work[i] = CPLX(x[0], x[1]);
+#endif
+    }
+    return (int)n;
+} /* spectralLoad */
+
+/*********************************************************
+ * @brief Real FFT of the loaded workspace and power of bins 0..SPECTRALN/2-1
+ *        With z[n]=x[2n]+i*x[2n+1] and Z=FFT(z): 
+ *        X[k] = (Z[k]+Z*[M-k])/2 + W^k*(Z[k]-Z*[M-k])/(2i), W=exp(-2*pi*i/SPECTRALN)
+ * @param[in,out] work: loaded by spectralLoad, power[k] in work[k] afterwards
+**********************************************************/
+void spectralPower(spec_t *work) {
+    uint32_t k, m;
+    int16_t s, c;
+#ifdef SPECTRALFLOAT
+    float *re = work, *im = work + SPECM;
+    float fer, fei, forr, foi, tr, ti, xr;
+
+    fftFloat(re, im);
+    xr = re[0] + im[0];
+    re[0] = xr*xr;      // DC
+    for(k = 1; k <= SPECM/2; k++) {
+        m = SPECM - k;
+        fer = 0.5f*(re[k] + re[m]);   fei = 0.5f*(im[k] - im[m]);
+        forr = 0.5f*(im[k] + im[m]);  foi = 0.5f*(re[m] - re[k]);
+        sinCosQ15(k, &s, &c);
+        tr = ((float)c*forr + (float)s*foi)*(1.0f/32767.0f);
+        ti = ((float)c*foi - (float)s*forr)*(1.0f/32767.0f);
+        // X[M-k] uses W^(M-k) = -c - i*s and conjugated parts
+        re[k] = (fer + tr)*(fer + tr) + (fei + ti)*(fei + ti);
+        re[m] = (fer - tr)*(fer - tr) + (ti - fei)*(ti - fei);
+    }
+#else
+    uint32_t a, b;
+    int32_t fer, fei, forr, foi, tr, ti, xr, xi;
+
+    fftQ15(work);
+    xr = (CRE(work[0]) + CIM(work[0])) >> 1;
+    work[0] = (uint32_t)(xr*xr);     // DC
+    for(k = 1; k <= SPECM/2; k++) {
+        m = SPECM - k;
+        a = work[k];  b = work[m];
+        fer = (CRE(a) + CRE(b)) >> 1;   fei = (CIM(a) - CIM(b)) >> 1;
+        forr = (CIM(a) + CIM(b)) >> 1;  foi = (CRE(b) - CRE(a)) >> 1;
+        sinCosQ15(k, &s, &c);
+        tr = (c*forr + s*foi) >> 15;
+        ti = (c*foi - s*forr) >> 15;
+        // halved once more, so that the power fits into 32 bit
+        xr = (fer + tr) >> 1;  xi = (fei + ti) >> 1;
+        work[k] = (uint32_t)(xr*xr) + (uint32_t)(xi*xi);
+        // X[M-k] uses W^(M-k) = -c - i*s and conjugated parts
+        xr = (fer - tr) >> 1;  xi = (ti - fei) >> 1;
+        work[m] = (uint32_t)(xr*xr) + (uint32_t)(xi*xi);
+    }
+#endif
+} /* spectralPower */
+
+/*********************************************************
+ * @brief Interpolated peak position from power in bins k-1, k, k+1
+ *        Gaussian: parabola through log power, else parabola through magnitudes
+ * @return k + offset with |offset| <= 0.5
+**********************************************************/
+float spectralPeak(const spec_t *work, uint32_t k) {
+    float a, b, c, den, delta;
+
+    if(k < 1 || k >= SPECM-1) return (float)k;
+#ifdef SPECGAUSSIAN
+    a = logf((float)work[k-1] + 1.0f);
+    b = logf((float)work[k] + 1.0f);
+    c = logf((float)work[k+1] + 1.0f);
+#else
+    a = sqrtf((float)work[k-1]);
+    b = sqrtf((float)work[k]);
+    c = sqrtf((float)work[k+1]);
+#endif
+    den = a - 2.0f*b + c;
+    if(den >= 0.0f) return (float)k;     // no maximum
+    delta = 0.5f*(a - c)/den;
+    if(delta > 0.5f) delta = 0.5f;
+    else if(delta < -0.5f) delta = -0.5f;
+    return (float)k + delta;
+} /* spectralPeak */
+
+/************************************************************************
+ * @brief Calculates frequency of analog signal from its spectrum
+ * @cond Signal frequency < samplerate/3, call peak_mean first
+ * @param[in] sAD: as with calcFreqAnalog (data, d_len, d_sFreq, d_deltaTime, d_mean, d_max, d_min)
+ * @param[in] work: workspace of SPECTRALWORKLEN items
+ * @param[out] d_freqClassic  interpolated frequency of fundamental [Hz]
+ * @param[out] d_periode      1/d_freqClassic
+ * @param[out] d_quality      d_periode*sqrt(mean power/peak power), so MINFREQQUALITY works as with calcFreqAnalog
+ * @param[out] d_numCP        FFT bin of fundamental
+ * @param[out] d_numPeriodes  periodes within the used data
+ * @param[out] d_usedLen      samples used (<= SPECTRALN)
+ * @return <0 for errors
+*************************************************************************/
+int calcFreqSpectral(struct sADCData *sAD, spec_t *work) {
+    uint32_t k, kMin, kMax, kBest = 0, kPeak, j, jk;
+    float binHz, hps, hpsBest = -FLT_MAX, pMax = 0.0f, pSum = 0.0f, p, pLimit;
+    int n;
+
+    n = spectralLoad(sAD, work);
+    if(n < 0) return n;
+    if(sAD->d_sFreq == 0)  return -5;
+    if(sAD->d_deltaTime <= FLT_MIN) return -6;
+    sAD->d_numRejected = 0;
+    sAD->d_octaveShift = 0;
+    sAD->d_usedLen = (uint32_t)n;
+    if(sAD->d_max - sAD->d_min <= ADC_Params(sAD)->a_maxAdcDiff) {
+        sAD->d_freqClassic = 0.0f;
+        sAD->d_numCP = 0;
+        sAD->d_numPeriodes = 0;
+        sAD->d_quality = sAD->d_periode = FLT_MAX;
+        return -1;
+    }
+
+    spectralPower(work);
+
+    binHz = (float)sAD->d_sFreq/(float)SPECTRALN;
+    kMin = (uint32_t)(SPECMINFREQ/binHz);
+    if(kMin < 2) kMin = 2;
+    kMax = (SPECM - 2)/SPECHARMONICS;
+    for(k = kMin; k <= kMax; k++) {
+        p = (float)work[k];
+        pSum += p;
+        if(p > pMax) pMax = p;
+    }
+    if(pMax <= 0.0f) goto NOPEAK;
+    pLimit = SPECMINFUND*pMax;
+
+    // harmonic product spectrum as sum of log2 power, each harmonic taken from the best of 3 bins.
+    // Candidates for the fundamental are local maxima only.
+    for(k = kMin; k <= kMax; k++) {
+        p = (float)work[k];
+        if(p < pLimit || work[k-1] > work[k] || work[k+1] > work[k]) continue;
+        hps = fastLog2(p + 1.0f);
+        for(j = 2; j <= SPECHARMONICS; j++) {
+            jk = j*k;
+            p = (float)work[jk];
+            if((float)work[jk-1] > p) p = (float)work[jk-1];
+            if((float)work[jk+1] > p) p = (float)work[jk+1];
+            hps += fastLog2(p + 1.0f);
+        }
+        if(hps > hpsBest) {
+            hpsBest = hps;
+            kBest = k;
+        }
+    }
+    if(!kBest) goto NOPEAK;
+
+    kPeak = kBest;
+    sAD->d_freqClassic = spectralPeak(work, kPeak)*binHz;
+    sAD->d_periode = 1.0f/sAD->d_freqClassic;
+    sAD->d_quality = sAD->d_periode*sqrtf(pSum/(float)(kMax - kMin + 1)/(float)work[kPeak]);
+    sAD->d_numCP = (uint16_t)kPeak;
+    sAD->d_numPeriodes = (uint16_t)((float)n*sAD->d_deltaTime*sAD->d_freqClassic);
+#ifdef OCTAVEGUARD
+    octaveGuard(sAD);
+#endif
+    return 0;
+
+NOPEAK:
+    sAD->d_freqClassic = 0.0f;
+    sAD->d_numCP = 0;
+    sAD->d_numPeriodes = 0;
+    sAD->d_quality = sAD->d_periode = FLT_MAX;
+    return -2;
+} /* calcFreqSpectral */
+
+
+/************************************************************************
+ * @brief Refines the frequency of a detected note by Goertzel filters at
+ *        GOERTZELBINS frequencies spaced GOERTZELSTEPCENT around noteFreq 
+ *        (each with GOERTZELHARM harmonics below sFreq/2), Hann windowed, and a parabola 
+ *        through the log power of the best bin and its neighbours.
+ * @note Cost is GOERTZELBINS*GOERTZELHARM*N multiply-adds. 
+ *       N is an integer number of periodes of noteFreq, at most so many that 
+ *       the Hann main lobe is still 2 steps wide. So the neighbours of the best bin
+ *       stay within the main lobe
+ *       and high notes use only a part of the buffer.
+ * @note The power of a bin is the energy of the least squares sine at its frequency,
+ *       the plain |X|^2 is biased by the image at -f with a few periodes only
+ *       (4 cent at 65Hz). Less than GOERTZELMINPERIODES are not refined.
+ * @param[in] sAD: data, d_len, d_sFreq and d_mean (from peak_mean)
+ * @param[in] noteFreq: frequency of detected note in the signal [Hz]
+ * @param[out] freq: refined frequency [Hz]
+ * @return 0 for success, <0 for errors or if the peak lies on the grid's border
+*************************************************************************/
+int refineFreqGoertzel(const struct sADCData *sAD, float noteFreq, float *freq) {
+    float power[GOERTZELBINS], binFreq, w, coeff, s0, s1, s2, x, mean, sFreq, periodes, maxPeriodes,
+        wc, ws, wt, dc, ds, re, im, sc, ss, hRe, hIm, cc, sn, cs, a, b, c, den, cent;
+    const float stepFactor = powf(2.0f, GOERTZELSTEPCENT/1200.0f);
+    const uint16_t *pb;
+    uint32_t n, i, sum;
+    int j, h, jMax = 0;
+
+    if(!sAD)  return -3;
+    pb = sAD->data;
+    if(!pb && !sAD->pdata)  return -4;
+    if(!sAD->d_sFreq)  return -5;
+    if(!freq)  return -8;
+    sFreq = (float)sAD->d_sFreq;
+    if(noteFreq <= FLT_MIN || noteFreq >= sFreq/2.0f)  return -9;
+
+    // integer number of periodes, Hann main lobe (2*sFreq/n) of highest harmonic not narrower than 2 steps
+    periodes = floorf((float)sAD->d_len*noteFreq/sFreq);
+    maxPeriodes = 2.0f/(powf(stepFactor, 2.0f) - 1.0f)/GOERTZELHARM;
+    if(periodes > maxPeriodes)  periodes = floorf(maxPeriodes);
+    if(periodes < GOERTZELMINPERIODES)  return -2;
+    n = (uint32_t)(periodes*sFreq/noteFreq + 0.5f);
+    if(n > sAD->d_len) n = sAD->d_len;
+    // mean of the n samples used, d_mean is over the whole buffer
+    for(i = 0, sum = 0; i < n; i++)  sum += ADC_Sample(sAD, i);
+    mean = (float)sum/n;
+    dc = cosf(2.0f*(float)M_PI/n);
+    ds = sinf(2.0f*(float)M_PI/n);
+
+    binFreq = noteFreq*powf(2.0f, -GOERTZELSTEPCENT*(GOERTZELBINS/2)/1200.0f);
+    for(j = 0; j < GOERTZELBINS; j++, binFreq *= stepFactor) {
+        power[j] = 0.0f;
+        for(h = 1; h <= GOERTZELHARM && h*binFreq < sFreq/2.0f; h++) {
+            w = 2.0f*(float)M_PI*h*binFreq/sFreq;
+            coeff = 2.0f*cosf(w);
+            s1 = s2 = 0.0f;
+            wc = 1.0f;  ws = 0.0f;      // Hann window 0.5-0.5*cos by rotation
+            for(i = 0; i < n; i++) {
+                x = ((float)ADC_Sample(sAD, i) - mean)*(0.5f - 0.5f*wc);
+                wt = wc*dc - ws*ds;
+                ws = ws*dc + wc*ds;
+                wc = wt;
+                s0 = x + coeff*s1 - s2;
+                s2 = s1;
+                s1 = s0;
+            }
+            // sum of x*window*exp(-jwi) from i = 0 on: cosine and sine part
+            re = s1 - 0.5f*coeff*s2;
+            im = s2*sinf(w);
+            wc = cosf(w*(n - 1));
+            ws = sinf(w*(n - 1));
+            sc = re*wc + im*ws;
+            ss = re*ws - im*wc;
+            // energy of the least squares sine at w, not |X|^2: the image at -w is part of the model
+            hannSum(2.0f*w, n, &hRe, &hIm);
+            cc = 0.25f*n + 0.5f*hRe;        // sums of window*cos^2, *sin^2 and *sin*cos
+            sn = 0.25f*n - 0.5f*hRe;
+            cs = 0.5f*hIm;
+            den = cc*sn - cs*cs;
+            if(den <= 0.0f)  return -2;
+            power[j] += (sn*sc*sc - 2.0f*cs*sc*ss + cc*ss*ss)/den;
+        }
+        if(power[j] > power[jMax]) jMax = j;
+    }
+    if(jMax == 0 || jMax == GOERTZELBINS-1)  return -2;
+
+    // Gaussian interpolation like spectralPeak
+    a = logf(power[jMax-1] + 1.0f);
+    b = logf(power[jMax] + 1.0f);
+    c = logf(power[jMax+1] + 1.0f);
+    den = a - 2.0f*b + c;
+    if(den >= 0.0f)  return -2;
+    cent = ((float)(jMax - GOERTZELBINS/2) + 0.5f*(a - c)/den)*GOERTZELSTEPCENT;
+    *freq = noteFreq*powf(2.0f, cent/1200.0f);
+    return 0;
+} /* refineFreqGoertzel */
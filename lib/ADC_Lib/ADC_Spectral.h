@@ -0,0 +1,71 @@
+/****************************************************
+ * @file ADC_Spectral.h
+ * @brief Spectral pitch engine for uint16_t ADC data, alternative to calcFreqAnalog,
+ *    and Goertzel refinement of a detected note
+ * @note Real FFT of SPECTRALN points in Q15 fixed point (default) or float (SPECTRALFLOAT, host),
+ *    Hann window, harmonic product spectrum for the fundamental and
+ *    Gaussian (or quadratic) peak interpolation for sub-bin accuracy.
+ * @note Uses a caller provided workspace of SPECTRALWORKLEN spec_t items
+ *    (4 kByte for Q15), no float copy of the data buffer.
+ *    Frequency resolution is d_sFreq/SPECTRALN before interpolation,
+ *    e.g. 14.6Hz with 30000Hz. Keep d_len near SPECTRALN (zero padded if shorter).
+*****************************************************/
+
+#ifndef ADCSPECTRAL_H
+#define ADCSPECTRAL_H
+
+#include "ADC_DataAnalysis.h"
+
+// length of real FFT, power of 2. The twiddle table in ADC_Spectral.cpp is made for 2048!
+#define SPECTRALN (2048)
+// number of harmonics multiplied in harmonic product spectrum (sum of logarithms)
+#define SPECHARMONICS (3)
+// lowest fundamental searched [Hz]
+#define SPECMINFREQ (60.0f)
+// Gaussian interpolation on log power, comment out for quadratic interpolation on magnitudes
+#define SPECGAUSSIAN
+// float path for host computers (auto vectorizing loops with -O3), else Q15 fixed point
+//#define SPECTRALFLOAT
+
+// Goertzel refinement (refineFreqGoertzel): bins at -75, -50 .. 75 cent around the note,
+// so a note detected up to 50 cent off still has a neighbour on both sides
+#define GOERTZELBINS (7)
+#define GOERTZELSTEPCENT (25.0f)
+// number of harmonics summed in each bin (1: fundamental only). Each harmonic narrows the lobe,
+// so fewer periodes of the frame are used
+#define GOERTZELHARM (1)
+// fewer periodes in the frame leave the note unrefined (-2): the Hann lobe is then so wide against
+// the grid, that harmonics shift the peak by cents (e.g. below 90Hz with 2000 samples at 30000Hz)
+#define GOERTZELMINPERIODES (6)
+
+#ifdef SPECTRALFLOAT
+typedef float spec_t;       // real parts in [0..N/2-1], imaginary parts in [N/2..N-1]
+#define SPECTRALWORKLEN (SPECTRALN)
+#else
+typedef uint32_t spec_t;    // Q15 complex: real part in low, imaginary part in high half word
+#define SPECTRALWORKLEN (SPECTRALN/2)
+#endif
+
+/*
+  @brief Fundamental frequency from spectrum of sAD->data. Call peak_mean first (d_mean is needed)
+  @return <0 for errors, results in d_freqClassic, d_periode, d_quality as with calcFreqAnalog
+*/
+int calcFreqSpectral(struct sADCData *, spec_t *work);
+
+/*
+  @brief Refines the frequency of a detected note by a small Goertzel bank on a +-50 cent grid
+  @return <0 for errors or if the peak is outside the grid, refined frequency in *freq
+*/
+int refineFreqGoertzel(const struct sADCData *, float noteFreq, float *freq);
+
+// lower level functions, also used by other spectral modes:
+// windowed and scaled data into work, returns number of samples used (<=SPECTRALN) or <0
+int spectralLoad(const struct sADCData *, spec_t *work);
+// real FFT in place, then power of bins 0..SPECTRALN/2-1 in work[0..SPECTRALN/2-1]
+void spectralPower(spec_t *work);
+// interpolated position of peak at bin k (k-1, k+1 needed)
+float spectralPeak(const spec_t *work, uint32_t k);
+// sine and cosine in Q15 for phase k/SPECTRALN of full circle
+void sinCosQ15(uint32_t k, int16_t *sinVal, int16_t *cosVal);
+
+#endif
@@ -0,0 +1,112 @@
+/**********************************************************
+ @brief Strobe tuner: phase tracking of ADC data against a reference note
+ @file ADC_Strobe.cpp
+ @author Juergen Boehm
+ @date 2025, May 5
+ @include ADC_Strobe.h
+ @note Compiler: GCC under Win32, Linux resp. Espressif
+ @implements I/Q demodulation with a 32 bit NCO and sinCosQ15 of ADC_Spectral,
+        two pole integer low pass. Once per call the angle of I/Q is unwrapped
+        into s_angle and its change gives the frequency difference in cent.
+
+ Copyright (C) <2025>  <Juergen Boehm>
+***********************************************************/
+#if defined _WIN32 || defined __linux__
+#include <stdio.h>
+#include <stdlib.h>
+#elif defined ESP32
+#include <Arduino.h>
+#endif
+
+#include <stdint-gcc.h>
+#include <math.h>     // atan2f, sqrtf, log2f
+#include <float.h>    // FLT_MIN
+
+#include "ADC_Strobe.h"
+
+// NCO phase to index of sinCosQ15 (SPECTRALN == 2^11 per turn)
+#define STROBEINDEXSHIFT (32 - 11)
+
+
+/*** public functions ***/
+
+/************************************************************************
+ * @brief Sets the reference frequency and resets the tracker
+ * @param[out] sST: strobe state
+ * @param[in] refFreq: reference note [Hz], below sFreq/2
+ * @param[in] sFreq: sample frequency [Hz]
+ * @return <0 for errors
+*************************************************************************/
+int strobeSetNote(struct sStrobe *sST, float refFreq, uint32_t sFreq) {
+    if(!sST)  return -3;
+    if(!sFreq)  return -5;
+    if(refFreq <= FLT_MIN || refFreq >= sFreq/2)  return -9;
+
+    sST->s_sFreq = sFreq;
+    sST->s_refFreq = refFreq;
+    sST->s_step = (uint32_t)((double)refFreq/(double)sFreq*4294967296.0 + 0.5);
+    sST->s_phase = 0;
+    sST->s_i1 = sST->s_q1 = sST->s_i2 = sST->s_q2 = 0;
+    sST->s_angle = 0;
+    sST->s_cent = 0.0f;
+    sST->s_level = 0;
+    sST->s_samples = 0;
+    return 0;
+} /* strobeSetNote */
+
+/************************************************************************
+ * @brief Tracks the phase of len samples against the reference.
+ *   The angle change since the last call is taken modulo one turn, so the
+ *   frequency difference must stay below sFreq/(2*len). s_cent is only updated,
+ *   when the filters have settled (2^(STROBELPSHIFT+2) samples).
+ * @param[in,out] sST: strobe state from strobeSetNote
+ * @param[in] data: len ADC samples, consecutive with the last call
+ * @param[in] mean: mean value of data (e.g. from peak_mean)
+ * @return <0 for errors, 0 if the level is below STROBEMINLEVEL, 1 for a valid phase
+*************************************************************************/
+int strobeProcess(struct sStrobe *sST, const uint16_t *data, uint32_t len, uint16_t mean) {
+    int32_t x, i1, q1, i2, q2;
+    uint32_t phase, step, n;
+    int16_t s, c, dAngle;
+    float fi, fq, df, cent;
+
+    if(!sST)  return -3;
+    if(!data)  return -4;
+    if(!sST->s_step)  return -5;
+    if(!len)  return -7;
+
+    i1 = sST->s_i1;  q1 = sST->s_q1;
+    i2 = sST->s_i2;  q2 = sST->s_q2;
+    phase = sST->s_phase;
+    step = sST->s_step;
+    for(n = 0; n < len; n++) {
+        sinCosQ15(phase >> STROBEINDEXSHIFT, &s, &c);
+        phase += step;
+        x = (int32_t)data[n] - mean;
+        // mixer output scaled to 2^STROBEFRACBITS, Q15 product shifted by 15
+        i1 += (((x*c) >> (15 - STROBEFRACBITS)) - i1) >> STROBELPSHIFT;
+        q1 += (((-x*s) >> (15 - STROBEFRACBITS)) - q1) >> STROBELPSHIFT;
+        i2 += (i1 - i2) >> STROBELPSHIFT;
+        q2 += (q1 - q2) >> STROBELPSHIFT;
+    }
+    sST->s_i1 = i1;  sST->s_q1 = q1;
+    sST->s_i2 = i2;  sST->s_q2 = q2;
+    sST->s_phase = phase;
+    sST->s_samples += len;
+
+    // magnitude of I/Q is half the signal's amplitude
+    fi = (float)i2/(1 << STROBEFRACBITS);
+    fq = (float)q2/(1 << STROBEFRACBITS);
+    sST->s_level = (uint16_t)(2.0f*sqrtf(fi*fi + fq*fq));
+    if(sST->s_level < STROBEMINLEVEL)  return 0;
+
+    dAngle = (int16_t)((int32_t)(atan2f(fq, fi)*(32768.0f/(float)M_PI)) - sST->s_angle);
+    sST->s_angle += dAngle;
+    if(sST->s_samples < len + (1u << (STROBELPSHIFT+2)))  return 1;
+
+    // angle change per call is the frequency difference
+    df = (float)dAngle/65536.0f*(float)sST->s_sFreq/(float)len;
+    cent = 1200.0f*log2f(1.0f + df/sST->s_refFreq);
+    sST->s_cent += (cent - sST->s_cent)/STROBECENTSMOOTH;
+    return 1;
+} /* strobeProcess */
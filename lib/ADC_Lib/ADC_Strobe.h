@@ -0,0 +1,53 @@
+/****************************************************
+ * @file ADC_Strobe.h
+ * @brief Strobe tuner: phase of the signal relative to a reference note, sample by sample
+ * @note An NCO at the reference frequency (32 bit phase accumulator, sine table of
+ *    ADC_Spectral) mixes each sample down to I/Q, a two pole low pass removes the
+ *    sum frequency. The angle of I/Q drifts with the frequency difference to the
+ *    reference: standing still when in tune. Cost per sample is one table lookup,
+ *    two multiplications and four shifts/adds, far below the budget at 30000Hz.
+ * @note Unambiguous for frequency differences below d_sFreq/(2*len) per call,
+ *    e.g. 30Hz with 500 samples (60 calls per second at 30000Hz).
+*****************************************************/
+
+#ifndef ADCSTROBE_H
+#define ADCSTROBE_H
+
+#include "ADC_DataAnalysis.h"
+#include "ADC_Spectral.h"
+
+// low pass of I/Q: two poles with coefficient 2^-STROBELPSHIFT (9: 9.3Hz at 30000Hz), damps the
+// sum frequency of 65Hz by 40dB. Differences of 50 cent at c3 (30Hz) are still passed with 1/10
+#define STROBELPSHIFT (9)
+// fixed point bits of the I/Q filter states
+#define STROBEFRACBITS (8)
+// smoothing of s_cent: new value weights 1/STROBECENTSMOOTH
+#define STROBECENTSMOOTH (4)
+// minimum I/Q magnitude (ADC units) for a valid phase
+#define STROBEMINLEVEL (20)
+
+struct sStrobe {
+    uint32_t s_sFreq;       // sample frequency [Hz]
+    float s_refFreq;        // reference note [Hz]
+    uint32_t s_phase;       // NCO phase, 2^32 is one periode of the reference
+    uint32_t s_step;        // NCO increment per sample
+    int32_t s_i1, s_q1, s_i2, s_q2;  // low pass states, scaled by 2^STROBEFRACBITS
+    int32_t s_angle;        // unwrapped phase of signal relative to reference, 65536 per turn
+    float s_cent;           // smoothed deviation from reference in cent
+    uint16_t s_level;       // I/Q magnitude in ADC units
+    uint32_t s_samples;     // samples processed since strobeSetNote
+};
+
+/*
+  @brief Sets reference frequency and resets the tracker
+  @return <0 for errors
+*/
+int strobeSetNote(struct sStrobe *, float refFreq, uint32_t sFreq);
+
+/*
+  @brief Tracks len samples (mean is subtracted). Updates s_angle, s_cent and s_level
+  @return <0 for errors, 0 if the level is too low for a phase, 1 for a valid phase
+*/
+int strobeProcess(struct sStrobe *, const uint16_t *data, uint32_t len, uint16_t mean);
+
+#endif
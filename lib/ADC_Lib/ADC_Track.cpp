@@ -0,0 +1,218 @@
+/**********************************************************
+ @brief Tracking of a sustained note: edges searched only where the last periode predicts them
+ @file ADC_Track.cpp
+ @author Juergen Boehm
+ @date 2025, May 15
+ @include ADC_Track.h
+ @note Compiler: GCC under Win32, Linux resp. Espressif
+ @note RAM: none besides a few locals
+
+ Copyright (C) <2025>  <Juergen Boehm>
+***********************************************************/
+#if defined _WIN32 || defined __linux__
+#include <stdio.h>
+#include <stdlib.h>
+#elif defined ESP32
+#include <Arduino.h>
+#endif
+
+#include <stdint.h>
+#include <math.h>     // sqrtf, fabsf
+#include <float.h>    // FLT_MIN, FLT_MAX
+
+#include "ADC_DataAnalysis.h"
+#ifdef PITCHCONTOUR
+#include "ADC_Contour.h"
+#endif
+#include "ADC_Track.h"
+
+
+/*** private functions ***/
+
+// position of the crossing of thres between samples i-1 and i
+static inline float crossing(const struct sADCData *sAD, uint32_t i, uint16_t thres) {
+    uint16_t x0 = ADC_Sample(sAD, i - 1), x1 = ADC_Sample(sAD, i);
+
+    return (float)(i - 1) + ((x1 > x0) ? ((float)thres - x0)/(float)(x1 - x0) : 1.0f);
+} /* crossing */
+
+/************************************************************************
+ * @brief Next rising edge after start: below lower, then above upper (as calcFreqAnalog)
+ * @return sample of the edge, 0 if none up to end
+*************************************************************************/
+static uint32_t nextEdge(const struct sADCData *sAD, uint16_t lower, uint16_t upper, uint32_t start, uint32_t end) {
+    bool low = false;
+    uint16_t x;
+
+    for(uint32_t i = start + 1; i < end; i++) {
+        x = ADC_Sample(sAD, i);
+        if(x <= lower)  low = true;
+        else if(low && x > upper)  return i;
+    }
+    return 0;
+} /* nextEdge */
+
+/************************************************************************
+ * @brief Upward crossing of upper in samples lo..hi nearest to expected
+ * @return sample after the crossing, 0 if none
+*************************************************************************/
+static uint32_t windowEdge(const struct sADCData *sAD, uint16_t upper, uint32_t lo, uint32_t hi, float expected) {
+    uint32_t best = 0;
+    float dist, bestDist = FLT_MAX;
+    uint16_t x0 = ADC_Sample(sAD, lo - 1), x1;
+
+    for(uint32_t i = lo; i <= hi; i++, x0 = x1) {
+        x1 = ADC_Sample(sAD, i);
+        if(x0 > upper || x1 <= upper)  continue;
+        dist = fabsf((float)i - expected);
+        if(dist < bestDist) {
+            bestDist = dist;
+            best = i;
+        }
+    }
+    return best;
+} /* windowEdge */
+
+/************************************************************************
+ * @brief Rising edges by hysteresis in start..end as nextEdge, but each side held for two samples:
+ *        a spike of a single sample gives no edge, an octave up still doubles the count
+ * @return number of edges
+*************************************************************************/
+static uint32_t countEdges(const struct sADCData *sAD, uint16_t lower, uint16_t upper, uint32_t start, uint32_t end) {
+    bool low = false;
+    uint32_t edges = 0;
+    uint16_t x0 = ADC_Sample(sAD, start), x1;
+
+    for(uint32_t i = start + 1; i < end; i++, x0 = x1) {
+        x1 = ADC_Sample(sAD, i);
+        if(x0 <= lower && x1 <= lower)  low = true;
+        else if(low && x0 > upper && x1 > upper) {
+            low = false;
+            edges++;
+        }
+    }
+    return edges;
+} /* countEdges */
+
+
+/*** public functions ***/
+
+/************************************************************************
+ * @brief Mean periode from edges predicted by periode (see ADC_Track.h)
+ * @param[in] sAD: frame with d_mean, d_max, d_min (peak_mean), d_targetCent, d_params
+ * @param[in] periode: of the last result [s]
+ * @return 0, -9 lock lost, <0 for errors
+*************************************************************************/
+int calcFreqTrack(struct sADCData *sAD, float periode) {
+    const struct sADCParams *par;
+    uint16_t lower, upper;
+    uint32_t len, end, i, lo, hi, steps, misses = 0, miss = 0, numD, edges;
+    float P, w, est, first, last, e, d, expected, sumD, sumD2, var;
+#ifdef PITCHCONTOUR
+    struct sPitchContour *c;
+    float refPeriode = 0.0f;
+#endif
+
+    if(!sAD)  return -3;
+    if(!sAD->data && !sAD->pdata)  return -4;
+    if(!sAD->d_sFreq)  return -5;
+    if(sAD->d_deltaTime <= FLT_MIN)  return -6;
+    len = sAD->d_len;
+    par = ADC_Params(sAD);
+    if(sAD->d_params && ADC_ParamsCheck(par) < 0)  return -8;
+    if(!(periode > 0.0f) || periode >= FLT_MAX)  return -9;
+    P = periode/sAD->d_deltaTime;      // in samples
+    if(P < 2.0f*par->a_minTicDiff || 2.0f*P >= len)  return -9;
+    if(sAD->d_max - sAD->d_min <= par->a_maxAdcDiff)  return -1;
+
+    // thresholds of calcFreqAnalog
+    lower = sAD->d_mean - (sAD->d_mean - sAD->d_min)/par->a_spanDiv;
+    if(lower <= sAD->d_min + par->a_maxAdcDiff) lower = sAD->d_mean - par->a_maxAdcDiff/2;
+    upper = sAD->d_mean + (sAD->d_max - sAD->d_mean)/par->a_spanDiv;
+    if(upper >= sAD->d_max - par->a_maxAdcDiff) upper = sAD->d_mean + par->a_maxAdcDiff/2;
+
+    // the first periode by hysteresis, too: an octave up would hit every other predicted window.
+    // A spike may give a false edge: the next pair of edges within TRACKFIRSTPERIODS is tried
+    w = P/TRACKWINDOW;
+    if(w < TRACKMINWINDOW)  w = TRACKMINWINDOW;
+    end = (uint32_t)(TRACKFIRSTPERIODS*P);
+    if(end > len)  end = len;
+    i = nextEdge(sAD, lower, upper, 0, end);
+    if(!i)  return -9;
+    first = crossing(sAD, i, upper);
+    for(;;) {
+        i = nextEdge(sAD, lower, upper, i, end);
+        if(!i)  return -9;
+        last = crossing(sAD, i, upper);
+        if(fabsf(last - first - P) <= w)  break;
+        first = last;
+    }
+    est = d = last - first;
+    steps = numD = 1;
+    sumD = d;
+    sumD2 = d*d;
+    sAD->d_usedLen = len;
+#ifdef PITCHCONTOUR
+    c = sAD->d_contour;
+    if(c) {
+        if(c->c_refFreq <= 0.0f)  c->c_refFreq = 1.0f/periode;
+        refPeriode = (float)sAD->d_sFreq/c->c_refFreq;
+    }
+#endif
+
+    for(;;) {
+        expected = last + (miss + 1)*est;
+        lo = (uint32_t)(expected - w);
+        hi = (uint32_t)(expected + w) + 1;
+        if(hi >= len)  break;
+        i = windowEdge(sAD, upper, lo, hi, expected);
+        if(!i) {
+            if(++miss > TRACKMAXMISS)  return -9;
+            continue;
+        }
+        e = crossing(sAD, i, upper);
+        d = (e - last)/(miss + 1);     // periode, spread over missed windows
+#ifdef PITCHCONTOUR
+        if(c && !miss)
+            contourAdd(c, c->c_frameTime + (uint32_t)(0.5e6f*(last + e)*sAD->d_deltaTime), contourCent(refPeriode/d));
+#endif
+        steps += miss + 1;
+        misses += miss;
+        miss = 0;
+        last = e;
+        est = (last - first)/steps;     // follows drift and vibrato
+        sumD += d;
+        sumD2 += d*d;
+        numD++;
+
+        // early termination as calcFreqAnalog: standard error of the mean periode (last-first)/steps
+        if(sAD->d_targetCent > 0.0f && numD >= CONVERGEMINPERIODS) {
+            var = (sumD2 - sumD*sumD/numD)/(numD - 1);
+            if(var*CENTPERREL*CENTPERREL < sAD->d_targetCent*sAD->d_targetCent*(last - first)*(last - first)) {
+                sAD->d_usedLen = hi + 1;
+                break;
+            }
+        }
+    }
+
+    if(numD < TRACKMINPERIODS)  return -9;
+    est = (last - first)/steps;
+    if(fabsf(est - P) > TRACKMAXDRIFT*P)  return -9;
+    var = (numD >= 2) ? (sumD2 - sumD*sumD/numD)/(numD - 1) : 0.0f;
+    sAD->d_periode = est*sAD->d_deltaTime;
+    sAD->d_quality = sqrtf(var > 0.0f ? var : 0.0f)*sAD->d_deltaTime;
+    sAD->d_numPeriodes = numD;
+    sAD->d_numRejected = misses;
+    sAD->d_numFalling = 0;
+    sAD->d_duty = 0.0f;
+    // classic frequency independent of the windows: rising edges by hysteresis between first and last edge.
+    // Else classifyResult would confirm the lock by its own periode.
+    // the held edge may follow the crossing taken by a few samples of noise, up to the window
+    end = (uint32_t)(last + w) + 3;
+    if(end > len)  end = len;
+    edges = countEdges(sAD, lower, upper, (uint32_t)first + 2, end);
+    sAD->d_freqClassic = (float)edges/((last - first)*sAD->d_deltaTime);
+    sAD->d_numCP = edges;
+    sAD->d_octaveShift = 0;
+    return 0;
+} /* calcFreqTrack */
@@ -0,0 +1,48 @@
+/****************************************************
+ * @file ADC_Track.h
+ * @brief Tracking of a sustained note: edges searched only where the last periode predicts them
+ * @note calcFreqTrack gets the periode of the last result. The first rising edge is found by the
+ *    hysteresis of calcFreqAnalog, the next one as well: the first periode must match
+ *    periode within the window (so an octave up loses the lock). Then each next edge only within
+ *    +-periode/TRACKWINDOW of last edge + periode: about 2/TRACKWINDOW of the samples are read for
+    the periode. d_freqClassic counts the edges by hysteresis over all samples between first and last edge.
+ *    In the window the upward crossing of the upper threshold nearest the prediction is taken,
+ *    interpolated between its two samples, so spikes and double crossings elsewhere in the periode
+ *    are not seen at all. The prediction follows the running mean periode (drift, vibrato).
+ * @note Loss of lock (return -9): no first periode within TRACKFIRSTPERIODS, more than TRACKMAXMISS windows in a row without
+ *    an edge, less than TRACKMINPERIODS periodes or a periode off the last one by TRACKMAXDRIFT
+ *    (a new note). The caller then analyses the frame with calcFreqAnalog.
+ * @note Thresholds come from d_mean, d_max, d_min as for calcFreqAnalog, d_targetCent
+ *    stops early as there. No workspace, results in the same fields of sADCData.
+*****************************************************/
+
+#ifndef ADCTRACK_H
+#define ADCTRACK_H
+
+#include <stdint.h>
+
+// edges are searched within +-periode/TRACKWINDOW of the prediction
+#define TRACKWINDOW (8)
+// but at least within +-TRACKMINWINDOW samples
+#define TRACKMINWINDOW (2)
+// the first periode is searched by hysteresis within this many periodes
+#define TRACKFIRSTPERIODS (4)
+// windows in a row without an edge, then the lock is lost
+#define TRACKMAXMISS (2)
+// minimum periodes of a result
+#define TRACKMINPERIODS (3)
+// relative difference of the mean periode to the last one, beyond: a new note (3% is half a semitone)
+#define TRACKMAXDRIFT (0.03f)
+
+struct sADCData;
+
+/*
+  @brief Mean periode of the frame in sAD near periode [s], the result of the last frame
+  @return 0, -9 lock lost (see above), other <0 for errors as calcFreqAnalog
+  @note Sets d_periode, d_quality, d_numPeriodes, d_numRejected (windows without edge),
+    d_freqClassic and d_numCP (edges by hysteresis between first and last edge, so classifyResult
+    checks the windows against all samples), d_usedLen and appends to d_contour (PITCHCONTOUR)
+*/
+int calcFreqTrack(struct sADCData *sAD, float periode);
+
+#endif
@@ -1,2 +1,3 @@
 void configure_i2s(int rate, int ADC_Chan);   // rate in Hz !!!
 void set_sample_rate(uint32_t rate, int ADC_Chan);     // if you do not trust my configure_i2s !
+int switch_sample_rate(uint32_t rate);    // clock only, driver stays installed. Returns 0, <0 for errors
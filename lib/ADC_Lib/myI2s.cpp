@@ -117,3 +117,16 @@ void set_sample_rate(uint32_t rate, int ADC_Chan) {   // rate [Hz]
   i2s_driver_uninstall(I2S_NUM_0);
   configure_i2s(rate, ADC_Chan);
 }
+
+/**********************************************
+ * Sample rate switch at runtime (RATEGOVERNOR): i2s_set_sample_rates
+ * reprograms the clock dividers and restarts I2S, no reinstall of the driver
+ * and no settling delay as with set_sample_rate. I2S is stopped again,
+ * as the caller starts it for each read (i2s_start resets the DMA buffers).
+ * @return 0, <0 for errors
+ **********************************************/
+int switch_sample_rate(uint32_t rate) {   // rate [Hz]
+  if(ESP_OK != i2s_set_sample_rates(I2S_NUM_0, rate))  return -1;
+  i2s_stop(I2S_NUM_0);
+  return 0;
+}
@@ -1,17 +1,20 @@
 /************************************************************************
- @brief Audio frequency analysis for musical instruments  
+ @brief Audio frequency analysis for musical instruments
  @file AFrequencies.cpp
  @author Juergen Boehm
  @date 2025 April 13
  @include AFrequencies.h
- @note Compiler: GCC under Win32 resp. Espressif
+ @note Compiler: GCC under Win32, Linux resp. Espressif
  @note Only using float and default int
- @note 52+28+4 bytes of global memory (DRAM).
+ @note 52 bytes of global memory (DRAM) plus 1.6 kByte of the default sTuning,
+        used by findNearestNote... until setDefaultTuning.
  @note Implementation is used with small modifications for Arduino/ESP32
+ @note 2025, May 8: Runtime reference pitch and temperaments (setTuning) with
+        table lookup instead of the equal tempered scan of a range.
 
   Copyright (C) <2025>  <Juergen Boehm>
 *************************************************************************/
-#ifdef _WIN32
+#if defined _WIN32 || defined __linux__
     #include <stdio.h>
     #include <stdlib.h>
 #elif defined ARDUINO_ARCH_ESP32   || defined ESP32
@@ -19,9 +22,9 @@
 #endif
 
 #include <stddef.h>
-#include <stdint-gcc.h>
+#include <stdint.h>
 #include <math.h>
-#include <string.h> 
+#include <string.h>
 #include <float.h>
 
 #include "AFrequencies.h"
@@ -31,172 +34,252 @@
 const char TAG[] = "FreqTune";
 #endif
 
+// 1200/ln(2): cent of a small relative frequency difference
+#define CENTPERLN (1731.234f)
+
 // *** Globals ***
 
-// I prefer the german notation with h and b. English:                             "bb"   "b"  
-char noteNames[13][4] = {"c", "cis", "d", "dis", "e", "f", "fis", "g", "gis", "a", "b", "h", "c"};
-
-/* note's ranges start up from
-	C	65.4063913251401 
-	c   130.812782650287
-	c1	261.625565300588
-	c2	523.251130601197
-	c3	1046.5022612024
-	c4	2093.00452240479
-	c5	4186.009045
-*/
-float noteCstart[] = {65.4063913251401, 130.812782650287, 261.625565300588, 523.251130601197, 1046.5022612024, 2093.00452240479, 4186.009045};
-int noteCstartCount = sizeof(noteCstart)/sizeof(float);
+// I prefer the german notation with h and b. English:                             "bb"   "b"
+static const char noteNames[13][4] = {"c", "cis", "d", "dis", "e", "f", "fis", "g", "gis", "a", "b", "h", "c"};
+
+// intervals above the root in cent, c .. h when the root is c
+static const float justCent[12] = {0.000f, 111.731f, 203.910f, 315.641f, 386.314f, 498.045f,
+    590.224f, 701.955f, 813.686f, 884.359f, 1017.596f, 1088.269f};
+static const float pythagoreanCent[12] = {0.000f, 90.225f, 203.910f, 294.135f, 407.820f, 498.045f,
+    611.730f, 701.955f, 792.180f, 905.865f, 996.090f, 1109.775f};
+// quarter comma: fifths of 696.578 cent, eb .. gis
+static const float meantoneCent[12] = {0.000f, 76.049f, 193.157f, 310.265f, 386.314f, 503.422f,
+    579.471f, 696.578f, 772.627f, 889.735f, 1006.843f, 1082.892f};
+
+// tuning of findNearestNote..., the firmware default. Analysers running concurrently pass their own
+static struct sTuning gDefaultTuning;
+static const struct sTuning *gCurTuning = NULL;
+
+
+/*** private functions ***/
+
+// tuning set by setDefaultTuning, 440Hz equal temperament before (built on first use, not thread-safe)
+static const struct sTuning *curTuning(void) {
+  if(!gCurTuning) {
+    tuningDefaults(&gDefaultTuning);
+    setTuning(&gDefaultTuning);
+    gCurTuning = &gDefaultTuning;
+  }
+  return gCurTuning;
+}
+
+// frequency of note n in the tuning sT with the deviations dev of each pitch class [cent]
+static float noteFreq(const struct sTuning *sT, const float *dev, int n) {
+  int d = n - NOTEA1;
+  float cent = 100.0f*d + dev[n%12] - dev[NOTEA1%12];
+
+  if(sT->t_temperament == TEMP_STRETCHED) cent += sT->t_stretch*(float)(d*abs(d))/144.0f;
+  return sT->t_refA*powf(2.0f, cent/1200.0f);
+}
+
 
 /* *** public functions *** */
 
 /**************************************
-    @brief  Finds the name of nearest musical notes between deep C and high c5
+    @brief Sets a1=440Hz, equal temperament, stretch of 2 cent, no correction
+***************************************/
+void tuningDefaults(struct sTuning *sT) {
+  memset(sT, 0, sizeof(*sT));
+  sT->t_refA = TONE_A1;
+  sT->t_temperament = TEMP_EQUAL;
+  sT->t_stretch = 2.0f;     // approx. +-30 cent at the ends of a piano
+}   /* tuningDefaults */
+
+/**************************************
+    @brief Builds the note table of a tuning, call again after changing a setting.
+        Uses pow and division, but only once per setting. Touches only sT.
+    @param[in] t_refA, t_temperament, t_key, t_stretch, t_userCent, t_correctCent
+    @param[out] all other members of sTuning
+    @return 0, <0 for invalid settings: tables and factors of the last valid setting stay,
+        a tuning never built gets factors of 1 (no correction) and finds no note
+***************************************/
+int setTuning(struct sTuning *sT) {
+  float dev[12], start, freq, prev;
+  int pc, interval, n, b;
+
+  if(!sT) return -1;
+  if(!(sT->t_corrFactor > 0.0f)) {      // never built: a refused setting must not scale frequencies to 0 Hz
+    sT->t_corrFactor = 1.0f;
+    sT->t_signalFactor = 1.0f;
+  }
+  if(sT->t_refA < MINREFPITCH || sT->t_refA > MAXREFPITCH) return -2;
+  if(sT->t_temperament > TEMP_USER || sT->t_key > 11) return -3;
+
+  // deviation of each pitch class from equal temperament
+  for(pc=0; pc<12; pc++) {
+    interval = (pc - sT->t_key + 12) % 12;
+    switch(sT->t_temperament) {
+      case TEMP_JUST:         dev[pc] = justCent[interval] - 100.0f*interval;  break;
+      case TEMP_PYTHAGOREAN:  dev[pc] = pythagoreanCent[interval] - 100.0f*interval;  break;
+      case TEMP_MEANTONE:     dev[pc] = meantoneCent[interval] - 100.0f*interval;  break;
+      case TEMP_USER:         dev[pc] = sT->t_userCent[pc];  break;
+      default:                dev[pc] = 0.0f;
+    }
+  }
+
+  // checked before any table is touched: sT may be the tuning in use
+  for(n=0, prev=0.0f; n<NOTECOUNT; n++, prev=freq) {
+    freq = noteFreq(sT, dev, n);
+    if(n > 0 && freq <= prev*1.001f) return -4;   // not ascending
+  }
+
+  // notes relative to a1, which stays at t_refA
+  for(n=0; n<NOTECOUNT; n++) {
+    sT->t_noteFreq[n] = noteFreq(sT, dev, n);
+    sT->t_invFreq[n] = 1.0f/sT->t_noteFreq[n];
+  }
+
+  // boundaries in the geometric middle, quarter tone beyond the first and last note
+  sT->t_bound[0] = sT->t_noteFreq[0]/HALFNOTEFACTOR;
+  for(n=1; n<NOTECOUNT; n++)  sT->t_bound[n] = sqrtf(sT->t_noteFreq[n-1]*sT->t_noteFreq[n]);
+  sT->t_bound[NOTECOUNT] = sT->t_noteFreq[NOTECOUNT-1]*HALFNOTEFACTOR;
+
+  // lowest note of each bucket: the one whose range holds the bucket's start
+  for(b=0, n=0; b<TUNINGBUCKETS; b++) {
+    start = ldexpf(1.0f + (float)(b & ((1 << TUNINGSUBBITS) - 1))/(1 << TUNINGSUBBITS), TUNINGMINEXP + (b >> TUNINGSUBBITS));
+    while(n < NOTECOUNT-1 && start >= sT->t_bound[n+1]) n++;
+    sT->t_bucket[b] = (uint8_t)n;
+  }
+
+  sT->t_corrFactor = powf(2.0f, sT->t_correctCent/1200.0f);
+  sT->t_signalFactor = 1.0f/sT->t_corrFactor;
+  return 0;
+}   /* setTuning */
+
+/**************************************
+    @brief Makes sT the tuning of findNearestNote..., NULL for 440Hz equal temperament.
+        Global state of the firmware: call it before any lookup, not while one runs.
+***************************************/
+void setDefaultTuning(const struct sTuning *sT) {
+  gCurTuning = sT;
+}   /* setDefaultTuning */
+
+/**************************************
+    @brief Nearest note by table lookup: bucket from exponent and mantissa bits,
+        then at most a step or two up (one bucket is narrower than a semitone).
+    @param[in] freq: true frequency (measured frequency times t_corrFactor) [Hz]
+    @param[out] noteName: >=5 chars or NULL
+    @param[out] cent: difference to the note or NULL. ln(1+d) as polynomial, error < 0.001 cent within +-60 cent
+    @return note index (0 is deep C, NOTEA1 is a1), -1 above, -2 below the table
+***************************************/
+int findNote(const struct sTuning *sT, float freq, char *noteName, float *cent) {
+  uint32_t bits, idx;
+  int32_t e;
+  int n;
+  float d;
+
+  if(freq >= sT->t_bound[NOTECOUNT]) return -1;
+  if(!(freq >= sT->t_bound[0])) return -2;   // also NaN
+
+  memcpy(&bits, &freq, sizeof(bits));
+  e = (int32_t)((bits >> 23) & 0xFF) - 127 - TUNINGMINEXP;
+  if(e < 0) idx = 0;
+  else {
+    idx = ((uint32_t)e << TUNINGSUBBITS) | ((bits >> (23 - TUNINGSUBBITS)) & ((1 << TUNINGSUBBITS) - 1));
+    if(idx >= TUNINGBUCKETS) idx = TUNINGBUCKETS - 1;
+  }
+  n = sT->t_bucket[idx];
+  while(n < NOTECOUNT-1 && freq >= sT->t_bound[n+1]) n++;
+
+  if(noteName) tuningNoteName(n, noteName);
+  if(cent) {
+    d = freq*sT->t_invFreq[n] - 1.0f;
+    *cent = CENTPERLN*d*(1.0f - d*(0.5f - d*(1.0f/3.0f - 0.25f*d)));
+  }
+  return n;
+}   /* findNote */
+
+/**************************************
+    @brief Name of a note index: "c" .. "h" for the lowest octave, then with the range digit, e.g. "fis3"
+***************************************/
+void tuningNoteName(int note, char *noteName) {
+  size_t len;
+
+  strcpy(noteName, noteNames[note%12]);
+  if(note >= 12) {
+    len = strlen(noteName);
+    noteName[len] = (char)('0' + note/12 - 1);
+    noteName[len+1] = '\0';
+  }
+}   /* tuningNoteName */
+
+/**************************************
+    @brief  Finds the name of nearest musical notes between deep C and high c6
     @author Juergen Boehm
     @date 2025 April 12
-    @note 
+    @note
     @param[in] freq:    audio frequency in Hz (1/s)
     @param[in] noteName: provide space for the note's name and one digit for the range, thus >=5
-    @param[out] noteName: name of the note with no error return. e.g. "fis3" for approx. 1480 Hz. 
+    @param[out] noteName: name of the note with no error return. e.g. "fis3" for approx. 1480 Hz.
     @return <0 for errors and >=0 for range, starting at deep C (65.4Hz)
           Range 0 will just give c, cis,...
           Range 1 will give c0, cis0,... according to list above and common style
 ***************************************/
 int findNearestNote(float freq, char *noteName) {
-    int retVal;
-    int noteRange;
+    int n;
 
-    retVal = findNoteRange(freq);
-    if(retVal<0) return retVal;
-    noteRange = retVal;
-
-    retVal = findNoteInRange(freq, noteRange, noteName);
-    if(retVal<-50) return retVal;
-    else return noteRange;
+    n = findNote(curTuning(), freq, noteName, NULL);
+    if(n<0) return n;
+    return (n/12 > 6) ? 6 : n/12;     // c6 is the top of range 6
 
 }   /* findNearestNote */
 
 /**************************************
-    @brief Same as findNearestNote, but also gives difference from noteName in cent (1 cent = 1/100 of a semitone) 
+    @brief Same as findNearestNote, but also gives difference from noteName in cent (1 cent = 1/100 of a semitone)
     @param[out] *diffCent
     @return <=-9999 for errors or noteRange as with findNearestNote
 ***************************************/
 int findNearestNoteDiff(float freq, char *noteName, int *diffCent) {
-  int retVal;
-  int noteRange;
-
-  retVal = findNoteRange(freq);
-  if(retVal<0) return retVal-9999;
-  noteRange = retVal;
 
-  retVal = findNoteInRange(freq, noteRange, noteName);
-  if(retVal < -50) return retVal;
-
-  *diffCent = retVal;
-
-  return noteRange;
+  return findNoteDiff(curTuning(), freq, noteName, diffCent);
 
 }   /* findNearestNoteDiff */
 
+/**************************************
+    @brief findNearestNoteDiff in the tuning sT
+    @param[in] freq: true frequency (measured frequency times t_corrFactor) [Hz]
+    @param[out] *diffCent
+    @return <=-9999 for errors or noteRange as with findNearestNote
+***************************************/
+int findNoteDiff(const struct sTuning *sT, float freq, char *noteName, int *diffCent) {
+  float cent;
+  int n;
 
+  n = findNote(sT, freq, noteName, &cent);
+  if(n<0) return n-9999;
 
-/*** private functions ***/
-
-/********************************************
- * Finds range of frequency
- * returns -1 for frequencies above c5
- * returns -2 for frequencies below C 
- * returns 0 .. 6 as index into noteCstart
-*********************************************/
-int findNoteRange(float freq) {
-  int retVal = -1;
-  
-  // allow 50 cent above c6:
-  if(freq > 2.0f * noteCstart[noteCstartCount-1] * HALFNOTEFACTOR)    return -1;
-  if(freq < noteCstart[0]) return -2;
-
-  if(freq < noteCstart[1])    {
-      retVal = 0;
-  }
-  else if(freq < noteCstart[2])    {
-      retVal = 1;
-  }
-  else if(freq < noteCstart[3])    {
-      retVal = 2;
-  }
-  else if(freq < noteCstart[4])    {
-      retVal = 3;
-  }
-  else if(freq < noteCstart[5])    {
-      retVal = 4;
-  }
-  else if(freq < noteCstart[6])    {
-      retVal = 5;
-  }
-  else retVal = 6;  // used up to c6
-  
-  return retVal;
-} /* findNoteRange */
-
-/********************************************
- * Finds note within a given range 0..6.
- * returns -9999 for errors
- * returns -50 .. 50 for differnece to note in cent
- * 2025, April 21: Tuning correction introduced.
-*********************************************/
-int findNoteInRange(float freq, int range, char *noteName)  {
-
-    float dist[13], noteFreq, freqMinDist;
-#ifdef _WIN32
-    float minDist = FLT_MAX; 
-#elif ARDUINO_ARCH_ESP32
-    float minDist = FLT_MAX;
-#endif
-    int i, idxMin, iCent;
-    char num[3];
-
-    if(range<0 || range>6) return -9999;
-
-
-    noteFreq = noteCstart[range];
-    // generate frequency distances within range and find index of minimum
-    for(i=0; i<13; i++) {
-        dist[i] = freq - noteFreq;
-        if(fabs(dist[i]) < minDist) {
-            minDist = dist[i];
-            idxMin = i;
-            freqMinDist = noteFreq;
-        }
-        noteFreq *= TWELFTH_SQ2;
-    }
-
-    strcpy(noteName, noteNames[idxMin]);
+  if(cent < 0.0f) *diffCent = (int)(cent - 0.5f);
+  else *diffCent = (int)(cent + 0.5f);
 
-    // pay attention with upper limit in range:
-    if(idxMin == 12)  { // next higher c is nearest!, e.g.c2, when in c1 range
-        itoa(range, num, 10);
-        strncat(noteName, num, 1);
-    }
-    else if(range>0) {
-        itoa(range-1, num, 10);
-        strncat(noteName, num, 1);
-    }
+  return (n/12 > 6) ? 6 : n/12;
 
-    // calculate cent from minDist
-    noteFreq = (TWELFTH_SQ2 - 1.0f) * freqMinDist / 100.0f;
-        //printf("+++ Debug: freqMinDist=%g minDist=%g  freq=%g oneCent=%g idxMin=%d\n", freqMinDist, minDist, freq, noteFreq, idxMin);
-    if(fabs(noteFreq)<0.03f)    // minimum cent with C is 0.0367Hz
-        return 0;
-    else {
-        if(minDist < 0.0f)  iCent = (int)(minDist/noteFreq - 0.5f);
-        else iCent = (int)(minDist/noteFreq + 0.5f);
-        return iCent;
-    }
-    
-}   /* findNoteInRange */
+}   /* findNoteDiff */
 
+/**************************************
+    @brief Frequency of the nearest note, e.g. as center for a finer analysis (refineFreqGoertzel)
+    @param[in] freq: audio frequency in Hz (1/s)
+    @return frequency of nearest note in Hz, 0.0f for frequencies out of range
+***************************************/
+float findNearestNoteFreq(float freq) {
 
+  return findNoteFreq(curTuning(), freq);
 
+}   /* findNearestNoteFreq */
 
+/**************************************
+    @brief findNearestNoteFreq in the tuning sT
+    @return frequency of nearest note in Hz, 0.0f for frequencies out of range
+***************************************/
+float findNoteFreq(const struct sTuning *sT, float freq) {
+  int n;
 
+  n = findNote(sT, freq, NULL, NULL);
+  if(n<0) return 0.0f;
+  return sT->t_noteFreq[n];
 
+}   /* findNoteFreq */
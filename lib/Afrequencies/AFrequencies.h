@@ -5,10 +5,14 @@
     @file AFrequencies.cpp
     @author Juergen Boehm
     @date 2025 April 12
-    @note 
+    @note Reference pitch and temperament are set at runtime by setTuning, which
+            builds the note table once. Lookups are O(1): a bucket table indexed by
+            exponent and upper mantissa bits of the float frequency, one compare
+            with the boundary to the next note and a short polynomial for the cent.
+            No pow, log or division per frame.
     @param[in] freq:    audio frequency in Hz (1/s)
     @param[in] noteName: provide space for the note's name and one digit for the range, thus >=5
-    @param[out] noteName: name of the note with no error return. e.g. "fis3" for approx. 1480 Hz. 
+    @param[out] noteName: name of the note with no error return. e.g. "fis3" for approx. 1480 Hz.
         Range 0 will just give c, cis,... (to save ram space)
         Range 1 will give c0, cis0,... according to list above and common style
     @return <0 for errors and >=0 for range, starting at deep C (65.4Hz, engl. C2)
@@ -16,6 +20,8 @@
 #ifndef FINDNOTES
 #define FINDNOTES
 
+#include <stdint.h>
+
 #define AUDIO_FREQ
 #define TONE_A1 (440.0f)
 #define TONE_C1 (261.625565300588f)
@@ -23,13 +29,63 @@
 #define TWELFTH_SQ2 (1.0594630943593f)
 #define HALFNOTEFACTOR (1.029302236643492f)
 
-// Finds the name of musical notes between deep C and high c6
+// notes of the table: deep C .. c6, a1 is note 33
+#define NOTECOUNT (7*12 + 1)
+#define NOTEA1 (2*12 + 9)
+// reference pitch a1 accepted by setTuning [Hz]
+#define MINREFPITCH (380.0f)
+#define MAXREFPITCH (500.0f)
+// lookup buckets: 2^TUNINGSUBBITS per octave of the float exponent (27 cent wide with 6 bits),
+// octaves 2^TUNINGMINEXP .. covering the boundaries of deep C and c6
+#define TUNINGSUBBITS (6)
+#define TUNINGMINEXP (5)
+#define TUNINGOCTAVES (9)
+#define TUNINGBUCKETS (TUNINGOCTAVES << TUNINGSUBBITS)
+
+// temperaments of setTuning
+#define TEMP_EQUAL (0)
+#define TEMP_JUST (1)           // 5-limit just intonation on t_key
+#define TEMP_PYTHAGOREAN (2)    // pure fifths from t_key
+#define TEMP_MEANTONE (3)       // quarter comma meantone from t_key
+#define TEMP_STRETCHED (4)      // equal with a piano like stretch of t_stretch cent per octave^2 from a1
+#define TEMP_USER (5)           // equal plus t_userCent per pitch class
+
+struct sTuning {
+  // setup by caller (see tuningDefaults)
+  float t_refA;           // frequency of a1 [Hz], e.g. 440.0f or 415.0f
+  uint8_t t_temperament;  // TEMP_...
+  uint8_t t_key;          // root of just, pythagorean and meantone temperaments: 0=c .. 11=h
+  float t_stretch;        // TEMP_STRETCHED: cent at one octave from a1, four times that at two octaves...
+  float t_userCent[12];   // TEMP_USER: deviation from equal temperament of c .. h in cent
+  float t_correctCent;    // correction of measured frequencies, e.g. -12 if the ADC clock reads 12 cent high
+  // calculated by setTuning
+  float t_corrFactor;     // measured frequency times t_corrFactor is the true frequency
+  float t_signalFactor;   // 1/t_corrFactor: true note frequency to measured frequency
+  float t_noteFreq[NOTECOUNT];      // true frequencies of the notes [Hz]
+  float t_invFreq[NOTECOUNT];       // 1/t_noteFreq
+  float t_bound[NOTECOUNT + 1];     // lower boundary of each note (geometric middle to the one below) [Hz]
+  uint8_t t_bucket[TUNINGBUCKETS];  // lowest note of each bucket
+};
+
+// sets 440Hz, equal temperament, no correction
+void tuningDefaults(struct sTuning *);
+// builds the tables of sTuning. Returns <0 for invalid settings
+int setTuning(struct sTuning *);
+// tuning used by findNearestNote... (firmware default, 440Hz equal before). Not thread-safe: set it at startup
+void setDefaultTuning(const struct sTuning *);
+// O(1) lookup: index of nearest note (0 is deep C) and cent difference to it. <0 if out of range
+int findNote(const struct sTuning *, float freq, char *noteName, float *cent);
+// as findNearestNoteDiff and findNearestNoteFreq, but in the tuning given: reentrant
+int findNoteDiff(const struct sTuning *, float freq, char *noteName, int *diffCent);
+float findNoteFreq(const struct sTuning *, float freq);
+// name of note index, e.g. "fis3"
+void tuningNoteName(int note, char *noteName);
+
+// Finds the name of musical notes between deep C and high c6 (tuning of setDefaultTuning, else 440Hz equal)
 int findNearestNote(float freq, char *noteName);
 // Same, but also gives difference from noteName in cent (1 cent = 1/100 of a semitone)
 int findNearestNoteDiff(float freq, char *noteName, int *diffCent);
-
-// internal use:
-int findNoteRange(float freq);
-int findNoteInRange(float freq, int range, char *noteName);
+// Frequency of the note nearest to freq, 0.0f outside deep C .. c6
+float findNearestNoteFreq(float freq);
 
 #endif //FINDNOTES
@@ -0,0 +1,341 @@
+/**********************************************************
+ @brief Corpus files of recorded ADC frames: delta and bit packing, footer index, mmap reader
+ @file Corpus.cpp
+ @author Juergen Boehm
+ @date 2025, May 11
+ @include Corpus.h
+ @note Compiler: GCC under Linux (mmap). The decoder reads little endian words directly.
+ @note RAM: writer CORPUSMAXREC bytes plus 8 bytes per frame, reader nothing but the mapping
+
+ Copyright (C) <2025>  <Juergen Boehm>
+***********************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "Corpus.h"
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "corpus decoder needs a little endian host"
+#endif
+
+static const char gMagic[8] = {'F', 'T', 'C', 'O', 'R', 'P', 'U', 'S'};
+static const char gIndexMagic[8] = {'F', 'T', 'C', 'I', 'N', 'D', 'E', 'X'};
+#define CORPUSVERSION (1)
+
+
+/*** private functions ***/
+
+static void put16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+    put16(p, (uint16_t)v);
+    put16(p+2, (uint16_t)(v >> 16));
+}
+
+static void put64(uint8_t *p, uint64_t v) {
+    put32(p, (uint32_t)v);
+    put32(p+4, (uint32_t)(v >> 32));
+}
+
+// little endian host (see above): plain unaligned loads
+static uint16_t get16(const uint8_t *p) {
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t get32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint64_t get64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint16_t zigzag(uint16_t d) {
+    return (uint16_t)((d << 1) ^ (uint16_t)((int16_t)d >> 15));
+}
+
+static inline uint16_t unzigzag(uint32_t z) {
+    return (uint16_t)((z >> 1) ^ (0u - (z & 1)));
+}
+
+static uint8_t bitWidth(uint32_t v) {
+    return v ? (uint8_t)(32 - __builtin_clz(v)) : 0;
+}
+
+/************************************************************************
+ * @brief Packs n values of w bits (LSB first) to out, which is cleared before
+ * @return bytes used
+*************************************************************************/
+static uint32_t packBits(const uint16_t *v, uint32_t n, uint8_t w, uint8_t *out) {
+    uint32_t bytes = (n*w + 7) >> 3, pos = 0, i;
+    uint64_t acc = 0;
+    int bits = 0;
+
+    for(i = 0; i < n; i++) {
+        acc |= (uint64_t)v[i] << bits;
+        bits += w;
+        while(bits >= 8) {
+            out[pos++] = (uint8_t)acc;
+            acc >>= 8;
+            bits -= 8;
+        }
+    }
+    if(bits)  out[pos] = (uint8_t)acc;
+    return bytes;
+}
+
+/************************************************************************
+ * @brief Decodes groups of 8 zigzag deltas of W bits: 8*W bits are W whole bytes,
+ *   so each group is one unaligned 64 bit load (two for W > 7) and constant shifts.
+*************************************************************************/
+template<unsigned W>
+static void unpackGroups(const uint8_t *in, uint32_t groups, uint16_t *s, uint16_t *out) {
+    const uint64_t mask = (1u << W) - 1;
+    uint64_t lo, hi;
+    uint16_t v = *s;
+
+    for(uint32_t g = 0; g < groups; g++, in += W, out += 8) {
+        lo = get64(in);
+        hi = (W > 7) ? get64(in + 8) : 0;
+        for(unsigned k = 0; k < 8; k++) {   // unrolled, k*W is constant
+            uint64_t z = (k*W + W <= 64) ? lo >> (k*W)
+                : (k*W >= 64) ? hi >> (k*W - 64) : (lo >> (k*W)) | (hi << (64 - k*W));
+            v += unzigzag((uint32_t)(z & mask));
+            out[k] = v;
+        }
+    }
+    *s = v;
+}
+
+typedef void (*unpack_t)(const uint8_t *, uint32_t, uint16_t *, uint16_t *);
+static const unpack_t gUnpack[17] = {NULL, unpackGroups<1>, unpackGroups<2>, unpackGroups<3>,
+    unpackGroups<4>, unpackGroups<5>, unpackGroups<6>, unpackGroups<7>, unpackGroups<8>,
+    unpackGroups<9>, unpackGroups<10>, unpackGroups<11>, unpackGroups<12>, unpackGroups<13>,
+    unpackGroups<14>, unpackGroups<15>, unpackGroups<16>};
+
+/************************************************************************
+ * @brief Decodes a block of n zigzag deltas of w bits, adding them to *prev:
+ *   whole groups of 8 by gUnpack, the rest bit by bit
+ * @note Reads up to 15 bytes beyond the block: records are followed by at least
+ *   the index and trailer (CORPUSTRAILLEN) in the file.
+*************************************************************************/
+static void unpackBlock(const uint8_t *in, uint32_t n, uint8_t w, uint16_t *prev, uint16_t *out) {
+    const uint64_t mask = (1u << w) - 1;
+    uint16_t s = *prev;
+    uint32_t i, pos;
+
+    if(!w) {    // constant
+        for(i = 0; i < n; i++)  out[i] = s;
+        return;
+    }
+    gUnpack[w](in, n >> 3, &s, out);
+    for(i = n & ~7u, pos = i*w; i < n; i++, pos += w) {
+        s += unzigzag((uint32_t)((get64(in + (pos >> 3)) >> (pos & 7)) & mask));
+        out[i] = s;
+    }
+    *prev = s;
+}
+
+// pointer to record i, NULL if out of range or damaged
+static const uint8_t *record(const struct sCorpusReader *cr, uint32_t i) {
+    uint64_t off;
+
+    if(!cr->r_map || i >= cr->r_frames)  return NULL;
+    off = get64(cr->r_index + 8*(uint64_t)i);
+    if(off < CORPUSHEADLEN || off + CORPUSRECHEADLEN > (uint64_t)(cr->r_index - cr->r_map))  return NULL;
+    return cr->r_map + off;
+}
+
+
+/*** public functions ***/
+
+int corpusCreate(struct sCorpusWriter *cw, const char *name, const char *device) {
+    uint8_t head[CORPUSHEADLEN] = {0};
+
+    memset(cw, 0, sizeof(*cw));
+    if(!(cw->w_buf = (uint8_t *)malloc(CORPUSMAXREC)))  return -4;
+    if(!(cw->w_fp = fopen(name, "wb"))) {
+        free(cw->w_buf);
+        cw->w_buf = NULL;
+        return -1;
+    }
+    memcpy(head, gMagic, sizeof(gMagic));
+    put16(head + 8, CORPUSVERSION);
+    put16(head + 10, CORPUSBLOCK);
+    if(device)  memcpy(head + 16, device, strnlen(device, CORPUSDEVICELEN));
+    if(fwrite(head, 1, sizeof(head), cw->w_fp) != sizeof(head)) {
+        fclose(cw->w_fp);
+        free(cw->w_buf);
+        memset(cw, 0, sizeof(*cw));
+        return -2;
+    }
+    cw->w_pos = sizeof(head);
+    return 0;
+} /* corpusCreate */
+
+/************************************************************************
+ * @brief Encodes a frame into w_buf and writes it: record head, a bit width per block,
+ *   the zigzag deltas of each block packed with its width
+ * @return index of frame, <0 for errors
+*************************************************************************/
+int32_t corpusAppend(struct sCorpusWriter *cw, const struct sCorpusFrame *meta, const uint16_t *data) {
+    uint16_t zz[CORPUSBLOCK], prev;
+    uint32_t len = meta->f_len, nb, b, n, i, bytes = 0, mx;
+    uint8_t *buf = cw->w_buf, *widths, *packed;
+    uint64_t *index;
+    uint32_t recLen;
+
+    if(!cw->w_fp)  return -3;
+    if(!len || len > CORPUSMAXLEN)  return -7;
+    nb = (len - 1 + CORPUSBLOCK - 1)/CORPUSBLOCK;
+    put16(buf, (uint16_t)len);
+    buf[2] = meta->f_channel;
+    buf[3] = 0;
+    put32(buf + 4, meta->f_sFreq);
+    put64(buf + 8, meta->f_time);
+    memcpy(buf + 16, &meta->f_refFreq, sizeof(float));
+    put16(buf + 20, data[0]);
+    widths = buf + CORPUSRECHEADLEN;
+    packed = widths + nb;
+    prev = data[0];
+    for(b = 0; b < nb; b++) {
+        n = (len - 1 - b*CORPUSBLOCK < CORPUSBLOCK) ? len - 1 - b*CORPUSBLOCK : CORPUSBLOCK;
+        for(i = 0, mx = 0; i < n; i++) {
+            zz[i] = zigzag((uint16_t)(data[1 + b*CORPUSBLOCK + i] - prev));
+            prev = data[1 + b*CORPUSBLOCK + i];
+            mx |= zz[i];
+        }
+        widths[b] = bitWidth(mx);
+        bytes += packBits(zz, n, widths[b], packed + bytes);
+    }
+    put16(buf + 22, (uint16_t)bytes);
+    recLen = CORPUSRECHEADLEN + nb + bytes;
+
+    if(cw->w_frames >= cw->w_cap) {
+        cw->w_cap = cw->w_cap ? 2*cw->w_cap : 1024;
+        if(!(index = (uint64_t *)realloc(cw->w_index, cw->w_cap*sizeof(uint64_t))))  return -4;
+        cw->w_index = index;
+    }
+    if(fwrite(buf, 1, recLen, cw->w_fp) != recLen)  return -2;
+    cw->w_index[cw->w_frames] = cw->w_pos;
+    cw->w_pos += recLen;
+    return cw->w_frames++;
+} /* corpusAppend */
+
+int corpusFinish(struct sCorpusWriter *cw) {
+    uint8_t trail[CORPUSTRAILLEN] = {0}, off[8];
+    int retval = 0;
+
+    if(!cw->w_fp)  return -3;
+    for(uint32_t i = 0; i < cw->w_frames && !retval; i++) {
+        put64(off, cw->w_index[i]);
+        if(fwrite(off, 1, 8, cw->w_fp) != 8)  retval = -2;
+    }
+    put64(trail, cw->w_pos);
+    put32(trail + 8, cw->w_frames);
+    memcpy(trail + 16, gIndexMagic, sizeof(gIndexMagic));
+    if(!retval && fwrite(trail, 1, sizeof(trail), cw->w_fp) != sizeof(trail))  retval = -2;
+    if(fclose(cw->w_fp))  retval = -2;
+    free(cw->w_index);
+    free(cw->w_buf);
+    memset(cw, 0, sizeof(*cw));
+    return retval;
+} /* corpusFinish */
+
+int32_t corpusOpen(struct sCorpusReader *cr, const char *name) {
+    struct stat st;
+    const uint8_t *trail;
+    uint64_t indexOff;
+    void *map;
+    int fd;
+
+    memset(cr, 0, sizeof(*cr));
+    if((fd = open(name, O_RDONLY)) < 0)  return -1;
+    if(fstat(fd, &st) < 0 || st.st_size < CORPUSHEADLEN + CORPUSTRAILLEN) {
+        close(fd);
+        return -3;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);      // the mapping stays
+    if(map == MAP_FAILED)  return -2;
+    cr->r_map = (const uint8_t *)map;
+    cr->r_size = st.st_size;
+
+    trail = cr->r_map + cr->r_size - CORPUSTRAILLEN;
+    indexOff = get64(trail);
+    cr->r_frames = get32(trail + 8);
+    if(memcmp(cr->r_map, gMagic, sizeof(gMagic)) || get16(cr->r_map + 8) != CORPUSVERSION
+        || get16(cr->r_map + 10) != CORPUSBLOCK || memcmp(trail + 16, gIndexMagic, sizeof(gIndexMagic))
+        || indexOff < CORPUSHEADLEN || indexOff + 8*(uint64_t)cr->r_frames + CORPUSTRAILLEN != cr->r_size) {
+        corpusClose(cr);
+        return -3;
+    }
+    cr->r_index = cr->r_map + indexOff;
+    memcpy(cr->r_device, cr->r_map + 16, CORPUSDEVICELEN);
+    madvise(map, cr->r_size, MADV_SEQUENTIAL);
+    return cr->r_frames;
+} /* corpusOpen */
+
+void corpusClose(struct sCorpusReader *cr) {
+    if(cr->r_map)  munmap((void *)cr->r_map, cr->r_size);
+    memset(cr, 0, sizeof(*cr));
+} /* corpusClose */
+
+int corpusFrame(const struct sCorpusReader *cr, uint32_t i, struct sCorpusFrame *meta) {
+    const uint8_t *rec = record(cr, i);
+
+    if(!rec)  return -1;
+    meta->f_len = get16(rec);
+    meta->f_channel = rec[2];
+    meta->f_sFreq = get32(rec + 4);
+    meta->f_time = get64(rec + 8);
+    memcpy(&meta->f_refFreq, rec + 16, sizeof(float));
+    return 0;
+} /* corpusFrame */
+
+/************************************************************************
+ * @brief Decodes frame i block by block straight from the mapping
+ * @return number of samples, <0 for errors
+*************************************************************************/
+int32_t corpusRead(const struct sCorpusReader *cr, uint32_t i, uint16_t *data, uint32_t maxLen) {
+    const uint8_t *rec = record(cr, i), *widths, *packed;
+    uint32_t len, nb, b, n, bytes;
+    uint16_t prev;
+
+    if(!rec)  return -1;
+    len = get16(rec);
+    if(!len || len > maxLen)  return -7;
+    nb = (len - 1 + CORPUSBLOCK - 1)/CORPUSBLOCK;
+    widths = rec + CORPUSRECHEADLEN;
+    packed = widths + nb;
+    if(packed > cr->r_index)  return -3;    // damaged
+    // block sizes from the widths must give the stored byte count, all before the index
+    for(b = 0, bytes = 0; b < nb; b++) {
+        n = (len - 1 - b*CORPUSBLOCK < CORPUSBLOCK) ? len - 1 - b*CORPUSBLOCK : CORPUSBLOCK;
+        if(widths[b] > 16)  return -3;
+        bytes += (n*widths[b] + 7) >> 3;
+    }
+    if(bytes != get16(rec + 22) || bytes > (uint32_t)(cr->r_index - packed))  return -3;
+    prev = data[0] = get16(rec + 20);
+    for(b = 0, bytes = 0; b < nb; b++) {
+        n = (len - 1 - b*CORPUSBLOCK < CORPUSBLOCK) ? len - 1 - b*CORPUSBLOCK : CORPUSBLOCK;
+        unpackBlock(packed + bytes, n, widths[b], &prev, data + 1 + b*CORPUSBLOCK);
+        bytes += (n*widths[b] + 7) >> 3;
+    }
+    return len;
+} /* corpusRead */
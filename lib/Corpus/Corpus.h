@@ -0,0 +1,88 @@
+/****************************************************
+ * @file Corpus.h
+ * @brief File format for recorded ADC frames: lossless compression, index for seeking, mmap reading
+ * @note Layout, all numbers little endian:
+ *    header   "FTCORPUS", version u16, block u16 (CORPUSBLOCK), reserved u32, device char[16]
+ *    frames   one record per frame, see below
+ *    index    frames * u64: file offset of each record
+ *    trailer  index offset u64, frames u32, reserved u32, "FTCINDEX"
+ *    So the reader finds the index from the end of the file, frame i is one lookup away.
+ * @note Record of a frame: len u16, channel u8, reserved u8, sFreq u32 [Hz], time u64 [us],
+ *    refFreq f32 [Hz] (frequency of the signal if known, else 0), first sample u16,
+ *    bytes u16 (of the packed deltas), (len-1+CORPUSBLOCK-1)/CORPUSBLOCK widths u8, packed deltas.
+ *    The deltas of neighbouring samples (mod 2^16, so any uint16_t is lossless) are zigzag coded
+ *    (0, -1, 1, -2 .. to 0, 1, 2, 3 ..) and packed with the bit width of the largest in their
+ *    block of CORPUSBLOCK samples. 12 bit frames of ADC_Sim with noise 300 need 10..11 bits per sample.
+ * @note The reader maps the file (mmap) and decodes straight from the mapping,
+ *    bit fields are read as unaligned 64 bit words: no copies, no system calls per frame.
+ * @note Host only (POSIX), not used by the firmware.
+*****************************************************/
+
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define CORPUSBLOCK (128)       // samples per bit width, CORPUSBLOCK*width bits are whole bytes
+#define CORPUSMAXLEN (16384)    // max. samples of a frame
+#define CORPUSDEVICELEN (16)    // chars of the device name, without terminating 0
+#define CORPUSHEADLEN (32)
+#define CORPUSRECHEADLEN (24)   // record bytes before the widths
+#define CORPUSTRAILLEN (24)
+// max. bytes of a record
+#define CORPUSMAXREC (CORPUSRECHEADLEN + CORPUSMAXLEN/CORPUSBLOCK + 1 + 2*CORPUSMAXLEN)
+
+// meta data of a frame
+struct sCorpusFrame {
+    uint16_t f_len;         // samples
+    uint8_t f_channel;      // ADC channel
+    uint32_t f_sFreq;       // sample rate [Hz]
+    uint64_t f_time;        // time stamp [us]
+    float f_refFreq;        // frequency of the signal [Hz], 0 if unknown
+};
+
+struct sCorpusWriter {
+    FILE *w_fp;
+    uint64_t w_pos;         // bytes written
+    uint64_t *w_index;      // offset of each record
+    uint32_t w_frames, w_cap;
+    uint8_t *w_buf;         // one record (CORPUSMAXREC)
+};
+
+struct sCorpusReader {
+    const uint8_t *r_map;   // whole file
+    uint64_t r_size;
+    const uint8_t *r_index;
+    uint32_t r_frames;
+    char r_device[CORPUSDEVICELEN + 1];
+};
+
+/*
+  @brief Creates a corpus file, device names the recording (e.g. "esp32 gpio34"), may be NULL
+  @return 0, <0 for errors
+*/
+int corpusCreate(struct sCorpusWriter *, const char *name, const char *device);
+/*
+  @brief Appends a frame of meta->f_len samples
+  @return index of the frame, <0 for errors
+*/
+int32_t corpusAppend(struct sCorpusWriter *, const struct sCorpusFrame *meta, const uint16_t *data);
+// writes index and trailer, closes the file. Returns 0, <0 for errors
+int corpusFinish(struct sCorpusWriter *);
+
+/*
+  @brief Maps a corpus file and checks header, trailer and index
+  @return number of frames, <0 for errors (-1 open, -2 map, -3 no corpus)
+*/
+int32_t corpusOpen(struct sCorpusReader *, const char *name);
+void corpusClose(struct sCorpusReader *);
+// meta data of frame i, <0 if out of range or damaged
+int corpusFrame(const struct sCorpusReader *, uint32_t i, struct sCorpusFrame *meta);
+/*
+  @brief Decodes frame i into data (maxLen samples at least f_len)
+  @return number of samples, <0 for errors
+*/
+int32_t corpusRead(const struct sCorpusReader *, uint32_t i, uint16_t *data, uint32_t maxLen);
+
+#endif
@@ -0,0 +1,136 @@
+/**********************************************************
+ @brief Atlas of pre-rasterised glyphs, drawn into 8 or 4 bit frame buffers
+ @file GlyphCache.cpp
+ @author Juergen Boehm
+ @date 2025, May 10
+ @include GlyphCache.h
+ @note Compiler: GCC under Win32, Linux resp. Espressif
+ @note RAM: sizeof(struct sGlyphCache), 2.2 kByte with the defaults
+
+ Copyright (C) <2025>  <Juergen Boehm>
+***********************************************************/
+#include <stdint.h>
+#include <string.h>   // memset
+
+#include "GlyphCache.h"
+
+
+/*** private functions ***/
+
+static inline uint16_t rowBytes(const struct sGlyph *g) {
+    return (g->g_w + 7) >> 3;
+}
+
+/************************************************************************
+ * @brief Copies the glyphs of text into the frame buffer:
+ *   per row the glyph's bytes, jumping from set bit to set bit (clz), writing fg.
+ * @param[in] bpp: 8 (a byte per pixel) or 4 (two pixels per byte, even x in the high nibble)
+ * @return width, <0 if a glyph is missing
+*************************************************************************/
+static int drawText(const struct sGlyphCache *gc, const char *text, uint8_t font, uint8_t *fb, uint16_t fbW, uint16_t fbH,
+        int16_t x, int16_t y, uint8_t fg, uint8_t bpp) {
+    const struct sGlyph *g;
+    const uint8_t *src;
+    uint8_t *dst, bits;
+    int16_t x0 = x, px;
+    uint16_t rb, r, b;
+    int idx[GCMAXGLYPHS], n = 0, i, k;
+    bool inside;    // glyph needs no clipping in x
+
+    // all glyphs first: nothing is drawn for unknown text
+    for(const char *p = text; *p; p++) {
+        if(n >= GCMAXGLYPHS || (idx[n] = gcFind(gc, *p, font)) < 0)  return -1;
+        n++;
+    }
+
+    for(i = 0; i < n; i++) {
+        g = &gc->c_glyph[idx[i]];
+        rb = rowBytes(g);
+        inside = x >= 0 && x + 8*rb <= fbW;
+        for(r = 0; r < g->g_h; r++) {
+            if(y + r < 0 || y + r >= fbH)  continue;
+            src = gc->c_bits + g->g_offset + r*rb;
+            dst = fb + (uint32_t)(y + r)*fbW*bpp/8;
+            for(b = 0; b < rb; b++) {
+                bits = src[b];      // empty bytes are skipped at once
+                px = x + 8*b;
+                while(bits) {
+                    k = __builtin_clz((uint32_t)bits) - 24;     // next set pixel
+                    bits &= (uint8_t)~(0x80 >> k);
+                    if(!inside && (px + k < 0 || px + k >= fbW))  continue;
+                    if(bpp == 8)  dst[px + k] = fg;
+                    else if((px + k) & 1)  dst[(px + k) >> 1] = (dst[(px + k) >> 1] & 0xF0) | fg;
+                    else  dst[(px + k) >> 1] = (dst[(px + k) >> 1] & 0x0F) | (uint8_t)(fg << 4);
+                }
+            }
+        }
+        x += g->g_w;
+    }
+    return x - x0;
+} /* drawText */
+
+
+/*** public functions ***/
+
+void gcInit(struct sGlyphCache *gc) {
+    gc->c_num = 0;
+    gc->c_used = 0;
+    memset(gc->c_bits, 0, sizeof(gc->c_bits));
+} /* gcInit */
+
+/************************************************************************
+ * @brief Reserves a glyph, its bits are cleared (gcInit)
+ * @return index, -1 cache full, -2 atlas full, -3 too large, -4 already cached
+*************************************************************************/
+int gcAdd(struct sGlyphCache *gc, char c, uint8_t font, uint8_t w, uint8_t h) {
+    struct sGlyph *g;
+    uint16_t bytes;
+
+    if(gc->c_num >= GCMAXGLYPHS)  return -1;
+    if(!w || !h || w > GCMAXW || h > GCMAXH)  return -3;
+    if(gcFind(gc, c, font) >= 0)  return -4;
+    bytes = ((w + 7) >> 3)*h;
+    if(gc->c_used + bytes > GCATLASBYTES)  return -2;
+    g = &gc->c_glyph[gc->c_num];
+    g->g_char = c;
+    g->g_font = font;
+    g->g_w = w;
+    g->g_h = h;
+    g->g_offset = gc->c_used;
+    gc->c_used += bytes;
+    return gc->c_num++;
+} /* gcAdd */
+
+void gcSetPixel(struct sGlyphCache *gc, int glyph, uint8_t x, uint8_t y) {
+    const struct sGlyph *g = &gc->c_glyph[glyph];
+
+    if(x >= g->g_w || y >= g->g_h)  return;
+    gc->c_bits[g->g_offset + y*rowBytes(g) + (x >> 3)] |= (uint8_t)(0x80 >> (x & 7));
+} /* gcSetPixel */
+
+int gcFind(const struct sGlyphCache *gc, char c, uint8_t font) {
+    for(int i = 0; i < gc->c_num; i++)
+        if(gc->c_glyph[i].g_char == c && gc->c_glyph[i].g_font == font)  return i;
+    return -1;
+} /* gcFind */
+
+int gcTextWidth(const struct sGlyphCache *gc, const char *text, uint8_t font) {
+    int w = 0, i;
+
+    for(; *text; text++) {
+        if((i = gcFind(gc, *text, font)) < 0)  return -1;
+        w += gc->c_glyph[i].g_w;
+    }
+    return w;
+} /* gcTextWidth */
+
+int gcDraw8(const struct sGlyphCache *gc, const char *text, uint8_t font, uint8_t *fb, uint16_t fbW, uint16_t fbH,
+        int16_t x, int16_t y, uint8_t fg) {
+    return drawText(gc, text, font, fb, fbW, fbH, x, y, fg, 8);
+} /* gcDraw8 */
+
+int gcDraw4(const struct sGlyphCache *gc, const char *text, uint8_t font, uint8_t *fb, uint16_t fbW, uint16_t fbH,
+        int16_t x, int16_t y, uint8_t fg) {
+    if(fbW & 1)  return -2;
+    return drawText(gc, text, font, fb, fbW, fbH, x, y, fg & 0x0F, 4);
+} /* gcDraw4 */
@@ -0,0 +1,65 @@
+/****************************************************
+ * @file GlyphCache.h
+ * @brief Atlas of pre-rasterised glyphs (1 bit per pixel), drawn into 8 or 4 bit frame buffers
+ * @note The fonts of TFT_eSPI have no kerning, so a text is its glyphs side by side,
+ *    each advancing by its width. The few glyphs of note names ("fis3") and scale labels
+ *    ("-25") are rasterised once (gcAdd, gcSetPixel, e.g. from a 1 bit sprite) and
+ *    then copied by gcDraw8: no String on the heap and no font decoding per frame.
+ * @note Transparent background, like TFT_eSPI drawString with setTextColor(fg) only.
+ * @note No dependency on TFT_eSPI, so the host benchmark uses the same code.
+*****************************************************/
+
+#ifndef GLYPHCACHE_H
+#define GLYPHCACHE_H
+
+#include <stdint.h>
+
+#define GCMAXGLYPHS (32)        // glyphs of all fonts
+#define GCATLASBYTES (2048)     // bits of all glyphs, rows padded to bytes
+#define GCMAXW (32)             // max. width of a glyph in pixels
+#define GCMAXH (32)             // max. height
+
+struct sGlyph {
+  char g_char;
+  uint8_t g_font;         // font number of TFT_eSPI
+  uint8_t g_w, g_h;       // advance width and font height [pixel]
+  uint16_t g_offset;      // first byte in c_bits, (g_w+7)/8 bytes per row
+};
+
+struct sGlyphCache {
+  uint8_t c_num;          // glyphs used
+  uint16_t c_used;        // bytes of c_bits used
+  struct sGlyph c_glyph[GCMAXGLYPHS];
+  uint8_t c_bits[GCATLASBYTES];
+};
+
+// empty cache
+void gcInit(struct sGlyphCache *);
+/*
+  @brief Reserves a cleared glyph of w x h pixels, to be set by gcSetPixel
+  @return index of glyph, <0 when the cache is full or the glyph too large
+*/
+int gcAdd(struct sGlyphCache *, char c, uint8_t font, uint8_t w, uint8_t h);
+void gcSetPixel(struct sGlyphCache *, int glyph, uint8_t x, uint8_t y);
+// index of glyph of c in font, <0 if not cached
+int gcFind(const struct sGlyphCache *, char c, uint8_t font);
+// width of text in pixels, <0 if a glyph is missing
+int gcTextWidth(const struct sGlyphCache *, const char *text, uint8_t font);
+/*
+  @brief Draws text with its top left corner at x, y into an 8 bit frame buffer of fbW x fbH pixels
+    (e.g. getPointer() of a TFT_eSprite with colour depth 8), clipped to the buffer
+  @param[in] fg: colour in the format of the buffer (RGB332 for 8 bit sprites)
+  @return width drawn, <0 if a glyph is missing (nothing drawn then)
+*/
+int gcDraw8(const struct sGlyphCache *, const char *text, uint8_t font, uint8_t *fb, uint16_t fbW, uint16_t fbH,
+    int16_t x, int16_t y, uint8_t fg);
+/*
+  @brief As gcDraw8 into a 4 bit frame buffer (palette index per pixel, TFT_eSprite with colour depth 4):
+    fbW/2 bytes per row, even x in the high nibble
+  @param[in] fg: palette index 0..15
+  @return width drawn, <0 if a glyph is missing, -2 for odd fbW
+*/
+int gcDraw4(const struct sGlyphCache *, const char *text, uint8_t font, uint8_t *fb, uint16_t fbW, uint16_t fbH,
+    int16_t x, int16_t y, uint8_t fg);
+
+#endif
@@ -0,0 +1,282 @@
+/**********************************************************
+ @brief Edge counting analysis of many streams: SoA state, lane kernels and thread pool
+ @file MultiStream.cpp
+ @author Juergen Boehm
+ @date 2025, May 10
+ @include MultiStream.h
+ @note Compiler: GCC under Linux, -O3 (and -march=native) for vectorised kernels, -pthread
+ @note RAM: 39 bytes per stream plus MSLANES*MSBLOCK*4 bytes per thread
+
+ Copyright (C) <2025>  <Juergen Boehm>
+***********************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+
+#include "MultiStream.h"
+
+// job of the pool: one frame of all streams, groups taken by atomic counter
+struct sMsJob {
+    struct sMultiStream *j_ms;
+    const uint16_t *const *j_frame;
+    uint32_t j_len;
+    std::atomic<uint32_t> j_next;
+};
+
+static std::vector<std::thread> gWorkers;
+static std::mutex gMutex;
+static std::condition_variable gWake, gDone;
+static uint64_t gGeneration = 0;    // incremented per job
+static uint32_t gActive = 0;        // workers still busy with the job
+static bool gStop = false;
+static struct sMsJob gJob;
+
+// one lane per stream: gcc vector extensions, compiled to SSE, AVX2 or NEON as available.
+// Comparisons give masks of all bits set (true) or 0.
+typedef uint32_t msvec_t __attribute__((vector_size(MSLANES*sizeof(uint32_t))));
+typedef float msvecf_t __attribute__((vector_size(MSLANES*sizeof(float))));
+
+
+/*** private functions ***/
+
+// min, max and mean of a frame, plain loop for the vectoriser
+static void frameStats(const uint16_t *p, uint32_t len, uint16_t *min, uint16_t *max, uint16_t *mean) {
+    uint32_t lo = 0xFFFF, hi = 0, sum = 0, i;
+
+    for(i = 0; i < len; i++) {
+        lo = p[i] < lo ? p[i] : lo;
+        hi = p[i] > hi ? p[i] : hi;
+        sum += p[i];
+    }
+    *min = (uint16_t)lo;
+    *max = (uint16_t)hi;
+    *mean = (uint16_t)(sum/len);
+}
+
+/************************************************************************
+ * @brief Analyses the streams of group g: statistics and thresholds per stream,
+ *   then the crossing kernel on transposed blocks, MSLANES streams per step.
+ *   Streams beyond m_num (padding) are constant 0.
+*************************************************************************/
+static void groupAnalyse(struct sMultiStream *ms, uint32_t g, const uint16_t *const *frame, uint32_t len) {
+    static thread_local msvec_t blk[MSBLOCK];
+    msvec_t upper, lower, side, count, first, last, up, cross, has, tv;
+    msvecf_t sumD2, d;
+    const struct sADCParams *par = ms->m_params ? ms->m_params : &gADCDefaultParams;
+    const uint16_t *fp[MSLANES];
+    uint32_t base = g*MSLANES, s, l, k, t0, n, start, temp, span;
+    uint16_t lo, hi, mean, lw, uw;
+    float fn, meanD, var;
+
+    // statistics and thresholds as in calcFreqAnalog
+    for(l = 0; l < MSLANES; l++) {
+        s = base + l;
+        fp[l] = (s < ms->m_num) ? frame[s] : NULL;
+        if(fp[l]) frameStats(fp[l], len, &lo, &hi, &mean);
+        else lo = hi = mean = 0;
+        ms->m_min[s] = lo;  ms->m_max[s] = hi;  ms->m_mean[s] = mean;
+        ms->m_status[s] = MS_OK;
+        if(hi - lo <= par->a_maxAdcDiff) {
+            ms->m_status[s] = MS_CONSTANT;
+            lw = uw = 0xFFFF;       // no crossings
+        }
+        else {
+            lw = mean - (mean - lo)/par->a_spanDiv;
+            if(lw <= lo + par->a_maxAdcDiff) lw = mean - par->a_maxAdcDiff/2;
+            uw = mean + (hi - mean)/par->a_spanDiv;
+            if(uw >= hi - par->a_maxAdcDiff) uw = mean + par->a_maxAdcDiff/2;
+        }
+        ms->m_lower[s] = lower[l] = lw;
+        ms->m_upper[s] = upper[l] = uw;
+        // initial side from the first a_minTicDiff samples
+        temp = 0;
+        if(fp[l]) {
+            if(fp[l][0] > uw) temp++;
+            for(k = 0; k < par->a_minTicDiff; k++)  if(fp[l][k] > uw) temp++;
+        }
+        side[l] = (temp > (uint32_t)(par->a_minTicDiff >> 1)) ? ~0u : 0;
+    }
+    count = first = last = msvec_t{};
+    sumD2 = msvecf_t{};
+
+    // crossings, block by block
+    for(t0 = 0; t0 < len; t0 += MSBLOCK) {
+        n = (len - t0 < MSBLOCK) ? len - t0 : MSBLOCK;
+        for(l = 0; l < MSLANES; l++)  {
+            if(fp[l])  for(k = 0; k < n; k++)  blk[k][l] = fp[l][t0 + k];
+            else  for(k = 0; k < n; k++)  blk[k][l] = 0;
+        }
+        start = (t0 == 0) ? par->a_minTicDiff : 0;
+        for(k = start; k < n; k++) {
+            // branchless, all lanes at once
+            tv = msvec_t{} + (t0 + k);
+            up = (msvec_t)(blk[k] > upper);
+            cross = up & ~side;
+            has = (msvec_t)(count != 0);
+            d = __builtin_convertvector(tv - last, msvecf_t);
+            d *= d;
+            sumD2 += (msvecf_t)((msvec_t)d & cross & has);   // periode^2 from the 2nd crossing on
+            first = (first & ~(cross & ~has)) | (tv & cross & ~has);
+            last = (last & ~cross) | (tv & cross);
+            count -= cross;
+            side = (side & ~(msvec_t)(blk[k] <= lower)) | up;     // hysteresis
+        }
+    }
+
+    // results
+    for(l = 0; l < MSLANES; l++) {
+        s = base + l;
+        ms->m_count[s] = count[l];
+        ms->m_first[s] = first[l];
+        ms->m_last[s] = last[l];
+        ms->m_sumD2[s] = sumD2[l];
+        if(count[l] < 2) {
+            if(ms->m_status[s] == MS_OK) ms->m_status[s] = MS_NOPERIODE;
+            ms->m_freq[s] = 0.0f;
+            ms->m_periode[s] = ms->m_quality[s] = FLT_MAX;
+            continue;
+        }
+        span = last[l] - first[l];
+        fn = (float)(count[l] - 1);
+        meanD = (float)span/fn;
+        ms->m_freq[s] = fn/(float)span*ms->m_sFreq;
+        ms->m_periode[s] = meanD/ms->m_sFreq;
+        var = (count[l] > 2) ? (sumD2[l] - fn*meanD*meanD)/(fn - 1.0f) : 0.0f;
+        ms->m_quality[s] = (var > 0.0f) ? sqrtf(var)/ms->m_sFreq : 0.0f;
+    }
+} /* groupAnalyse */
+
+// groups of the current job until none is left
+static void runShard(void) {
+    uint32_t g;
+
+    while((g = gJob.j_next.fetch_add(1, std::memory_order_relaxed)) < gJob.j_ms->m_groups)
+        groupAnalyse(gJob.j_ms, g, gJob.j_frame, gJob.j_len);
+}
+
+// seen: generation at start, so a new pool does not run the last job again
+static void workerLoop(uint64_t seen) {
+    for(;;) {
+        {
+            std::unique_lock<std::mutex> lock(gMutex);
+            gWake.wait(lock, [&]{ return gStop || gGeneration != seen; });
+            if(gStop)  return;
+            seen = gGeneration;
+        }
+        runShard();
+        {
+            std::lock_guard<std::mutex> lock(gMutex);
+            if(--gActive == 0)  gDone.notify_one();
+        }
+    }
+}
+
+
+/*** public functions ***/
+
+/************************************************************************
+ * @brief Allocates the SoA arrays of num streams, padded to whole groups
+ * @return 0, <0 for errors
+*************************************************************************/
+int msInit(struct sMultiStream *ms, uint32_t num, uint32_t sFreq, const struct sADCParams *params) {
+    uint32_t n;
+
+    if(!ms)  return -3;
+    memset(ms, 0, sizeof(*ms));
+    if(!num)  return -7;
+    if(!sFreq)  return -5;
+    if(params && ADC_ParamsCheck(params) < 0)  return -8;
+    ms->m_num = num;
+    ms->m_groups = (num + MSLANES - 1)/MSLANES;
+    ms->m_sFreq = sFreq;
+    ms->m_params = params;
+    n = ms->m_groups*MSLANES;
+    ms->m_min = (uint16_t *)calloc(5*n, sizeof(uint16_t));
+    ms->m_count = (uint32_t *)calloc(3*n, sizeof(uint32_t));
+    ms->m_sumD2 = (float *)calloc(4*n, sizeof(float));
+    ms->m_status = (int8_t *)calloc(n, sizeof(int8_t));
+    if(!ms->m_min || !ms->m_count || !ms->m_sumD2 || !ms->m_status) {
+        msFree(ms);
+        return -4;
+    }
+    ms->m_max = ms->m_min + n;
+    ms->m_mean = ms->m_max + n;
+    ms->m_lower = ms->m_mean + n;
+    ms->m_upper = ms->m_lower + n;
+    ms->m_first = ms->m_count + n;
+    ms->m_last = ms->m_first + n;
+    ms->m_freq = ms->m_sumD2 + n;
+    ms->m_periode = ms->m_freq + n;
+    ms->m_quality = ms->m_periode + n;
+    return 0;
+} /* msInit */
+
+void msFree(struct sMultiStream *ms) {
+    free(ms->m_min);
+    free(ms->m_count);
+    free(ms->m_sumD2);
+    free(ms->m_status);
+    memset(ms, 0, sizeof(*ms));
+} /* msFree */
+
+/************************************************************************
+ * @brief Starts threads-1 workers waiting for jobs of msAnalyse
+ * @return 0, <0 for errors
+*************************************************************************/
+int msBegin(uint32_t threads) {
+    if(!threads || threads > MSMAXTHREADS)  return -1;
+    msEnd();
+    gStop = false;
+    for(uint32_t i = 1; i < threads; i++)  gWorkers.push_back(std::thread(workerLoop, gGeneration));
+    return 0;
+} /* msBegin */
+
+void msEnd(void) {
+    {
+        std::lock_guard<std::mutex> lock(gMutex);
+        gStop = true;
+    }
+    gWake.notify_all();
+    for(auto &w : gWorkers)  w.join();
+    gWorkers.clear();
+} /* msEnd */
+
+/************************************************************************
+ * @brief Analyses one frame of each stream, groups are shared by the caller and the workers
+ * @note Not reentrant: one msAnalyse at a time (the pool has one job)
+ * @return number of streams with MS_OK, <0 for errors
+*************************************************************************/
+int msAnalyse(struct sMultiStream *ms, const uint16_t *const *frame, uint32_t len) {
+    int ok = 0;
+
+    if(!ms || !ms->m_min)  return -3;
+    if(!frame)  return -4;
+    if(len <= (ms->m_params ? ms->m_params->a_minTicDiff : MINTICDIFF))  return -7;
+
+    gJob.j_ms = ms;
+    gJob.j_frame = frame;
+    gJob.j_len = len;
+    gJob.j_next.store(0, std::memory_order_relaxed);
+    if(!gWorkers.empty()) {
+        std::lock_guard<std::mutex> lock(gMutex);
+        gActive = gWorkers.size();
+        gGeneration++;
+    }
+    gWake.notify_all();
+    runShard();
+    if(!gWorkers.empty()) {
+        std::unique_lock<std::mutex> lock(gMutex);
+        gDone.wait(lock, []{ return gActive == 0; });
+    }
+
+    for(uint32_t s = 0; s < ms->m_num; s++)  if(ms->m_status[s] == MS_OK) ok++;
+    return ok;
+} /* msAnalyse */
@@ -0,0 +1,68 @@
+/****************************************************
+ * @file MultiStream.h
+ * @brief Edge counting analysis of many independent streams (channels) at once, for host test benches
+ * @note Per stream state and results are kept as structure of arrays, padded to a multiple
+ *    of MSLANES streams. A group of MSLANES streams is analysed together: blocks of MSBLOCK
+ *    samples are transposed into lanes, so the branchless kernels work on MSLANES channels
+ *    per step in SIMD registers (auto vectorised by gcc -O3, e.g. 8 x 32 bit with AVX2).
+ * @note Groups are sharded over a pool of msBegin threads. Each thread transposes into its
+ *    own block, results of a group are written by one thread only: no locks in the hot path.
+ * @note Per frame and stream the same as calcFreqAnalog with its sADCParams
+ *    (hysteresis thresholds from min, max and mean, upward crossings), but
+ *    without ROBUSTPERIODE, OCTAVEGUARD and early termination:
+ *    m_freq is the classic frequency, m_periode and m_quality are mean and stdev of all periodes.
+ * @note Host only (std::thread), not used by the firmware.
+*****************************************************/
+
+#ifndef MULTISTREAM_H
+#define MULTISTREAM_H
+
+#include <stdint.h>
+
+#include "ADC_DataAnalysis.h"
+
+#define MSLANES (8)         // streams per group, one SIMD register of uint32_t/float with AVX2
+#define MSBLOCK (256)       // samples per transposed block: MSLANES*MSBLOCK*4 bytes stay in L1
+#define MSMAXTHREADS (64)
+
+// status of a stream after msAnalyse
+#define MS_OK (0)
+#define MS_CONSTANT (-1)    // signal within a_maxAdcDiff
+#define MS_NOPERIODE (-2)   // less than 2 upward crossings
+
+struct sMultiStream {
+  uint32_t m_num;           // number of streams
+  uint32_t m_groups;        // (m_num + MSLANES - 1)/MSLANES
+  uint32_t m_sFreq;         // sample frequency of all streams [Hz]
+  const struct sADCParams *m_params;  // NULL for the defaults
+  // per stream, m_groups*MSLANES items each
+  uint16_t *m_min, *m_max, *m_mean;
+  uint16_t *m_lower, *m_upper;    // hysteresis thresholds
+  uint32_t *m_count;        // upward crossings
+  uint32_t *m_first, *m_last;     // sample index of first and last upward crossing
+  float *m_sumD2;           // sum of squared periodes [samples^2]
+  float *m_freq;            // classic frequency [Hz]
+  float *m_periode;         // mean periode [s]
+  float *m_quality;         // standard deviation of periodes [s]
+  int8_t *m_status;         // MS_...
+};
+
+/*
+  @brief Allocates the arrays of num streams, <0 for errors
+*/
+int msInit(struct sMultiStream *, uint32_t num, uint32_t sFreq, const struct sADCParams *params);
+void msFree(struct sMultiStream *);
+/*
+  @brief Starts the pool: threads-1 workers, the caller of msAnalyse is the last one.
+  Without msBegin msAnalyse runs in the calling thread.
+*/
+int msBegin(uint32_t threads);
+// stops and joins the workers
+void msEnd(void);
+/*
+  @brief Analyses one frame of len samples of each stream, frame[i] is stream i
+  @return number of streams with MS_OK, <0 for errors
+*/
+int msAnalyse(struct sMultiStream *, const uint16_t *const *frame, uint32_t len);
+
+#endif
@@ -0,0 +1,109 @@
+/**********************************************************
+ @brief 4 bit palette frame buffer of the tuner screens: span fills and changed rows
+ @file PalSprite.cpp
+ @author Juergen Boehm
+ @date 2025, May 13
+ @include PalSprite.h
+ @note Compiler: GCC under Win32, Linux resp. Espressif
+ @note RAM: the frame buffer of the caller, w*h/2 bytes
+
+ Copyright (C) <2025>  <Juergen Boehm>
+***********************************************************/
+#include <stdint.h>
+#include <string.h>   // memset
+
+#include "PalSprite.h"
+
+// TFT_BLACK, TFT_WHITE, TFT_RED, TFT_GREEN, TFT_ORANGE, TFT_YELLOW of TFT_eSPI, unused indices black
+const uint16_t psPalette[PSCOLORS] = {0x0000, 0xFFFF, 0xF800, 0x07E0, 0xFDA0, 0xFFE0};
+
+
+/*** private functions ***/
+
+// n pixels from x in a row
+static void fillSpan(uint8_t *row, int16_t x, int16_t n, uint8_t idx) {
+    uint8_t *p;
+
+    if(x & 1) {     // odd start: low nibble
+        p = row + (x >> 1);
+        *p = (*p & 0xF0) | idx;
+        x++;
+        n--;
+    }
+    if(n <= 0)  return;
+    memset(row + (x >> 1), idx*0x11, n >> 1);
+    if(n & 1) {     // even end: high nibble
+        p = row + ((x + n - 1) >> 1);
+        *p = (*p & 0x0F) | (uint8_t)(idx << 4);
+    }
+} /* fillSpan */
+
+
+/*** public functions ***/
+
+int psInit(struct sPalSprite *ps, uint8_t *fb, uint16_t w, uint16_t h) {
+    if(!ps || !fb)  return -4;
+    if(!w || (w & 1) || !h)  return -3;
+    ps->p_fb = fb;
+    ps->p_w = w;
+    ps->p_h = h;
+    ps->p_row0 = 0;
+    ps->p_row1 = h - 1;
+    return 0;
+} /* psInit */
+
+void psMarkRows(struct sPalSprite *ps, int16_t y, int16_t h) {
+    if(y < 0) { h += y;  y = 0; }
+    if(y + h > ps->p_h)  h = ps->p_h - y;
+    if(h <= 0)  return;
+    if(ps->p_row0 > ps->p_row1) {
+        ps->p_row0 = y;
+        ps->p_row1 = y + h - 1;
+        return;
+    }
+    if(y < ps->p_row0)  ps->p_row0 = y;
+    if(y + h - 1 > ps->p_row1)  ps->p_row1 = y + h - 1;
+} /* psMarkRows */
+
+/************************************************************************
+ * @brief Clips the rectangle, then a span per row. Rows of full width
+ *   are contiguous bytes: a single memset.
+*************************************************************************/
+void psFillRect(struct sPalSprite *ps, int16_t x, int16_t y, int16_t w, int16_t h, uint8_t idx) {
+    uint16_t bpr = ps->p_w >> 1;    // bytes per row
+
+    if(x < 0) { w += x;  x = 0; }
+    if(y < 0) { h += y;  y = 0; }
+    if(x + w > ps->p_w)  w = ps->p_w - x;
+    if(y + h > ps->p_h)  h = ps->p_h - y;
+    if(w <= 0 || h <= 0)  return;
+    idx &= 0x0F;
+    psMarkRows(ps, y, h);
+    if(w == ps->p_w) {
+        memset(ps->p_fb + (uint32_t)y*bpr, idx*0x11, (uint32_t)h*bpr);
+        return;
+    }
+    for(int16_t r = y; r < y + h; r++)  fillSpan(ps->p_fb + (uint32_t)r*bpr, x, w, idx);
+} /* psFillRect */
+
+void psFill(struct sPalSprite *ps, uint8_t idx) {
+    psFillRect(ps, 0, 0, ps->p_w, ps->p_h, idx);
+} /* psFill */
+
+uint8_t psPixel(const struct sPalSprite *ps, int16_t x, int16_t y) {
+    uint8_t b;
+
+    if(x < 0 || y < 0 || x >= ps->p_w || y >= ps->p_h)  return 0;
+    b = ps->p_fb[(uint32_t)y*(ps->p_w >> 1) + (x >> 1)];
+    return (x & 1) ? (b & 0x0F) : (b >> 4);
+} /* psPixel */
+
+int16_t psTakeRows(struct sPalSprite *ps, int16_t *y) {
+    int16_t n = ps->p_row1 - ps->p_row0 + 1;
+
+    if(n <= 0)  return 0;
+    *y = ps->p_row0;
+    ps->p_row0 = 1;     // none
+    ps->p_row1 = 0;
+    return n;
+} /* psTakeRows */
@@ -0,0 +1,59 @@
+/****************************************************
+ * @file PalSprite.h
+ * @brief 4 bit palette frame buffer of the tuner screens: span fills and changed rows
+ * @note The tuner draws six colours, so a palette index of 4 bits per pixel is enough
+ *    (2 bits would hold four colours only). The layout is that of a TFT_eSprite with colour
+ *    depth 4: w/2 bytes per row, even x in the high nibble. So the firmware draws with
+ *    these functions into getPointer() and TFT_eSPI pushes the sprite with its palette
+ *    (createPalette(psPalette)). 280x120 pixels need 16800 bytes instead of 33600 at 8 bit.
+ * @note psFillRect fills spans: a nibble at an odd start or even end, memset in between
+ *    (and one memset for rows of full width), instead of a pixel write per pixel.
+ * @note The rows changed since the last psTakeRows are tracked, so only these rows are
+ *    pushed to the display (the rows of a sprite are contiguous, columns are not).
+ * @note No dependency on TFT_eSPI, so the host benchmark uses the same code.
+*****************************************************/
+
+#ifndef PALSPRITE_H
+#define PALSPRITE_H
+
+#include <stdint.h>
+
+// palette indices of the tuner's colours, RGB565 in psPalette
+#define PSBLACK (0)
+#define PSWHITE (1)
+#define PSRED (2)
+#define PSGREEN (3)
+#define PSORANGE (4)
+#define PSYELLOW (5)
+#define PSCOLORS (16)
+
+struct sPalSprite {
+  uint8_t *p_fb;          // p_w*p_h/2 bytes
+  uint16_t p_w, p_h;      // [pixel], p_w even
+  int16_t p_row0, p_row1; // rows changed since psTakeRows, none if p_row0 > p_row1
+};
+
+// RGB565 of the indices, as TFT_BLACK, TFT_WHITE .. for createPalette and pushImage
+extern const uint16_t psPalette[PSCOLORS];
+
+/*
+  @brief Uses fb of w*h/2 bytes (e.g. getPointer() of a 4 bit TFT_eSprite), all rows changed
+  @return 0, <0 for errors (NULL buffer, odd width)
+*/
+int psInit(struct sPalSprite *, uint8_t *fb, uint16_t w, uint16_t h);
+// fills the rectangle with palette index idx, clipped to the sprite
+void psFillRect(struct sPalSprite *, int16_t x, int16_t y, int16_t w, int16_t h, uint8_t idx);
+// whole sprite
+void psFill(struct sPalSprite *, uint8_t idx);
+// palette index of pixel x, y (0 outside)
+uint8_t psPixel(const struct sPalSprite *, int16_t x, int16_t y);
+// marks h rows from y as changed, for drawing not done by psFillRect (e.g. gcDraw4)
+void psMarkRows(struct sPalSprite *, int16_t y, int16_t h);
+/*
+  @brief Rows changed since the last call, then none
+  @param[out] y: first row
+  @return number of rows, 0 if nothing changed
+*/
+int16_t psTakeRows(struct sPalSprite *, int16_t *y);
+
+#endif
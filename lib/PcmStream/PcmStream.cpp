@@ -0,0 +1,247 @@
+/**********************************************************
+ @brief Live PCM from stdin, a FIFO or a pipe as uint16_t ADC frames
+ @file PcmStream.cpp
+ @author Juergen Boehm
+ @date 2025, May 16
+ @include PcmStream.h
+ @note Compiler: GCC under Linux (POSIX read, fcntl, clock_gettime)
+ @note RAM: PCMBUFBYTES of input buffer plus sizeof(struct sPcmStream)
+
+ Copyright (C) <2025>  <Juergen Boehm>
+***********************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "PcmStream.h"
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "PCM conversion needs a little endian host"
+#endif
+
+#define WAVPCM (1)
+#define WAVFLOAT (3)
+#define WAVEXTENSIBLE (0xFFFE)
+
+
+/*** private functions ***/
+
+static uint16_t get16(const uint8_t *p) {
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t get32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static void put16(uint8_t *p, uint16_t v) {
+    memcpy(p, &v, sizeof(v));
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+    memcpy(p, &v, sizeof(v));
+}
+
+static bool validFormat(const struct sPcmFormat *fmt) {
+    if(!fmt->f_rate || !fmt->f_channels || fmt->f_channels > PCMMAXCHANNELS)  return false;
+    if(fmt->f_type == PCMFLOAT)  return fmt->f_bits == 32;
+    return fmt->f_bits == 8 || fmt->f_bits == 16 || fmt->f_bits == 24 || fmt->f_bits == 32;
+}
+
+/************************************************************************
+ * @brief WAV header at the start of the buffer: sets s_fmt and skips up to the data chunk
+ * @return 1 parsed, 0 need more bytes, <0 no valid WAV
+*************************************************************************/
+static int parseWav(struct sPcmStream *st) {
+    const uint8_t *p = st->s_buf + st->s_start;
+    uint32_t n = st->s_end - st->s_start, size, tag;
+    uint64_t off = 12;      // 64 bit: sums of untrusted chunk sizes must not wrap
+    bool fmtFound = false;
+
+    if(n < 12)  return 0;
+    if(memcmp(p + 8, "WAVE", 4))  return -1;
+    while(off + 8 <= n) {
+        size = get32(p + off + 4);
+        if(!memcmp(p + off, "data", 4)) {
+            if(!fmtFound || !validFormat(&st->s_fmt))  return -1;
+            st->s_start += (uint32_t)off + 8;
+            return 1;
+        }
+        if(size > n - off - 8)  return (n >= PCMMAXHEADER) ? -1 : 0;
+        if(!memcmp(p + off, "fmt ", 4) && size >= 16) {
+            tag = get16(p + off + 8);
+            if(tag == WAVEXTENSIBLE && size >= 26)  tag = get16(p + off + 32);    // sub format GUID
+            if(tag != WAVPCM && tag != WAVFLOAT)  return -1;
+            st->s_fmt.f_type = (tag == WAVFLOAT) ? PCMFLOAT : PCMINT;
+            st->s_fmt.f_channels = get16(p + off + 10);
+            st->s_fmt.f_rate = get32(p + off + 12);
+            st->s_fmt.f_bits = get16(p + off + 22);
+            fmtFound = true;
+        }
+        off += 8 + (uint64_t)size + (size & 1);     // chunks are padded to even size
+    }
+    return (n >= PCMMAXHEADER) ? -1 : 0;
+} /* parseWav */
+
+// sample at p as 16 bit signed (before gain)
+static inline float sample16(const uint8_t *p, const struct sPcmFormat *fmt) {
+    float f;
+
+    if(fmt->f_type == PCMFLOAT) {
+        memcpy(&f, p, sizeof(f));
+        return f*32767.0f;
+    }
+    switch(fmt->f_bits) {
+        case 8:  return (float)((int32_t)p[0] - 128)*256.0f;
+        case 16: return (float)(int16_t)get16(p);
+        case 24: return (float)((int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24) >> 8)/256.0f;
+        default: return (float)(int32_t)get32(p)/65536.0f;
+    }
+} /* sample16 */
+
+// time of the read that brought the stream beyond byte total
+static uint64_t arrival(const struct sPcmStream *st, uint64_t total) {
+    uint32_t first = (st->s_marks > PCMMARKS) ? st->s_marks - PCMMARKS : 0;
+
+    for(uint32_t i = first; i < st->s_marks; i++)
+        if(st->s_mark[i & (PCMMARKS - 1)].m_bytes >= total)  return st->s_mark[i & (PCMMARKS - 1)].m_ns;
+    return pcmNow();
+} /* arrival */
+
+
+/*** public functions ***/
+
+uint64_t pcmNow(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000ull + ts.tv_nsec;
+} /* pcmNow */
+
+int pcmOpen(struct sPcmStream *st, int fd, const struct sPcmFormat *raw, float gain) {
+    int flags;
+
+    memset(st, 0, sizeof(*st));
+    st->s_fd = fd;
+    st->s_fmt = *raw;
+    st->s_gain = gain;
+    if(!validFormat(raw))  return -3;
+    flags = fcntl(fd, F_GETFL);
+    if(flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)  return -1;
+    st->s_buf = (uint8_t *)malloc(PCMBUFBYTES);
+    if(!st->s_buf)  return -2;
+    return 0;
+} /* pcmOpen */
+
+void pcmClose(struct sPcmStream *st) {
+    free(st->s_buf);
+    st->s_buf = NULL;
+} /* pcmClose */
+
+/************************************************************************
+ * @brief Reads until the input has no more (EAGAIN) or the buffer is full.
+ *   Unread bytes are moved to the start of the buffer first, when less than half is free.
+ *   The header is checked as soon as 4 bytes are there.
+ * @return bytes read, <0 for errors
+*************************************************************************/
+int32_t pcmRead(struct sPcmStream *st) {
+    ssize_t n;
+    int32_t sum = 0;
+    int retval;
+
+    if(st->s_eof)  return 0;
+    if(st->s_end > PCMBUFBYTES/2) {
+        memmove(st->s_buf, st->s_buf + st->s_start, st->s_end - st->s_start);
+        st->s_end -= st->s_start;
+        st->s_start = 0;
+    }
+    while(st->s_end < PCMBUFBYTES) {
+        n = read(st->s_fd, st->s_buf + st->s_end, PCMBUFBYTES - st->s_end);
+        if(n < 0) {
+            if(errno == EINTR)  continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK)  break;
+            return -1;
+        }
+        if(!n) {
+            st->s_eof = true;
+            break;
+        }
+        st->s_end += n;
+        sum += n;
+    }
+    if(!sum)  return 0;
+    st->s_reads++;
+
+    if(!st->s_header && st->s_end - st->s_start >= 4) {
+        if(memcmp(st->s_buf + st->s_start, "RIFF", 4))  st->s_header = true;    // raw
+        else if((retval = parseWav(st)) < 0)  return -3;
+        else if(retval > 0)  st->s_header = true;
+        if(!st->s_header)  return sum;      // WAV header incomplete
+    }
+    st->s_total = st->s_consumed + (st->s_end - st->s_start);
+    st->s_mark[st->s_marks & (PCMMARKS - 1)].m_bytes = st->s_total;
+    st->s_mark[st->s_marks & (PCMMARKS - 1)].m_ns = pcmNow();
+    st->s_marks++;
+    return sum;
+} /* pcmRead */
+
+/************************************************************************
+ * @brief Converts the next frame, skipping frames beyond maxBacklog
+ * @return 1 for a frame in out, 0 if none complete, <0 for errors
+*************************************************************************/
+int pcmFrame(struct sPcmStream *st, uint16_t *out, uint32_t len, uint16_t channel, uint32_t maxBacklog, uint64_t *arrivalNs) {
+    const struct sPcmFormat *fmt = &st->s_fmt;
+    uint32_t bytesPerSample = fmt->f_bits/8, stride = bytesPerSample*fmt->f_channels, frameBytes, avail, skip;
+    const uint8_t *p;
+    float v;
+
+    if(!st->s_header)  return 0;
+    if(channel >= fmt->f_channels || !len)  return -3;
+    frameBytes = len*stride;
+    if(frameBytes > PCMBUFBYTES/2)  return -2;
+    avail = (st->s_end - st->s_start)/frameBytes;
+    if(!avail)  return 0;
+    if(avail - 1 > maxBacklog) {
+        skip = avail - maxBacklog - 1;
+        st->s_start += skip*frameBytes;
+        st->s_consumed += (uint64_t)skip*frameBytes;
+        st->s_dropped += skip;
+    }
+
+    p = st->s_buf + st->s_start + channel*bytesPerSample;
+    for(uint32_t i = 0; i < len; i++, p += stride) {
+        v = sample16(p, fmt)*st->s_gain;
+        if(v > 32767.0f)  v = 32767.0f;
+        else if(v < -32768.0f)  v = -32768.0f;
+        out[i] = (uint16_t)((int32_t)v + 32768) >> 4;
+    }
+    st->s_start += frameBytes;
+    st->s_consumed += frameBytes;
+    *arrivalNs = arrival(st, st->s_consumed);
+    st->s_frames++;
+    return 1;
+} /* pcmFrame */
+
+void pcmWavHeader(uint8_t *h, const struct sPcmFormat *fmt) {
+    memcpy(h, "RIFF", 4);
+    put32(h + 4, 0xFFFFFFFF);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    put32(h + 16, 16);
+    put16(h + 20, WAVPCM);
+    put16(h + 22, fmt->f_channels);
+    put32(h + 24, fmt->f_rate);
+    put32(h + 28, fmt->f_rate*fmt->f_channels*2);
+    put16(h + 32, fmt->f_channels*2);
+    put16(h + 34, 16);
+    memcpy(h + 36, "data", 4);
+    put32(h + 40, 0xFFFFFFFF);
+} /* pcmWavHeader */
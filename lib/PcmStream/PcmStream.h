@@ -0,0 +1,83 @@
+/****************************************************
+ * @file PcmStream.h
+ * @brief Live PCM from stdin, a FIFO or a pipe (e.g. arecord -f S16_LE) as uint16_t ADC frames
+ * @note The input is read non-blocking in large reads (whatever the pipe holds, up to the free
+ *    buffer) into a linear buffer of PCMBUFBYTES. A WAV header (RIFF, PCM 8/16/24/32 bit or
+ *    32 bit float, also WAVE_FORMAT_EXTENSIBLE) sets the format, else the raw format given
+ *    by the caller is used.
+ * @note pcmFrame converts the next len samples of one channel into 12 bit values like those of
+ *    the ESP32 ADC: sample (16 bit signed after scaling) times gain, clamped, + 32768, >> 4.
+ *    Each read is time stamped, so a frame knows when its last byte arrived (its latency).
+ * @note Bounded latency: when more than maxBacklog frames wait behind the next one (the
+ *    analysis is slower than the input), the oldest are skipped and counted in s_dropped.
+ * @note Host only (POSIX), not used by the firmware.
+*****************************************************/
+
+#ifndef PCMSTREAM_H
+#define PCMSTREAM_H
+
+#include <stdint.h>
+
+#define PCMBUFBYTES (1 << 20)   // input buffer, 5.4 s of 16 bit stereo at 48 kHz
+#define PCMMARKS (256)          // time stamps of reads kept, power of 2
+#define PCMMAXCHANNELS (8)
+#define PCMMAXHEADER (4096)     // WAV chunks before "data" must fit in here
+
+// sample formats
+#define PCMINT (0)
+#define PCMFLOAT (1)
+
+struct sPcmFormat {
+    uint32_t f_rate;        // [Hz]
+    uint16_t f_channels;
+    uint16_t f_bits;        // 8 (unsigned), 16, 24, 32 (signed) or 32 float
+    uint8_t f_type;         // PCMINT or PCMFLOAT
+};
+
+// time stamp of a read: total bytes after it and CLOCK_MONOTONIC [ns]
+struct sPcmMark {
+    uint64_t m_bytes;
+    uint64_t m_ns;
+};
+
+struct sPcmStream {
+    int s_fd;
+    struct sPcmFormat s_fmt;
+    bool s_header;          // header checked (WAV parsed or raw)
+    bool s_eof;
+    uint8_t *s_buf;         // PCMBUFBYTES
+    uint32_t s_start, s_end;    // unread bytes s_buf[s_start..s_end)
+    uint64_t s_total;       // bytes read since pcmOpen (after the header)
+    uint64_t s_consumed;    // bytes taken by frames or skipped
+    struct sPcmMark s_mark[PCMMARKS];
+    uint32_t s_marks;       // marks written, the last at s_marks-1 & (PCMMARKS-1)
+    float s_gain;
+    uint32_t s_frames;      // frames delivered
+    uint32_t s_dropped;     // frames skipped to bound the latency
+    uint32_t s_reads;       // read calls with data
+};
+
+// CLOCK_MONOTONIC [ns]
+uint64_t pcmNow(void);
+/*
+  @brief Takes fd (set non-blocking), raw format used unless a WAV header is found
+  @return 0, <0 for errors (-1 fcntl, -2 no memory, -3 invalid format)
+*/
+int pcmOpen(struct sPcmStream *, int fd, const struct sPcmFormat *raw, float gain);
+void pcmClose(struct sPcmStream *);
+/*
+  @brief Reads all the input has at present (until EAGAIN), no waiting
+  @return bytes read, 0 for nothing available, <0 for errors. s_eof at the end of input
+*/
+int32_t pcmRead(struct sPcmStream *);
+/*
+  @brief Next frame of len samples of channel into out, arrivalNs when its last byte was read
+  @return 1 for a frame, 0 if not yet complete (or header not yet known), <0 for errors
+*/
+int pcmFrame(struct sPcmStream *, uint16_t *out, uint32_t len, uint16_t channel, uint32_t maxBacklog, uint64_t *arrivalNs);
+/*
+  @brief 44 byte WAV header of PCM 16 bit for fmt, data size unknown (streaming: 0xFFFFFFFF)
+*/
+void pcmWavHeader(uint8_t *header, const struct sPcmFormat *fmt);
+
+#endif
@@ -0,0 +1,182 @@
+/**********************************************************
+ @brief Scoped profiling: stage registry, lock free statistics and report
+ @file Profiling.cpp
+ @author Juergen Boehm
+ @date 2025, May 7
+ @include Profiling.h
+ @note Compiler: GCC under Win32, Linux resp. Espressif
+ @note RAM: PROFMAXSTAGES*(PROFBUCKETS+6)*4 bytes, 3.3 kByte with the defaults
+
+ Copyright (C) <2025>  <Juergen Boehm>
+***********************************************************/
+#if defined _WIN32 || defined __linux__
+#include <chrono>
+#elif defined ESP32
+#include <Arduino.h>
+#endif
+
+#include <stdint.h>
+#include <stdio.h>    // snprintf
+#include <string.h>   // strcmp
+
+#include "Profiling.h"
+
+static struct sProfStage gProfStages[PROFMAXSTAGES];
+static std::atomic<uint32_t> gProfNumStages(0);
+
+
+/*** private functions ***/
+
+// index of the highest set bit, v>0
+static int highBit(uint32_t v) {
+    return 31 - __builtin_clz(v);
+}
+
+// bucket: octave of ticks and the PROFSUBBITS bits below the highest one
+static uint32_t bucketOf(uint32_t ticks) {
+    int b;
+
+    if(ticks < PROFSUBBUCKETS) return ticks;
+    b = highBit(ticks);
+    return (uint32_t)(b - PROFSUBBITS + 1)*PROFSUBBUCKETS + ((ticks >> (b - PROFSUBBITS)) & (PROFSUBBUCKETS - 1));
+}
+
+// lowest tick value of bucket
+static uint32_t bucketLow(uint32_t bucket) {
+    uint32_t octave = bucket/PROFSUBBUCKETS;
+
+    if(octave == 0) return bucket;
+    return (uint32_t)(PROFSUBBUCKETS + bucket%PROFSUBBUCKETS) << (octave - 1);
+}
+
+static void atomicMin(std::atomic<uint32_t> &a, uint32_t v) {
+    uint32_t old = a.load(std::memory_order_relaxed);
+    while(v < old && !a.compare_exchange_weak(old, v, std::memory_order_relaxed))  ;
+}
+
+static void atomicMax(std::atomic<uint32_t> &a, uint32_t v) {
+    uint32_t old = a.load(std::memory_order_relaxed);
+    while(v > old && !a.compare_exchange_weak(old, v, std::memory_order_relaxed))  ;
+}
+
+// percentile (per mille) from histogram: middle of the bucket, clipped to min and max
+static uint32_t percentile(struct sProfStage *st, uint32_t count, uint32_t perMille) {
+    uint32_t limit = (uint32_t)(((uint64_t)count*perMille + 999)/1000), sum = 0, b, v;
+
+    for(b = 0; b < PROFBUCKETS; b++) {
+        sum += st->p_hist[b].load(std::memory_order_relaxed);
+        if(sum >= limit) break;
+    }
+    if(b >= PROFBUCKETS) return st->p_max.load(std::memory_order_relaxed);
+    v = (b + 1 < PROFBUCKETS) ? bucketLow(b) + (bucketLow(b + 1) - bucketLow(b))/2 : bucketLow(b);
+    if(v < st->p_min.load(std::memory_order_relaxed)) v = st->p_min.load(std::memory_order_relaxed);
+    if(v > st->p_max.load(std::memory_order_relaxed)) v = st->p_max.load(std::memory_order_relaxed);
+    return v;
+}
+
+static void clearStage(struct sProfStage *st) {
+    st->p_count.store(0, std::memory_order_relaxed);
+    st->p_min.store(UINT32_MAX, std::memory_order_relaxed);
+    st->p_max.store(0, std::memory_order_relaxed);
+    st->p_sumLo.store(0, std::memory_order_relaxed);
+    st->p_sumHi.store(0, std::memory_order_relaxed);
+    for(uint32_t b = 0; b < PROFBUCKETS; b++)  st->p_hist[b].store(0, std::memory_order_relaxed);
+}
+
+
+/*** public functions ***/
+
+uint32_t profTicks(void) {
+#if defined ESP32 && !defined __linux__
+    return esp_cpu_get_ccount();
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+} /* profTicks */
+
+uint32_t profTicksPerUs(void) {
+#if defined ESP32 && !defined __linux__
+    return getCpuFrequencyMhz();
+#else
+    return 1000;
+#endif
+} /* profTicksPerUs */
+
+/************************************************************************
+ * @brief Registers a stage. Called once per PROF_SCOPE (function static),
+ *   so the linear search over PROFMAXSTAGES does not matter.
+ * @note Two tasks registering the same new name at once may get two stages
+ * @return stage or NULL, when the table is full
+*************************************************************************/
+struct sProfStage *profStage(const char *name) {
+    uint32_t n = gProfNumStages.load(std::memory_order_acquire), i;
+
+    for(i = 0; i < n; i++)
+        if(gProfStages[i].p_name && !strcmp(gProfStages[i].p_name, name))  return &gProfStages[i];
+    i = gProfNumStages.fetch_add(1, std::memory_order_acq_rel);
+    if(i >= PROFMAXSTAGES) {
+        gProfNumStages.store(PROFMAXSTAGES, std::memory_order_release);
+        return NULL;
+    }
+    gProfStages[i].p_name = name;
+    clearStage(&gProfStages[i]);
+    return &gProfStages[i];
+} /* profStage */
+
+/************************************************************************
+ * @brief One measurement: a few relaxed atomic adds and two compare loops
+ *   that rarely iterate. Safe from both cores, no interrupts disabled.
+*************************************************************************/
+void profRecord(struct sProfStage *st, uint32_t ticks) {
+    uint32_t old;
+
+    st->p_count.fetch_add(1, std::memory_order_relaxed);
+    old = st->p_sumLo.fetch_add(ticks, std::memory_order_relaxed);
+    if(old + ticks < old)  st->p_sumHi.fetch_add(1, std::memory_order_relaxed);   // carry
+    atomicMin(st->p_min, ticks);
+    atomicMax(st->p_max, ticks);
+    st->p_hist[bucketOf(ticks)].fetch_add(1, std::memory_order_relaxed);
+} /* profRecord */
+
+void profReset(void) {
+    uint32_t n = gProfNumStages.load(std::memory_order_acquire);
+
+    for(uint32_t i = 0; i < n && i < PROFMAXSTAGES; i++)  clearStage(&gProfStages[i]);
+} /* profReset */
+
+/************************************************************************
+ * @brief Report of all stages, one line per stage plus a header
+ * @note Values read while other tasks record may be off by one measurement
+ * @return number of stages
+*************************************************************************/
+int profReport(void (*out)(const char *line)) {
+    char line[PROFLINELEN];
+    uint32_t n = gProfNumStages.load(std::memory_order_acquire), i, count;
+    float perUs = (float)profTicksPerUs(), mean;
+    uint64_t sum;
+    struct sProfStage *st;
+
+    if(n > PROFMAXSTAGES) n = PROFMAXSTAGES;
+    snprintf(line, sizeof(line), "%-20s %8s %9s %9s %9s %9s %9s [us]",
+        "stage", "count", "min", "mean", "p50", "p99", "max");
+    out(line);
+    for(i = 0; i < n; i++) {
+        st = &gProfStages[i];
+        count = st->p_count.load(std::memory_order_relaxed);
+        if(!count) {
+            snprintf(line, sizeof(line), "%-20s %8u", st->p_name, 0u);
+            out(line);
+            continue;
+        }
+        sum = ((uint64_t)st->p_sumHi.load(std::memory_order_relaxed) << 32) | st->p_sumLo.load(std::memory_order_relaxed);
+        mean = (float)sum/(float)count;
+        snprintf(line, sizeof(line), "%-20s %8u %9.1f %9.1f %9.1f %9.1f %9.1f",
+            st->p_name, count,
+            st->p_min.load(std::memory_order_relaxed)/perUs, mean/perUs,
+            percentile(st, count, 500)/perUs, percentile(st, count, 990)/perUs,
+            st->p_max.load(std::memory_order_relaxed)/perUs);
+        out(line);
+    }
+    return (int)n;
+} /* profReport */
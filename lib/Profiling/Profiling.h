@@ -0,0 +1,71 @@
+/****************************************************
+ * @file Profiling.h
+ * @brief Scoped timers of hot path stages with per stage statistics and histogram
+ * @note Usage: { PROF_SCOPE("calcFreqAnalog");  calcFreqAnalog(&gsAD); }
+ *    measures from PROF_SCOPE to the end of the enclosing block.
+ *    Without PROFILING defined (before including this file) PROF_SCOPE is empty,
+ *    so the instrumentation costs nothing in normal builds.
+ * @note Ticks are CPU cycles (esp_cpu_get_ccount) on ESP32, ns (steady_clock) on host.
+ *    Each stage accumulates count, min, max, sum and a histogram of PROFSUBBUCKETS
+ *    buckets per octave with relaxed atomics, no locks, no floats in the hot path.
+ *    p50 and p99 come from the histogram (resolution one bucket, 41% with 2 per octave).
+*****************************************************/
+
+#ifndef PROFILING_H
+#define PROFILING_H
+
+#include <stdint.h>
+#include <atomic>
+
+#define PROFMAXSTAGES (12)      // stages registered by PROF_SCOPE
+#define PROFSUBBITS (1)         // 2^PROFSUBBITS buckets per octave
+#define PROFSUBBUCKETS (1 << PROFSUBBITS)
+#define PROFBUCKETS (32*PROFSUBBUCKETS)   // covers all uint32_t tick values
+#define PROFLINELEN (96)        // length of one report line
+
+struct sProfStage {
+    const char *p_name;
+    std::atomic<uint32_t> p_count;
+    std::atomic<uint32_t> p_min;
+    std::atomic<uint32_t> p_max;
+    std::atomic<uint32_t> p_sumLo, p_sumHi;     // 64 bit sum of ticks, carry by the adder
+    std::atomic<uint32_t> p_hist[PROFBUCKETS];
+};
+
+// current tick counter
+uint32_t profTicks(void);
+// ticks per microsecond (CPU MHz on ESP32, 1000 on host)
+uint32_t profTicksPerUs(void);
+// stage with this name (registered on first call), NULL when all PROFMAXSTAGES are used
+struct sProfStage *profStage(const char *name);
+// adds one measurement of ticks to stage
+void profRecord(struct sProfStage *, uint32_t ticks);
+// clears all statistics, stages stay registered
+void profReset(void);
+/*
+  @brief Report of all stages in us: count, min, mean, p50, p99, max.
+  Calls out once per line (without newline), e.g. with a function printing to Serial or stdout
+  @return number of stages
+*/
+int profReport(void (*out)(const char *line));
+
+// RAII timer: measures from construction to end of the scope
+struct sProfScope {
+    struct sProfStage *s_stage;
+    uint32_t s_start;
+    explicit sProfScope(struct sProfStage *stage) : s_stage(stage), s_start(profTicks()) {}
+    ~sProfScope() { if(s_stage) profRecord(s_stage, profTicks() - s_start); }   // unsigned difference is fine with wrap around
+};
+
+#define PROFCAT2(a, b) a##b
+#define PROFCAT(a, b) PROFCAT2(a, b)
+#ifdef PROFILING
+// stage is looked up once (function static), then only two tick reads and profRecord per pass
+#define PROF_SCOPE(name) \
+    static struct sProfStage *const PROFCAT(profStage_, __LINE__) = profStage(name); \
+    sProfScope PROFCAT(profScope_, __LINE__)(PROFCAT(profStage_, __LINE__))
+#else
+#define PROF_SCOPE(name)
+#endif
+
+#endif
@@ -0,0 +1,174 @@
+/**********************************************************
+ @brief Latest result and a history ring in POSIX shared memory, seqlock protected
+ @file ResultShm.cpp
+ @author Juergen Boehm
+ @date 2025, May 16
+ @include ResultShm.h
+ @note Compiler: GCC under Linux (POSIX shm_open, mmap; older glibc link with -lrt)
+ @note RAM: sizeof(struct sShmSegment) of shared memory, 14 kByte with the defaults
+
+ Copyright (C) <2025>  <Juergen Boehm>
+***********************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <atomic>
+
+#include "ResultShm.h"
+
+static_assert(SHMRESULTBYTES % sizeof(uint32_t) == 0, "sShmResult must be whole words");
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+    "atomics in shared memory must be lock free");
+
+
+/*** private functions ***/
+
+// writer side of the seqlock: odd, words, even
+static void slotWrite(struct sShmSlot *l, const struct sShmResult *r) {
+    uint32_t w[SHMRESULTWORDS], seq = l->l_seq.load(std::memory_order_relaxed);
+
+    memcpy(w, r, SHMRESULTBYTES);
+    l->l_seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);    // odd sequence before the words
+    for(uint32_t i = 0; i < SHMRESULTWORDS; i++)  l->l_word[i].store(w[i], std::memory_order_relaxed);
+    l->l_seq.store(seq + 2, std::memory_order_release);
+} /* slotWrite */
+
+/************************************************************************
+ * @brief Reader side of the seqlock: copy between two equal even sequences
+ * @return sequence of the copy, 1 (odd) if the writer stayed busy for SHMMAXRETRIES
+*************************************************************************/
+static uint32_t slotRead(const struct sShmSlot *l, struct sShmResult *r, uint32_t *retries) {
+    uint32_t w[SHMRESULTWORDS], s0, s1;
+
+    for(uint32_t n = 0; n < SHMMAXRETRIES; n++) {
+        s0 = l->l_seq.load(std::memory_order_acquire);
+        if(!(s0 & 1)) {
+            for(uint32_t i = 0; i < SHMRESULTWORDS; i++)  w[i] = l->l_word[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);    // words before the 2nd sequence
+            s1 = l->l_seq.load(std::memory_order_relaxed);
+            if(s0 == s1) {
+                memcpy(r, w, SHMRESULTBYTES);
+                return s0;
+            }
+        }
+        (*retries)++;
+#if defined __x86_64__ || defined __i386__
+        __builtin_ia32_pause();
+#endif
+    }
+    return 1;
+} /* slotRead */
+
+
+/*** public functions ***/
+
+int shmPublisherOpen(struct sShmPublisher *p, const char *name) {
+    struct sShmSegment *h;
+
+    memset(p, 0, sizeof(*p));
+    snprintf(p->p_name, sizeof(p->p_name), "%s", name);
+    p->p_fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if(p->p_fd < 0)  return -1;
+    if(ftruncate(p->p_fd, sizeof(struct sShmSegment)) < 0) {
+        close(p->p_fd);
+        p->p_fd = -1;
+        return -2;
+    }
+    h = (struct sShmSegment *)mmap(NULL, sizeof(struct sShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, p->p_fd, 0);
+    if(h == MAP_FAILED) {
+        close(p->p_fd);
+        p->p_fd = -1;
+        return -3;
+    }
+    // a new writer starts afresh: readers see an invalid segment until the magic is back
+    h->h_magic.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    h->h_version = SHMVERSION;
+    h->h_bytes = sizeof(struct sShmSegment);
+    h->h_history = SHMHISTORY;
+    h->h_pid = (uint32_t)getpid();
+    h->h_count.store(0, std::memory_order_relaxed);
+    h->h_latest.l_seq.store(0, std::memory_order_relaxed);
+    for(uint32_t i = 0; i < SHMHISTORY; i++)  h->h_ring[i].l_seq.store(0, std::memory_order_relaxed);
+    h->h_magic.store(SHMMAGIC, std::memory_order_release);
+    p->p_seg = h;
+    return 0;
+} /* shmPublisherOpen */
+
+/************************************************************************
+ * @brief Latest slot first (what most readers poll), then the ring and its count
+*************************************************************************/
+void shmPublish(struct sShmPublisher *p, struct sShmResult *r) {
+    struct sShmSegment *h = p->p_seg;
+
+    r->r_seq = p->p_count;
+    slotWrite(&h->h_latest, r);
+    slotWrite(&h->h_ring[p->p_count & (SHMHISTORY - 1)], r);
+    h->h_count.store(++p->p_count, std::memory_order_release);
+} /* shmPublish */
+
+void shmPublisherClose(struct sShmPublisher *p, bool unlink) {
+    if(p->p_seg)  munmap(p->p_seg, sizeof(struct sShmSegment));
+    if(p->p_fd >= 0)  close(p->p_fd);
+    if(unlink)  shm_unlink(p->p_name);
+    p->p_seg = NULL;
+    p->p_fd = -1;
+} /* shmPublisherClose */
+
+int shmReaderOpen(struct sShmReader *q, const char *name) {
+    const struct sShmSegment *h;
+
+    memset(q, 0, sizeof(*q));
+    q->q_fd = shm_open(name, O_RDONLY, 0);
+    if(q->q_fd < 0)  return -1;
+    h = (const struct sShmSegment *)mmap(NULL, sizeof(struct sShmSegment), PROT_READ, MAP_SHARED, q->q_fd, 0);
+    if(h == MAP_FAILED) {
+        close(q->q_fd);
+        q->q_fd = -1;
+        return -3;
+    }
+    q->q_seg = h;
+    if(h->h_magic.load(std::memory_order_acquire) != SHMMAGIC || h->h_version != SHMVERSION
+        || h->h_bytes != sizeof(struct sShmSegment) || h->h_history != SHMHISTORY) {
+        shmReaderClose(q);
+        return -4;
+    }
+    return 0;
+} /* shmReaderOpen */
+
+void shmReaderClose(struct sShmReader *q) {
+    if(q->q_seg)  munmap((void *)q->q_seg, sizeof(struct sShmSegment));
+    if(q->q_fd >= 0)  close(q->q_fd);
+    q->q_seg = NULL;
+    q->q_fd = -1;
+} /* shmReaderClose */
+
+int shmLatest(struct sShmReader *q, struct sShmResult *out) {
+    uint32_t seq = slotRead(&q->q_seg->h_latest, out, &q->q_retries);
+
+    if(seq & 1)  return -1;
+    if(!seq)  return -2;
+    if(seq == q->q_lastSeq)  return 0;
+    q->q_lastSeq = seq;
+    return 1;
+} /* shmLatest */
+
+/************************************************************************
+ * @brief Reads the ring from h_count - max on; a slot with another r_seq was overwritten
+ *   meanwhile (the writer is a whole ring ahead) or is not yet written, it is skipped
+*************************************************************************/
+int shmHistory(struct sShmReader *q, struct sShmResult *out, uint32_t max) {
+    uint64_t count = q->q_seg->h_count.load(std::memory_order_acquire), k;
+    uint32_t n = 0, seq;
+
+    if(max > SHMHISTORY)  max = SHMHISTORY;
+    for(k = (count > max) ? count - max : 0; k < count; k++) {
+        seq = slotRead(&q->q_seg->h_ring[k & (SHMHISTORY - 1)], &out[n], &q->q_retries);
+        if(!(seq & 1) && seq && out[n].r_seq == k)  n++;
+    }
+    return n;
+} /* shmHistory */
@@ -0,0 +1,112 @@
+/****************************************************
+ * @file ResultShm.h
+ * @brief Latest result and a history ring in POSIX shared memory for readers in other processes
+ * @note One writer (e.g. pcm_tuner -m /freqtuner) publishes each result with shmPublish, any
+ *    number of readers map the segment read only (shmReaderOpen) and poll it without syscalls.
+ * @note Seqlocks: the writer makes the sequence of a slot odd, writes the words of the result
+ *    and makes it even again; a reader copies the words between two equal even sequences, else
+ *    it retries. So the writer never waits for readers, a slow reader costs it nothing, and readers
+ *    do not write to the segment (no cache line bouncing between them). All words are relaxed
+ *    atomics with fences, no data race in the C++ sense.
+ * @note shmChanged is a single load: whether there is a result newer than the last one read.
+ *    shmLatest then copies SHMRESULTBYTES. The ring holds the last SHMHISTORY results, each
+ *    with its own seqlock; results overwritten while reading are skipped (shmHistory).
+ * @note Host only (POSIX shm_open, mmap), not used by the firmware.
+*****************************************************/
+
+#ifndef RESULTSHM_H
+#define RESULTSHM_H
+
+#include <stdint.h>
+#include <atomic>
+
+#define SHMMAGIC (0x46545253)   // "SRTF"
+#define SHMVERSION (1)
+#define SHMHISTORY (256)        // results in the ring, power of 2
+#define SHMMAXRETRIES (1000)    // of a reader on a slot being written, then -1
+
+// r_flags, as in the pitch track of pcm_tuner
+#define SHMVALID (0x01)
+#define SHMGREEN (0x02)
+#define SHMLATE (0x04)
+
+struct sShmResult {
+    uint64_t r_seq;         // number of the result, from 0
+    uint64_t r_timeNs;      // CLOCK_MONOTONIC when published [ns]
+    float r_freq;           // [Hz], 0 without a note
+    float r_cent;           // to r_note
+    float r_quality;        // d_quality [s]
+    float r_latencyMs;      // from the arrival of the last sample of the frame
+    uint16_t r_numPeriodes;
+    uint16_t r_usedLen;
+    uint8_t r_flags;        // SHMVALID, SHMGREEN, SHMLATE
+    char r_note[7];
+};
+
+#define SHMRESULTBYTES (sizeof(struct sShmResult))
+#define SHMRESULTWORDS (SHMRESULTBYTES/sizeof(uint32_t))
+
+// a result under its seqlock
+struct sShmSlot {
+    std::atomic<uint32_t> l_seq;        // odd while written
+    std::atomic<uint32_t> l_word[SHMRESULTWORDS];
+};
+
+// the shared memory segment; readers and writer on their own cache lines
+struct sShmSegment {
+    std::atomic<uint32_t> h_magic;      // SHMMAGIC when initialised
+    uint32_t h_version;
+    uint32_t h_bytes;                   // sizeof(struct sShmSegment)
+    uint32_t h_history;                 // SHMHISTORY
+    uint32_t h_pid;                     // of the writer
+    alignas(64) struct sShmSlot h_latest;
+    alignas(64) std::atomic<uint64_t> h_count;     // results published, the next goes to h_ring[h_count % SHMHISTORY]
+    alignas(64) struct sShmSlot h_ring[SHMHISTORY];
+};
+
+struct sShmPublisher {
+    int p_fd;
+    struct sShmSegment *p_seg;
+    char p_name[64];
+    uint64_t p_count;
+};
+
+struct sShmReader {
+    int q_fd;
+    const struct sShmSegment *q_seg;
+    uint32_t q_lastSeq;     // sequence of h_latest at the last shmLatest
+    uint32_t q_retries;     // seqlock retries so far
+};
+
+/*
+  @brief Creates (or takes over) the segment name, e.g. "/freqtuner"
+  @return 0, <0 for errors (-1 shm_open, -2 ftruncate, -3 mmap)
+*/
+int shmPublisherOpen(struct sShmPublisher *, const char *name);
+// publishes r as the latest result and into the ring, r_seq is set here. Never blocks
+void shmPublish(struct sShmPublisher *, struct sShmResult *r);
+// unmaps, with unlink the segment is removed (readers keep their mapping)
+void shmPublisherClose(struct sShmPublisher *, bool unlink);
+
+/*
+  @brief Maps the segment name read only
+  @return 0, <0 for errors (-1 shm_open, -3 mmap, -4 not (yet) a valid segment of this version)
+*/
+int shmReaderOpen(struct sShmReader *, const char *name);
+void shmReaderClose(struct sShmReader *);
+// true if a result newer than the last shmLatest was published (one load, nothing copied)
+static inline bool shmChanged(const struct sShmReader *q) {
+    return q->q_seg->h_latest.l_seq.load(std::memory_order_acquire) != q->q_lastSeq;
+}
+/*
+  @brief Copy of the latest result
+  @return 1 new result, 0 the same as last time, -1 writer busy on it for SHMMAXRETRIES, -2 none yet
+*/
+int shmLatest(struct sShmReader *, struct sShmResult *out);
+/*
+  @brief The last results, oldest first
+  @return number of results in out (at most max and SHMHISTORY)
+*/
+int shmHistory(struct sShmReader *, struct sShmResult *out, uint32_t max);
+
+#endif
@@ -0,0 +1,313 @@
+/**********************************************************
+ @brief Binary telemetry: COBS framing, CRC and records, ESP32 serial transport
+ @file Telemetry.cpp
+ @author Juergen Boehm
+ @date 2025, May 6
+ @include Telemetry.h
+ @note Compiler: GCC under Win32, Linux resp. Espressif. The framing and
+        record functions are used by the host decoder as well.
+ @note ESP32: TLMQUEUE bytes queue plus TLMMAXFRAME bytes frame buffer (DRAM).
+
+ Copyright (C) <2025>  <Juergen Boehm>
+***********************************************************/
+#if defined _WIN32 || defined __linux__
+#include <stdio.h>
+#include <stdlib.h>
+#elif defined ESP32
+#include <Arduino.h>
+#endif
+
+#include <stdint.h>
+#include <string.h>   // memcpy
+
+#include "Telemetry.h"
+
+
+/*** private functions ***/
+
+static void put16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+    put16(p, (uint16_t)v);
+    put16(p+2, (uint16_t)(v >> 16));
+}
+
+static void putFloat(uint8_t *p, float f) {
+    uint32_t v;
+    memcpy(&v, &f, sizeof(v));
+    put32(p, v);
+}
+
+static uint16_t get16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t *p) {
+    return (uint32_t)get16(p) | ((uint32_t)get16(p+2) << 16);
+}
+
+static float getFloat(const uint8_t *p) {
+    uint32_t v = get32(p);
+    float f;
+    memcpy(&f, &v, sizeof(f));
+    return f;
+}
+
+
+/*** public functions ***/
+
+/************************************************************************
+ * @brief CRC-16/CCITT-FALSE, bitwise (a frame is short, no table in flash)
+*************************************************************************/
+uint16_t tlmCrc16(const uint8_t *data, uint32_t len) {
+    uint16_t crc = 0xFFFF;
+    int b;
+
+    while(len--) {
+        crc ^= (uint16_t)(*data++) << 8;
+        for(b = 0; b < 8; b++)
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return crc;
+} /* tlmCrc16 */
+
+/************************************************************************
+ * @brief Consistent overhead byte stuffing: no 0x00 in the output
+ * @param[in] in: len bytes
+ * @param[out] out: len + len/254 + 1 bytes
+ * @return encoded length without delimiter
+*************************************************************************/
+uint32_t tlmCobsEncode(const uint8_t *in, uint32_t len, uint8_t *out) {
+    uint32_t code = 0, o = 1, i;      // out[code] takes the distance to the next zero
+    uint8_t dist = 1;
+
+    for(i = 0; i < len; i++) {
+        if(in[i]) {
+            out[o++] = in[i];
+            dist++;
+        }
+        if(!in[i] || dist == 0xFF) {
+            out[code] = dist;
+            code = o++;
+            dist = 1;
+        }
+    }
+    out[code] = dist;
+    return o;
+} /* tlmCobsEncode */
+
+/************************************************************************
+ * @brief Reverses tlmCobsEncode
+ * @param[in] in: len bytes without delimiter
+ * @param[out] out: outSize bytes (len bytes are always enough)
+ * @return decoded length, <0 for a 0x00, a code beyond len or more than outSize bytes
+*************************************************************************/
+int32_t tlmCobsDecode(const uint8_t *in, uint32_t len, uint8_t *out, uint32_t outSize) {
+    uint32_t i = 0, o = 0, n;
+    uint8_t code;
+
+    while(i < len) {
+        code = in[i++];
+        if(!code || i + code - 1 > len) return -1;
+        for(n = 1; n < code; n++) {
+            if(!in[i] || o >= outSize) return -1;
+            out[o++] = in[i++];
+        }
+        if(code < 0xFF && i < len) {
+            if(o >= outSize) return -1;
+            out[o++] = 0;
+        }
+    }
+    return (int32_t)o;
+} /* tlmCobsDecode */
+
+/************************************************************************
+ * @brief Frame of a payload: CRC appended in place, COBS encoded, 0x00 before and after.
+ *   The leading 0x00 ends text (ESP_LOG) written since the last frame,
+ *   so the text is lost, not the frame.
+ * @param[in,out] payload: len bytes, room for 2 more
+ * @return frame length or <0 if outSize is too small
+*************************************************************************/
+int32_t tlmFrame(uint8_t *payload, uint32_t len, uint8_t *out, uint32_t outSize) {
+    uint32_t n;
+
+    if(len > TLMMAXPAYLOAD) return -1;
+    if(outSize < len + 2 + (len + 2)/254 + 3) return -2;
+    put16(payload + len, tlmCrc16(payload, len));
+    out[0] = 0;
+    n = 1 + tlmCobsEncode(payload, len + 2, out + 1);
+    out[n++] = 0;
+    return (int32_t)n;
+} /* tlmFrame */
+
+/************************************************************************
+ * @brief Payload from a frame (without its delimiter), CRC checked
+ * @param[out] payload: TLMMAXPAYLOAD+2 bytes
+ * @return payload length, <0 for COBS or CRC errors
+*************************************************************************/
+int32_t tlmUnframe(const uint8_t *frame, uint32_t len, uint8_t *payload) {
+    int32_t n;
+
+    if(len > TLMMAXFRAME) return -3;
+    n = tlmCobsDecode(frame, len, payload, TLMMAXPAYLOAD + 2);
+    if(n < 3) return -1;
+    n -= 2;
+    if(tlmCrc16(payload, n) != get16(payload + n)) return -2;
+    return n;
+} /* tlmUnframe */
+
+/************************************************************************
+ * @brief Result record into payload (TLMRESULTLEN bytes)
+*************************************************************************/
+uint32_t tlmPutResult(const struct sTlmResult *r, uint8_t *p) {
+    p[0] = TLM_RESULT;
+    put16(p+1, r->t_seq);
+    put32(p+3, r->t_time);
+    putFloat(p+7, r->t_freq);
+    putFloat(p+11, r->t_periode);
+    putFloat(p+15, r->t_quality);
+    putFloat(p+19, r->t_cent);
+    put16(p+23, r->t_numPeriodes);
+    put16(p+25, r->t_usedLen);
+    p[27] = r->t_flags;
+    memcpy(p+28, r->t_note, 4);
+    return TLMRESULTLEN;
+} /* tlmPutResult */
+
+/************************************************************************
+ * @brief Result record from payload
+ * @return <0 for other records
+*************************************************************************/
+int tlmGetResult(const uint8_t *p, uint32_t len, struct sTlmResult *r) {
+    if(len != TLMRESULTLEN || p[0] != TLM_RESULT) return -1;
+    r->t_seq = get16(p+1);
+    r->t_time = get32(p+3);
+    r->t_freq = getFloat(p+7);
+    r->t_periode = getFloat(p+11);
+    r->t_quality = getFloat(p+15);
+    r->t_cent = getFloat(p+19);
+    r->t_numPeriodes = get16(p+23);
+    r->t_usedLen = get16(p+25);
+    r->t_flags = p[27];
+    memcpy(r->t_note, p+28, 4);
+    r->t_note[4] = '\0';
+    return 0;
+} /* tlmGetResult */
+
+/************************************************************************
+ * @brief Raw record into payload (TLMRAWHEADLEN + 2*len bytes)
+*************************************************************************/
+uint32_t tlmPutRaw(uint16_t seq, uint32_t time, uint32_t sFreq, const uint16_t *data, uint16_t len, uint8_t *p) {
+    uint32_t i;
+
+    if(len > TLMMAXRAW) len = TLMMAXRAW;
+    p[0] = TLM_RAW;
+    put16(p+1, seq);
+    put32(p+3, time);
+    put32(p+7, sFreq);
+    put16(p+11, len);
+    for(i = 0; i < len; i++) put16(p + TLMRAWHEADLEN + 2*i, data[i]);
+    return TLMRAWHEADLEN + 2*len;
+} /* tlmPutRaw */
+
+/************************************************************************
+ * @brief Raw record from payload
+ * @return number of samples in data, <0 for other records
+*************************************************************************/
+int tlmGetRaw(const uint8_t *p, uint32_t len, uint16_t *seq, uint32_t *time, uint32_t *sFreq, uint16_t *data) {
+    uint16_t n, i;
+
+    if(len < TLMRAWHEADLEN || p[0] != TLM_RAW) return -1;
+    n = get16(p+11);
+    if(n > TLMMAXRAW || len != TLMRAWHEADLEN + 2u*n) return -2;
+    *seq = get16(p+1);
+    *time = get32(p+3);
+    *sFreq = get32(p+7);
+    for(i = 0; i < n; i++) data[i] = get16(p + TLMRAWHEADLEN + 2*i);
+    return n;
+} /* tlmGetRaw */
+
+
+#if defined ESP32
+/*** ESP32 transport ***/
+
+#if TLMQUEUE & (TLMQUEUE - 1)
+#error "TLMQUEUE must be a power of 2"
+#endif
+
+static uint8_t gTlmQueue[TLMQUEUE];         // ring buffer of encoded frames
+static uint32_t gTlmHead = 0, gTlmTail = 0; // write and read position
+static uint8_t gTlmPayload[TLMMAXPAYLOAD + 2];
+static uint8_t gTlmFrame[TLMMAXFRAME];
+static uint32_t gTlmDropped = 0;
+
+// queues a whole frame or nothing
+static int tlmQueue(const uint8_t *frame, uint32_t len) {
+    uint32_t used = gTlmHead - gTlmTail, n;
+
+    if(len > TLMQUEUE - used) {
+        gTlmDropped++;
+        return -1;
+    }
+    while(len) {
+        n = TLMQUEUE - gTlmHead%TLMQUEUE;
+        if(n > len) n = len;
+        memcpy(gTlmQueue + gTlmHead%TLMQUEUE, frame, n);
+        gTlmHead += n;
+        frame += n;
+        len -= n;
+    }
+    return 0;
+}
+
+void tlmBegin(void) {
+    Serial.setTxBufferSize(TLMTXBUFFER);    // before begin!
+    Serial.begin(TLMBAUD);
+} /* tlmBegin */
+
+int tlmSendResult(const struct sTlmResult *r) {
+    int32_t n;
+
+    n = tlmFrame(gTlmPayload, tlmPutResult(r, gTlmPayload), gTlmFrame, sizeof(gTlmFrame));
+    if(n < 0) return n;
+    return tlmQueue(gTlmFrame, n);
+} /* tlmSendResult */
+
+int tlmSendRaw(uint16_t seq, uint32_t sFreq, const uint16_t *data, uint16_t len) {
+    int32_t n;
+
+    n = tlmFrame(gTlmPayload, tlmPutRaw(seq, micros(), sFreq, data, len, gTlmPayload), gTlmFrame, sizeof(gTlmFrame));
+    if(n < 0) return n;
+    return tlmQueue(gTlmFrame, n);
+} /* tlmSendRaw */
+
+void tlmPoll(void) {
+    uint32_t n, room;
+
+    room = Serial.availableForWrite();
+    while(room && gTlmHead != gTlmTail) {
+        n = TLMQUEUE - gTlmTail%TLMQUEUE;   // up to end of ring
+        if(n > gTlmHead - gTlmTail) n = gTlmHead - gTlmTail;
+        if(n > room) n = room;
+        n = Serial.write(gTlmQueue + gTlmTail%TLMQUEUE, n);
+        if(!n) break;
+        gTlmTail += n;
+        room -= n;
+    }
+} /* tlmPoll */
+
+bool tlmRawRequested(void) {
+    bool bRequest = false;
+
+    while(Serial.available() > 0)
+        if(Serial.read() == TLM_CMDRAW) bRequest = true;
+    return bRequest;
+} /* tlmRawRequested */
+
+uint32_t tlmDropped(void) {
+    return gTlmDropped;
+} /* tlmDropped */
+#endif
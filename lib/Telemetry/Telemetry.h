@@ -0,0 +1,88 @@
+/****************************************************
+ * @file Telemetry.h
+ * @brief Binary telemetry of results and raw ADC frames over serial
+ * @note Frame: 0x00, COBS encoded (payload, CRC-16/CCITT little endian), 0x00.
+ *    Text output (ESP_LOG) between frames is skipped by the decoder, as its CRC fails.
+ *    Payload starts with the record type, all numbers little endian:
+ *    'F' result:  seq u16, time u32 [us], freq f32 [Hz], periode f32 [s], quality f32 [s],
+ *                 cent f32, numPeriodes u16, usedLen u16, flags u8, note char[4]
+ *    'R' raw:     seq u16, time u32 [us], sFreq u32 [Hz], len u16, len*u16 samples
+ * @note On ESP32 frames are queued and written by tlmPoll only as far as the
+ *    UART driver's TX buffer has room (availableForWrite), so the loop never blocks.
+ *    Frames not fitting into the queue are dropped and counted.
+*****************************************************/
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+
+// record types
+#define TLM_RESULT ('F')
+#define TLM_RAW ('R')
+// command byte from host requesting the next raw frame
+#define TLM_CMDRAW ('R')
+
+// flags of result records
+#define TLMVALID (0x01)     // note and cent valid
+#define TLMGREEN (0x02)     // quality good (green bar)
+
+#define TLMRESULTLEN (32)   // payload bytes of a result record
+#define TLMRAWHEADLEN (13)  // payload bytes of a raw record before the samples
+#define TLMMAXRAW (2000)    // max. samples in a raw record
+// max. payload and frame length (COBS adds one byte per 254, plus CRC and delimiters)
+#define TLMMAXPAYLOAD (TLMRAWHEADLEN + 2*TLMMAXRAW)
+#define TLMMAXFRAME (TLMMAXPAYLOAD + 2 + (TLMMAXPAYLOAD + 2)/254 + 3)
+
+// ESP32 transport
+#define TLMBAUD (921600)        // serial speed with telemetry, also for ESP_LOG output!
+#define TLMTXBUFFER (4096)      // TX buffer of UART driver
+#define TLMQUEUE (8192)         // queue of encoded frames, holds one raw frame. Power of 2
+
+struct sTlmResult {
+    uint16_t t_seq;         // frame counter
+    uint32_t t_time;        // time stamp [us]
+    float t_freq;           // frequency after tuning [Hz], 0 for invalid frames
+    float t_periode;        // mean periode [s]
+    float t_quality;        // stdev of periode [s]
+    float t_cent;           // difference to t_note in cent
+    uint16_t t_numPeriodes;
+    uint16_t t_usedLen;     // samples used by the analysis
+    uint8_t t_flags;        // TLMVALID, TLMGREEN
+    char t_note[5];         // note name, e.g. "fis3"
+};
+
+// CRC-16/CCITT (poly 0x1021, init 0xFFFF)
+uint16_t tlmCrc16(const uint8_t *data, uint32_t len);
+// COBS, returns encoded length (no delimiter), out needs len + len/254 + 1 bytes
+uint32_t tlmCobsEncode(const uint8_t *in, uint32_t len, uint8_t *out);
+// returns decoded length or <0 for errors, also if out (outSize bytes) is too small
+int32_t tlmCobsDecode(const uint8_t *in, uint32_t len, uint8_t *out, uint32_t outSize);
+
+// payload (room for 2 more bytes) with CRC, COBS encoded between two 0x00 into out. Returns frame length or <0
+int32_t tlmFrame(uint8_t *payload, uint32_t len, uint8_t *out, uint32_t outSize);
+// frame without delimiters to payload (TLMMAXPAYLOAD+2 bytes). Returns payload length or <0 (CRC)
+int32_t tlmUnframe(const uint8_t *frame, uint32_t len, uint8_t *payload);
+
+// records to/from payload. Put returns payload length, get returns <0 for wrong records
+uint32_t tlmPutResult(const struct sTlmResult *, uint8_t *payload);
+int tlmGetResult(const uint8_t *payload, uint32_t len, struct sTlmResult *);
+uint32_t tlmPutRaw(uint16_t seq, uint32_t time, uint32_t sFreq, const uint16_t *data, uint16_t len, uint8_t *payload);
+// samples are copied to data (TLMMAXRAW), returns number of samples or <0
+int tlmGetRaw(const uint8_t *payload, uint32_t len, uint16_t *seq, uint32_t *time, uint32_t *sFreq, uint16_t *data);
+
+#if defined ESP32
+// Serial with TLMBAUD and TLMTXBUFFER
+void tlmBegin(void);
+// queue records, <0 when dropped
+int tlmSendResult(const struct sTlmResult *);
+int tlmSendRaw(uint16_t seq, uint32_t sFreq, const uint16_t *data, uint16_t len);
+// write queued bytes as far as the TX buffer has room, call once per loop
+void tlmPoll(void);
+// did the host send TLM_CMDRAW?
+bool tlmRawRequested(void);
+// number of dropped frames
+uint32_t tlmDropped(void);
+#endif
+
+#endif
@@ -47,14 +47,53 @@
 // special includes 
 #include "ADC_DataAnalysis.h"
 #include "AFrequencies.h"
+#if defined SPECTRALENGINE || defined GOERTZELREFINE || defined POLYMODE
+#include "ADC_Spectral.h"
+#endif
+#ifdef POLYMODE
+#include "ADC_Poly.h"
+#endif
+#ifdef STROBEMODE
+#include "ADC_Strobe.h"
+#endif
+#ifdef TELEMETRY
+#include "Telemetry.h"
+#endif
+#ifdef CONTOURMODE
+#include "ADC_Contour.h"
+#ifndef PITCHCONTOUR
+#error "CONTOURMODE needs PITCHCONTOUR in ADC_DataAnalysis.h"
+#endif
+#endif
+#ifdef TRACKMODE
+#include "ADC_Track.h"
+#endif
+#ifdef RATEGOVERNOR
+#include "ADC_Governor.h"
+#if defined POLYMODE || defined STROBEMODE
+#error "RATEGOVERNOR works with single notes (getFreqNoteName) only"
+#endif
+#endif
+#if defined HISTORYMODE && (defined POLYMODE || defined STROBEMODE)
+#error "HISTORYMODE works with single notes (getFreqNoteName) only, below the bar graph"
+#endif
+#include "Profiling.h"    // PROF_SCOPE is empty without PROFILING
+#ifdef GLYPHCACHE
+#include "GlyphCache.h"
+#endif
+#ifdef PALETTESPRITE
+#include "PalSprite.h"
+#endif
 
 #define I2S_NUM         (0)   // I2S channel used with ADC reading
-#define MINFREQQUALITY  (0.15f)  // set minimum value of stdev/periode
-#define MINFREQDIFF     (0.1f)  // relative difference between two frequences, resp. 10 cent
-// Tuning of 400Hz. Deviation in cent:
-#define TUNINGCENT (-12)
-// In order to improve speed: (TWELFTH_SQ2 from AFrequencies.h) Attention : -TUNINGCENT only when TUNINGCENT<0   !
-#define TUNINGFACTOR (((TWELFTH_SQ2-1.0f)*(float)(-TUNINGCENT)/100.0f) + 1.0f)
+// samples of a full frame and of one ADC read into gsAD.data
+#ifdef PACKEDSAMPLES
+#define FRAMELEN (PACKEDLEN)
+#define READLEN (PACKCHUNK)
+#else
+#define FRAMELEN (BUFF_SIZE)
+#define READLEN (BUFF_SIZE)
+#endif
 
 
 /* Structure plan
@@ -76,9 +115,67 @@ const char TAG[] = "FreqTune";
 
 TFT_eSPI tft = TFT_eSPI();         // Invoke custom library
 TFT_eSprite barGraph = TFT_eSprite(&tft);
+// what barGraph shows at present, see updateBarGraph
+struct sBarGraphState {
+  int16_t b_cent;       // length of the bar in cent
+  bool b_valid;         // false: red bar, no note name (invalid at startup)
+};
+struct sBarGraphState gBarState = {0, false};
 
 // structure to hold ADC data, parameters and results. Defined in ADC_DataAnalysis.h
 struct sADCData gsAD;
+// thresholds and limits of the analysis: defaults or TUNEDPARAMS of a header from host/param_tuner (main.h)
+struct sADCParams gParams;
+// nearest note of the last valid getFreqNoteName in signal frequency (without tuning), 0.0f if invalid
+float gNoteFreq = 0.0f;
+// reference pitch, temperament and correction of measured frequencies. Change at runtime with setTuning
+struct sTuning gTuning;
+#ifdef GLYPHCACHE
+// glyphs of note names (font 4) and scale labels (font 2), rasterised once by initGlyphCache
+struct sGlyphCache gGlyphs;
+#endif
+#ifdef PALETTESPRITE
+// 4 bit frame buffer of barGraph: span fills and the rows to push
+struct sPalSprite gPal;
+#endif
+#ifdef STROBEMODE
+// strobe tracker and its 1 bit band below the bar graph
+struct sStrobe gStrobe;
+TFT_eSprite strobeBand = TFT_eSprite(&tft);
+#endif
+#ifdef HISTORYMODE
+// one column of the pitch history, see updateHistory
+TFT_eSprite histColumn = TFT_eSprite(&tft);
+#endif
+// samples of a full frame at the present sample rate (gsAD.d_sFreq)
+uint32_t gFrameLen = FRAMELEN;
+#ifdef RATEGOVERNOR
+// lowest adequate sample rate for the note played
+struct sRateGovernor gGov;
+#endif
+#ifdef TRACKMODE
+// periode of the last green result [s] predicting the edges of the next frame, 0.0f: analyse from scratch
+float gTrackPeriode = 0.0f;
+#endif
+#ifdef CONTOURMODE
+// per periode cent values of the held note, filled by calcFreqAnalog (gsAD.d_contour)
+struct sPitchContour gContour;
+#endif
+#ifdef TELEMETRY
+// frame counter of telemetry records
+uint16_t gTlmSeq = 0;
+#endif
+#if defined SPECTRALENGINE || defined POLYMODE
+// workspace of FFT engine (4 kByte for Q15)
+spec_t gSpecWork[SPECTRALWORKLEN];
+#endif
+#ifdef POLYMODE
+// strum tuning: decimated captures, results and the instrument (german names as with AFrequencies)
+struct sPolyData gsPD;
+struct sPolyTuning gPolyTuning;
+const uint8_t gPolyNotes[] = {4, 9, 14, 19, 23, 28};   // note indices of AFrequencies (0 is deep C)
+const char *const gPolyNames[] = {"E", "A", "d", "g", "h", "e1"};
+#endif
 
 
 // =========================================================================
@@ -109,6 +206,110 @@ void showHeapInfo(void) {
   */
 } /* showHeapInfo */
 
+#ifdef GLYPHCACHE
+/*********************************************
+ * @brief Rasterises the glyphs of note names and scale labels into gGlyphs:
+ * each character into a 1 bit sprite, read back pixel by pixel. Once in setup.
+**********************************************/
+void initGlyphCache(void) {
+  static const struct {
+    uint8_t font;
+    const char *chars;
+  } sets[] = {
+    {4, "abcdefghis0123456"},   // note names c, cis .. h and range digits
+    {2, "-0125"},               // scale labels of initBarGraph
+  };
+  TFT_eSprite glyph = TFT_eSprite(&tft);
+  char str[2] = {0, 0};
+  int idx;
+  uint8_t w, h;
+
+  gcInit(&gGlyphs);
+  glyph.setColorDepth(1);
+  glyph.setTextColor(TFT_WHITE);
+  glyph.setTextDatum(TL_DATUM);
+  for(auto &set : sets) {
+    h = glyph.fontHeight(set.font);
+    for(const char *p = set.chars; *p; p++) {
+      str[0] = *p;
+      w = glyph.textWidth(str, set.font);
+      if((idx = gcAdd(&gGlyphs, *p, set.font, w, h)) < 0 || !glyph.createSprite(w, h))  {
+        ESP_LOGE(TAG, "Could not cache glyph %c of font %u", *p, set.font);
+        continue;
+      }
+      glyph.fillSprite(TFT_BLACK);
+      glyph.drawString(str, 0, 0, set.font);
+      for(uint8_t y=0; y<h; y++)
+        for(uint8_t x=0; x<w; x++)
+          if(glyph.readPixel(x, y) != TFT_BLACK)  gcSetPixel(&gGlyphs, idx, x, y);
+      glyph.deleteSprite();
+    }
+  }
+  ESP_LOGI(TAG, "Glyph cache: %u glyphs, %u bytes", gGlyphs.c_num, gGlyphs.c_used);
+} /* initGlyphCache */
+#endif
+
+// colours of barGraph: palette indices of a 4 bit sprite (also for TFT_eSPI drawing into it) or RGB565
+#ifdef PALETTESPRITE
+#define BGC_BLACK (PSBLACK)
+#define BGC_WHITE (PSWHITE)
+#define BGC_RED (PSRED)
+#define BGC_GREEN (PSGREEN)
+#define BGC_ORANGE (PSORANGE)
+#define BGC_YELLOW (PSYELLOW)
+#else
+#define BGC_BLACK (TFT_BLACK)
+#define BGC_WHITE (TFT_WHITE)
+#define BGC_RED (TFT_RED)
+#define BGC_GREEN (TFT_GREEN)
+#define BGC_ORANGE (TFT_ORANGE)
+#define BGC_YELLOW (TFT_YELLOW)
+#endif
+
+// rectangle of barGraph: spans into the 4 bit buffer or the sprite's fillRect
+static inline void bgFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint32_t color) {
+#ifdef PALETTESPRITE
+  psFillRect(&gPal, x, y, w, h, (uint8_t)color);
+#else
+  barGraph.fillRect(x, y, w, h, color);
+#endif
+}
+
+static inline void bgVLine(int16_t x, int16_t y, int16_t h, uint32_t color) {
+  bgFillRect(x, y, 1, h, color);
+}
+
+// barGraph to the display, after initBarGraph (BGX, BGY)
+static void bgPush(void);
+
+/******************************************
+ * @brief: Text into barGraph, centered at xc (as TC_DATUM). 
+ * Copied from gGlyphs, drawString only for text not cached.
+*******************************************/
+static void drawLabel(const char *text, uint8_t font, int16_t xc, int16_t y, uint16_t color) {
+#ifdef GLYPHCACHE
+  int w = gcTextWidth(&gGlyphs, text, font);
+  uint8_t *fb = (uint8_t *)barGraph.getPointer();
+
+  if(w >= 0 && fb)  {
+#ifdef PALETTESPRITE
+    gcDraw4(&gGlyphs, text, font, fb, barGraph.width(), barGraph.height(), xc - w/2, y, (uint8_t)color);
+    psMarkRows(&gPal, y, barGraph.fontHeight(font));
+#else
+    gcDraw8(&gGlyphs, text, font, fb, barGraph.width(), barGraph.height(), xc - w/2, y, barGraph.color16to8(color));
+#endif
+    return;
+  }
+#endif
+#ifdef PALETTESPRITE
+  psMarkRows(&gPal, y, barGraph.fontHeight(font));
+#endif
+  barGraph.setTextDatum(TC_DATUM);
+  barGraph.setTextColor(color);
+  barGraph.setTextFont(font);
+  barGraph.drawString(text, xc, y);
+} /* drawLabel */
+
 /*********************************************
  * @brief Inits a bar graph of size bgHight, bgWidth
  * at bgX, bgY. Main tuning display.
@@ -141,85 +342,100 @@ void initBarGraph(void) {
   pSprite = barGraph.createSprite(BGWIDTH, BGHEIGHT);
   if(!pSprite)  ESP_LOGE(TAG, "Could not create barGraph!");
    // set color depth in advance to save allocation of 16bit mem!
+#ifdef PALETTESPRITE
+  pSprite = barGraph.setColorDepth(4);  // palette indices, half the RAM of 8 bit
+  if(!pSprite)  ESP_LOGE(TAG, "Could not set ColorDepth of barGraph!");
+  barGraph.createPalette(psPalette, PSCOLORS);
+  if(psInit(&gPal, (uint8_t *)pSprite, BGWIDTH, BGHEIGHT) < 0)  ESP_LOGE(TAG, "No 4 bit buffer of barGraph!");
+#else
   pSprite = barGraph.setColorDepth(8);  // sorry for recreating/reallocating
   if(!pSprite)  ESP_LOGE(TAG, "Could not set ColorDepth of barGraph!");
-  barGraph.fillSprite(TFT_BLACK);
+#endif
+  bgFillRect(0, 0, BGWIDTH, BGHEIGHT, BGC_BLACK);
 
   // plot the markings. 0 is at center at BGCENTER, -50 at BGBARX, +50 at BGBARXE
-  barGraph.setTextDatum(TC_DATUM);
-  barGraph.setTextColor(TFT_WHITE);
-  barGraph.setTextFont(2);
-  barGraph.drawString(String("-50"), BGBARX, 0);
-  barGraph.drawFastVLine(BGBARX, 15, BGMARKH, TFT_WHITE);
-  barGraph.drawString(String("-25"), BGCENTER-52, 0);
-  barGraph.drawFastVLine(BGCENTER-50, 15, BGMARKH, TFT_WHITE);
-  barGraph.drawString(String("-10"), BGCENTER-22, 0);
-  barGraph.drawFastVLine(BGCENTER-20, 15, BGMARKH, TFT_WHITE);
-  barGraph.drawString(String("0"), BGCENTER, 0);
-  barGraph.drawFastVLine(BGCENTER, 15, 2*BGMARKH+BGBARH, TFT_WHITE);
-  barGraph.drawString(String("10"), BGCENTER+20, 0);
-  barGraph.drawFastVLine(BGCENTER+20, 15, BGMARKH, TFT_WHITE);
-  barGraph.drawString(String("25"), BGCENTER+50, 0);
-  barGraph.drawFastVLine(BGCENTER+50, 15, BGMARKH, TFT_WHITE);
-  barGraph.drawString(String("50"), BGBARXE, 0);
-  barGraph.drawFastVLine(BGBARXE, 15, BGMARKH, TFT_WHITE);
+  drawLabel("-50", 2, BGBARX, 0, BGC_WHITE);
+  bgVLine(BGBARX, 15, BGMARKH, BGC_WHITE);
+  drawLabel("-25", 2, BGCENTER-52, 0, BGC_WHITE);
+  bgVLine(BGCENTER-50, 15, BGMARKH, BGC_WHITE);
+  drawLabel("-10", 2, BGCENTER-22, 0, BGC_WHITE);
+  bgVLine(BGCENTER-20, 15, BGMARKH, BGC_WHITE);
+  drawLabel("0", 2, BGCENTER, 0, BGC_WHITE);
+  bgVLine(BGCENTER, 15, 2*BGMARKH+BGBARH, BGC_WHITE);
+  drawLabel("10", 2, BGCENTER+20, 0, BGC_WHITE);
+  bgVLine(BGCENTER+20, 15, BGMARKH, BGC_WHITE);
+  drawLabel("25", 2, BGCENTER+50, 0, BGC_WHITE);
+  bgVLine(BGCENTER+50, 15, BGMARKH, BGC_WHITE);
+  drawLabel("50", 2, BGBARXE, 0, BGC_WHITE);
+  bgVLine(BGBARXE, 15, BGMARKH, BGC_WHITE);
 
   // draw red centered bar to show "invalid"
-  barGraph.fillRect(BGBARXRED, BGBARY, BGBARW2, BGBARH, TFT_RED);
+  bgFillRect(BGBARXRED, BGBARY, BGBARW2, BGBARH, BGC_RED);
 
-  barGraph.pushSprite(BGX, BGY);
+  bgPush();
   
 } /* initBarGraph */
 
+/******************************************
+ * @brief: barGraph to the display. With PALETTESPRITE only the rows changed
+ * since the last push, nothing when unchanged. 
+*******************************************/
+static void bgPush(void) {
+#ifdef PALETTESPRITE
+  int16_t y, n = psTakeRows(&gPal, &y);
+
+  if(n > 0)  tft.pushImage(BGX, BGY + y, BGWIDTH, n, gPal.p_fb + (uint32_t)y*(BGWIDTH/2), false, (uint16_t *)psPalette);
+#else
+  barGraph.pushSprite(BGX, BGY);
+#endif
+} /* bgPush */
+
 /******************************************
  * @brief: Update tuning bar and note name
+ * @param[in,out] bs: what the bar graph shows, only changes are drawn
  * @param[in] valid: are cent and cNote valid results? 
  *            valid == false will show red bar and no note name.
  * @param[in] bGreen: green bar when true, else orange
  * @param[in] cent: 1 cent is 1% to next note
  * @param[in] cNote: a note name not longer than 4 letters!
 *******************************************/
-void updateBarGraph(bool valid, bool bGreen, int16_t cent, char *cNote)	{
-	static int16_t myCent=0;
+void updateBarGraph(struct sBarGraphState *bs, bool valid, bool bGreen, int16_t cent, char *cNote)	{
   bool bReDrawEq = false;
-  static bool gBGvalid = false;  // frequency reading is invalid at startup
-  uint32_t uColor = TFT_GREEN;
+  uint32_t uColor = BGC_GREEN;
 
   // is cent value valid?
   if(valid) {
     ESP_LOGD(TAG, "Note=%s, cent=%d", cNote, ent);
-    if(!gBGvalid)  {
+    if(!bs->b_valid)  {
       // clear the red bar
-      barGraph.fillRect(BGBARXRED, BGBARY, BGBARW2, BGBARH, TFT_BLACK);
-      gBGvalid = true;
+      bgFillRect(BGBARXRED, BGBARY, BGBARW2, BGBARH, BGC_BLACK);
+      bs->b_valid = true;
       bReDrawEq = true;
     }
   
-    if((myCent != cent) || bReDrawEq) 
+    if((bs->b_cent != cent) || bReDrawEq) 
     {
       // redraw bar
-      if(myCent<0)  barGraph.fillRect(BGBARX, BGBARY, BGBARW2, BGBARH, TFT_BLACK);
-      else barGraph.fillRect(BGCENTER+1, BGBARY, BGBARW2, BGBARH, TFT_BLACK);
+      if(bs->b_cent<0)  bgFillRect(BGBARX, BGBARY, BGBARW2, BGBARH, BGC_BLACK);
+      else bgFillRect(BGCENTER+1, BGBARY, BGBARW2, BGBARH, BGC_BLACK);
       if(cent>50) cent = 51;
       else if(cent<-50) cent = -51;
-      myCent = cent;
+      bs->b_cent = cent;
       // clear note name
-      barGraph.fillRect(BGCENTER-40, BGNOTEY, 80, 25, TFT_BLACK);
+      bgFillRect(BGCENTER-40, BGNOTEY, 80, 25, BGC_BLACK);
       // replace white VLine
-      barGraph.drawFastVLine(BGCENTER, BGBARY, BGBARH, TFT_WHITE);
+      bgVLine(BGCENTER, BGBARY, BGBARH, BGC_WHITE);
       // draw green or orange bar
-      if(!bGreen) uColor = TFT_ORANGE;
-      if(cent>0) barGraph.fillRect(BGCENTER+1, BGBARY, cent*2, BGBARH, uColor);
+      if(!bGreen) uColor = BGC_ORANGE;
+      if(cent>0) bgFillRect(BGCENTER+1, BGBARY, cent*2, BGBARH, uColor);
       else if(cent<0) {
         cent = -2*cent; // make it positive and double
-        barGraph.fillRect(BGCENTER-cent-1, BGBARY, cent, BGBARH, uColor);
+        bgFillRect(BGCENTER-cent-1, BGBARY, cent, BGBARH, uColor);
       }
       // OK, when cent==0
 
-      barGraph.setTextDatum(TC_DATUM);
-      barGraph.setTextColor(TFT_YELLOW);
-      barGraph.setTextFont(4);
-      barGraph.drawString(String(cNote), BGCENTER, BGNOTEY);
+      // note name from the glyph cache, no String on the heap
+      drawLabel(cNote, 4, BGCENTER, BGNOTEY, BGC_YELLOW);
     } // redraw
 
   } // valid
@@ -227,24 +443,333 @@ void updateBarGraph(bool valid, bool bGreen, int16_t cent, char *cNote)	{
   { // no valid results to display
     
   ESP_LOGD(TAG, "Note not valid");
-    if(gBGvalid)  
+    if(bs->b_valid)  
     { 
-      gBGvalid = false;
+      bs->b_valid = false;
       // clear all green bar
-      barGraph.fillRect(BGBARX, BGBARY, BGBARW, BGBARH, TFT_BLACK);
+      bgFillRect(BGBARX, BGBARY, BGBARW, BGBARH, BGC_BLACK);
       // display red bar
-      barGraph.fillRect(BGBARXRED, BGBARY, BGBARW2, BGBARH, TFT_RED);
+      bgFillRect(BGBARXRED, BGBARY, BGBARW2, BGBARH, BGC_RED);
       // clear note name
-      barGraph.fillRect(BGCENTER-40, BGNOTEY, 80, 25, TFT_BLACK);
+      bgFillRect(BGCENTER-40, BGNOTEY, 80, 25, BGC_BLACK);
     }
     // or still not valid
   }
 
-  barGraph.pushSprite(BGX, BGY);
+  bgPush();
 
 } /* updateBarGraph */
 
 
+#ifdef POLYMODE
+/*********************************************
+ * @brief Inits the per string display of strum tuning in barGraph.
+ * One row of PGROWH pixels per string: name, bar -50 .. +50 cent 
+ * (same scale as updateBarGraph) and cent value.
+**********************************************/
+#define PGROWH (BGHEIGHT/POLYMAXSTRINGS)  // height of a string's row
+#define PGBARH (PGROWH-6)                 // bar height within row
+
+void initPolyGraph(void) {
+  bgFillRect(0, 0, BGWIDTH, BGHEIGHT, BGC_BLACK);
+  barGraph.setTextFont(2);
+  barGraph.setTextColor(BGC_YELLOW);
+  barGraph.setTextDatum(ML_DATUM);
+  for(int s=0; s<gPolyTuning.numStrings; s++) {
+    barGraph.drawString(gPolyTuning.name[s], 4, s*PGROWH + PGROWH/2);
+    bgVLine(BGBARX, s*PGROWH+1, PGROWH-2, BGC_WHITE);
+    bgVLine(BGBARXE, s*PGROWH+1, PGROWH-2, BGC_WHITE);
+  }
+  bgPush();
+} /* initPolyGraph */
+
+/*********************************************
+ * @brief Updates all strings' rows from gsPD results.
+ *  Green bar for strings found, orange for strings sharing all their harmonics
+ *  (less reliable), small red block for strings not found.
+**********************************************/
+void updatePolyGraph(void) {
+  int16_t cent, y;
+  uint32_t uColor;
+  char cText[8];
+
+  barGraph.setTextFont(2);
+  barGraph.setTextDatum(MR_DATUM);
+  for(int s=0; s<gPolyTuning.numStrings; s++) {
+    y = s*PGROWH;
+    bgFillRect(BGBARX+1, y+3, BGBARW-2, PGBARH, BGC_BLACK);
+    bgFillRect(BGBARXE+2, y, BGWIDTH-BGBARXE-2, PGROWH, BGC_BLACK);
+    bgVLine(BGCENTER, y+1, PGROWH-2, BGC_WHITE);
+    if(!(gsPD.p_found & (1<<s))) {
+      bgFillRect(BGCENTER-10, y+3, 20, PGBARH, BGC_RED);
+      continue;
+    }
+    cent = (int16_t)roundf(gsPD.p_cent[s]);
+    if(cent>50) cent = 51;
+    else if(cent<-50) cent = -51;
+    uColor = (gPolyTuning.sharedMask & (1<<s)) ? BGC_ORANGE : BGC_GREEN;
+    if(cent>0) bgFillRect(BGCENTER+1, y+3, cent*2, PGBARH, uColor);
+    else if(cent<0) bgFillRect(BGCENTER+2*cent-1, y+3, -2*cent, PGBARH, uColor);
+    snprintf(cText, sizeof(cText), "%+d", cent);
+    barGraph.setTextColor(BGC_WHITE);
+    barGraph.drawString(cText, BGWIDTH-2, y + PGROWH/2);
+  }
+  bgPush();
+} /* updatePolyGraph */
+#endif
+
+#ifdef STROBEMODE
+/*********************************************
+ * @brief Inits the strobe band below the bar graph: 1 bit sprite 
+ * with stripes of SBPERIODPX pixels per periode of the reference.
+**********************************************/
+#define SBWIDTH (BGWIDTH)
+#define SBHEIGHT (24)
+#define SBX (BGX)
+#define SBY (BGY+BGHEIGHT+8)
+#define SBPERIODPX (40)   // pixels per periode of reference, half of it white
+
+static int32_t gSBOffset = 0;   // pattern offset in pixels of the band
+
+// is column x of the band white with pattern offset?
+static inline bool strobeStripe(int32_t x, int32_t offset) {
+  return ((uint32_t)(x - offset) % SBPERIODPX) < SBPERIODPX/2;
+}
+
+void initStrobeBand(void) {
+  void *pSprite;
+
+  strobeBand.setColorDepth(1);
+  pSprite = strobeBand.createSprite(SBWIDTH, SBHEIGHT);
+  if(!pSprite)  ESP_LOGE(TAG, "Could not create strobeBand!");
+  strobeBand.setBitmapColor(TFT_WHITE, TFT_BLACK);
+  strobeBand.fillSprite(TFT_BLACK);
+  for(int32_t x=0; x<SBWIDTH; x++)
+    if(strobeStripe(x, gSBOffset)) strobeBand.drawFastVLine(x, 0, SBHEIGHT, TFT_WHITE);
+  strobeBand.pushSprite(SBX, SBY);
+} /* initStrobeBand */
+
+/*********************************************
+ * @brief Moves the strobe pattern to the phase angle (65536 per periode).
+ * Incremental: scrolls the sprite and draws only the uncovered columns,
+ * the bar graph is not touched.
+ * @param[in] angle: unwrapped phase of signal relative to reference note, s_angle
+**********************************************/
+void updateStrobeBand(int32_t angle) {
+  int32_t offset, dx, x, x0, x1;
+
+  offset = (int32_t)(((int64_t)angle*SBPERIODPX) >> 16);
+  // move less than half a periode, as the eye does with a strobe
+  dx = (offset - gSBOffset) % SBPERIODPX;
+  if(dx >= SBPERIODPX/2) dx -= SBPERIODPX;
+  else if(dx < -SBPERIODPX/2) dx += SBPERIODPX;
+  if(!dx) return;
+  gSBOffset += dx;
+
+  strobeBand.scroll(dx, 0);
+  if(dx > 0) { x0 = 0;  x1 = dx; }
+  else { x0 = SBWIDTH + dx;  x1 = SBWIDTH; }
+  for(x=x0; x<x1; x++)
+    if(strobeStripe(x, gSBOffset)) strobeBand.drawFastVLine(x, 0, SBHEIGHT, TFT_WHITE);
+  strobeBand.pushSprite(SBX, SBY);
+} /* updateStrobeBand */
+#endif
+
+#ifdef HISTORYMODE
+/*********************************************
+ * @brief Inits the pitch history below the bar graph: cent against time,
+ * one column per result. It sweeps like a chart recorder: the column of a
+ * result is addressed as a ring (gHistX), a cursor in the next column
+ * separates newest and oldest results. Nothing is scrolled or redrawn, 
+ * so an update transfers two columns of HSHEIGHT pixels.
+ * @note The hardware scroll of the ILI9341 runs along its 320 pixel side,
+ * i.e. along x in landscape, but over all rows: it would move the bar graph, too.
+**********************************************/
+#define HSWIDTH (BGWIDTH)
+#define HSHEIGHT (49)     // odd: row HSHEIGHT/2 is 0 cent
+#define HSX (BGX)
+#define HSY (BGY+BGHEIGHT+6)
+#define HSCENTPX (1)      // cent per pixel, so +-24 cent are shown
+#define HSGRID (10)       // cent between grid rows
+
+static int16_t gHistX = 0;    // column of the next result
+static int16_t gHistY = -1;   // row of the last result, -1 after an invalid one
+
+// row of cent, clamped to the strip
+static inline int16_t histRow(int16_t cent) {
+  int16_t y = HSHEIGHT/2 - cent/HSCENTPX;
+  return (y < 0) ? 0 : ((y >= HSHEIGHT) ? HSHEIGHT-1 : y);
+}
+
+// colour of row y without a result: grid every HSGRID cent, 0 cent in dark green
+static inline uint32_t histGrid(int16_t y) {
+  if(y == HSHEIGHT/2)  return TFT_DARKGREEN;
+  return ((y - HSHEIGHT/2)*HSCENTPX % HSGRID) ? TFT_BLACK : TFT_DARKGREY;
+}
+
+void initHistory(void) {
+  void *pSprite;
+
+  pSprite = histColumn.createSprite(1, HSHEIGHT);
+  if(!pSprite)  ESP_LOGE(TAG, "Could not create histColumn!");
+  for(int16_t y=0; y<HSHEIGHT; y++)  tft.drawFastHLine(HSX, HSY + y, HSWIDTH, histGrid(y));
+  tft.drawFastVLine(HSX, HSY, HSHEIGHT, TFT_WHITE);   // cursor
+} /* initHistory */
+
+/*********************************************
+ * @brief Appends a result: a vertical segment from the row of the last 
+ * result to that of cent (a continuous trace), green or orange as the bar,
+ * red when clamped. Invalid results leave a gap.
+**********************************************/
+void updateHistory(bool valid, bool bGreen, int16_t cent) {
+  int16_t y, y0, y1;
+  uint32_t color;
+
+  for(y=0; y<HSHEIGHT; y++)  histColumn.drawPixel(0, y, histGrid(y));
+  if(valid) {
+    y = histRow(cent);
+    if(cent/HSCENTPX > HSHEIGHT/2 || cent/HSCENTPX < -HSHEIGHT/2)  color = TFT_RED;
+    else color = bGreen ? TFT_GREEN : TFT_ORANGE;
+    y0 = y1 = y;
+    if(gHistY >= 0) {
+      if(gHistY < y) y0 = gHistY;
+      else y1 = gHistY;
+    }
+    histColumn.drawFastVLine(0, y0, y1 - y0 + 1, color);
+    gHistY = y;
+  }
+  else gHistY = -1;
+  histColumn.pushSprite(HSX + gHistX, HSY);
+  if(++gHistX >= HSWIDTH)  gHistX = 0;
+  tft.drawFastVLine(HSX + gHistX, HSY, HSHEIGHT, TFT_WHITE);
+} /* updateHistory */
+#endif
+
+/**********************************************************
+ * @brief: I2S delivers the higher word first, so switch readings
+ * @param[in,out] data: ADC samples
+ * @param[in] len: number of samples, even
+***********************************************************/
+static void swapWords(uint16_t *data, uint32_t len) {
+  uint16_t mean;
+
+  for(int i=0; i<len;)  {
+    /* something wrong, mayby compiler optimization?
+    mean = (*pbo + *(++pbo))/2;
+    *(++pbn) = *pbn = mean;
+    pbn++;
+    pbo++;
+    */
+    /* mean for both. Slowly, but reliable:
+    mean = (data[i+1] + data[i])/2;
+    data[i+1] = data[i] = mean;
+    i+=2;
+    */
+    // use higher word first, so switch readings
+    mean = data[i+1];
+    data[i+1] = data[i];
+    data[i] = mean;
+    i += 2;
+  }
+} /* swapWords */
+
+#ifdef TELEMETRY
+/**********************************************************
+ * @brief: Queues the result of one getFreqNoteName frame and, when the 
+ * host requested it, the raw samples of this frame.
+ * @param len number of samples read into gsAD.data
+ * @note Only queued here, tlmPoll in loop() writes to Serial
+***********************************************************/
+static void sendTelemetry(bool bValid, bool bGreen, float cent, const char *noteName, uint32_t len) {
+  struct sTlmResult r;
+
+  memset(&r, 0, sizeof(r));
+  r.t_seq = gTlmSeq;
+  r.t_time = micros();
+  if(bValid) {
+    r.t_freq = gsAD.d_freqClassic;
+    r.t_periode = gsAD.d_periode;
+    r.t_quality = gsAD.d_quality;
+    r.t_cent = cent;
+    r.t_numPeriodes = gsAD.d_numPeriodes;
+    r.t_usedLen = (uint16_t)gsAD.d_usedLen;
+    r.t_flags = TLMVALID | (bGreen ? TLMGREEN : 0);
+    strncpy(r.t_note, noteName, 4);
+  }
+  if(tlmSendResult(&r) < 0)  ESP_LOGD(TAG, "telemetry dropped, %u frames", tlmDropped());
+#ifdef PACKEDSAMPLES
+  tlmRawRequested();    // no raw frames, gsAD.data holds the last chunk only
+#else
+  if(tlmRawRequested())  tlmSendRaw(gTlmSeq, gsAD.d_sFreq, gsAD.data, len);
+#endif
+  gTlmSeq++;
+} /* sendTelemetry */
+#endif
+
+#ifdef PROFILING
+// one line of profReport to Serial
+static void profLine(const char *line) {
+  Serial.println(line);
+} /* profLine */
+#endif
+
+#ifdef PACKEDSAMPLES
+/**********************************************************
+ * @brief: Reads len samples in chunks of PACKCHUNK into gsAD.data
+ * and packs each chunk into gsAD.pdata, while I2S runs on.
+ * So only the chunk needs DMA capable RAM.
+ * @param len: even
+ * @return number of samples read
+***********************************************************/
+static size_t capturePacked(uint32_t len) {
+  size_t retSamples, total = 0;
+  uint32_t n;
+
+  i2s_start(I2S_NUM_0);
+  while(total < len) {
+    n = len - total;
+    if(n > PACKCHUNK) n = PACKCHUNK;
+    retSamples = ADC_Sampling(gsAD.data, n);
+    if(retSamples != n) break;
+    swapWords(gsAD.data, n);
+    pack12(gsAD.data, n, gsAD.pdata, total);
+    total += n;
+  }
+  i2s_stop(I2S_NUM_0);
+  return total;
+} /* capturePacked */
+#endif
+
+#ifdef RATEGOVERNOR
+/**********************************************************
+ * @brief: Switches I2S, gsAD and the frame length to the rate of gGov
+ * @return 0, <0 if I2S could not be switched
+***********************************************************/
+static int setSampleRate(void) {
+  uint32_t rate = govRate(&gGov);
+
+  if(switch_sample_rate(rate) < 0) {
+    ESP_LOGE(TAG, "Could not switch to %u Hz", rate);
+    return -1;
+  }
+  gsAD.d_sFreq = rate;
+  gsAD.d_deltaTime = 1.0f/rate;
+  gFrameLen = govFrameLen(&gGov);
+  if(gFrameLen > FRAMELEN)  gFrameLen = FRAMELEN;
+  gsAD.d_len = gFrameLen;
+  ESP_LOGI(TAG, "Sample rate %u Hz, frames of %u samples", rate, gFrameLen);
+  return 0;
+} /* setSampleRate */
+
+/**********************************************************
+ * @brief: Next result to the governor, switches when it asks for another rate
+ * @param noteFreq: nearest note of a green result (signal domain), 0.0f else
+***********************************************************/
+static void rateGovernor(float noteFreq) {
+  if(govUpdate(&gGov, noteFreq))  setSampleRate();
+} /* rateGovernor */
+#endif
+
 /**********************************************************
  * @brief: Main routine of this app.
  * Read from ADC channel 0 into gBuf.
@@ -265,45 +790,38 @@ int getFreqNoteName() {
   int cent;
   bool bGreen=true;   // usually we display a green bar, but when quality is bad, bar will be drawn in orange
   bool bValid = true; // noteName valid
-  float freqRelDiff;
-  //uint32_t udt_a, udt_e;  // measure timing
+  float noteFreq;   // nearest note without tuning
+#ifdef GOERTZELREFINE
+  float refinedFreq;  // refined frequency without tuning
+#endif
   uint16_t max, min, mean;
-  uint32_t newLen=0;  // new usable data buffer length after oversampling
-  uint16_t *pbn, *pbo;
+  uint32_t newLen=0;  // new usable data buffer length after early termination
+#ifdef TELEMETRY
+  uint32_t readLen = gsAD.d_len;  // samples of this frame
+  float tlmCent = 0.0f;           // cent without rounding
+#endif
 
+  gNoteFreq = 0.0f;
   if(!gsAD.data) goto INVALID;
-
-    //udt_a = esp_cpu_get_ccount();
+#ifdef CONTOURMODE
+  gContour.c_frameTime = micros();    // first sample, contour points are timed from here
+#endif
+#ifdef PACKEDSAMPLES
+  if(!gsAD.pdata) goto INVALID;
+  {
+    PROF_SCOPE("capturePacked");
+    retSamples = capturePacked(gsAD.d_len);
+  }
+#else
   i2s_start(I2S_NUM_0);
-  retSamples = ADC_Sampling(gsAD.data, gsAD.d_len);
-    /*udt_e = esp_cpu_get_ccount(); 
-    if(udt_e > udt_a)   udt_e -= udt_a;
-    else udt_e += (0xFFFFFFFF - udt_a) +1;
-    Serial.printf("TIMING: ADC_Sampling %d [µs]\n", udt_e/240);
-    */
+  {
+    PROF_SCOPE("ADC_Sampling");
+    retSamples = ADC_Sampling(gsAD.data, gsAD.d_len);
+  }
   i2s_stop(I2S_NUM_0);
   
-
-  pbn = pbo = gsAD.data;
-  
-  for(int i=0; i<gsAD.d_len;)  {
-    /* something wrong, mayby compiler optimization?
-    mean = (*pbo + *(++pbo))/2;
-    *(++pbn) = *pbn = mean;
-    pbn++;
-    pbo++;
-    */
-    /* mean for both. Slowly, but reliable:
-    mean = (gsAD.data[i+1] + gsAD.data[i])/2;
-    gsAD.data[i+1] = gsAD.data[i] = mean;
-    i+=2;
-    */
-    // use higher word first, so switch readings
-    mean = gsAD.data[i+1];
-    gsAD.data[i+1] = gsAD.data[i];
-    gsAD.data[i] = mean;
-    i += 2;
-  }
+  swapWords(gsAD.data, gsAD.d_len);
+#endif
       /*
       // debug: printout data
       Serial.println("ADC buffer (300 items)");
@@ -313,105 +831,297 @@ int getFreqNoteName() {
   if(retSamples != gsAD.d_len)  goto INVALID;
 
   // prepare data analysis
-    //udt_a = esp_cpu_get_ccount();
-  peak_mean(&gsAD, &max, &min, &mean);
-    /*udt_e = esp_cpu_get_ccount(); 
-    if(udt_e > udt_a)   udt_e -= udt_a;
-    else udt_e += (0xFFFFFFFF - udt_a) +1;
-    Serial.printf("TIMING: peak_mean %d [µs]\n", udt_e/240);
+#ifdef SPARSEPEAKMEAN
+  {
+    PROF_SCOPE("peak_mean_sparse");
+    retval = peak_mean_sparse(&gsAD, &max, &min, &mean);
+  }
+  if(retval<0) goto INVALID;
+  ESP_LOGD(TAG, "peak_mean_sparse %s", retval ? "used full scan" : "estimated");
+#else
+  {
+    PROF_SCOPE("peak_mean");
+    peak_mean(&gsAD, &max, &min, &mean);
+  }
+#endif
     //Serial.printf("signal's max=%u min=%u mean=%u\n", max, min, mean);
-    */
   gsAD.d_max = max;
   gsAD.d_min = min;
   gsAD.d_mean = mean;
 
   // get frequency and periode
-    //udt_a = esp_cpu_get_ccount();
-  retval = calcFreqAnalog(&gsAD);
-    /*udt_e = esp_cpu_get_ccount(); 
-    if(udt_e > udt_a)   udt_e -= udt_a;
-    else udt_e += (0xFFFFFFFF - udt_a) +1;
-    Serial.printf("TIMING: calcFreqAnalog %d [µs]\n", udt_e/240);
-    */
+#ifdef SPECTRALENGINE
+  {
+    PROF_SCOPE("calcFreqSpectral");
+    retval = calcFreqSpectral(&gsAD, gSpecWork);
+  }
+#else
+#ifdef TRACKMODE
+  // sustained note: edges searched where the last periode predicts them, from scratch on loss of lock
+  retval = -9;
+  if(gTrackPeriode > 0.0f) {
+    PROF_SCOPE("calcFreqTrack");
+    retval = calcFreqTrack(&gsAD, gTrackPeriode);
+  }
+  if(retval == -9)
+#endif
+  {
+    PROF_SCOPE("calcFreqAnalog");
+    retval = calcFreqAnalog(&gsAD);
+  }
+#endif
   if(retval<0) {
     ESP_LOGD(TAG, "calcFreqAnalog returned code %d\n", retval);
     goto INVALID;
   }
-  ESP_LOGD(TAG, "Classic F=%7.1f[Hz](NC=%u) mean periode=%7.1f[us](Fp=%7.1f) N=%u  quality=stdev=%7.1f[us]\n", 
-      gsAD.d_freqClassic, gsAD.d_numCP, gsAD.d_periode*ONEM, 1.0f/gsAD.d_periode, gsAD.d_numPeriodes, gsAD.d_quality*ONEM);
+  ESP_LOGD(TAG, "Classic F=%7.1f[Hz](NC=%u) mean periode=%7.1f[us](Fp=%7.1f) N=%u (rejected %u) quality=stdev=%7.1f[us]\n", 
+      gsAD.d_freqClassic, gsAD.d_numCP, gsAD.d_periode*ONEM, 1.0f/gsAD.d_periode, gsAD.d_numPeriodes, gsAD.d_numRejected, gsAD.d_quality*ONEM);
+#ifdef DUALEDGE
+  ESP_LOGD(TAG, "falling edges N=%u, duty=%5.3f%s", gsAD.d_numFalling, gsAD.d_duty, ADC_DutyAsymmetric(&gsAD) ? " (asymmetric)" : "");
+#endif
   
   // in case off freq==0
   if((gsAD.d_freqClassic < FLT_MIN) || (gsAD.d_periode > gsAD.d_len))  goto INVALID;
 
-  // if quality is worse, plot orange bar
-  if(gsAD.d_quality/gsAD.d_periode > MINFREQQUALITY) bGreen = false;
+  // next read: samples consumed by calcFreqAnalog plus 50% margin (even for the word swap)
+  newLen = (gsAD.d_usedLen + gsAD.d_usedLen/2 + 1) & ~1UL;
+  if(newLen < MINREADLEN) newLen = MINREADLEN;
+  else if(newLen > gFrameLen) newLen = gFrameLen;
+  ESP_LOGD(TAG, "used %u of %u samples, next read %u", gsAD.d_usedLen, gsAD.d_len, newLen);
 
-  // if d_freqClassic and (1.0f/gsAD.d_periode) differ too much use mean value only if d_numPeriodes is large enough!
-  freqRelDiff = fabs(gsAD.d_freqClassic - (1.0f/gsAD.d_periode))/gsAD.d_freqClassic;
-  ESP_LOGD(TAG, "Frequency relative difference = %g", freqRelDiff);
-  if(freqRelDiff > MINFREQDIFF) {
-    bGreen = false;  
-    // alternative: use mean value:
-    // gsAD.d_freqClassic = (gsAD.d_freqClassic + (1.0f/gsAD.d_periode))/2.0f;
-  }
+  // if quality is worse or d_freqClassic and 1/d_periode differ too much, plot orange bar
+  if(classifyResult(&gsAD) < 1) bGreen = false;
+#ifdef TRACKMODE
+  gTrackPeriode = bGreen ? gsAD.d_periode : 0.0f;
+#endif
+  ESP_LOGD(TAG, "Frequency relative difference = %g", fabs(gsAD.d_freqClassic - (1.0f/gsAD.d_periode))/gsAD.d_freqClassic);
 
-  // Tuning for 440Hz signals. 100cent = factor TWELFTH_SQ2
-  /* 
-  if(TUNINGCENT < 0) gsAD.d_freqClassic /= (((TWELFTH_SQ2-1.0f)*(-TUNINGCENT)/100) + 1.0f);
-  if(TUNINGCENT > 0) gsAD.d_freqClassic *= (((TWELFTH_SQ2-1.0f)*(TUNINGCENT)/100) + 1.0f);
-  Tuned version :   
-  */
-  if(TUNINGCENT < 0) gsAD.d_freqClassic /= TUNINGFACTOR;
-  if(TUNINGCENT > 0) gsAD.d_freqClassic *= TUNINGFACTOR;
+  // correction of measured frequencies (CORRECTCENT), factor precalculated by setTuning
+  gsAD.d_freqClassic *= gTuning.t_corrFactor;
 
   ESP_LOGD(TAG, "Freq after tuning=%7.1f[Hz]", gsAD.d_freqClassic);
 
   // find note name and cent difference
-    //udt_a = esp_cpu_get_ccount(); 
-  retval = findNearestNoteDiff(gsAD.d_freqClassic, noteName, &cent);
-    /*
-    udt_e = esp_cpu_get_ccount(); 
-    if(udt_e > udt_a)   udt_e -= udt_a;
-    else udt_e += (0xFFFFFFFF - udt_a) +1;
-    Serial.printf("TIMING: findNearestNoteDiff %d [µs]\n", udt_e/240);
-    */
-  if(retval < -50) bValid = false;
+  {
+    PROF_SCOPE("findNoteDiff");
+    retval = findNoteDiff(&gTuning, gsAD.d_freqClassic, noteName, &cent);
+  }
+  // no note: full length for the next read and no tracking, as for other invalid results
+  if(retval < -50)  goto INVALID;
+#ifdef TELEMETRY
+  tlmCent = (float)cent;
+#endif
+
+  // nearest note in frequencies of the signal, i.e. without tuning
+  noteFreq = findNoteFreq(&gTuning, gsAD.d_freqClassic);
+  if(bValid && noteFreq > 0.0f) {
+    noteFreq *= gTuning.t_signalFactor;
+    gNoteFreq = noteFreq;
+#ifdef CONTOURMODE
+    // new note: contour against its frequency, else vibrato and drift of the held note
+    if(gContour.c_refFreq != noteFreq)  contourSetRef(&gContour, noteFreq);
+    else {
+      struct sContourStats st;
+      retval = contourStats(&gContour, 0, &st);
+      if(retval >= 0)  ESP_LOGD(TAG, "Contour %u points in %5.2f[s]: mean=%5.1f drift=%5.1f[cent/s] vibrato %4.1f[Hz] +-%4.1f[cent]",
+          st.s_num, st.s_span, st.s_meanCent, st.s_drift, st.s_vibRate, st.s_vibDepth);
+    }
+#endif
+#ifdef GOERTZELREFINE
+    // cent from Goertzel bank around the note instead of edge timing, same frame (d_len not yet changed)
+    {
+      PROF_SCOPE("refineFreqGoertzel");
+      retval = refineFreqGoertzel(&gsAD, noteFreq, &refinedFreq);
+    }
+    if(retval >= 0) {
+      ESP_LOGD(TAG, "Goertzel refined cent=%5.2f (edge cent=%d)", 1200.0f*log2f(refinedFreq/noteFreq), cent);
+      cent = (int)roundf(1200.0f*log2f(refinedFreq/noteFreq));
+#ifdef TELEMETRY
+      tlmCent = 1200.0f*log2f(refinedFreq/noteFreq);
+#endif
+    }
+#endif
+  }
+  gsAD.d_len = newLen;
 
 UPDATEGRAPH:
 
   // update bar grap / sprite
-    //udt_a = esp_cpu_get_ccount(); 
-  updateBarGraph(bValid, bGreen, cent, noteName);
-    /*udt_e = esp_cpu_get_ccount(); 
-    if(udt_e > udt_a)   udt_e -= udt_a;
-    else udt_e += (0xFFFFFFFF - udt_a) +1;
-    Serial.printf("TIMING: updateBarGraph %d [µs]\n", udt_e/240);
-    */
+  {
+    PROF_SCOPE("updateBarGraph");
+    updateBarGraph(&gBarState, bValid, bGreen, cent, noteName);
+  }
+#ifdef HISTORYMODE
+  {
+    PROF_SCOPE("updateHistory");
+    updateHistory(bValid, bGreen, cent);
+  }
+#endif
+#ifdef TELEMETRY
+  sendTelemetry(bValid, bGreen, tlmCent, noteName, readLen);
+#endif
+#ifdef RATEGOVERNOR
+  // after the telemetry of this frame, which was read at the old rate
+  rateGovernor((bValid && bGreen) ? gNoteFreq : 0.0f);
+#endif
   return 0;
 
 INVALID:
   bValid = false;
+#ifdef TRACKMODE
+  gTrackPeriode = 0.0f;
+#endif
+  gsAD.d_len = gFrameLen;    // new note may need the full buffer
   goto UPDATEGRAPH;
 
 } /* getFreqNoteName */
 
 
+#ifdef POLYMODE
+/**********************************************************
+ * @brief: Strum tuning. Reads consecutive captures until POLYLEN 
+ * decimated samples are accumulated, finds all strings of gPolyTuning
+ * and updates their rows in the display.
+ * @return <0 for errors (display not updated), else number of strings found
+ * @note with 30000Hz one evaluation reads 8192 samples (0.27s)
+***********************************************************/
+int getPolyNoteNames() {
+  size_t retSamples;
+  int retval;
+
+  if(!gsAD.data || !gsPD.data) return -4;
+  polyReset(&gsPD, SAMPLERATE);
+
+  // I2S runs on between the captures, so the decimated data stays continuous
+  i2s_start(I2S_NUM_0);
+  do {
+    retSamples = ADC_Sampling(gsAD.data, READLEN);
+    if(retSamples != READLEN) {
+      i2s_stop(I2S_NUM_0);
+      return -1;
+    }
+    swapWords(gsAD.data, READLEN);
+    retval = polyAccumulate(&gsPD, gsAD.data, READLEN);
+  } while(retval == 0);
+  i2s_stop(I2S_NUM_0);
+  if(retval < 0) return retval;
+
+  retval = calcFreqPoly(&gsPD, &gPolyTuning, gSpecWork);
+  ESP_LOGD(TAG, "calcFreqPoly found %d strings (mask 0x%02x)", retval, gsPD.p_found);
+  if(retval < 0) return retval;
+  updatePolyGraph();
+  return retval;
+
+} /* getPolyNoteNames */
+#endif
+
+#ifdef STROBEMODE
+/**********************************************************
+ * @brief: Strobe mode. Locks to the note found by getFreqNoteName 
+ * (also updating the bar graph) every STROBEREDETECT frames, in between 
+ * reads SAMPLERATE/STROBEFPS samples per call with I2S running on, 
+ * tracks their phase and moves the strobe band. The blocking read paces the frames.
+ * @return <0 for errors, 0 when no note is locked, 1 for a strobe frame
+***********************************************************/
+#define STROBEFPS (60)
+#define STROBEREDETECT (2*STROBEFPS)   // frames between note detections
+#define STROBEBLOCK ((SAMPLERATE/STROBEFPS) & ~1UL)    // even for the word swap
+#if STROBEBLOCK > READLEN
+#error "STROBEBLOCK does not fit into gsAD.data, increase PACKCHUNK"
+#endif
+
+int getStrobePhase() {
+  static uint32_t frameCount = 0;
+  static bool bLocked = false;
+  size_t retSamples;
+  int retval;
+
+  if(!bLocked || frameCount >= STROBEREDETECT) {
+    getFreqNoteName();
+    frameCount = 0;
+    bLocked = (gNoteFreq > 0.0f) && (strobeSetNote(&gStrobe, gNoteFreq, SAMPLERATE) >= 0);
+    if(!bLocked) return 0;
+    ESP_LOGD(TAG, "Strobe locked to %7.2f[Hz]", gNoteFreq);
+    i2s_start(I2S_NUM_0);
+  }
+
+  retSamples = ADC_Sampling(gsAD.data, STROBEBLOCK);
+  if(retSamples == STROBEBLOCK) {
+    swapWords(gsAD.data, STROBEBLOCK);
+    retval = strobeProcess(&gStrobe, gsAD.data, STROBEBLOCK, gsAD.d_mean);
+  }
+  else retval = -1;
+  if(retval <= 0) {
+    // signal lost, detect again
+    i2s_stop(I2S_NUM_0);
+    bLocked = false;
+    return retval;
+  }
+  updateStrobeBand(gStrobe.s_angle);
+  if(++frameCount >= STROBEREDETECT) {
+    ESP_LOGD(TAG, "Strobe cent=%5.2f level=%u", gStrobe.s_cent, gStrobe.s_level);
+    i2s_stop(I2S_NUM_0);
+  }
+  return 1;
+
+} /* getStrobePhase */
+#endif
+
 void setup(void) 
 {
   tft.init();
   tft.setRotation(3);   // using landscape
+#ifdef TELEMETRY
+  tlmBegin();           // binary frames and debug output with TLMBAUD
+#else
   Serial.begin(115200); // For debug
+#endif
   delay(100);
   //Serial.println("Booting...");
   
   //showHeapInfo();
 
   // setup ADC buffer
-  gsAD.data = (uint16_t *)heap_caps_malloc(BUFF_SIZE*sizeof(uint16_t), MALLOC_CAP_DMA);
+  gsAD.data = (uint16_t *)heap_caps_malloc(READLEN*sizeof(uint16_t), MALLOC_CAP_DMA);
   if(!gsAD.data)  ESP_LOGE(TAG,"Could not allocate ADC buffer!");
-  gsAD.d_len = BUFF_SIZE; 
+#ifdef PACKEDSAMPLES
+  // frame of packed 12 bit samples, filled by the CPU: no DMA capable RAM needed
+  gsAD.pdata = (uint8_t *)malloc(PACKED12BYTES(PACKEDLEN));
+  if(!gsAD.pdata)  ESP_LOGE(TAG,"Could not allocate packed buffer!");
+#endif
+  gsAD.d_len = FRAMELEN; 
   gsAD.d_sFreq = SAMPLERATE;  // [Hz]
   gsAD.d_deltaTime = 1.0f/SAMPLERATE;   // [s] !!
+  gsAD.d_targetCent = TARGETCENT;
+#ifdef TUNEDPARAMS
+  const struct sADCParams tuned = TUNEDPARAMS;
+  gParams = tuned;
+  if(ADC_ParamsCheck(&gParams) < 0)  {
+    ESP_LOGE(TAG,"Invalid TUNEDPARAMS of %s!", TUNEDPROFILE);
+    ADC_ParamsDefault(&gParams);
+  }
+#else
+  ADC_ParamsDefault(&gParams);
+#endif
+  gsAD.d_params = &gParams;
+#ifdef CONTOURMODE
+  contourSetRef(&gContour, 0.0f);
+  gsAD.d_contour = &gContour;
+#else
+  gsAD.d_contour = NULL;
+#endif
+
+  // note table of reference pitch and temperament
+  tuningDefaults(&gTuning);
+  gTuning.t_refA = REFPITCH;
+  gTuning.t_temperament = TEMPERAMENT;
+  gTuning.t_correctCent = CORRECTCENT;
+  if(setTuning(&gTuning) < 0) {
+    ESP_LOGE(TAG,"Invalid tuning, using 440Hz equal temperament!");
+    tuningDefaults(&gTuning);
+    setTuning(&gTuning);
+  }
+  setDefaultTuning(&gTuning);
 
   tft.fillScreen(TFT_NAVY);
   tft.setTextDatum(TC_DATUM);
@@ -419,10 +1129,44 @@ void setup(void)
   tft.setTextFont(4);
   tft.drawString(String("Frequency Tuner"), TFT_HEIGHT/2, 15);
 
+#ifdef POLYMODE
+  // strum tuning: decimated buffer and string targets from gTuning in signal frequencies
+  gsPD.data = (uint16_t *)malloc(POLYLEN*sizeof(uint16_t));
+  if(!gsPD.data)  ESP_LOGE(TAG,"Could not allocate poly buffer!");
+  {
+    float polyFreq[POLYMAXSTRINGS];
+    uint8_t num = sizeof(gPolyNotes)/sizeof(gPolyNotes[0]);
+    for(int s=0; s<num; s++)
+      polyFreq[s] = gTuning.t_noteFreq[gPolyNotes[s]]*gTuning.t_signalFactor;
+    if(polySetTuning(&gPolyTuning, polyFreq, gPolyNames, num) < 0)  ESP_LOGE(TAG,"Invalid poly tuning!");
+  }
+#endif
+
+#ifdef GLYPHCACHE
+  initGlyphCache();     // before the first label of initBarGraph
+#endif
   initBarGraph();
+#ifdef POLYMODE
+  initPolyGraph();
+#endif
+#ifdef STROBEMODE
+  initStrobeBand();
+#endif
+#ifdef HISTORYMODE
+  initHistory();
+#endif
 
   // setup I2S for ADC-DMA mode
   configure_i2s(SAMPLERATE, ADC_CHANNEL);    // call own i2s.cpp
+#ifdef RATEGOVERNOR
+  // rates from GOVRATES, frames of the duration of FRAMELEN at SAMPLERATE. Starts at the highest
+  {
+    const uint32_t rates[] = GOVRATES;
+    if(govInit(&gGov, rates, sizeof(rates)/sizeof(rates[0]), TARGETCENT > 0.0f ? TARGETCENT : 1.0f, (float)FRAMELEN/SAMPLERATE) < 0)
+      ESP_LOGE(TAG, "No rate of GOVRATES is adequate!");
+    else if(govRate(&gGov) != SAMPLERATE)  setSampleRate();
+  }
+#endif
   
   // getFreqNoteName();     // one run just for testing
 
@@ -436,7 +1180,25 @@ void loop()
   
   
     //if(millis() > updT) {
+    {
+      PROF_SCOPE("frame");
+#ifdef POLYMODE
+      getPolyNoteNames();
+#elif defined STROBEMODE
+      getStrobePhase();
+#else
   	  getFreqNoteName();
+#endif
+    }
+#ifdef TELEMETRY
+      tlmPoll();
+#endif
+#ifdef PROFILING
+      if(millis() - updateTime >= PROFREPORTMS) {
+        profReport(profLine);
+        updateTime = millis();
+      }
+#endif
     //  updT = millis() + uTime;
     //}
   } 	/* loop */
@@ -2,7 +2,13 @@
  * main.h
 ***************************/
 
+// Constants tuned by host/param_tuner for an instrument profile: SAMPLERATE, BUFF_SIZE, TARGETCENT
+// and TUNEDPARAMS of the analysis (struct sADCParams). Without such a header the defaults below are used.
+//#include "tuned_guitar.h"
+
+#ifndef SAMPLERATE
 #define SAMPLERATE (30000)  // sample rate in Hz as suggested in ADC_DataAnalysis.h
+#endif
 //#define DEBUG_BUF           // DEBUG_BUF : stand alone routine that gives raw ADC data to console
 
 // Width and height of TFT screen // redundand, may be read from TFT object
@@ -10,10 +16,43 @@
 #define HEIGHT (240)
 #define HEIGHT1 (HEIGHT - 1)
 
+#ifndef BUFF_SIZE
 #define BUFF_SIZE (2000)    // as suggested in ADC_DataAnalysis.h
+#endif
+#ifndef TARGETCENT
+#define TARGETCENT (1.0f)  // stop analysis, when the estimated error of mean periode is below 1 cent. 0.0f scans all of BUFF_SIZE
+#endif
+#define MINREADLEN (BUFF_SIZE/8)  // shortest ADC read after early termination
+//#define PACKEDSAMPLES     // frames of packed 12 bit samples (pack12): PACKEDLEN samples, DMA buffer of PACKCHUNK only
+#define PACKEDLEN ((BUFF_SIZE*4/3) & ~1UL)  // samples packed into the RAM of BUFF_SIZE uint16_t (2666)
+#define PACKCHUNK (512)     // samples per ADC read with PACKEDSAMPLES, at least SAMPLERATE/STROBEFPS
+//#define SPECTRALENGINE    // FFT based calcFreqSpectral (ADC_Spectral.h) instead of edge counting calcFreqAnalog
+#define SPARSEPEAKMEAN      // thresholds from a subsample (peak_mean_sparse) instead of a full peak_mean pass
+#define GOERTZELREFINE      // cent value from a Goertzel bank around the detected note (refineFreqGoertzel)
+#define GLYPHCACHE          // note names and scale labels copied from pre-rasterised glyphs (GlyphCache.h) instead of drawString
+//#define PALETTESPRITE     // barGraph as 4 bit palette sprite (PalSprite.h): half the RAM of 8 bit, only changed rows pushed
+//#define POLYMODE          // strum tuning of all strings of an instrument (ADC_Poly.h) instead of single notes
+//#define STROBEMODE        // strobe band locked to the detected note at 60 frames/s (ADC_Strobe.h)
+//#define HISTORYMODE       // pitch history below the bar graph: cent against time, one column per result, single notes only
+//#define TRACKMODE         // sustained notes: edges searched where the last periode predicts them (ADC_Track.h), calcFreqAnalog on loss of lock
+//#define CONTOURMODE       // pitch contour per periode (ADC_Contour.h, PITCHCONTOUR in ADC_DataAnalysis.h), vibrato and drift of the held note logged
+//#define RATEGOVERNOR      // lowest adequate sample rate of GOVRATES for the note played (ADC_Governor.h), single notes only
+#define GOVRATES {12000, 16000, 20000, 24000, SAMPLERATE}   // [Hz], at most SAMPLERATE: frames keep the duration of FRAMELEN at SAMPLERATE
+//#define TELEMETRY         // binary result and raw frames over serial (Telemetry.h), switches to TLMBAUD
+//#define PROFILING         // stage timers (PROF_SCOPE, Profiling.h) with a report on Serial every PROFREPORTMS
+#define PROFREPORTMS (10000)
+
+// defaults of gTuning, may be changed at runtime by setTuning (AFrequencies.h)
+#define REFPITCH (440.0f)       // a1 [Hz]
+#define TEMPERAMENT (TEMP_EQUAL)
+#define CORRECTCENT (-12.0f)    // 440Hz signals read +12 cent, see freq_tune.cpp
 
 #define ADC_CHANNEL   (0)  // 0 == GPIO36
 #define ONEM (1000000)      // 1 Mio
 
 // main routine 
 int getFreqNoteName(void);
+// main routine in POLYMODE
+int getPolyNoteNames(void);
+// main routine in STROBEMODE
+int getStrobePhase(void);